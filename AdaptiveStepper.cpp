@@ -0,0 +1,361 @@
+#include <math.h>
+#include <vector>
+#include <functional>
+
+#include "AdaptiveStepper.h"
+#include "Cloth.h"
+
+
+//****************************************************
+// Adaptive Stepper Class - Constants
+//****************************************************
+
+// Ladder: four rungs per halving of the timestep
+const int RUNGS_PER_HALVING = 4;
+const float RUNG_FRACTION[RUNGS_PER_HALVING] = { 1.0f, 0.8408964f, 0.7071068f, 0.5946036f };
+
+// A retry whose error is over this fraction of the last try's did not respond to the smaller step
+const float SHRINK_RESPONSE = 0.75f;
+
+// Accepted steps in a row under half of both limits before the timestep grows, at first
+const int GROW_AFTER = 8;
+const int MAX_GROW_AFTER = 128;
+
+// Steps a larger timestep must pass before it is kept
+const int TRIAL_STEPS = 8;
+
+const float DEFAULT_MAX_STEP = 0.04f;
+const float DEFAULT_MIN_STEP = 0.0001f;
+const float DEFAULT_MAX_STRAIN = 0.01f;
+const float DEFAULT_MAX_CFL = 0.5f;
+
+// Particles & springs measured per block
+const int MEASURE_BLOCK = 256;
+
+//****************************************************
+// Adaptive Stepper - Constructors
+//****************************************************
+AdaptiveStepper::AdaptiveStepper(Simulation* s) {
+    simulation = s;
+
+    maxStep = DEFAULT_MAX_STEP;
+    minStep = DEFAULT_MIN_STEP;
+    maxStrain = DEFAULT_MAX_STRAIN;
+    maxCFL = DEFAULT_MAX_CFL;
+
+    savedTime = 0.0;
+    trustedTime = 0.0;
+
+    reset(DEFAULT_MAX_STEP);
+}
+
+void AdaptiveStepper::reset(float initialStep) {
+    rung = 0;
+    while(rungStep(rung + 1) >= minStep && rungStep(rung) > initialStep) {
+        rung++;
+    }
+
+    calmSteps = 0;
+    growAfter = GROW_AFTER;
+    trial = false;
+    trialRung = rung;
+    trialSteps = 0;
+    trialTime = 0.0;
+    lastStep = 0.0f;
+    owed = 0.0;
+
+    acceptedSteps = 0;
+    rejectedSteps = 0;
+    smallestStep = 0.0f;
+    largestStep = 0.0f;
+    lastStrain = 0.0f;
+    lastCFL = 0.0f;
+}
+
+void AdaptiveStepper::setStepRange(float minimum, float maximum) {
+    float current = getStep();
+
+    maxStep = maximum;
+    minStep = (minimum < maximum) ? minimum : maximum;
+
+    reset(current);
+}
+
+// Exact on every machine: a fixed fraction scaled by a power of two
+float AdaptiveStepper::rungStep(int r) {
+    return ldexpf(maxStep * RUNG_FRACTION[r % RUNGS_PER_HALVING], -(r / RUNGS_PER_HALVING));
+}
+
+//****************************************************
+// Advance:
+//      - Takes steps until the time owed is paid; the
+//        last may overshoot, and the overshoot is
+//        owed back by the next call. A trial rolled
+//        back owes its time again.
+//****************************************************
+int AdaptiveStepper::advance(double duration) {
+    if(simulation->getCloth() == NULL) {
+        return 0;
+    }
+
+    owed += duration;
+
+    long before = acceptedSteps;
+    while(owed > 0.5 * minStep) {
+        owed -= step();
+    }
+
+    return (int) (acceptedSteps - before);
+}
+
+//****************************************************
+// Step:
+//      - Saves the particles, steps, and measures. Over
+//        a limit the particles are restored and the
+//        step retried at half the timestep, until it
+//        passes or the smallest step is reached, which
+//        is accepted whatever it measures
+//      - Growing starts a trial: the particles are
+//        kept as they were, and if any of the next
+//        TRIAL_STEPS fails the whole trial is undone
+//        and the old timestep kept. An instability
+//        the larger step started can take a few steps
+//        to show, by when one step back is too late.
+//        Each failed trial doubles the calm steps the
+//        next one waits for.
+//      - Returns the time simulated, negative when a
+//        trial was undone
+//****************************************************
+double AdaptiveStepper::step() {
+    Cloth* cloth = simulation->getCloth();
+    ParticleStore* p = cloth->getParticles();
+
+    saved.copyFrom(*p);
+    savedTime = simulation->getTime();
+
+    int lowestRung = 0;
+    while(rungStep(lowestRung + 1) >= minStep) {
+        lowestRung++;
+    }
+
+    float h;
+    float strain;
+    float cfl;
+    float lastError = HUGE_VALF;
+
+    while(true) {
+        h = rungStep(rung);
+
+        // Position Verlet keeps velocity as x - x_prev, which must be rescaled to the new step
+        if(cloth->getIntegrator() == VERLET && lastStep > 0.0f && h != lastStep) {
+            rescalePrevious(p, h / lastStep);
+        }
+
+        simulation->step(h);
+        measure(p, strain, cfl);
+
+        // Error over 1 fails; NaN measures as infinity
+        float error = strain / maxStrain;
+        if(cfl / maxCFL > error) {
+            error = cfl / maxCFL;
+        }
+
+        // A spike that did not shrink with the step (a collision, a constraint) is not the step's fault
+        if(error <= 1.0f || error > SHRINK_RESPONSE * lastError || rung >= lowestRung) {
+            break;
+        }
+
+        calmSteps = 0;
+
+        if(trial) {
+            p->copyFrom(trusted);
+            simulation->setTime(trustedTime);
+            cloth->onParticlesRestored();
+
+            acceptedSteps -= trialSteps;
+            rejectedSteps += trialSteps + 1;
+
+            rung = trialRung;
+            lastStep = rungStep(trialRung);
+            trial = false;
+
+            if(growAfter < MAX_GROW_AFTER) {
+                growAfter *= 2;
+            }
+
+            return -trialTime;
+        }
+
+        lastError = error;
+
+        p->copyFrom(saved);
+        simulation->setTime(savedTime);
+        cloth->onParticlesRestored();
+        rejectedSteps++;
+
+        rung += RUNGS_PER_HALVING;
+        if(rung > lowestRung) {
+            rung = lowestRung;
+        }
+    }
+
+    acceptedSteps++;
+    lastStep = h;
+    lastStrain = strain;
+    lastCFL = cfl;
+
+    if(acceptedSteps == 1 || h < smallestStep) {
+        smallestStep = h;
+    }
+    if(h > largestStep) {
+        largestStep = h;
+    }
+
+    if(trial) {
+        trialSteps++;
+        trialTime += h;
+
+        if(trialSteps >= TRIAL_STEPS) {
+            trial = false;
+            growAfter = GROW_AFTER;
+        }
+    }
+
+    if(strain < 0.5f * maxStrain && cfl < 0.5f * maxCFL) {
+        calmSteps++;
+
+        if(calmSteps >= growAfter && rung > 0 && !trial) {
+            trusted.copyFrom(*p);
+            trustedTime = simulation->getTime();
+
+            trial = true;
+            trialRung = rung;
+            trialSteps = 0;
+            trialTime = 0.0;
+
+            rung--;
+            calmSteps = 0;
+        }
+    } else {
+        calmSteps = 0;
+    }
+
+    return h;
+}
+
+void AdaptiveStepper::rescalePrevious(ParticleStore* p, float ratio) {
+    for(int i = 0; i < p->size(); i++) {
+        if(!p->isFixed(i)) {
+            p->ox[i] = p->px[i] - (p->px[i] - p->ox[i]) * ratio;
+            p->oy[i] = p->py[i] - (p->py[i] - p->oy[i]) * ratio;
+            p->oz[i] = p->pz[i] - (p->pz[i] - p->oz[i]) * ratio;
+        }
+    }
+}
+
+//****************************************************
+// Measure:
+//      - strain: largest change of a stretch spring's
+//        strain l / L over the step
+//      - cfl: largest move since the saved particles,
+//        over the shortest stretch rest length
+//      - Blocks of MEASURE_BLOCK each keep their own
+//        maximum, so the pass splits across the
+//        Cloth's threads; a NaN anywhere gives infinity
+//****************************************************
+static void keepLarger(float& best, float value) {
+    if(!(value <= best)) {
+        best = (value == value) ? value : HUGE_VALF;
+    }
+}
+
+void AdaptiveStepper::measure(ParticleStore* p, float& strain, float& cfl) {
+    Cloth* cloth = simulation->getCloth();
+    ThreadPool* pool = cloth->isParallel() ? cloth->getThreadPool() : NULL;
+
+    SpringSpan stretch = cloth->getStretchSprings();
+
+    int vertexBlocks = (p->size() + MEASURE_BLOCK - 1) / MEASURE_BLOCK;
+    int springBlocks = (stretch.count + MEASURE_BLOCK - 1) / MEASURE_BLOCK;
+
+    // Per block: largest move squared, largest strain, shortest rest length
+    partials.assign(vertexBlocks + 2 * springBlocks, 0.0f);
+    float* moves = partials.data();
+    float* strains = moves + vertexBlocks;
+    float* rests = strains + springBlocks;
+
+    const ParticleStore* before = &saved;
+    std::function<void(int, int)> vertexBody = [p, before, moves](int blockBegin, int blockEnd) {
+        for(int b = blockBegin; b < blockEnd; b++) {
+            int end = (b + 1) * MEASURE_BLOCK < p->size() ? (b + 1) * MEASURE_BLOCK : p->size();
+            float best = 0.0f;
+
+            for(int i = b * MEASURE_BLOCK; i < end; i++) {
+                float dx = p->px[i] - before->px[i];
+                float dy = p->py[i] - before->py[i];
+                float dz = p->pz[i] - before->pz[i];
+
+                keepLarger(best, dx * dx + dy * dy + dz * dz);
+            }
+
+            moves[b] = best;
+        }
+    };
+
+    std::function<void(int, int)> springBody = [p, before, stretch, strains, rests](int blockBegin, int blockEnd) {
+        for(int b = blockBegin; b < blockEnd; b++) {
+            int end = (b + 1) * MEASURE_BLOCK < stretch.count ? (b + 1) * MEASURE_BLOCK : stretch.count;
+            float best = 0.0f;
+            float shortest = HUGE_VALF;
+
+            for(int s = b * MEASURE_BLOCK; s < end; s++) {
+                int a = stretch.i0[s];
+                int c = stretch.i1[s];
+
+                float dx = p->px[a] - p->px[c];
+                float dy = p->py[a] - p->py[c];
+                float dz = p->pz[a] - p->pz[c];
+
+                float ox = before->px[a] - before->px[c];
+                float oy = before->py[a] - before->py[c];
+                float oz = before->pz[a] - before->pz[c];
+
+                float rest = stretch.restLength[s];
+                float change = sqrtf(dx * dx + dy * dy + dz * dz) - sqrtf(ox * ox + oy * oy + oz * oz);
+                keepLarger(best, fabsf(change) / rest);
+
+                if(rest < shortest) {
+                    shortest = rest;
+                }
+            }
+
+            strains[b] = best;
+            rests[b] = shortest;
+        }
+    };
+
+    if(pool == NULL) {
+        vertexBody(0, vertexBlocks);
+        springBody(0, springBlocks);
+    } else {
+        pool->parallelFor(0, vertexBlocks, vertexBody);
+        pool->parallelFor(0, springBlocks, springBody);
+    }
+
+    float move = 0.0f;
+    for(int b = 0; b < vertexBlocks; b++) {
+        keepLarger(move, moves[b]);
+    }
+
+    strain = 0.0f;
+    float shortest = HUGE_VALF;
+    for(int b = 0; b < springBlocks; b++) {
+        keepLarger(strain, strains[b]);
+
+        if(rests[b] < shortest) {
+            shortest = rests[b];
+        }
+    }
+
+    cfl = (springBlocks > 0) ? sqrtf(move) / shortest : 0.0f;
+}
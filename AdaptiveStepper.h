@@ -0,0 +1,120 @@
+#ifndef ADAPTIVESTEPPER_H
+#define ADAPTIVESTEPPER_H
+
+#include <vector>
+#include "ParticleStore.h"
+#include "Simulation.h"
+
+//****************************************************
+// Adaptive Stepper Header Definition
+//      - Advances a Simulation by a duration in
+//        timesteps it picks itself, instead of one
+//        hand picked step that must be safe for the
+//        whole run
+//      - After every step it measures how far the
+//        strain l / L of any stretch spring changed
+//        and the largest particle move in rest
+//        lengths (the CFL number). A step over either
+//        limit, or one that left a NaN, is rolled back
+//        to a saved copy of the particles and retried
+//        at half the timestep
+//      - A retry that measures nearly as badly was not
+//        the timestep's fault (a collision or a
+//        constraint moved the particles) and is kept
+//      - After GROW_AFTER steps in a row under half
+//        of both limits the timestep grows one rung,
+//        on trial: a failure within the next few steps
+//        undoes them all, back to the smaller step
+//      - Timesteps come from a fixed ladder,
+//          maxStep * 2^(-rung / 4)
+//        so a run only ever uses a few distinct steps
+//        (solvers that factor per timestep refactor
+//        rarely) and they are the same on any machine
+//      - advance carries any overshoot to the next
+//        call, so the sequence of steps never depends
+//        on how the time was split between calls
+//****************************************************
+
+class AdaptiveStepper {
+  private:
+    Simulation* simulation;     // Not owned
+
+    // Particles before the step being tried, and before the timestep last grew
+    ParticleStore saved;
+    ParticleStore trusted;
+    double savedTime;
+    double trustedTime;
+
+    // Ladder
+    float maxStep;
+    float minStep;
+    int rung;
+    int calmSteps;              // Accepted in a row under half of both limits
+    int growAfter;              // Calm steps needed to grow, doubled by every failed trial
+
+    // A grown timestep on trial, undone back to trusted if it fails within TRIAL_STEPS
+    bool trial;
+    int trialRung;
+    int trialSteps;
+    double trialTime;
+
+    // Limits
+    float maxStrain;
+    float maxCFL;
+
+    // Timestep the particles' previous positions were taken with (Verlet)
+    float lastStep;
+
+    // Simulated time still owed to advance, negative when a step overshot
+    double owed;
+
+    // Block maxima, so measuring splits across threads without sharing a write
+    std::vector<float> partials;
+
+    // Stats since the last reset
+    long acceptedSteps;
+    long rejectedSteps;
+    float smallestStep;
+    float largestStep;
+    float lastStrain;
+    float lastCFL;
+
+    float rungStep(int r);
+
+    // One accepted step, rolling back & retrying as needed; returns the time simulated
+    double step();
+
+    void rescalePrevious(ParticleStore* p, float ratio);
+    void measure(ParticleStore* p, float& strain, float& cfl);
+
+  public:
+    AdaptiveStepper(Simulation* s);
+
+    // Forgets the owed time & stats, the next step is the ladder's largest at or below initialStep
+    void reset(float initialStep);
+
+    // Steps until duration more has been simulated; returns the steps accepted
+    int advance(double duration);
+
+    // Settings
+    void setStepRange(float minimum, float maximum);
+    float getMaxStep() { return maxStep; };
+    float getMinStep() { return minStep; };
+    void setMaxStrain(float s) { maxStrain = s; };
+    float getMaxStrain() { return maxStrain; };
+    void setMaxCFL(float c) { maxCFL = c; };
+    float getMaxCFL() { return maxCFL; };
+
+    // Timestep the next step will try
+    float getStep() { return rungStep(rung); };
+
+    // Stats
+    long getAcceptedSteps() { return acceptedSteps; };
+    long getRejectedSteps() { return rejectedSteps; };
+    float getSmallestStep() { return smallestStep; };
+    float getLargestStep() { return largestStep; };
+    float getLastStrain() { return lastStrain; };
+    float getLastCFL() { return lastCFL; };
+};
+
+#endif
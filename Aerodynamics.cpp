@@ -0,0 +1,188 @@
+#include <math.h>
+#include <float.h>
+#include <functional>
+#include "glm/glm.hpp"
+
+#include "Aerodynamics.h"
+
+//****************************************************
+// Aerodynamics Class - Constants
+//****************************************************
+
+// The scenes' cloths weigh 25 kg/m^2 on stiff springs and settle only under heavy air: the old
+// drag scaled velocity by 1 / 0.021, as air of about 2500 kg/m^3. Real air is 1.225
+const float DEFAULT_AIR_DENSITY = 2500.0f;
+
+// A flat plate's drag & lift
+const float DEFAULT_DRAG_COEFFICIENT = 1.0f;
+const float DEFAULT_LIFT_COEFFICIENT = 0.5f;
+
+// Quads per stack tile of a row
+const int AERO_TILE = 64;
+
+//****************************************************
+// Aerodynamics Class - Constructors
+//****************************************************
+Aerodynamics::Aerodynamics() {
+    density = DEFAULT_AIR_DENSITY;
+    dragCoefficient = DEFAULT_DRAG_COEFFICIENT;
+    liftCoefficient = DEFAULT_LIFT_COEFFICIENT;
+    windVelocity = glm::vec3(0.0f);
+}
+
+//****************************************************
+// Triangle Force:
+//      - A third of the drag & lift of one triangle
+//        with relative velocity u & cross product c,
+//        and a third of its drag's damping
+//      - kd & kl already hold rho C / 12; a triangle
+//        with no area or relative velocity gets no
+//        lift instead of 0 / 0. Adding FLT_MIN to r
+//        rather than testing it keeps the row loop
+//        free of branches, so it vectorizes
+//****************************************************
+static inline void triangleForce(float ux, float uy, float uz, float cx, float cy, float cz,
+                                 float kd, float kl, float& fx, float& fy, float& fz, float& d) {
+    float uc = ux*cx + uy*cy + uz*cz;
+    float uu = ux*ux + uy*uy + uz*uz;
+    float cc = cx*cx + cy*cy + cz*cz;
+
+    // r = 0 only when u or c is, and then so is every term lift multiplies
+    float r = sqrtf(uu * cc);
+    float lift = kl * uc / (r + FLT_MIN);
+
+    d = kd * fabsf(uc);
+
+    fx = -d * ux + lift * (uc * ux - uu * cx);
+    fy = -d * uy + lift * (uc * uy - uu * cy);
+    fz = -d * uz + lift * (uc * uz - uu * cz);
+}
+
+//****************************************************
+// Apply Row:
+//      - Quad w has triangles A = (w, h), (w, h+1),
+//        (w+1, h) & B = (w+1, h+1), (w+1, h), (w, h+1)
+//        as Cloth::updateNormals
+//      - Each tile computes both triangles into stack
+//        arrays, then adds them to the four corners in
+//        four separate loops, so no loop both reads
+//        and writes an overlapping range
+//****************************************************
+void Aerodynamics::applyRow(ParticleStore* p, int width, int h, int w0, int w1, SymmetricBlocks* damping) const {
+    float kd = density * dragCoefficient / 12.0f;
+    float kl = density * liftCoefficient / 12.0f;
+    float third = 1.0f / 3.0f;
+
+    float ax[AERO_TILE], ay[AERO_TILE], az[AERO_TILE], ad[AERO_TILE];
+    float bx[AERO_TILE], by[AERO_TILE], bz[AERO_TILE], bd[AERO_TILE];
+
+    for(int t0 = w0; t0 < w1; t0 += AERO_TILE) {
+        int n = (w1 - t0 < AERO_TILE) ? w1 - t0 : AERO_TILE;
+
+        // Corners: a = (w, h), b = (w, h+1); a + 1 & b + 1 are the next column
+        int a = h * width + t0;
+        int b = a + width;
+
+        for(int i = 0; i < n; i++) {
+            int a0 = a + i, a1 = a + i + 1;
+            int b0 = b + i, b1 = b + i + 1;
+
+            // Triangle A
+            float ux = (p->vx[a0] + p->vx[b0] + p->vx[a1]) * third - windVelocity.x;
+            float uy = (p->vy[a0] + p->vy[b0] + p->vy[a1]) * third - windVelocity.y;
+            float uz = (p->vz[a0] + p->vz[b0] + p->vz[a1]) * third - windVelocity.z;
+
+            float e1x = p->px[b0] - p->px[a0], e1y = p->py[b0] - p->py[a0], e1z = p->pz[b0] - p->pz[a0];
+            float e2x = p->px[a1] - p->px[a0], e2y = p->py[a1] - p->py[a0], e2z = p->pz[a1] - p->pz[a0];
+
+            triangleForce(ux, uy, uz,
+                          e1y*e2z - e1z*e2y, e1z*e2x - e1x*e2z, e1x*e2y - e1y*e2x,
+                          kd, kl, ax[i], ay[i], az[i], ad[i]);
+
+            // Triangle B
+            ux = (p->vx[b1] + p->vx[a1] + p->vx[b0]) * third - windVelocity.x;
+            uy = (p->vy[b1] + p->vy[a1] + p->vy[b0]) * third - windVelocity.y;
+            uz = (p->vz[b1] + p->vz[a1] + p->vz[b0]) * third - windVelocity.z;
+
+            e1x = p->px[a1] - p->px[b1];  e1y = p->py[a1] - p->py[b1];  e1z = p->pz[a1] - p->pz[b1];
+            e2x = p->px[b0] - p->px[b1];  e2y = p->py[b0] - p->py[b1];  e2z = p->pz[b0] - p->pz[b1];
+
+            triangleForce(ux, uy, uz,
+                          e1y*e2z - e1z*e2y, e1z*e2x - e1x*e2z, e1x*e2y - e1y*e2x,
+                          kd, kl, bx[i], by[i], bz[i], bd[i]);
+        }
+
+        // (w, h) gets A, (w+1, h) & (w, h+1) both, (w+1, h+1) B
+        float* fx = p->fx;  float* fy = p->fy;  float* fz = p->fz;
+
+        for(int i = 0; i < n; i++) {
+            fx[a + i] += ax[i];  fy[a + i] += ay[i];  fz[a + i] += az[i];
+        }
+
+        for(int i = 0; i < n; i++) {
+            fx[a + 1 + i] += ax[i] + bx[i];  fy[a + 1 + i] += ay[i] + by[i];  fz[a + 1 + i] += az[i] + bz[i];
+        }
+
+        for(int i = 0; i < n; i++) {
+            fx[b + i] += ax[i] + bx[i];  fy[b + i] += ay[i] + by[i];  fz[b + i] += az[i] + bz[i];
+        }
+
+        for(int i = 0; i < n; i++) {
+            fx[b + 1 + i] += bx[i];  fy[b + 1 + i] += by[i];  fz[b + 1 + i] += bz[i];
+        }
+
+        if(damping != NULL) {
+            for(int i = 0; i < n; i++) {
+                damping->addIdentity(a + i, ad[i]);
+                damping->addIdentity(a + 1 + i, ad[i] + bd[i]);
+                damping->addIdentity(b + i, ad[i] + bd[i]);
+                damping->addIdentity(b + 1 + i, bd[i]);
+            }
+        }
+    }
+}
+
+//****************************************************
+// Apply:
+//      - Quad row h touches particle rows h & h + 1,
+//        so even quad rows share no particle, nor do
+//        odd ones; the two run one after the other
+//****************************************************
+void Aerodynamics::apply(ParticleStore* p, int width, int height, SymmetricBlocks* damping, ThreadPool* pool) const {
+    int numRows = height - 1;
+
+    if(numRows <= 0 || width < 2) {
+        return;
+    }
+
+    for(int c = 0; c < 2; c++) {
+        std::function<void(int, int)> body = [this, p, width, damping, c](int begin, int end) {
+            for(int j = begin; j < end; j++) {
+                applyRow(p, width, 2 * j + c, 0, width - 1, damping);
+            }
+        };
+
+        int count = (numRows - c + 1) / 2;
+
+        if(pool == NULL) {
+            body(0, count);
+        } else {
+            pool->parallelFor(0, count, body);
+        }
+    }
+}
+
+void Aerodynamics::applyRows(ParticleStore* p, int width, int height, int w0, int w1, int h0, int h1,
+                             SymmetricBlocks* damping) const {
+    if(w1 > width - 1) {
+        w1 = width - 1;
+    }
+
+    if(h1 > height - 1) {
+        h1 = height - 1;
+    }
+
+    for(int h = h0; h < h1 && w0 < w1; h++) {
+        applyRow(p, width, h, w0, w1, damping);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef AERODYNAMICS_H
+#define AERODYNAMICS_H
+
+#include "glm/glm.hpp"
+#include "ParticleStore.h"
+#include "BlockSparseMatrix.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Aerodynamics Header Definition
+//      - Drag & lift on every triangle of a width x
+//        height grid Cloth, from its velocity relative
+//        to a uniform wind. A third of each triangle's
+//        force goes to each of its particles
+//      - With u the triangle's mean velocity less the
+//        wind and c the cross product of two edges
+//        (twice the area along the normal):
+//          drag = -1/4 rho Cd |u . c| u
+//          lift = 1/4 rho Cl (u . c) / (|u||c|)
+//                 * ((u . c) u - |u|^2 c)
+//        so drag opposes u and lift is normal to it,
+//        both zero for a triangle edge on to the flow
+//      - One fused pass: each quad row computes both
+//        triangles into stack arrays, then adds them
+//        to its two particle rows. Even & odd quad
+//        rows run as separate phases, so the result
+//        does not depend on the number of threads
+//      - Verlet keeps no velocity, so it only feels
+//        the wind
+//****************************************************
+
+class Aerodynamics {
+  private:
+    float density;
+    float dragCoefficient;
+    float liftCoefficient;
+    glm::vec3 windVelocity;
+
+    // Quad row h: both triangles of quads [w0, w1) of rows h & h + 1
+    void applyRow(ParticleStore* p, int width, int h, int w0, int w1, SymmetricBlocks* damping) const;
+
+  public:
+    Aerodynamics();
+
+    void setDensity(float rho) { density = rho; };
+    void setDragCoefficient(float c) { dragCoefficient = c; };
+    void setLiftCoefficient(float c) { liftCoefficient = c; };
+    void setWindVelocity(glm::vec3 v) { windVelocity = v; };
+
+    float getDensity() const { return density; };
+    float getDragCoefficient() const { return dragCoefficient; };
+    float getLiftCoefficient() const { return liftCoefficient; };
+    glm::vec3 getWindVelocity() const { return windVelocity; };
+
+    // Adds the forces to every particle. Given a solver's damping, also adds the drag's velocity
+    // derivative (|u . c| held constant, lumped onto each particle) so the solve treats it as
+    // damping. A NULL pool runs serially, with the same result
+    void apply(ParticleStore* p, int width, int height, SymmetricBlocks* damping, ThreadPool* pool) const;
+
+    // Serially adds the forces of quads [w0, w1) x [h0, h1) only
+    void applyRows(ParticleStore* p, int width, int height, int w0, int w1, int h0, int h1,
+                   SymmetricBlocks* damping) const;
+};
+
+#endif
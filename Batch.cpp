@@ -0,0 +1,447 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "glm/glm.hpp"
+#include "Cloth.h"
+#include "ParticleStore.h"
+#include "Simulation.h"
+#include "AdaptiveStepper.h"
+#include "SceneLoader.h"
+#include "SimdKernels.h"
+
+//****************************************************
+// Cloth Batch
+//      - Headless runner: loads the same cloth and
+//        shape files as Scene, steps a fixed
+//        timestep N times with no OpenGL, and prints
+//        timing plus a checksum of the final state
+//****************************************************
+
+//****************************************************
+// Batch Variables
+//****************************************************
+const char* inputFile = "test/cloth.test";
+const char* shapeFile = "shapes/4spheres.test";
+
+IntegratorType integrator = EULER;
+bool useFloor = true;
+bool useWind = false;
+bool setWindForce = false;
+glm::vec3 windForce(0.0f);
+float windTurbulence = -1.0f;   // < 0 = wind field default
+float windGusts = -1.0f;        // < 0 = wind field default
+int windOctaves = -1;           // < 0 = wind field default
+bool useAerodynamics = true;
+glm::vec3 windVelocity(0.0f);
+float airDensity = 0.0f;        // 0 = aerodynamics default
+bool useStencil = false;
+bool useSleep = false;
+float sleepSpeed = 0.0f;        // 0 = tiles default
+bool useSelf = false;
+bool useContinuous = false;
+
+const char* isaName = NULL;     // NULL = widest ISA the CPU supports
+
+int numSteps = 1000;
+int cgIterations = 0;           // 0 = solver default
+float cgTolerance = 0.0f;       // 0 = solver default
+bool useMultigrid = false;
+int xpbdIterations = 0;         // 0 = solver default
+int pdIterations = 0;           // 0 = solver default
+bool pdWarmStart = true;
+float xpbdTolerance = 0.0f;     // 0 = always run every iteration
+float xpbdCompliance[NUM_SPRING_TYPES] = { -1.0f, -1.0f, -1.0f };   // < 0 = solver default
+int numThreads = 0;             // 0 = every hardware thread
+int parallelMin = 0;            // 0 = Cloth's default threshold
+float timestep = 0.005f;
+bool adaptive = false;
+float maxStep = 0.0f;           // 0 = stepper default
+float maxStrain = 0.0f;         // 0 = stepper default
+float maxCFL = 0.0f;            // 0 = stepper default
+
+//****************************************************
+// Print Usage
+//****************************************************
+void printUsage() {
+    std::cout << std::endl;
+    std::cout << "USAGE: ./cloth_batch <cloth_file> <shape_file> [OPTIONAL]" << std::endl;
+    std::cout << "OPTIONAL: '-v'          = Verlet Integration (default Euler)" << std::endl;
+    std::cout << "          '-i'          = Implicit Euler Integration" << std::endl;
+    std::cout << "          '-cg-iters N' = Max conjugate gradient iterations for '-i'" << std::endl;
+    std::cout << "          '-cg-tol T'   = Relative conjugate gradient tolerance for '-i'" << std::endl;
+    std::cout << "          '-mg'         = Multigrid V-cycle preconditioner for '-i'" << std::endl;
+    std::cout << "          '-x'          = XPBD, springs solved as constraints" << std::endl;
+    std::cout << "          '-xpbd-iters N' = XPBD iterations per step" << std::endl;
+    std::cout << "          '-xpbd-tol T' = Stop XPBD iterating once the RMS residual is below T" << std::endl;
+    std::cout << "          '-xpbd-compliance S,H,B' = Stretch, shear & bend compliance per unit length" << std::endl;
+    std::cout << "          '-pd'         = Projective Dynamics, prefactored Cholesky" << std::endl;
+    std::cout << "          '-pd-iters N' = Projective Dynamics local / global iterations per step" << std::endl;
+    std::cout << "          '-pd-cold'    = Start every step's iterations from the prediction alone" << std::endl;
+    std::cout << "          '-steps N'    = Number of timesteps (default " << numSteps << ")" << std::endl;
+    std::cout << "          '-dt S'       = Timestep in seconds (default " << timestep << ")" << std::endl;
+    std::cout << "          '-adaptive'   = Simulate steps * dt seconds with adaptive timesteps, starting at dt" << std::endl;
+    std::cout << "          '-max-dt S'   = Largest adaptive timestep" << std::endl;
+    std::cout << "          '-max-strain S' = Adaptive steps changing a stretch strain by over S are retried smaller" << std::endl;
+    std::cout << "          '-max-cfl C'  = Adaptive steps moving a particle over C rest lengths are retried smaller" << std::endl;
+    std::cout << "          '-threads N'  = Worker threads (default every hardware thread)" << std::endl;
+    std::cout << "          '-parallel-min N' = Smallest cloth, in vertices, split across threads" << std::endl;
+    std::cout << "          '-stencil'    = Grid stencil spring kernels instead of the spring table" << std::endl;
+    std::cout << "          '-sleep'      = Let settled tiles sleep (Euler & Verlet on the spring table)" << std::endl;
+    std::cout << "          '-sleep-speed S' = Tiles whose particles stay under S m/s fall asleep" << std::endl;
+    std::cout << "          '-self'       = Self collision: keep the cloth from passing through itself" << std::endl;
+    std::cout << "          '-ccd'        = Continuous collision: keep the cloth from passing through shape triangles in one step" << std::endl;
+    std::cout << "          '-isa NAME'   = SIMD kernels: scalar, sse, avx2 or avx512 (default widest supported)" << std::endl;
+    std::cout << "          '-wind'       = Turn on Wind" << std::endl;
+    std::cout << "          '-wind-force X,Y,Z' = Mean wind force (default 0,0,-1)" << std::endl;
+    std::cout << "          '-turbulence T' = Curl noise wind, relative to the mean" << std::endl;
+    std::cout << "          '-gusts G'    = Gusts, relative to the mean" << std::endl;
+    std::cout << "          '-wind-octaves N' = Curl noise octaves" << std::endl;
+    std::cout << "          '-noaero'     = No aerodynamic drag & lift" << std::endl;
+    std::cout << "          '-wind-velocity X,Y,Z' = Air velocity for drag & lift (default still air)" << std::endl;
+    std::cout << "          '-air-density R' = Air density for drag & lift in kg/m^3" << std::endl;
+    std::cout << "          '-nofloor'    = Don't add the floor plane" << std::endl;
+    std::cout << std::endl;
+}
+
+//****************************************************
+// Process Inputs
+//      - ./cloth_batch <cloth_file> <shape_file> [OPTIONAL]
+//****************************************************
+void processInputs(int argc, char *argv[]) {
+    int arg = 1;
+
+    if(argc >= 2 && (std::string(argv[1]) == "-help" || std::string(argv[1]) == "--help")) {
+        printUsage();
+        std::exit(1);
+    }
+
+    if(argc >= 3 && argv[1][0] != '-' && argv[2][0] != '-') {
+        inputFile = argv[1];
+        shapeFile = argv[2];
+        arg = 3;
+    }
+
+    for(; arg < argc; arg++) {
+        std::string flag = argv[arg];
+
+        if(flag == "-v") {
+            integrator = VERLET;
+        } else if(flag == "-i") {
+            integrator = IMPLICIT_EULER;
+        } else if(flag == "-x") {
+            integrator = XPBD;
+        } else if(flag == "-pd") {
+            integrator = PROJECTIVE_DYNAMICS;
+        } else if(flag == "-pd-iters" && arg + 1 < argc) {
+            pdIterations = atoi(argv[++arg]);
+        } else if(flag == "-pd-cold") {
+            pdWarmStart = false;
+        } else if(flag == "-xpbd-iters" && arg + 1 < argc) {
+            xpbdIterations = atoi(argv[++arg]);
+        } else if(flag == "-xpbd-tol" && arg + 1 < argc) {
+            xpbdTolerance = (float) atof(argv[++arg]);
+        } else if(flag == "-xpbd-compliance" && arg + 1 < argc) {
+            std::stringstream list(argv[++arg]);
+            std::string item;
+
+            for(int t = 0; t < NUM_SPRING_TYPES && std::getline(list, item, ','); t++) {
+                xpbdCompliance[t] = (float) atof(item.c_str());
+            }
+        } else if(flag == "-cg-iters" && arg + 1 < argc) {
+            cgIterations = atoi(argv[++arg]);
+        } else if(flag == "-cg-tol" && arg + 1 < argc) {
+            cgTolerance = (float) atof(argv[++arg]);
+        } else if(flag == "-mg") {
+            useMultigrid = true;
+        } else if(flag == "-wind") {
+            useWind = true;
+        } else if(flag == "-wind-force" && arg + 1 < argc) {
+            std::stringstream list(argv[++arg]);
+            std::string item;
+
+            for(int c = 0; c < 3 && std::getline(list, item, ','); c++) {
+                windForce[c] = (float) atof(item.c_str());
+            }
+            setWindForce = true;
+        } else if(flag == "-turbulence" && arg + 1 < argc) {
+            windTurbulence = (float) atof(argv[++arg]);
+        } else if(flag == "-gusts" && arg + 1 < argc) {
+            windGusts = (float) atof(argv[++arg]);
+        } else if(flag == "-wind-octaves" && arg + 1 < argc) {
+            windOctaves = atoi(argv[++arg]);
+        } else if(flag == "-noaero") {
+            useAerodynamics = false;
+        } else if(flag == "-wind-velocity" && arg + 1 < argc) {
+            std::stringstream list(argv[++arg]);
+            std::string item;
+
+            for(int c = 0; c < 3 && std::getline(list, item, ','); c++) {
+                windVelocity[c] = (float) atof(item.c_str());
+            }
+        } else if(flag == "-air-density" && arg + 1 < argc) {
+            airDensity = (float) atof(argv[++arg]);
+        } else if(flag == "-stencil") {
+            useStencil = true;
+        } else if(flag == "-sleep") {
+            useSleep = true;
+        } else if(flag == "-sleep-speed" && arg + 1 < argc) {
+            sleepSpeed = (float) atof(argv[++arg]);
+        } else if(flag == "-self") {
+            useSelf = true;
+        } else if(flag == "-ccd") {
+            useContinuous = true;
+        } else if(flag == "-nofloor") {
+            useFloor = false;
+        } else if(flag == "-steps" && arg + 1 < argc) {
+            numSteps = atoi(argv[++arg]);
+        } else if(flag == "-threads" && arg + 1 < argc) {
+            numThreads = atoi(argv[++arg]);
+        } else if(flag == "-parallel-min" && arg + 1 < argc) {
+            parallelMin = atoi(argv[++arg]);
+        } else if(flag == "-isa" && arg + 1 < argc) {
+            isaName = argv[++arg];
+        } else if(flag == "-dt" && arg + 1 < argc) {
+            timestep = (float) atof(argv[++arg]);
+        } else if(flag == "-adaptive") {
+            adaptive = true;
+        } else if(flag == "-max-dt" && arg + 1 < argc) {
+            maxStep = (float) atof(argv[++arg]);
+        } else if(flag == "-max-strain" && arg + 1 < argc) {
+            maxStrain = (float) atof(argv[++arg]);
+        } else if(flag == "-max-cfl" && arg + 1 < argc) {
+            maxCFL = (float) atof(argv[++arg]);
+        } else {
+            std::cerr << "Incorrect Flag Parameter: " << flag << std::endl;
+            printUsage();
+            std::exit(1);
+        }
+    }
+}
+
+//****************************************************
+// State Checksum
+//      - FNV-1a over the raw bits of every position,
+//        so two runs match only if bitwise identical
+//****************************************************
+unsigned long long stateChecksum(ParticleStore* p) {
+    unsigned long long hash = 14695981039346656037ULL;
+    const float* arrays[3] = { p->px, p->py, p->pz };
+
+    for(int a = 0; a < 3; a++) {
+        const unsigned char* bytes = (const unsigned char*) arrays[a];
+        int numBytes = p->size() * sizeof(float);
+
+        for(int b = 0; b < numBytes; b++) {
+            hash ^= bytes[b];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+int main(int argc, char *argv[]) {
+
+    processInputs(argc, argv);
+
+    const SimdKernels* kernels = getBestSimdKernels();
+    if(isaName != NULL) {
+        kernels = findSimdKernels(isaName);
+
+        if(kernels == NULL) {
+            std::cerr << "SIMD kernels not available on this CPU: " << isaName << std::endl;
+            return 1;
+        }
+    }
+
+    Simulation simulation;
+    simulation.setNumThreads(numThreads);
+    simulation.setParallelThreshold(parallelMin);
+
+    Cloth* cloth = loadClothFile(inputFile, integrator);
+    if(cloth == NULL) {
+        return 1;
+    }
+
+    cloth->setStencil(useStencil);
+    cloth->setSleeping(useSleep);
+    cloth->setSelfCollision(useSelf);
+    cloth->setContinuousCollision(useContinuous);
+
+    if(sleepSpeed > 0.0f) {
+        cloth->getTiles().setSleepSpeed(sleepSpeed);
+    }
+
+    if(cgIterations > 0) {
+        cloth->getImplicitSolver().setMaxIterations(cgIterations);
+    }
+
+    if(cgTolerance > 0.0f) {
+        cloth->getImplicitSolver().setTolerance(cgTolerance);
+    }
+
+    cloth->getImplicitSolver().setMultigrid(useMultigrid);
+
+    XPBDSolver& xpbd = cloth->getXPBDSolver();
+    if(xpbdIterations > 0) {
+        xpbd.setIterations(xpbdIterations);
+    }
+
+    xpbd.setResidualTolerance(xpbdTolerance);
+
+    for(int t = 0; t < NUM_SPRING_TYPES; t++) {
+        if(xpbdCompliance[t] >= 0.0f) {
+            xpbd.setCompliance((SpringType) t, xpbdCompliance[t]);
+        }
+    }
+
+    ProjectiveDynamicsSolver& projective = cloth->getProjectiveSolver();
+    if(pdIterations > 0) {
+        projective.setIterations(pdIterations);
+    }
+
+    projective.setWarmStart(pdWarmStart);
+
+    if(airDensity > 0.0f) {
+        cloth->getAerodynamics().setDensity(airDensity);
+    }
+
+    cloth->setSimdKernels(kernels);
+    simulation.setAerodynamics(useAerodynamics);
+    simulation.setWindVelocity(windVelocity);
+    simulation.setCloth(cloth);
+    loadShapeFile(shapeFile, simulation.getShapes(), simulation.getPool());
+
+    if(useFloor) {
+        simulation.addFloor();
+    }
+
+    simulation.setWind(useWind);
+
+    if(setWindForce) {
+        simulation.setWindForce(windForce);
+    }
+
+    WindField& field = simulation.getWindField();
+    if(windTurbulence >= 0.0f) {
+        field.setTurbulence(windTurbulence);
+    }
+    if(windGusts >= 0.0f) {
+        field.setGustStrength(windGusts);
+    }
+    if(windOctaves >= 0) {
+        field.setOctaves(windOctaves);
+    }
+
+    AdaptiveStepper stepper(&simulation);
+    if(maxStep > 0.0f) {
+        stepper.setStepRange(stepper.getMinStep(), maxStep);
+    }
+    if(maxStrain > 0.0f) {
+        stepper.setMaxStrain(maxStrain);
+    }
+    if(maxCFL > 0.0f) {
+        stepper.setMaxCFL(maxCFL);
+    }
+    stepper.reset(timestep);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    int stepsTaken = numSteps;
+    if(adaptive) {
+        stepsTaken = stepper.advance((double) numSteps * timestep);
+    } else {
+        for(int i = 0; i < numSteps; i++) {
+            simulation.step(timestep);
+        }
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double wallTime = std::chrono::duration<double>(end - start).count();
+
+    // Position sum is a readable companion to the bitwise checksum
+    ParticleStore* p = cloth->getParticles();
+    glm::dvec3 posSum(0.0);
+    for(int i = 0; i < p->size(); i++) {
+        posSum += glm::dvec3(p->getPos(i));
+    }
+
+    std::cout << "---------------------------------------" << std::endl;
+    std::cout << " Batch Results: " << std::endl;
+    std::cout << "---------------------------------------" << std::endl;
+    std::cout << "Cloth: " << inputFile << "  Shapes: " << shapeFile << std::endl;
+    std::cout << "Vertices: " << cloth->getWidth() << " x " << cloth->getHeight() << std::endl;
+    std::cout << "Integration: " << INTEGRATOR_NAMES[integrator] << std::endl;
+    if(integrator == IMPLICIT_EULER) {
+        ImplicitSolver& solver = cloth->getImplicitSolver();
+        std::cout << "CG (last step): " << solver.getLastIterations() << " iterations, residual " << solver.getLastResidual();
+        std::cout << (solver.isMultigridActive() ? ", multigrid preconditioner" : ", block Jacobi preconditioner") << std::endl;
+    } else if(integrator == XPBD) {
+        const std::vector<float>& residuals = xpbd.getResiduals();
+
+        std::cout << "XPBD (last step): " << residuals.size() << " iterations, RMS residual per iteration:";
+        for(int i = 0; i < residuals.size(); i++) {
+            std::cout << " " << residuals[i];
+        }
+        std::cout << std::endl;
+    } else if(integrator == PROJECTIVE_DYNAMICS) {
+        const std::vector<float>& residuals = projective.getResiduals();
+
+        std::cout << "Projective Dynamics (last step): " << residuals.size() << " iterations, factor " << projective.getFactorNonZeros();
+        std::cout << " non-zeros, RMS move per iteration:";
+        for(int i = 0; i < residuals.size(); i++) {
+            std::cout << " " << residuals[i];
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "Springs: " << (useStencil ? "Grid Stencil" : "Spring Table") << std::endl;
+    std::cout << "SIMD: " << kernels->name << std::endl;
+    std::cout << "Threads: " << simulation.getNumThreads() << std::endl;
+    if(useWind) {
+        glm::vec3 mean = field.getMeanForce();
+
+        std::cout << "Wind: (" << mean.x << ", " << mean.y << ", " << mean.z << "), turbulence " << field.getTurbulence();
+        std::cout << ", gusts " << field.getGustStrength() << ", " << field.getOctaves() << " octaves, ";
+        std::cout << field.getRefreshes() << " grid updates of " << field.getNumNodes() << " nodes" << std::endl;
+    }
+    if(useAerodynamics) {
+        Aerodynamics& aero = cloth->getAerodynamics();
+        glm::vec3 air = aero.getWindVelocity();
+
+        std::cout << "Aerodynamics: density " << aero.getDensity() << ", drag " << aero.getDragCoefficient();
+        std::cout << ", lift " << aero.getLiftCoefficient() << ", wind (" << air.x << ", " << air.y << ", " << air.z << ")" << std::endl;
+    } else {
+        std::cout << "Aerodynamics: OFF" << std::endl;
+    }
+    if(useSleep) {
+        std::cout << "Tiles Awake: " << cloth->getAwakeTiles() << " / " << cloth->getNumTiles() << std::endl;
+    }
+    if(useSelf) {
+        std::cout << "Self Contacts (last step): " << cloth->getSelfContacts() << std::endl;
+        std::cout << "Self Patches Searched (last step): " << cloth->getSelfPatches() << " / " << cloth->getNumSelfPatches() << std::endl;
+    }
+    if(useContinuous) {
+        std::cout << "Continuous Impacts (last step): " << cloth->getContinuousImpacts() << std::endl;
+        std::cout << "BVH Rebuilds: " << cloth->getContinuousRebuilds() << std::endl;
+    }
+    if(adaptive) {
+        std::cout << "Steps: " << stepsTaken << " adaptive (" << stepper.getRejectedSteps() << " rolled back) over ";
+        std::cout << numSteps * timestep << "s  dt: " << stepper.getSmallestStep() << " - " << stepper.getLargestStep() << "s" << std::endl;
+        std::cout << "Last Step: strain " << stepper.getLastStrain() << ", CFL " << stepper.getLastCFL() << std::endl;
+    } else {
+        std::cout << "Steps: " << numSteps << "  dt: " << timestep << "s" << std::endl;
+    }
+    std::cout << "Wall Time: " << wallTime << "s" << std::endl;
+    std::cout << "Steps/sec: " << (wallTime > 0.0 ? stepsTaken / wallTime : 0.0) << std::endl;
+    std::cout << std::setprecision(9);
+    std::cout << "Position Sum: (" << posSum.x << ", " << posSum.y << ", " << posSum.z << ")" << std::endl;
+    std::cout << "Checksum: " << std::hex << std::setw(16) << std::setfill('0') << stateChecksum(p) << std::dec << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,781 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <chrono>
+#include <algorithm>
+#include <math.h>
+
+#include "glm/glm.hpp"
+#include "Cloth.h"
+#include "ParticleStore.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "BroadPhase.h"
+#include "TriangleMesh.h"
+#include "TriangleMeshShape.h"
+#include "WindField.h"
+#include "ThreadPool.h"
+#include "SimdKernels.h"
+#include "ImplicitSolver.h"
+#include "BlockSparseMatrix.h"
+
+//****************************************************
+// Cloth Bench
+//      - Times every per-step kernel on its own over
+//        a range of grid densities
+//      - Prints a table to stderr and JSON to stdout
+//        (or to the file given with -o)
+//****************************************************
+
+//****************************************************
+// Bench Variables
+//****************************************************
+std::vector<int> gridSizes;
+double minTime = 0.2;           // Seconds each measurement must run for
+int numTrials = 3;              // Best of numTrials is reported
+int warmupSteps = 20;           // Full steps run before timing so springs are stretched
+const char* outputFile = NULL;
+int numThreads = 1;             // <= 0 = every hardware thread
+int parallelMin = 0;            // 0 = Cloth's default threshold
+
+ThreadPool* pool = NULL;
+const SimdKernels* kernels = NULL;  // Timed ISA, widest supported unless -isa
+
+bool verify = false;                // Compare every SIMD ISA against scalar instead of timing
+const double VERIFY_TOLERANCE = 1.0e-4;
+
+const float BENCH_STEP = 0.002f;
+const float STABLE_STEP_FACTOR = 0.2f;     // Fraction of sqrt(m / k) used as the warmup step
+
+// Field of small spheres for the broad phase kernels, FIELD_SIDE x FIELD_SIDE across the cloth
+const int FIELD_SIDE = 16;
+const float FIELD_RADIUS = 0.04f;
+
+// Squares along each cube edge of the triangle mesh copy of the sphere, 6 x 2 x 91^2 = 99372 triangles
+const int MESH_SIDE = 91;
+
+//****************************************************
+// Bench Context
+//      - The state every kernel runs on
+//****************************************************
+struct BenchContext {
+    Cloth* cloth;
+    Sphere* sphere;
+    Plane* plane;
+    float timestep;
+
+    // The sphere & plane as batched colliders, 0 & 1
+    ColliderSet colliders;
+
+    // Sphere field & the broad phase built over it
+    std::vector<Shape*> field;
+    ColliderSet fieldColliders;
+    BroadPhase broad;
+
+    // The sphere again as a triangle mesh
+    ColliderSet meshColliders;
+    BroadPhase meshBroad;
+
+    // Default turbulent wind, its grid laid over the warmed up cloth
+    WindField wind;
+
+    // Operands of the block sparse multiply
+    SolverVector input;
+    SolverVector output;
+};
+
+typedef void (*KernelFunc)(BenchContext& ctx);
+
+//****************************************************
+// Kernel
+//      - bytesPerVertex / bytesPerSpring model the
+//        compulsory memory traffic of one call, used
+//        for the effective GB/s figure
+//****************************************************
+struct Kernel {
+    const char* name;
+    KernelFunc run;
+    float bytesPerVertex;
+    float bytesPerSpring;
+};
+
+//****************************************************
+// Kernels
+//****************************************************
+static void runUpdateSprings(BenchContext& ctx) {
+    ctx.cloth->updateSprings();
+}
+
+static void runLengthConstraints(BenchContext& ctx) {
+    ctx.cloth->applyLengthConstraints();
+}
+
+static void runStencilSprings(BenchContext& ctx) {
+    ctx.cloth->setStencil(true);
+    ctx.cloth->updateSprings();
+    ctx.cloth->setStencil(false);
+}
+
+static void runStencilConstraints(BenchContext& ctx) {
+    ctx.cloth->setStencil(true);
+    ctx.cloth->applyLengthConstraints();
+    ctx.cloth->setStencil(false);
+}
+
+static void runUpdateNormals(BenchContext& ctx) {
+    ctx.cloth->updateNormals();
+}
+
+static void runTriangleForce(BenchContext& ctx) {
+    ctx.cloth->addTriangleForce(glm::vec3(0.0f, 0.0f, -1.0f));
+}
+
+static void runAerodynamicDrag(BenchContext& ctx) {
+    ctx.cloth->addAerodynamicDrag();
+}
+
+static void runWindFieldUpdate(BenchContext& ctx) {
+    glm::vec3 lo, hi;
+    ctx.cloth->getBox(lo, hi);
+
+    ctx.wind.invalidate();
+    ctx.wind.update(0.0, lo, hi, pool);
+}
+
+static void runWindField(BenchContext& ctx) {
+    ctx.cloth->addWindField(ctx.wind);
+}
+
+// The field evaluated at every triangle instead of sampled from the grid
+static void runWindFieldNaive(BenchContext& ctx) {
+    Cloth* cloth = ctx.cloth;
+    ParticleStore* p = cloth->getParticles();
+
+    for(int h = 0; h < cloth->getHeight() - 1; h++) {
+        for(int w = 0; w < cloth->getWidth() - 1; w++) {
+            int tri[2][3] = { { cloth->getIndex(w, h), cloth->getIndex(w, h+1), cloth->getIndex(w+1, h) },
+                              { cloth->getIndex(w+1, h+1), cloth->getIndex(w+1, h), cloth->getIndex(w, h+1) } };
+
+            for(int t = 0; t < 2; t++) {
+                glm::vec3 p1 = p->getPos(tri[t][0]);
+                glm::vec3 p2 = p->getPos(tri[t][1]);
+                glm::vec3 p3 = p->getPos(tri[t][2]);
+
+                glm::vec3 normal = glm::normalize(glm::cross(p2 - p1, p3 - p1));
+                glm::vec3 force = normal * glm::dot(normal, ctx.wind.evaluate((p1 + p2 + p3) / 3.0f, 0.0));
+
+                p->addForce(tri[t][0], force);
+                p->addForce(tri[t][1], force);
+                p->addForce(tri[t][2], force);
+            }
+        }
+    }
+}
+
+static void runIntegrateEuler(BenchContext& ctx) {
+    ctx.cloth->setEuler(true);
+    ctx.cloth->integrate(ctx.timestep);
+}
+
+static void runIntegrateVerlet(BenchContext& ctx) {
+    ctx.cloth->setEuler(false);
+    ctx.cloth->integrate(ctx.timestep);
+}
+
+static void runXPBDStep(BenchContext& ctx) {
+    ctx.cloth->setIntegrator(XPBD);
+    ctx.cloth->integrate(ctx.timestep);
+}
+
+// The first call, in timeKernel's warm up, factors the system; timed calls reuse the factor
+static void runProjectiveStep(BenchContext& ctx) {
+    ctx.cloth->setIntegrator(PROJECTIVE_DYNAMICS);
+    ctx.cloth->integrate(ctx.timestep);
+}
+
+static void runMatrixAssemble(BenchContext& ctx) {
+    ctx.cloth->getImplicitSolver().assemble(ctx.cloth->getParticles(), ctx.cloth->getSprings(), ctx.timestep, pool);
+}
+
+static void runMatrixMultiply(BenchContext& ctx) {
+    ctx.cloth->getImplicitSolver().getMatrix().multiply(ctx.input, ctx.output, pool);
+}
+
+static void runCollideSphere(BenchContext& ctx) {
+    ctx.cloth->updateCollision(ctx.sphere);
+}
+
+static void runCollidePlane(BenchContext& ctx) {
+    ctx.cloth->updateCollision(ctx.plane);
+}
+
+static void runCollideSphereBatch(BenchContext& ctx) {
+    ctx.cloth->updateCollision(ctx.colliders, 0);
+}
+
+static void runCollidePlaneBatch(BenchContext& ctx) {
+    ctx.cloth->updateCollision(ctx.colliders, 1);
+}
+
+static void runCollideField(BenchContext& ctx) {
+    ctx.cloth->updateCollisions(ctx.fieldColliders, ctx.broad);
+}
+
+// Every vertex against every sphere of the field, as without a broad phase
+static void runCollideFieldNaive(BenchContext& ctx) {
+    for(int i = 0; i < ctx.field.size(); i++) {
+        ctx.cloth->updateCollision(ctx.field[i]);
+    }
+}
+
+static void runCollideMesh(BenchContext& ctx) {
+    ctx.meshColliders.setNumParticles(ctx.cloth->getParticles()->size());
+    ctx.cloth->updateCollisions(ctx.meshColliders, ctx.meshBroad);
+}
+
+// Without hints every search starts from the root with the full contact distance
+static void runCollideMeshCold(BenchContext& ctx) {
+    ctx.meshColliders.setNumParticles(0);
+    ctx.cloth->updateCollisions(ctx.meshColliders, ctx.meshBroad);
+}
+
+// Per spring: indices + rest + stiffness (16), two positions (24), two force read-modify-writes (48)
+// Per vertex: position (12), force RMW (24), velocity (12), normal (12) as each kernel touches
+// Stencil kernels read no spring data, only positions (12) and force (24) or position (24) & invMass (4) RMW
+// XPBD step per vertex: predict & velocity update (112); per spring, each of the 10 default iterations:
+// spring data (12), positions RMW (48), invMass (8), lambda RMW (8), residual written & summed (8)
+// Projective Dynamics step per vertex: predict & velocity update (112); each of the 10 default iterations
+// gathers mass, prediction & rhs (48) and moves the position (36). Per spring, each iteration: spring data (16),
+// positions (24), projection written & read back twice (36). Reading the factor, a grid dependent
+// ~24 bytes per non-zero per iteration, is not counted
+// Matrix assemble per spring: two 36 byte blocks written, their columns and copied rest length & stiffness (96);
+// per vertex: mass, damping, force, velocity & position (64), diagonal block (36), rhs & preconditioner (36)
+// Wind field per vertex: position (12) & force RMW (24); its grid update reads no particles
+// Matrix multiply per vertex: row start, diagonal block & column (44), in & out (24); per spring: two blocks & columns (80)
+const Kernel KERNELS[] = {
+    { "updateSprings",          runUpdateSprings,       0.0f,  88.0f },
+    { "applyLengthConstraints", runLengthConstraints,   0.0f,  64.0f },
+    { "stencilSprings",         runStencilSprings,      36.0f, 0.0f },
+    { "stencilConstraints",     runStencilConstraints,  28.0f, 0.0f },
+    { "updateNormals",          runUpdateNormals,       36.0f, 0.0f },
+    { "addTriangleForce",       runTriangleForce,       36.0f, 0.0f },
+    { "addAerodynamicDrag",     runAerodynamicDrag,     48.0f, 0.0f },
+    { "windFieldUpdate",        runWindFieldUpdate,     0.0f,  0.0f },
+    { "addWindField",           runWindField,           36.0f, 0.0f },
+    { "windFieldNaive",         runWindFieldNaive,      36.0f, 0.0f },
+    { "integrateEuler",         runIntegrateEuler,      76.0f, 0.0f },
+    { "integrateVerlet",        runIntegrateVerlet,     76.0f, 0.0f },
+    { "xpbdStep",               runXPBDStep,            112.0f, 840.0f },
+    { "projectiveStep",         runProjectiveStep,      952.0f, 760.0f },
+    { "matrixAssemble",         runMatrixAssemble,      136.0f, 96.0f },
+    { "matrixMultiply",         runMatrixMultiply,      68.0f, 80.0f },
+    { "collideSphere",          runCollideSphere,       24.0f, 0.0f },
+    { "collidePlane",           runCollidePlane,        24.0f, 0.0f },
+    { "collideSphereBatch",     runCollideSphereBatch,  24.0f, 0.0f },
+    { "collidePlaneBatch",      runCollidePlaneBatch,   24.0f, 0.0f },
+    { "collideField",           runCollideField,        24.0f, 0.0f },
+    { "collideFieldNaive",      runCollideFieldNaive,   24.0f, 0.0f },
+    { "collideMesh",            runCollideMesh,         24.0f, 0.0f },
+    { "collideMeshCold",        runCollideMeshCold,     24.0f, 0.0f }
+};
+
+const int NUM_KERNELS = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+//****************************************************
+// Result
+//****************************************************
+struct BenchResult {
+    std::string kernel;
+    int grid;
+    int vertices;
+    int springs;
+    long reps;
+    double nsPerCall;
+    double nsPerVertex;
+    double nsPerSpring;
+    double gbPerSec;
+};
+
+//****************************************************
+// Time Kernel:
+//      - Doubles the repetition count until a batch
+//        runs for at least minTime, restoring the
+//        warmed up state before every trial
+//      - Returns the best ns per call
+//****************************************************
+double timeKernel(const Kernel& k, BenchContext& ctx, const ParticleStore& snapshot, long& repsOut) {
+    double best = -1.0;
+    ParticleStore* particles = ctx.cloth->getParticles();
+
+    for(int trial = 0; trial < numTrials; trial++) {
+        particles->copyFrom(snapshot);
+        ctx.cloth->onParticlesRestored();
+
+        // Warm caches & branch predictors
+        k.run(ctx);
+
+        long reps = 1;
+        double elapsed = 0.0;
+
+        while(true) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            for(long r = 0; r < reps; r++) {
+                k.run(ctx);
+            }
+
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            elapsed = std::chrono::duration<double>(end - start).count();
+
+            if(elapsed >= minTime || reps >= (1L << 30)) {
+                break;
+            }
+
+            reps *= 2;
+        }
+
+        double ns = elapsed * 1.0e9 / reps;
+        if(best < 0.0 || ns < best) {
+            best = ns;
+            repsOut = reps;
+        }
+    }
+
+    particles->copyFrom(snapshot);
+    ctx.cloth->onParticlesRestored();
+
+    return best;
+}
+
+//****************************************************
+// Make Sphere Mesh:
+//      - Each face of a cube cut into n x n squares,
+//        two triangles each, and pushed out onto the
+//        sphere; wound to face out
+//****************************************************
+void makeSphereMesh(glm::vec3 center, float radius, int n, TriangleMesh& mesh) {
+    // Each face's normal, then its two edge directions, ordered so the triangles face out
+    const glm::vec3 faces[6][3] = {
+        { glm::vec3( 1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1) },
+        { glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0) },
+        { glm::vec3(0,  1, 0), glm::vec3(0, 0, 1), glm::vec3(1, 0, 0) },
+        { glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1) },
+        { glm::vec3(0, 0,  1), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0) },
+        { glm::vec3(0, 0, -1), glm::vec3(0, 1, 0), glm::vec3(1, 0, 0) }
+    };
+
+    std::vector<glm::vec3> vertices;
+    std::vector<int> indices;
+
+    for(int f = 0; f < 6; f++) {
+        int base = (int) vertices.size();
+
+        for(int j = 0; j <= n; j++) {
+            for(int i = 0; i <= n; i++) {
+                glm::vec3 c = faces[f][0] + faces[f][1] * (2.0f * i / n - 1.0f) + faces[f][2] * (2.0f * j / n - 1.0f);
+                vertices.push_back(center + radius * glm::normalize(c));
+            }
+        }
+
+        for(int j = 0; j < n; j++) {
+            for(int i = 0; i < n; i++) {
+                int a = base + j * (n + 1) + i;
+
+                indices.push_back(a);
+                indices.push_back(a + 1);
+                indices.push_back(a + n + 2);
+                indices.push_back(a);
+                indices.push_back(a + n + 2);
+                indices.push_back(a + n + 1);
+            }
+        }
+    }
+
+    mesh.setTriangles(vertices, indices);
+}
+
+//****************************************************
+// Setup Grid:
+//      - Pins two corners and warms the cloth up
+//        falling onto the sphere so springs are
+//        stretched
+//****************************************************
+void setupGrid(BenchContext& ctx) {
+    Cloth& cloth = *ctx.cloth;
+
+    cloth.setFixedCorners(true, true, false, false);
+    cloth.setThreadPool(pool);
+    cloth.setSimdKernels(kernels);
+
+    if(parallelMin > 0) {
+        cloth.setParallelThreshold(parallelMin);
+    }
+
+    // Explicit springs are only stable for dt well below sqrt(m / k), and
+    // denser grids have lighter particles and stiffer springs
+    ParticleStore* p = cloth.getParticles();
+    SpringSpan all = cloth.getSprings().getAll();
+
+    float minMass = p->mass[0];
+    for(int i = 1; i < p->size(); i++) {
+        minMass = std::min(minMass, p->mass[i]);
+    }
+
+    float maxStiffness = 0.0f;
+    for(int s = 0; s < all.size(); s++) {
+        maxStiffness = std::max(maxStiffness, all.stiffness[s]);
+    }
+
+    ctx.timestep = BENCH_STEP;
+    if(maxStiffness > 0.0f) {
+        ctx.timestep = std::min(BENCH_STEP, STABLE_STEP_FACTOR * sqrtf(minMass / maxStiffness));
+    }
+
+    // Verlet damps, Euler would blow up before the first measurement
+    bool wasEuler = cloth.isEuler();
+    cloth.setEuler(false);
+
+    for(int i = 0; i < warmupSteps; i++) {
+        cloth.addConstantAccel(glm::vec3(0.0f, -9.81f, 0.0f));
+        cloth.update(ctx.timestep);
+        cloth.updateCollision(ctx.sphere);
+    }
+
+    cloth.setEuler(wasEuler);
+}
+
+//****************************************************
+// Bench Grid:
+//      - Builds an n x n cloth, warms it up falling
+//        onto a sphere and times every kernel
+//****************************************************
+void benchGrid(int n, std::vector<BenchResult>& results) {
+    Cloth cloth(n, n);
+
+    // Default cloth spans [-1, 1] in x & z at y = 0
+    Sphere sphere(glm::vec3(0.0f, -0.55f, 0.0f), 0.6f);
+    Plane plane(glm::vec3(-2.0f, -0.02f, -2.0f), glm::vec3(2.0f, -0.02f, -2.0f),
+                glm::vec3(2.0f, -0.02f, 2.0f), glm::vec3(-2.0f, -0.02f, 2.0f));
+
+    BenchContext ctx;
+    ctx.cloth = &cloth;
+    ctx.sphere = &sphere;
+    ctx.plane = &plane;
+
+    std::vector<Shape*> pair;
+    pair.push_back(&sphere);
+    pair.push_back(&plane);
+    ctx.colliders.build(pair);
+
+    // Just under the cloth's warmed up sag, so its lowest vertices reach a few
+    std::vector<Sphere> field;
+    for(int z = 0; z < FIELD_SIDE; z++) {
+        for(int x = 0; x < FIELD_SIDE; x++) {
+            glm::vec3 center(-1.0f + 2.0f * (x + 0.5f) / FIELD_SIDE, -0.08f, -1.0f + 2.0f * (z + 0.5f) / FIELD_SIDE);
+            field.push_back(Sphere(center, FIELD_RADIUS));
+        }
+    }
+
+    for(int i = 0; i < field.size(); i++) {
+        ctx.field.push_back(&field[i]);
+    }
+    ctx.broad.build(ctx.field);
+    ctx.fieldColliders.build(ctx.field);
+
+    TriangleMesh sphereMesh;
+    makeSphereMesh(glm::vec3(0.0f, -0.55f, 0.0f), 0.6f, MESH_SIDE, sphereMesh);
+
+    TriangleMeshShape meshShape;
+    meshShape.setMesh(sphereMesh);
+
+    std::vector<Shape*> meshList(1, &meshShape);
+    ctx.meshBroad.build(meshList);
+    ctx.meshColliders.build(meshList);
+
+    setupGrid(ctx);
+    runWindFieldUpdate(ctx);
+
+    // The implicit system's structure is built once here; the kernels only refill & multiply it
+    ParticleStore* particles = cloth.getParticles();
+    cloth.getImplicitSolver().assemble(particles, cloth.getSprings(), ctx.timestep, pool);
+
+    ctx.input.resize(particles->size());
+    ctx.output.resize(particles->size());
+
+    for(int i = 0; i < particles->size(); i++) {
+        ctx.input.x[i] = particles->vx[i];
+        ctx.input.y[i] = particles->vy[i];
+        ctx.input.z[i] = particles->vz[i];
+    }
+
+    bool wasEuler = cloth.isEuler();
+
+    ParticleStore snapshot;
+    snapshot.copyFrom(*cloth.getParticles());
+
+    int vertices = cloth.getNumVertices();
+    int springs = cloth.getSprings().size();
+
+    for(int k = 0; k < NUM_KERNELS; k++) {
+        long reps = 0;
+        double ns = timeKernel(KERNELS[k], ctx, snapshot, reps);
+        cloth.setEuler(wasEuler);
+
+        BenchResult r;
+        r.kernel = KERNELS[k].name;
+        r.grid = n;
+        r.vertices = vertices;
+        r.springs = springs;
+        r.reps = reps;
+        r.nsPerCall = ns;
+        r.nsPerVertex = ns / vertices;
+        r.nsPerSpring = ns / springs;
+
+        double bytes = KERNELS[k].bytesPerVertex * (double) vertices + KERNELS[k].bytesPerSpring * (double) springs;
+        r.gbPerSec = bytes / ns;    // bytes per ns == GB/s
+
+        results.push_back(r);
+
+        std::cerr << std::setw(24) << std::left << r.kernel << std::right
+                  << std::setw(6) << n
+                  << std::setw(14) << std::fixed << std::setprecision(1) << r.nsPerCall / 1000.0 << " us"
+                  << std::setw(10) << std::setprecision(3) << r.nsPerVertex << " ns/vtx"
+                  << std::setw(10) << r.nsPerSpring << " ns/spr"
+                  << std::setw(9) << std::setprecision(2) << r.gbPerSec << " GB/s" << std::endl;
+    }
+}
+
+//****************************************************
+// Max Error:
+//      - Largest difference between two copies of an
+//        array, relative to the largest reference value
+//****************************************************
+double maxError(const float* reference, const float* test, int count) {
+    double maxDiff = 0.0;
+    double maxValue = 0.0;
+
+    for(int i = 0; i < count; i++) {
+        double diff = std::fabs((double) reference[i] - (double) test[i]);
+
+        // Written so a NaN in either array is carried through as a failure
+        if(!(diff <= maxDiff)) {
+            maxDiff = diff;
+        }
+
+        maxValue = std::max(maxValue, (double) std::fabs(reference[i]));
+    }
+
+    return maxDiff / std::max(maxValue, 1.0e-6);
+}
+
+//****************************************************
+// Verify Grid:
+//      - Runs each SIMD kernel and the scalar one from
+//        the same warmed up state and compares every
+//        array they write
+//      - Returns the number of failures
+//****************************************************
+int verifyGrid(int n) {
+    const KernelFunc checked[] = { runUpdateSprings, runLengthConstraints, runIntegrateEuler, runIntegrateVerlet,
+                                   runCollideSphereBatch, runCollidePlaneBatch };
+    const char* checkedNames[] = { "updateSprings", "applyLengthConstraints", "integrateEuler", "integrateVerlet",
+                                   "collideSphereBatch", "collidePlaneBatch" };
+    const int numChecked = 6;
+
+    Cloth cloth(n, n);
+
+    Sphere sphere(glm::vec3(0.0f, -0.55f, 0.0f), 0.6f);
+    Plane plane(glm::vec3(-2.0f, -0.02f, -2.0f), glm::vec3(2.0f, -0.02f, -2.0f),
+                glm::vec3(2.0f, -0.02f, 2.0f), glm::vec3(-2.0f, -0.02f, 2.0f));
+
+    BenchContext ctx;
+    ctx.cloth = &cloth;
+    ctx.sphere = &sphere;
+    ctx.plane = &plane;
+
+    std::vector<Shape*> pair;
+    pair.push_back(&sphere);
+    pair.push_back(&plane);
+    ctx.colliders.build(pair);
+
+    setupGrid(ctx);
+
+    ParticleStore* particles = cloth.getParticles();
+
+    ParticleStore snapshot;
+    snapshot.copyFrom(*particles);
+
+    ParticleStore reference;
+
+    int failures = 0;
+
+    for(int isa = SIMD_SCALAR + 1; isa < NUM_SIMD_ISAS; isa++) {
+        const SimdKernels* table = getSimdKernels((SimdISA) isa);
+        if(table == NULL) {
+            continue;
+        }
+
+        for(int k = 0; k < numChecked; k++) {
+            particles->copyFrom(snapshot);
+            cloth.onParticlesRestored();
+            cloth.setSimdKernels(getSimdKernels(SIMD_SCALAR));
+            checked[k](ctx);
+            reference.copyFrom(*particles);
+
+            particles->copyFrom(snapshot);
+            cloth.onParticlesRestored();
+            cloth.setSimdKernels(table);
+            checked[k](ctx);
+
+            const float* refArrays[] = { reference.px, reference.py, reference.pz, reference.ox, reference.oy, reference.oz,
+                                         reference.vx, reference.vy, reference.vz, reference.fx, reference.fy, reference.fz };
+            const float* testArrays[] = { particles->px, particles->py, particles->pz, particles->ox, particles->oy, particles->oz,
+                                          particles->vx, particles->vy, particles->vz, particles->fx, particles->fy, particles->fz };
+
+            double error = 0.0;
+            for(int a = 0; a < 12; a++) {
+                double e = maxError(refArrays[a], testArrays[a], particles->size());
+                error = (e != e || e > error) ? e : error;
+            }
+
+            bool pass = (error <= VERIFY_TOLERANCE);
+            if(!pass) {
+                failures++;
+            }
+
+            std::cerr << std::setw(8) << std::left << table->name << std::setw(24) << checkedNames[k] << std::right
+                      << std::setw(6) << n
+                      << std::setw(14) << std::scientific << std::setprecision(3) << error << std::fixed
+                      << (pass ? "  PASS" : "  FAIL") << std::endl;
+        }
+    }
+
+    particles->copyFrom(snapshot);
+    cloth.onParticlesRestored();
+
+    return failures;
+}
+
+//****************************************************
+// Write JSON
+//****************************************************
+void writeJSON(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << "{" << std::endl;
+    out << "  \"benchmark\": \"cloth_bench\"," << std::endl;
+    out << "  \"min_time_s\": " << minTime << "," << std::endl;
+    out << "  \"threads\": " << pool->getNumThreads() << "," << std::endl;
+    out << "  \"isa\": \"" << kernels->name << "\"," << std::endl;
+    out << "  \"results\": [" << std::endl;
+
+    for(int i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+
+        out << "    { \"kernel\": \"" << r.kernel << "\""
+            << ", \"grid\": " << r.grid
+            << ", \"vertices\": " << r.vertices
+            << ", \"springs\": " << r.springs
+            << ", \"reps\": " << r.reps
+            << std::setprecision(6) << std::scientific
+            << ", \"ns_per_call\": " << r.nsPerCall
+            << ", \"ns_per_vertex\": " << r.nsPerVertex
+            << ", \"ns_per_spring\": " << r.nsPerSpring
+            << ", \"gb_per_s\": " << r.gbPerSec
+            << " }" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
+
+//****************************************************
+// Process Inputs
+//      - ./cloth_bench [-sizes 20,50,...] [-min-time S] [-threads N]
+//                      [-parallel-min N] [-isa NAME] [-verify] [-o file]
+//****************************************************
+void processInputs(int argc, char *argv[]) {
+    for(int arg = 1; arg < argc; arg++) {
+        std::string flag = argv[arg];
+
+        if(flag == "-sizes" && arg + 1 < argc) {
+            std::stringstream list(argv[++arg]);
+            std::string item;
+
+            while(std::getline(list, item, ',')) {
+                gridSizes.push_back(atoi(item.c_str()));
+            }
+        } else if(flag == "-min-time" && arg + 1 < argc) {
+            minTime = atof(argv[++arg]);
+        } else if(flag == "-threads" && arg + 1 < argc) {
+            numThreads = atoi(argv[++arg]);
+        } else if(flag == "-parallel-min" && arg + 1 < argc) {
+            parallelMin = atoi(argv[++arg]);
+        } else if(flag == "-isa" && arg + 1 < argc) {
+            kernels = findSimdKernels(argv[++arg]);
+
+            if(kernels == NULL) {
+                std::cerr << "SIMD kernels not available on this CPU: " << argv[arg] << std::endl;
+                std::exit(1);
+            }
+        } else if(flag == "-verify") {
+            verify = true;
+        } else if(flag == "-o" && arg + 1 < argc) {
+            outputFile = argv[++arg];
+        } else {
+            std::cerr << "USAGE: ./cloth_bench [-sizes 20,50,100] [-min-time S] [-threads N] [-parallel-min N] [-isa NAME] [-verify] [-o file.json]" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    // Matches test/cloth20x20, freefall100x100 & freefall200x200, plus larger grids
+    if(gridSizes.empty()) {
+        int defaults[] = { 20, 50, 100, 200, 500, 1000 };
+        gridSizes.assign(defaults, defaults + 6);
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    processInputs(argc, argv);
+
+    if(kernels == NULL) {
+        kernels = getBestSimdKernels();
+    }
+
+    pool = new ThreadPool(numThreads);
+    std::cerr << "Threads: " << pool->getNumThreads() << "  SIMD: " << kernels->name << std::endl;
+
+    // Exit status is the number of kernels outside tolerance
+    if(verify) {
+        int failures = 0;
+
+        for(int i = 0; i < gridSizes.size(); i++) {
+            failures += verifyGrid(gridSizes[i]);
+        }
+
+        std::cerr << (failures == 0 ? "All SIMD kernels agree with scalar" : "SIMD kernels disagree with scalar") << std::endl;
+
+        delete pool;
+        return failures;
+    }
+
+    std::vector<BenchResult> results;
+
+    for(int i = 0; i < gridSizes.size(); i++) {
+        benchGrid(gridSizes[i], results);
+    }
+
+    if(outputFile != NULL) {
+        std::ofstream out(outputFile);
+        writeJSON(out, results);
+    } else {
+        writeJSON(std::cout, results);
+    }
+
+    delete pool;
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "BlockSparseMatrix.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Block Sparse Matrix - Constructors
+//****************************************************
+BlockSparseMatrix::BlockSparseMatrix() {
+    numRows = 0;
+    numEdges = 0;
+
+    rowStart.assign(1, 0);
+}
+
+//****************************************************
+// Build:
+//      - Counts each row's neighbours, fills & sorts
+//        their columns, then drops repeated edges
+//      - Edges with i0 == i1 map onto the diagonal
+//      - Values start at zero
+//****************************************************
+void BlockSparseMatrix::build(int rows, const int* i0, const int* i1, int count) {
+    numRows = rows;
+    numEdges = count;
+
+    // Diagonal plus every edge end, before repeats are merged
+    std::vector<int> counts(rows + 1, 1);
+    counts[rows] = 0;
+
+    for(int e = 0; e < count; e++) {
+        if(i0[e] != i1[e]) {
+            counts[i0[e]]++;
+            counts[i1[e]]++;
+        }
+    }
+
+    std::vector<int> start(rows + 1, 0);
+    for(int i = 0; i < rows; i++) {
+        start[i + 1] = start[i] + counts[i];
+    }
+
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    std::vector<int> candidates(start[rows]);
+
+    for(int i = 0; i < rows; i++) {
+        candidates[fill[i]++] = i;
+    }
+
+    for(int e = 0; e < count; e++) {
+        if(i0[e] != i1[e]) {
+            candidates[fill[i0[e]]++] = i1[e];
+            candidates[fill[i1[e]]++] = i0[e];
+        }
+    }
+
+    // Sorted, unique columns per row
+    rowStart.assign(rows + 1, 0);
+    columns.clear();
+    columns.reserve(candidates.size());
+
+    for(int i = 0; i < rows; i++) {
+        std::sort(candidates.begin() + start[i], candidates.begin() + start[i + 1]);
+
+        for(int c = start[i]; c < start[i + 1]; c++) {
+            if(c == start[i] || candidates[c] != candidates[c - 1]) {
+                columns.push_back(candidates[c]);
+            }
+        }
+
+        rowStart[i + 1] = (int) columns.size();
+    }
+
+    diagonalSlots.resize(rows);
+    for(int i = 0; i < rows; i++) {
+        diagonalSlots[i] = findSlot(i, i);
+    }
+
+    forwardSlots.resize(count);
+    reverseSlots.resize(count);
+    for(int e = 0; e < count; e++) {
+        forwardSlots[e] = findSlot(i0[e], i1[e]);
+        reverseSlots[e] = findSlot(i1[e], i0[e]);
+    }
+
+    values.assign(columns.size() * BLOCK_VALUES, 0.0f);
+}
+
+// Binary search of a row's sorted columns
+int BlockSparseMatrix::findSlot(int row, int column) const {
+    std::vector<int>::const_iterator first = columns.begin() + rowStart[row];
+    std::vector<int>::const_iterator last = columns.begin() + rowStart[row + 1];
+    std::vector<int>::const_iterator found = std::lower_bound(first, last, column);
+
+    return (found != last && *found == column) ? (int) (found - columns.begin()) : -1;
+}
+
+void BlockSparseMatrix::forEachRowChunk(ThreadPool* pool, const std::function<void(int, int)>& body) const {
+    if(pool == NULL) {
+        body(0, numRows);
+    } else {
+        pool->parallelFor(0, numRows, body);
+    }
+}
+
+//****************************************************
+// Set Zero:
+//      - Clears every block of a row range per thread
+//****************************************************
+void BlockSparseMatrix::setZero(ThreadPool* pool) {
+    forEachRowChunk(pool, [this](int begin, int end) {
+        std::fill(values.begin() + rowStart[begin] * BLOCK_VALUES, values.begin() + rowStart[end] * BLOCK_VALUES, 0.0f);
+    });
+}
+
+//****************************************************
+// Multiply:
+//      - Each row sums its blocks in column order, so
+//        the result is the same for any thread count
+//****************************************************
+void BlockSparseMatrix::multiply(const SolverVector& in, SolverVector& out, ThreadPool* pool) const {
+    forEachRowChunk(pool, [this, &in, &out](int begin, int end) {
+        const int* col = columns.data();
+        const float* block = values.data();
+
+        const float* inX = in.x.data();
+        const float* inY = in.y.data();
+        const float* inZ = in.z.data();
+
+        for(int i = begin; i < end; i++) {
+            float sx = 0.0f;
+            float sy = 0.0f;
+            float sz = 0.0f;
+
+            for(int slot = rowStart[i]; slot < rowStart[i + 1]; slot++) {
+                const float* b = block + slot * BLOCK_VALUES;
+                int c = col[slot];
+
+                float x = inX[c], y = inY[c], z = inZ[c];
+
+                sx += b[0] * x + b[1] * y + b[2] * z;
+                sy += b[3] * x + b[4] * y + b[5] * z;
+                sz += b[6] * x + b[7] * y + b[8] * z;
+            }
+
+            out.x[i] = sx;
+            out.y[i] = sy;
+            out.z[i] = sz;
+        }
+    });
+}
@@ -0,0 +1,113 @@
+#ifndef BLOCKSPARSEMATRIX_H
+#define BLOCKSPARSEMATRIX_H
+
+#include <vector>
+#include <functional>
+#include "ThreadPool.h"
+
+//****************************************************
+// Block Sparse Matrix Header Definition
+//      - Square matrix of 3x3 blocks stored in block
+//        CSR (BSR) form: per row, its blocks' columns
+//        in increasing order & 9 row-major values each
+//      - The symbolic structure comes from an edge
+//        list (the cloth's springs) and is built once;
+//        every row holds its diagonal block plus one
+//        block per distinct neighbour
+//      - Each edge remembers the slots of its (a, b) &
+//        (b, a) blocks, so refilling values touches no
+//        index search and allocates nothing
+//****************************************************
+
+// Floats per 3x3 block
+const int BLOCK_VALUES = 9;
+
+//****************************************************
+// Solver Vector
+//      - One 3-vector per row, SoA like the
+//        ParticleStore
+//****************************************************
+struct SolverVector {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    void resize(int n) { x.assign(n, 0.0f); y.assign(n, 0.0f); z.assign(n, 0.0f); };
+    int size() const { return (int) x.size(); };
+};
+
+//****************************************************
+// Symmetric 3x3 Blocks
+//      - xx, xy, xz, yy, yz, zz of each block
+//****************************************************
+struct SymmetricBlocks {
+    std::vector<float> xx, xy, xz, yy, yz, zz;
+
+    void resize(int n) {
+        xx.assign(n, 0.0f); xy.assign(n, 0.0f); xz.assign(n, 0.0f);
+        yy.assign(n, 0.0f); yz.assign(n, 0.0f); zz.assign(n, 0.0f);
+    };
+
+    // Adds c * n n^T to block i
+    void addOuter(int i, float nx, float ny, float nz, float c) {
+        xx[i] += c * nx * nx;  xy[i] += c * nx * ny;  xz[i] += c * nx * nz;
+        yy[i] += c * ny * ny;  yz[i] += c * ny * nz;  zz[i] += c * nz * nz;
+    };
+
+    // Adds c * I to block i
+    void addIdentity(int i, float c) {
+        xx[i] += c;  yy[i] += c;  zz[i] += c;
+    };
+};
+
+class BlockSparseMatrix {
+  private:
+    int numRows;
+    int numEdges;
+
+    // Row i's blocks are slots [rowStart[i], rowStart[i + 1])
+    std::vector<int> rowStart;
+    std::vector<int> columns;
+
+    // Slot of each row's diagonal block & of each edge's two off diagonal blocks
+    std::vector<int> diagonalSlots;
+    std::vector<int> forwardSlots;      // Block (i0, i1) of edge e
+    std::vector<int> reverseSlots;      // Block (i1, i0) of edge e
+
+    std::vector<float> values;
+
+    // Rows split into one contiguous range per thread, pool may be NULL
+    void forEachRowChunk(ThreadPool* pool, const std::function<void(int, int)>& body) const;
+
+  public:
+    BlockSparseMatrix();
+
+    // Symbolic structure of rows x rows blocks for count edges (i0[e], i1[e])
+    void build(int rows, const int* i0, const int* i1, int count);
+
+    // Values
+    void setZero(ThreadPool* pool);
+    float* getBlock(int slot) { return &values[slot * BLOCK_VALUES]; };
+    const float* getBlock(int slot) const { return &values[slot * BLOCK_VALUES]; };
+
+    // out = A in; rows are independent, so this needs no coloring
+    void multiply(const SolverVector& in, SolverVector& out, ThreadPool* pool) const;
+
+    // Structure
+    int getNumRows() const { return numRows; };
+    int getNumEdges() const { return numEdges; };
+    int getNumBlocks() const { return (int) columns.size(); };
+
+    int getRowStart(int row) const { return rowStart[row]; };
+    int getRowEnd(int row) const { return rowStart[row + 1]; };
+    int getColumn(int slot) const { return columns[slot]; };
+
+    // Slot of block (row, column) by binary search, -1 if the block is not stored
+    int findSlot(int row, int column) const;
+
+    int getDiagonalSlot(int row) const { return diagonalSlots[row]; };
+    int getForwardSlot(int edge) const { return forwardSlots[edge]; };
+    int getReverseSlot(int edge) const { return reverseSlots[edge]; };
+};
+
+#endif
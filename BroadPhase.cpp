@@ -0,0 +1,160 @@
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "BroadPhase.h"
+
+
+//****************************************************
+// Broad Phase Class - Constants
+//****************************************************
+
+// Shapes per leaf
+const int LEAF_SHAPES = 4;
+
+// An infinite side counts as ending here when picking a split
+const float BIG_EXTENT = 1e30f;
+
+// Every shape's box grows by this on each side, so a contact on its very edge is not missed
+const float BOX_PADDING = 1e-3f;
+
+//****************************************************
+// Broad Phase - Constructors
+//****************************************************
+BroadPhase::BroadPhase() {
+}
+
+//****************************************************
+// Build:
+//      - A node's shapes are a run of order; split at
+//        the median of their box centres along the
+//        axis the centres spread furthest, ties broken
+//        by index so any two builds agree
+//****************************************************
+void BroadPhase::build(const std::vector<Shape*>& shapes) {
+    int n = (int) shapes.size();
+
+    shapeLo.resize(n);
+    shapeHi.resize(n);
+    order.resize(n);
+
+    for(int i = 0; i < n; i++) {
+        shapes[i]->getBounds(shapeLo[i], shapeHi[i]);
+        shapeLo[i] -= glm::vec3(BOX_PADDING);
+        shapeHi[i] += glm::vec3(BOX_PADDING);
+        order[i] = i;
+    }
+
+    nodes.clear();
+    if(n > 0) {
+        nodes.reserve(2 * n);
+        nodes.resize(1);
+        buildNode(0, 0, n);
+    }
+}
+
+static float clampExtent(float v) {
+    return (v < -BIG_EXTENT) ? -BIG_EXTENT : (v > BIG_EXTENT) ? BIG_EXTENT : v;
+}
+
+// Fills in node 'at' over order[begin, end)
+void BroadPhase::buildNode(int at, int begin, int end) {
+    glm::vec3 lo = shapeLo[order[begin]];
+    glm::vec3 hi = shapeHi[order[begin]];
+    glm::vec3 centreLo(HUGE_VALF);
+    glm::vec3 centreHi(-HUGE_VALF);
+
+    for(int k = begin; k < end; k++) {
+        int s = order[k];
+        lo = glm::min(lo, shapeLo[s]);
+        hi = glm::max(hi, shapeHi[s]);
+
+        for(int a = 0; a < 3; a++) {
+            float centre = 0.5f * clampExtent(shapeLo[s][a]) + 0.5f * clampExtent(shapeHi[s][a]);
+            centreLo[a] = std::min(centreLo[a], centre);
+            centreHi[a] = std::max(centreHi[a], centre);
+        }
+    }
+
+    nodes[at].lo = lo;
+    nodes[at].hi = hi;
+
+    if(end - begin <= LEAF_SHAPES) {
+        nodes[at].first = begin;
+        nodes[at].count = end - begin;
+        return;
+    }
+
+    int axis = 0;
+    for(int a = 1; a < 3; a++) {
+        if(centreHi[a] - centreLo[a] > centreHi[axis] - centreLo[axis]) {
+            axis = a;
+        }
+    }
+
+    const std::vector<glm::vec3>& sLo = shapeLo;
+    const std::vector<glm::vec3>& sHi = shapeHi;
+    int mid = (begin + end) / 2;
+
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+        [&sLo, &sHi, axis](int l, int r) {
+            float cl = 0.5f * clampExtent(sLo[l][axis]) + 0.5f * clampExtent(sHi[l][axis]);
+            float cr = 0.5f * clampExtent(sLo[r][axis]) + 0.5f * clampExtent(sHi[r][axis]);
+            return (cl < cr) || (cl == cr && l < r);
+        });
+
+    // Children sit side by side, so an inner node only keeps its left child's index
+    int left = (int) nodes.size();
+    nodes[at].first = left;
+    nodes[at].count = 0;
+    nodes.resize(left + 2);
+
+    buildNode(left, begin, mid);
+    buildNode(left + 1, mid, end);
+}
+
+//****************************************************
+// Query:
+//      - Walks the tree with a small stack, collecting
+//        the shapes of every leaf box that overlaps,
+//        then each shape's own box, then sorts
+//****************************************************
+void BroadPhase::query(glm::vec3 lo, glm::vec3 hi, std::vector<int>& found) const {
+    found.clear();
+
+    if(nodes.empty()) {
+        return;
+    }
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while(top > 0) {
+        const Node& node = nodes[stack[--top]];
+
+        if(node.lo.x > hi.x || node.hi.x < lo.x ||
+           node.lo.y > hi.y || node.hi.y < lo.y ||
+           node.lo.z > hi.z || node.hi.z < lo.z) {
+            continue;
+        }
+
+        if(node.count == 0) {
+            stack[top++] = node.first;
+            stack[top++] = node.first + 1;
+            continue;
+        }
+
+        for(int k = node.first; k < node.first + node.count; k++) {
+            int s = order[k];
+
+            if(shapeLo[s].x <= hi.x && shapeHi[s].x >= lo.x &&
+               shapeLo[s].y <= hi.y && shapeHi[s].y >= lo.y &&
+               shapeLo[s].z <= hi.z && shapeHi[s].z >= lo.z) {
+                found.push_back(s);
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+}
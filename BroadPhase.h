@@ -0,0 +1,55 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "Shape.h"
+
+//****************************************************
+// Broad Phase Header Definition
+//      - Bounding volume hierarchy over the boxes of
+//        a scene's Shapes, so a patch of cloth only
+//        runs collide against the shapes its box
+//        overlaps
+//      - Built top down, splitting each node's shapes
+//        at the median centre along its longest axis;
+//        leaves hold up to LEAF_SHAPES shapes
+//      - Boxes may be infinite on a side (a plane);
+//        those still overlap correctly, and split as
+//        if ending at +-BIG_EXTENT
+//      - query returns shape indices in ascending
+//        order, so every particle meets its shapes in
+//        scene order as without a broad phase
+//****************************************************
+
+class BroadPhase {
+  private:
+    struct Node {
+        glm::vec3 lo;
+        glm::vec3 hi;
+        int first;              // Leaf: first of count entries in order. Inner: left child, right is first + 1
+        int count;              // 0 for an inner node
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> order;     // Shape indices, each leaf's a contiguous run
+
+    std::vector<glm::vec3> shapeLo;
+    std::vector<glm::vec3> shapeHi;
+
+    void buildNode(int at, int begin, int end);
+
+  public:
+    BroadPhase();
+
+    // Reads every shape's bounds; shapes must not move or change until the next build
+    void build(const std::vector<Shape*>& shapes);
+
+    int getNumShapes() const { return (int) shapeLo.size(); };
+    int getNumNodes() const { return (int) nodes.size(); };
+
+    // Indices of the shapes whose boxes overlap [lo, hi], ascending
+    void query(glm::vec3 lo, glm::vec3 hi, std::vector<int>& found) const;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <math.h>
 #include <vector>
+#include <functional>
 #include "glm/glm.hpp"
 
 #include "Cloth.h"
@@ -15,18 +16,24 @@
 bool debug = false;
 bool useSpringForce = true;
 
+// Below this many vertices (about 64 x 64) a pass is cheaper than waking the pool,
+// so test/cloth20x20 and similar stay single-threaded
+const int PARALLEL_MIN_VERTICES = 4096;
+
+const char* INTEGRATOR_NAMES[NUM_INTEGRATORS] = { "Euler", "Verlet", "Implicit Euler", "XPBD", "Projective Dynamics" };
+
 //****************************************************
 // Cloth Class - Constructors
 //****************************************************
 Cloth::Cloth() {
-    euler = true;
+    integrator = EULER;
     initCounts();
 
     createDefaultCloth(20, 20);
 }
 
 Cloth::Cloth(int w, int h) {
-    euler = true;
+    integrator = EULER;
     initCounts();
 
     createDefaultCloth(w, h);
@@ -43,7 +50,7 @@ Cloth::Cloth(int w, int h) {
 //      - Also determines the spring constants based
 //          on the length of the divisions
 //****************************************************
-Cloth::Cloth(int density, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Vertex* downLeft, bool isEuler) {
+Cloth::Cloth(int density, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Vertex* downLeft, IntegratorType type) {
     initCounts();
 
     // Determine which edge is shorter:
@@ -67,7 +74,7 @@ Cloth::Cloth(int density, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Ve
     }
 
 
-    euler = isEuler;
+    integrator = type;
 
     horizVec = horizVec / (float)(this->width - 1);
     vertVec = vertVec / (float)(this->height - 1);
@@ -92,13 +99,13 @@ Cloth::Cloth(int density, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Ve
 //            Into W x H vertices
 //
 //****************************************************
-Cloth::Cloth(int w, int h, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Vertex* downLeft, bool isEuler) {
+Cloth::Cloth(int w, int h, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Vertex* downLeft, IntegratorType type) {
     initCounts();
 
     this->width = w;
     this->height = h;
 
-    euler = isEuler;
+    integrator = type;
 
     glm::vec3 vertVec = upLeft->vectorTo(downLeft);
     glm::vec3 horizVec = upLeft->vectorTo(upRight);
@@ -124,6 +131,13 @@ void Cloth::initCounts() {
     numBendSprings = 0;
 
     areNormalsUpdated = false;
+
+    pool = NULL;
+    parallelThreshold = PARALLEL_MIN_VERTICES;
+    useStencil = false;
+    useAerodynamics = true;
+
+    kernels = getBestSimdKernels();
 }
 
 
@@ -160,16 +174,20 @@ void Cloth::createVertices(glm::vec3 upLeft, glm::vec3 vertStep, glm::vec3 horiz
     
     // Sets the radius of the spheres that will be drawn for the points when drawing the structure
     pointDrawSize = glm::length(horizStep)*0.2;
-    std::cout << "Poind Draw Size = " << pointDrawSize << std::endl;
+    if(debug) {
+        std::cout << "Poind Draw Size = " << pointDrawSize << std::endl;
+    }
 
-    // Sets size of the Vector holding the vertices to W * H
+    // Sets size of the Particle Store to W * H
     numVertices = this->width * this->height;
-    vertexMatrix.resize(numVertices);
+    particles.resize(numVertices);
 
     mass = 100.0f;
 
     float vertexMass = mass / (float) numVertices;
-    std::cout << "Vertex Mass = " << vertexMass << std::endl;
+    if(debug) {
+        std::cout << "Vertex Mass = " << vertexMass << std::endl;
+    }
 
     actualWidth = glm::length(horizStep) * (this->width - 1); 
     actualHeight = glm::length(vertStep) * (this->height - 1);
@@ -189,19 +207,15 @@ void Cloth::createVertices(glm::vec3 upLeft, glm::vec3 vertStep, glm::vec3 horiz
     for(int h = 0; h < this->height; h++) {
         for(int w = 0; w < this->width; w++) {
 
-            //I*W + j indexes vertexMatrix like a 2D array vertexMatrix[i][j]; 
+            //I*W + j indexes particles like a 2D array particles[i][j];
             int vertIndex = h * (this->width) + w;
 
             glm::vec3 temp = upLeft + ((float)h * vertStep) + ((float)w * horizStep);
             
-            vertexMatrix[vertIndex] = new Vertex(temp.x, temp.y, temp.z);
-
-            //vertexMatrix[vertIndex] = new Vertex(temp.x, temp.y, temp.z, stretchConst, shearConst, bendConst);
-            //vertexMatrix[vertIndex]->setSpringRestLengths(stretchLength, bendLength, shearLength); 
-
-            // Sets its position in the Grid of the cloth
-            vertexMatrix[vertIndex]->setPosition(w, h);
-            vertexMatrix[vertIndex]->setMass(vertexMass);
+            // Previous Position starts at the current one (Verlet at rest)
+            particles.setPos(vertIndex, temp);
+            particles.setPrevPos(vertIndex, temp);
+            particles.setMass(vertIndex, vertexMass);
 
         }        
     }
@@ -215,82 +229,484 @@ void Cloth::createVertices(glm::vec3 upLeft, glm::vec3 vertStep, glm::vec3 horiz
 //          satisfy constraints after update.
 //****************************************************
 void Cloth::update(float timestep) {
-    // Iterate through vertexMatrix, and update each individual particle
+    // Iterate through the particles, and update each individual particle
 
-    updateSprings();
-    addAerodynamicDrag();
+    // XPBD & Projective Dynamics solve the springs inside integrate
+    bool springForces = (integrator != XPBD && integrator != PROJECTIVE_DYNAMICS);
 
-    for(int i = 0; i < height*width; i++) {
-        vertexMatrix[i]->update(timestep, euler);
+    if(springForces) {
+        updateSprings();
     }
 
-    if(useSpringForce) {
+    if(useAerodynamics) {
+        addAerodynamicDrag();
+    }
+
+    integrate(timestep);
+
+    if(useSpringForce && springForces) {
         applyLengthConstraints();
     }
 
+    refitTileBoxes();
+
     areNormalsUpdated = false;
 }
 
 
+//****************************************************
+// Integrate:
+//      - Moves every particle by its accumulated
+//          force with the Cloth's integration method
+//****************************************************
+void Cloth::integrate(float timestep) {
+    if(integrator == EULER) {
+        forEachAwakeChunk([this, timestep](int begin, int end) {
+            kernels->updateEuler(&particles, timestep, begin, end);
+        });
+    } else if(integrator == VERLET) {
+        forEachAwakeChunk([this, timestep](int begin, int end) {
+            kernels->updateVerlet(&particles, timestep, begin, end);
+        });
+    } else if(integrator == IMPLICIT_EULER) {
+        implicitSolver.step(&particles, springs, timestep, isParallel() ? pool : NULL);
+    } else if(integrator == XPBD) {
+        xpbdSolver.step(&particles, springs, timestep, isParallel() ? pool : NULL);
+    } else {
+        projectiveSolver.step(&particles, springs, timestep, isParallel() ? pool : NULL);
+    }
+}
+
+
+//****************************************************
+// Parallel Pass Helpers:
+//      - Vertex passes are split into chunks of whole
+//        PARTICLE_PAD blocks, so no two threads write
+//        the same cache line
+//      - Spring passes run one color group at a time,
+//        even serially: a group never shares a
+//        particle, so each is split across threads and
+//        across SIMD lanes. Groups run in table
+//        order, giving every particle the same
+//        sequence of updates as the serial loop.
+//****************************************************
+bool Cloth::isParallel() {
+    return pool != NULL && pool->getNumThreads() > 1 && numVertices >= parallelThreshold;
+}
+
+void Cloth::forEachVertexChunk(const std::function<void(int, int)>& body) {
+    if(!isParallel()) {
+        body(0, numVertices);
+        return;
+    }
+
+    int numBlocks = (numVertices + PARTICLE_PAD - 1) / PARTICLE_PAD;
+    int count = numVertices;
+
+    pool->parallelFor(0, numBlocks, [&body, count](int blockBegin, int blockEnd) {
+        int begin = blockBegin * PARTICLE_PAD;
+        int end = blockEnd * PARTICLE_PAD;
+
+        body(begin, end < count ? end : count);
+    });
+}
+
+void Cloth::forEachSpringGroup(const std::function<void(int, int)>& body) {
+    bool parallel = isParallel();
+
+    for(int g = 0; g < springs.getNumGroups(); g++) {
+        if(parallel) {
+            pool->parallelFor(springs.getGroupStart(g), springs.getGroupEnd(g), body);
+        } else {
+            body(springs.getGroupStart(g), springs.getGroupEnd(g));
+        }
+    }
+}
+
+//****************************************************
+// Sleeping Pass Helpers:
+//      - With tiles asleep, vertex passes visit the
+//        rows of each awake tile, and spring passes
+//        each active tile's range of a group (see
+//        ClothTiles). Tiles are disjoint, so threads
+//        split them like chunks & ranges above.
+//      - With every tile awake they are the helpers
+//        above, in the same order
+//****************************************************
+bool Cloth::isSleeping() {
+    return tiles.isEnabled() && !tiles.isAllAwake();
+}
+
+void Cloth::forEachAwakeChunk(const std::function<void(int, int)>& body) {
+    if(!isSleeping()) {
+        forEachVertexChunk(body);
+        return;
+    }
+
+    const std::vector<int>& awakeTiles = tiles.getAwakeTiles();
+    std::function<void(int, int)> tileBody = [this, &body, &awakeTiles](int begin, int end) {
+        for(int a = begin; a < end; a++) {
+            int w0, w1, h0, h1;
+            tiles.getBounds(awakeTiles[a], w0, w1, h0, h1);
+
+            for(int h = h0; h < h1; h++) {
+                body(getIndex(w0, h), getIndex(w1 - 1, h) + 1);
+            }
+        }
+    };
+
+    if(isParallel()) {
+        pool->parallelFor(0, (int) awakeTiles.size(), tileBody);
+    } else {
+        tileBody(0, (int) awakeTiles.size());
+    }
+}
+
+void Cloth::forEachActiveSpringRange(const std::function<void(int, int)>& body) {
+    if(!isSleeping()) {
+        forEachSpringGroup(body);
+        return;
+    }
+
+    const std::vector<int>& activeTiles = tiles.getActiveTiles();
+    bool parallel = isParallel();
+
+    for(int g = 0; g < springs.getNumGroups(); g++) {
+        std::function<void(int, int)> tileBody = [this, &body, &activeTiles, g](int begin, int end) {
+            for(int a = begin; a < end; a++) {
+                int first = tiles.getSpringBegin(g, activeTiles[a]);
+                int last = tiles.getSpringEnd(g, activeTiles[a]);
+
+                if(first < last) {
+                    body(first, last);
+                }
+            }
+        };
+
+        if(parallel) {
+            pool->parallelFor(0, (int) activeTiles.size(), tileBody);
+        } else {
+            tileBody(0, (int) activeTiles.size());
+        }
+    }
+}
+
+
+//****************************************************
+// Tile Sleeping:
+//      - Only the explicit integrators on the spring
+//        table sleep: the implicit solvers, XPBD &
+//        Projective Dynamics solve the whole cloth at
+//        once, and the stencil walks every vertex
+//****************************************************
+void Cloth::setSleeping(bool on) {
+    wakeAll();
+    tiles.setEnabled(on);
+}
+
+void Cloth::updateSleep(float timestep) {
+    if((integrator == EULER || integrator == VERLET) && !useStencil) {
+        tiles.update(&particles, springs, integrator == VERLET, timestep);
+    } else {
+        wakeAll();
+    }
+}
+
+void Cloth::wakeAll() {
+    tiles.wakeAll(&particles);
+}
+
+
 //****************************************************
 // Update Springs:
 //      - Goes through Spring and applies the force
 //        to Vertices its connected to
 //****************************************************
 void Cloth::updateSprings() {
-    if(useSpringForce) {
+    // Families are stored back to back: STRETCH, SHEAR then BEND
+    if(useSpringForce && useStencil) {
+        stencil.applyForce(&particles, isParallel() ? pool : NULL);
+    } else if(useSpringForce) {
+        forEachActiveSpringRange([this](int begin, int end) {
+            kernels->springForce(&particles, springs.getSpan(begin, end));
+        });
+    } else {
+        forEachActiveSpringRange([this](int begin, int end) {
+            springs.applyCorrection(&particles, begin, end);
+        });
+    }
 
-        for(int i = 0; i < stretchMatrix.size(); i++) {
-            stretchMatrix[i]->applyForce();
-        }
+}
 
-        for(int j = 0; j < shearMatrix.size(); j++) {
-            shearMatrix[j]->applyForce();
+void Cloth::applyLengthConstraints() {
+    if(useStencil) {
+        stencil.lengthConstraint(&particles, isParallel() ? pool : NULL);
+        return;
+    }
+
+    forEachActiveSpringRange([this](int begin, int end) {
+        kernels->lengthConstraint(&particles, springs.getSpan(begin, end), tolerance);
+    });
+}
+
+
+//****************************************************
+// Update Collision:
+//      - Tests the shape against the particles of each
+//        tile whose box overlaps the shape's bounds;
+//        a shape missing the cloth's box skips them all
+//      - Sleeping tiles are skipped
+//****************************************************
+void Cloth::updateCollision(Shape* s) {
+    glm::vec3 lo, hi;
+    s->getBounds(lo, hi);
+
+    // A collision only moves the particle tested
+    forEachTileNear(lo, hi, [this, s](int w0, int w1, int h0, int h1) {
+        bool hit = false;
+
+        for(int h = h0; h < h1; h++) {
+            for(int i = getIndex(w0, h); i < getIndex(w1 - 1, h) + 1; i++) {
+                hit |= s->collide(&particles, i);
+            }
         }
+        return hit;
+    });
+}
 
-        for(int k = 0; k < stretchMatrix.size(); k++) {
-            stretchMatrix[k]->applyForce();
+void Cloth::updateCollision(const ColliderSet& colliders, int k) {
+    glm::vec3 lo, hi;
+    colliders.getBounds(k, lo, hi);
+
+    forEachTileNear(lo, hi, [this, &colliders, k](int w0, int w1, int h0, int h1) {
+        // Rows of a tile spanning the whole grid are one run
+        if(w0 == 0 && w1 == width) {
+            return colliders.collide(kernels, &particles, k, getIndex(0, h0), getIndex(0, h1));
         }
 
-    } else {
-        for(int i = 0; i < stretchMatrix.size(); i++) {
-            stretchMatrix[i]->applyCorrection();
+        bool hit = false;
+        for(int h = h0; h < h1; h++) {
+            hit |= colliders.collide(kernels, &particles, k, getIndex(w0, h), getIndex(w1 - 1, h) + 1);
         }
+        return hit;
+    });
+}
+
+//****************************************************
+// Update Collisions:
+//      - Tile by tile: the shapes whose boxes overlap
+//        the tile's box are tested, in scene order,
+//        against each of its particles, a row at a
+//        time through the collision kernels
+//      - A shape that moved a particle may have moved
+//        it into the box of a later one, so the tile's
+//        box is measured again & later shapes queried
+//        afresh. Each particle still meets every shape
+//        that can touch it in the order the per-shape
+//        loop above gives, so the result is the same
+//      - Sleeping tiles are skipped, as above
+//****************************************************
+void Cloth::updateCollisions(const ColliderSet& colliders, const BroadPhase& broad) {
+    if(!tiles.areBoxesFresh()) {
+        refitTileBoxes();
+    }
+
+    int numTiles = isSleeping() ? (int) tiles.getAwakeTiles().size() : tiles.getNumTiles();
+
+    std::function<void(int, int)> tileBody = [this, &colliders, &broad](int begin, int end) {
+        std::vector<int> found;
+        std::vector<int> later;
 
-        for(int j = 0; j < shearMatrix.size(); j++) {
-            shearMatrix[j]->applyCorrection();
+        for(int a = begin; a < end; a++) {
+            int t = isSleeping() ? tiles.getAwakeTiles()[a] : a;
+
+            int w0, w1, h0, h1;
+            tiles.getBounds(t, w0, w1, h0, h1);
+
+            if(tiles.isDirty(t)) {
+                tiles.measureBox(&particles, t);
+            }
+
+            glm::vec3 lo, hi;
+            tiles.getBox(t, lo, hi);
+            broad.query(lo, hi, found);
+
+            for(int k = 0; k < found.size(); k++) {
+                bool hit = false;
+
+                // Rows of a tile spanning the whole grid are one run
+                if(w0 == 0 && w1 == width) {
+                    hit = colliders.collide(kernels, &particles, found[k], getIndex(0, h0), getIndex(0, h1));
+                } else {
+                    for(int h = h0; h < h1; h++) {
+                        hit |= colliders.collide(kernels, &particles, found[k], getIndex(w0, h), getIndex(w1 - 1, h) + 1);
+                    }
+                }
+
+                if(hit && k + 1 == found.size()) {
+                    tiles.markDirty(t);
+                }
+
+                if(hit && k + 1 < found.size()) {
+                    tiles.measureBox(&particles, t);
+                    tiles.getBox(t, lo, hi);
+                    broad.query(lo, hi, later);
+
+                    int current = found[k];
+                    found.resize(k + 1);
+
+                    for(int l = 0; l < later.size(); l++) {
+                        if(later[l] > current) {
+                            found.push_back(later[l]);
+                        }
+                    }
+                }
+            }
         }
+    };
+
+    if(isParallel()) {
+        pool->parallelFor(0, numTiles, tileBody);
+    } else {
+        tileBody(0, numTiles);
+    }
+}
 
-        for(int k = 0; k < stretchMatrix.size(); k++) {
-            stretchMatrix[k]->applyCorrection();
+//****************************************************
+// Tile Boxes:
+//      - Refit as the last pass of update, so the
+//        collisions after it only read the particles
+//        of tiles near a shape: their cost follows the
+//        contact area, not the size of the cloth
+//      - A tile a collision moved is marked dirty and
+//        measured when its box is next read, so the
+//        last shape to touch it in a step costs no
+//        second pass over its particles
+//      - Sleeping tiles have not moved since their box
+//        was measured, unless the boxes went stale
+//****************************************************
+void Cloth::refitTileBoxes() {
+    bool every = !tiles.areBoxesFresh() || !isSleeping();
+
+    std::function<void(int, int)> body = [this, every](int begin, int end) {
+        for(int t = begin; t < end; t++) {
+            if(every || tiles.isAwake(t) || tiles.isDirty(t)) {
+                tiles.measureBox(&particles, t);
+            }
         }
+    };
+
+    if(isParallel()) {
+        pool->parallelFor(0, tiles.getNumTiles(), body);
+    } else {
+        body(0, tiles.getNumTiles());
     }
 
+    tiles.uniteBoxes();
 }
 
-void Cloth::applyLengthConstraints() {
-    for(int i = 0; i < stretchMatrix.size(); i++) {
-        stretchMatrix[i]->lengthConstraint();
+// The box around every particle, measured first if stale
+void Cloth::getBox(glm::vec3& lo, glm::vec3& hi) {
+    if(!tiles.areBoxesFresh() || tiles.isAnyDirty()) {
+        refitTileBoxes();
     }
 
-    for(int j = 0; j < shearMatrix.size(); j++) {
-        shearMatrix[j]->lengthConstraint();
+    tiles.getClothBox(lo, hi);
+}
+
+// Awake tile t's box, measured first if dirty, overlaps [lo, hi]
+bool Cloth::isTileNear(int t, glm::vec3 lo, glm::vec3 hi, bool sleeping) {
+    if(sleeping && !tiles.isAwake(t)) {
+        return false;
     }
 
-    for(int k = 0; k < stretchMatrix.size(); k++) {
-        stretchMatrix[k]->lengthConstraint();
+    if(tiles.isDirty(t)) {
+        tiles.measureBox(&particles, t);
     }
+
+    return tiles.overlapsBox(t, lo, hi);
 }
 
+//****************************************************
+// For Each Tile Near:
+//      - Row of tiles by row of tiles, in parallel;
+//        neighbouring tiles of a row that are near
+//        [lo, hi] are one run, so the collision kernels
+//        see long runs of particles when much of the
+//        cloth is in contact
+//****************************************************
+void Cloth::forEachTileNear(glm::vec3 lo, glm::vec3 hi, const std::function<bool(int, int, int, int)>& body) {
+    if(!tiles.areBoxesFresh()) {
+        refitTileBoxes();
+    }
+
+    if(!tiles.isAnyDirty() && !tiles.overlapsCloth(lo, hi)) {
+        return;
+    }
+
+    bool sleeping = isSleeping();
+    int tilesX = tiles.getTilesX();
+
+    std::function<void(int, int)> rowBody = [this, &body, lo, hi, sleeping, tilesX](int begin, int end) {
+        for(int row = begin; row < end; row++) {
+            int last = (row + 1) * tilesX;
+
+            for(int t = row * tilesX; t < last; t++) {
+                if(!isTileNear(t, lo, hi, sleeping)) {
+                    continue;
+                }
+
+                int runEnd = t + 1;
+                while(runEnd < last && isTileNear(runEnd, lo, hi, sleeping)) {
+                    runEnd++;
+                }
+
+                int w0, w1, h0, h1;
+                int unused0, unused1;
+                tiles.getBounds(t, w0, unused0, h0, h1);
+                tiles.getBounds(runEnd - 1, unused0, w1, unused1, unused1);
+
+                if(body(w0, w1, h0, h1)) {
+                    for(int k = t; k < runEnd; k++) {
+                        tiles.markDirty(k);
+                    }
+                }
+
+                t = runEnd;
+            }
+        }
+    };
+
+    if(isParallel()) {
+        pool->parallelFor(0, tiles.getTilesY(), rowBody);
+    } else {
+        rowBody(0, tiles.getTilesY());
+    }
+}
 
 //****************************************************
-// Update Collision:
-//      - Iterates through each vertex and tests if it
-//          intersects with the shape
+// Update Self Collision:
+//      - After the step, before the shapes, so a shape
+//        still has the last word on where a particle is
 //****************************************************
-void Cloth::updateCollision(Shape* s) {
-    for(int i = 0; i < height*width; i++) {
-        s->collide(vertexMatrix[i]);
+void Cloth::updateSelfCollision() {
+    selfCollision.apply(&particles, integrator == VERLET, isParallel() ? pool : NULL);
+
+    if(selfCollision.getContacts() > 0) {
+        tiles.setBoxesStale();
+    }
+}
+
+//****************************************************
+// Update Continuous Collision:
+//      - Before the discrete tests, which then only
+//        have to push out what is left close to a face
+//****************************************************
+void Cloth::updateContinuousCollision(const ColliderSet& colliders) {
+    continuous.apply(&particles, colliders.getTriangles(), integrator == VERLET, isParallel() ? pool : NULL);
+
+    if(continuous.getImpacts() > 0) {
+        tiles.setBoxesStale();
     }
 }
 
@@ -299,7 +715,7 @@ void Cloth::updateCollision(Shape* s) {
 //      - Iterates through each square of the grid of
 //          Vertices and for each of the 2 triangles
 //          in the square computes the normal.
-//      - Adds the normal to the Vertex, so normal is
+//      - Adds the normal to the particle, so normal is
 //          a weighted average of all of the its
 //          surrounding triangles
 //****************************************************
@@ -308,26 +724,28 @@ void Cloth::updateNormals() {
     // Only Update if they are not updated
     if(true) {
 
+        particles.resetNormals(0, numVertices);
+
         for(int h = 0; h < this->height - 1; h++) {
             for(int w = 0; w < this->width - 1; w++) {
 
-                // Get Vertex must be called (width, height);
-                Vertex* v1 = getVertex(w, h);
-                Vertex* v2 = getVertex(w, h+1);
-                Vertex* v3 = getVertex(w+1, h);
-                Vertex* v4 = getVertex(w+1, h+1);
+                // Get Index must be called (width, height);
+                int v1 = getIndex(w, h);
+                int v2 = getIndex(w, h+1);
+                int v3 = getIndex(w+1, h);
+                int v4 = getIndex(w+1, h+1);
 
-                glm::vec3 triNormal1 = glm::normalize(v1->findNormal(v2,v3));
+                glm::vec3 triNormal1 = glm::normalize(findNormal(v1, v2, v3));
 
-                v1->updateNormal(triNormal1);
-                v2->updateNormal(triNormal1);
-                v3->updateNormal(triNormal1);
+                particles.addNormal(v1, triNormal1);
+                particles.addNormal(v2, triNormal1);
+                particles.addNormal(v3, triNormal1);
 
-                glm::vec3 triNormal2 = glm::normalize(v4->findNormal(v3,v2));
+                glm::vec3 triNormal2 = glm::normalize(findNormal(v4, v3, v2));
                 
-                v2->updateNormal(triNormal2);
-                v3->updateNormal(triNormal2);
-                v4->updateNormal(triNormal2);
+                particles.addNormal(v2, triNormal2);
+                particles.addNormal(v3, triNormal2);
+                particles.addNormal(v4, triNormal2);
 
             }
         }
@@ -343,9 +761,20 @@ void Cloth::updateNormals() {
 //      - Resets Acceleration for all Vertices to 0.
 //****************************************************
 void Cloth::resetAccel() {
-    for(int i = 0; i < height*width; i++) {
-        vertexMatrix[i]->resetAccel();
-    }
+    forEachAwakeChunk([this](int begin, int end) {
+        particles.resetForces(begin, end);
+    });
+}
+
+//****************************************************
+// Find Normal:
+//      - Calculates the (unnormalized) Normal for the
+//        triangle formed by particles v1, v2 & v3.
+//****************************************************
+glm::vec3 Cloth::findNormal(int v1, int v2, int v3) {
+    glm::vec3 p1 = particles.getPos(v1);
+
+    return glm::cross(particles.getPos(v2) - p1, particles.getPos(v3) - p1);
 }
 
 //****************************************************
@@ -361,84 +790,71 @@ void Cloth::addTriangleForce(glm::vec3 force){
     for(int h = 0; h < this->height - 1; h++) {
         for(int w = 0; w < this->width - 1; w++) {
 
-            Vertex* v1 = getVertex(w,h);
-            Vertex* v2 = getVertex(w, h+1);
-            Vertex* v3 = getVertex(w+1, h);
-            Vertex* v4 = getVertex(w+1, h+1);
+            int v1 = getIndex(w, h);
+            int v2 = getIndex(w, h+1);
+            int v3 = getIndex(w+1, h);
+            int v4 = getIndex(w+1, h+1);
 
             // Calculates Force Contribution on the first Triangle
-            glm::vec3 triNormal1 = glm::normalize(v1->findNormal(v2,v3));
+            glm::vec3 triNormal1 = glm::normalize(findNormal(v1, v2, v3));
             glm::vec3 triForce1 = triNormal1 * glm::dot(triNormal1, force);
 
-            v1->addForce(triForce1);
-            v2->addForce(triForce1);
-            v3->addForce(triForce1);
+            particles.addForce(v1, triForce1);
+            particles.addForce(v2, triForce1);
+            particles.addForce(v3, triForce1);
 
             // Calculates Force Contribution on the Second Triangle
-            glm::vec3 triNormal2 = glm::normalize(v4->findNormal(v3,v2));
+            glm::vec3 triNormal2 = glm::normalize(findNormal(v4, v3, v2));
             glm::vec3 triForce2 = triNormal2 * glm::dot(triNormal2, force);
 
-            v2->addForce(triForce2);
-            v3->addForce(triForce2);
-            v4->addForce(triForce2);
+            particles.addForce(v2, triForce2);
+            particles.addForce(v3, triForce2);
+            particles.addForce(v4, triForce2);
 
         }
     }
 }
 
-void calcDragOnTriangle(Vertex* v1, Vertex* v2, Vertex* v3) {
-
-    // Velocity is Triangle Velocity - Air Velocity
-
-    glm::vec3 avgVel = (v1->getVelocity() + v2->getVelocity() + v3->getVelocity())/(3.0f*0.007f);
-   
-
-    std::cout << "Avg Velocity = " << avgVel.x << ", " << avgVel.y << ", " << avgVel.z << ")" << std::endl;
-
-
-    glm::vec3 cross = glm::cross(v1->vectorTo(v2), v1->vectorTo(v3));
-
-    // To Do: Test if this is correct
-
-    float rho = 1.1f;
-    float dragCoeff = 1.0f;
-
-    glm::vec3 factor = cross * (glm::length(avgVel) * glm::dot(avgVel, cross) / (2 * glm::length(cross)));
-
-
-
-    std::cout << "FACTOR LENGTH = " << glm::length(factor) << std::endl;
-
-    glm::vec3 force = (0.5f) * rho * dragCoeff * factor;
-
-    v1->addForce(force/3.0f);
-    v2->addForce(force /3.0f);
-    v3->addForce(force/3.0f);
-
-    std::cout << "Aerodynamic Force = (" << force.x << ", " << force.y << ", " << force.z << ")" << std::endl;
-
+//****************************************************
+// Add Wind Field:
+//      - Each triangle's share of a field sampled at
+//        its centroid, see WindField
+//****************************************************
+void Cloth::addWindField(const WindField& field) {
+    field.apply(&particles, width, height, isParallel() ? pool : NULL);
 }
 
 //****************************************************
-// Add Aerodynamic Drag
+// Add Aerodynamic Drag:
+//      - Drag & lift of every triangle, see
+//        Aerodynamics. Given a solver's damping, the
+//        drag also goes into the solve
 //****************************************************
 void Cloth::addAerodynamicDrag() {
+    SymmetricBlocks* damping = NULL;
+
+    if(integrator == IMPLICIT_EULER) {
+        implicitSolver.prepare(numVertices, springs);
+        damping = &implicitSolver.getDamping();
+    } else if(integrator == PROJECTIVE_DYNAMICS) {
+        projectiveSolver.prepare(numVertices, springs);
+        damping = &projectiveSolver.getDamping();
+    }
 
-    for(int h = 0; h < this->height - 1; h++) {
-        for(int w = 0; w < this->width - 1; w++) {
-            Vertex* v1 = getVertex(w,h);
-            Vertex* v2 = getVertex(w, h+1);
-            Vertex* v3 = getVertex(w+1, h);
-            Vertex* v4 = getVertex(w+1, h+1);
-
-            calcDragOnTriangle(v1, v2, v3);
+    if(!isSleeping()) {
+        aerodynamics.apply(&particles, width, height, damping, isParallel() ? pool : NULL);
+        return;
+    }
 
-            calcDragOnTriangle(v4, v3, v2);
+    // Asleep, only quads whose corner (w, h) is in an active tile can touch an awake particle
+    const std::vector<int>& active = tiles.getActiveTiles();
 
+    for(int a = 0; a < active.size(); a++) {
+        int w0, w1, h0, h1;
+        tiles.getBounds(active[a], w0, w1, h0, h1);
 
-        }
+        aerodynamics.applyRows(&particles, width, height, w0, w1, h0, h1, damping);
     }
-
 }
 
 
@@ -448,10 +864,10 @@ void Cloth::addAerodynamicDrag() {
 //          vertices. I.E. Gravity
 //****************************************************
 void Cloth::addConstantAccel(glm::vec3 accel) {
-    
-    for(int i = 0; i < height*width; i++) {
-        vertexMatrix[i]->addAccel(accel);
-    }
+
+    forEachAwakeChunk([this, accel](int begin, int end) {
+        particles.addConstantAccel(accel, begin, end);
+    });
 
 }
 
@@ -462,21 +878,23 @@ void Cloth::addConstantAccel(glm::vec3 accel) {
 //          unmovable
 //****************************************************
 void Cloth::setFixedCorners(bool c1, bool c2, bool c3, bool c4) {
-    
+    // A sleeping particle would be freed again when its tile wakes
+    wakeAll();
+
     if(c1) {
-        this->getVertex(0, 0)->setFixedVertex(true);
+        particles.setFixed(getIndex(0, 0), true);
     }
 
     if(c2) {
-        this->getVertex(width-1, 0)->setFixedVertex(true);
+        particles.setFixed(getIndex(width-1, 0), true);
     } 
 
     if(c3) {
-        this->getVertex(width-1, height-1)->setFixedVertex(true);
+        particles.setFixed(getIndex(width-1, height-1), true);
     }
 
     if(c4) {
-        this->getVertex(0, height-1)->setFixedVertex(true);
+        particles.setFixed(getIndex(0, height-1), true);
     }
 }
 
@@ -485,8 +903,28 @@ void Cloth::setFixedCorners(bool c1, bool c2, bool c3, bool c4) {
 //      - Connects all of the Springs in the Cloth
 //      - Only Checks % adds Springs downwards and
 //          leftwards, to avoid duplicates
+//      - The spring count of each family is known
+//          from the grid, so the table is sized once
+//          and filled in a single pass
+//      - Each spring gets a color from its grid
+//          position so no two springs of a family &
+//          color share a vertex:
+//              stretch & bend: 2 horizontal + 2 vertical
+//              shear: 2 down-right + 2 down-left
 //****************************************************
 void Cloth::connectNewSprings() {
+    int w1 = (width > 1) ? width - 1 : 0;
+    int w2 = (width > 2) ? width - 2 : 0;
+    int h1 = (height > 1) ? height - 1 : 0;
+    int h2 = (height > 2) ? height - 2 : 0;
+
+    int counts[NUM_SPRING_TYPES];
+    counts[STRETCH] = w1 * height + width * h1;
+    counts[SHEAR] = 2 * w1 * h1;
+    counts[BEND] = w2 * height + width * h2;
+
+    springs.allocate(counts);
+
     for(int h = 0; h < this->height; h++) {
         for(int w = 0; w < this->width; w++) {
 
@@ -494,70 +932,62 @@ void Cloth::connectNewSprings() {
 
             // Connections to the Right
             if(w < width - 1) {                    // If there is a vertex 1 spaces to the right
-                this->addStretch(w, h, w+1, h);
+                addSpring(STRETCH, w, h, w+1, h, w & 1);
 
                 if(w < width - 2) {                // If there is a vertex 2 spaces to the right
-                    this->addBend(w, h, w+2, h);
+                    addSpring(BEND, w, h, w+2, h, (w >> 1) & 1);
                 }
             }
 
             // Connect Downwards
             if(h < height - 1) {                // If There are vertices 1 spaces down
-                addStretch(w, h, w, h+1);
+                addSpring(STRETCH, w, h, w, h+1, 2 + (h & 1));
 
                 if(h < height - 2) {            // If There are vertices 2 spaces down
-                    addBend(w, h, w, h+2);
+                    addSpring(BEND, w, h, w, h+2, 2 + ((h >> 1) & 1));
                 }
             }
             
             // Add Down Right Shear
             if(w < (width - 1) && h < (height - 1)) {
-                addShear(w, h, w+1, h+1);
+                addSpring(SHEAR, w, h, w+1, h+1, h & 1);
             }
 
             // Add Down-Left Shear
             if (w >= 1 && h < (height - 1)) {
-                addShear(w, h, w-1, h+1);
+                addSpring(SHEAR, w, h, w-1, h+1, 2 + (h & 1));
             }
         }
     }
-}
 
-//****************************************************
-// Add Stretch
-//      - Adds a stretch spring to stretchMatrix
-//****************************************************
-void Cloth::addStretch(int x1, int y1, int x2, int y2) {
-    Vertex* v1 = this->getVertex(x1, y1);
-    Vertex* v2 = this->getVertex(x2, y2);
+    springs.buildColorGroups();
+    tiles.build(width, height, springs);
+    selfCollision.build(width, height, springs);
+    continuous.build(width, height, springs);
 
-    Spring* temp = new Spring(v1, v2, "STRETCH");
-    stretchMatrix.push_back(temp);
-    numStretchSprings++;
+    stencil.build(&particles, width, height);
+    implicitSolver.setGrid(width, height);
 }
-//****************************************************
-// Add Shear
-//      - Adds a shear spring to shearMatrix
-//****************************************************
-void Cloth::addShear(int x1, int y1, int x2, int y2) {
-    Vertex* v1 = this->getVertex(x1, y1);
-    Vertex* v2 = this->getVertex(x2, y2);
 
-    Spring* temp = new Spring(v1, v2, "SHEAR");
-    shearMatrix.push_back(temp);
-    numShearSprings++;
-}
 //****************************************************
-// Add Bend
-//      - Adds a Bend spring to bendMatrix
+// Add Spring
+//      - Adds a spring of the given family & color
+//          between grid points (x1, y1) and (x2, y2)
 //****************************************************
-void Cloth::addBend(int x1, int y1, int x2, int y2) {
-    Vertex* v1 = this->getVertex(x1, y1);
-    Vertex* v2 = this->getVertex(x2, y2);
-
-    Spring* temp = new Spring(v1, v2, "BEND");
-    bendMatrix.push_back(temp);   
-    numBendSprings++;
+void Cloth::addSpring(SpringType type, int x1, int y1, int x2, int y2, int color) {
+    springs.addSpring(&particles, type, getIndex(x1, y1), getIndex(x2, y2), color);
+
+    switch(type) {
+        case STRETCH:
+            numStretchSprings++;
+            break;
+        case SHEAR:
+            numShearSprings++;
+            break;
+        default:
+            numBendSprings++;
+            break;
+    }
 }
 
 //****************************************************
@@ -577,7 +1007,7 @@ void Cloth::printStats() {
     std::cout << "# of   SHEAR: " << numShearSprings << std::endl;
     std::cout << "# of    BEND: " << numBendSprings << std::endl;
 
-    Spring::printStats();
+    springs.printStats();
 
     std::cout << "---------------------------------------" << std::endl;   
     std::cout << "---------------------------------------" << std::endl;           
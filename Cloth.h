@@ -2,14 +2,41 @@
 #define CLOTH_H
 
 #include <vector>
+#include <functional>
 #include "Vertex.h"
+#include "ParticleStore.h"
 #include "Shape.h"
 #include "Spring.h"
+#include "GridStencil.h"
+#include "SimdKernels.h"
+#include "ImplicitSolver.h"
+#include "XPBDSolver.h"
+#include "ProjectiveDynamicsSolver.h"
+#include "ThreadPool.h"
+#include "ClothTiles.h"
+#include "BroadPhase.h"
+#include "Colliders.h"
+#include "SelfCollision.h"
+#include "ContinuousCollision.h"
+#include "Aerodynamics.h"
+#include "WindField.h"
 
 //****************************************************
 // Cloth Header Definition
 //****************************************************
 
+// Integration Methods
+enum IntegratorType {
+    EULER = 0,              // Explicit (symplectic) Euler
+    VERLET = 1,             // Position Verlet with damping
+    IMPLICIT_EULER = 2,     // Backward Euler, conjugate gradient solve
+    XPBD = 3,               // Springs solved as compliant constraints
+    PROJECTIVE_DYNAMICS = 4,    // Local / global iterations, prefactored Cholesky
+    NUM_INTEGRATORS = 5
+};
+
+extern const char* INTEGRATOR_NAMES[NUM_INTEGRATORS];
+
 class Cloth {
   private:
     int width;   // Number of Vertices
@@ -23,17 +50,40 @@ class Cloth {
 
     float pointDrawSize;
     
-    // 2D Array of Vertices: vertexMatrix[i][j] == vertexMatrix(i*w + j)
-    std::vector<Vertex*> vertexMatrix;
+    // Structure of Arrays of all particles: particle (w, h) is index h*width + w
+    ParticleStore particles;
 
     // TODO: Other Variables
     //      bool tearable
     //      Spring Constants
     //      Dampening Constants
 
-    std::vector<Spring*> stretchMatrix;
-    std::vector<Spring*> shearMatrix;
-    std::vector<Spring*> bendMatrix;
+    // All Springs, grouped by family (STRETCH, SHEAR, BEND) then color
+    SpringTable springs;
+
+    // Same springs as per offset constants, used instead of the table when useStencil
+    GridStencil stencil;
+    bool useStencil;
+
+    // Grid tiles; settled ones sleep & are skipped when sleeping is on
+    ClothTiles tiles;
+
+    // Keeps the cloth from passing through itself when on
+    SelfCollision selfCollision;
+    ContinuousCollision continuous;
+
+    // Drag & lift against the air, applied every step when on
+    Aerodynamics aerodynamics;
+    bool useAerodynamics;
+
+    // Workers for the parallel passes, NULL = serial. Not owned.
+    ThreadPool* pool;
+
+    // Spring & integration kernels, the widest ISA the CPU supports by default
+    const SimdKernels* kernels;
+
+    // Cloths with fewer vertices than this run every pass serially
+    int parallelThreshold;
 
     // Stats to Display
     int numStretchSprings;
@@ -47,7 +97,16 @@ class Cloth {
 
 
     // Integration Type
-    bool euler;
+    IntegratorType integrator;
+
+    // Used when integrator is IMPLICIT_EULER
+    ImplicitSolver implicitSolver;
+
+    // Used when integrator is XPBD
+    XPBDSolver xpbdSolver;
+
+    // Used when integrator is PROJECTIVE_DYNAMICS
+    ProjectiveDynamicsSolver projectiveSolver;
 
     // Private Functions and Constructor Helpers:
     void createDefaultCloth(int w, int h);
@@ -57,9 +116,25 @@ class Cloth {
     void connectSprings();
     void connectNewSprings();
 
-    void addStretch(int x1, int y1, int x2, int y2);
-    void addShear(int x1, int y1, int x2, int y2);
-    void addBend(int x1, int y1, int x2, int y2);
+    void addSpring(SpringType type, int x1, int y1, int x2, int y2, int color);
+
+    glm::vec3 findNormal(int v1, int v2, int v3);
+
+    // Parallel Pass Helpers
+    void forEachVertexChunk(const std::function<void(int, int)>& body);
+    void forEachSpringGroup(const std::function<void(int, int)>& body);
+
+    // As above, skipping sleeping tiles' vertices & the springs of tiles next to none awake
+    bool isSleeping();
+    void forEachAwakeChunk(const std::function<void(int, int)>& body);
+    void forEachActiveSpringRange(const std::function<void(int, int)>& body);
+
+    // Measures the awake & dirty tiles' boxes (every tile's if stale) & the cloth's box around them
+    void refitTileBoxes();
+    bool isTileNear(int t, glm::vec3 lo, glm::vec3 hi, bool sleeping);
+    // Runs of awake tiles whose boxes overlap [lo, hi], as grid columns [w0, w1) & rows [h0, h1);
+    // the tiles of a run body returns true for are marked dirty
+    void forEachTileNear(glm::vec3 lo, glm::vec3 hi, const std::function<bool(int, int, int, int)>& body);
 
     // Display and Counting Info Initializers:
     void initCounts();
@@ -68,26 +143,70 @@ class Cloth {
     // Constructors:
     Cloth();
     Cloth(int w, int h);
-    Cloth(int density, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Vertex* downLeft, bool isEuler);
-    Cloth(int w, int h, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Vertex* downLeft, bool isEuler);
+    Cloth(int density, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Vertex* downLeft, IntegratorType type);
+    Cloth(int w, int h, Vertex* upLeft, Vertex* upRight, Vertex* downRight, Vertex* downLeft, IntegratorType type);
     // Other Constructors: Include Spring Constants
 
     // Getters:
     int getWidth() { return width; };
     int getHeight() { return height; };    
     float getPointDrawSize() { return pointDrawSize; };
-
-    std::vector<Spring*> getStretchSprings() { return stretchMatrix; };
-    std::vector<Spring*> getShearSprings() { return shearMatrix; };
-    std::vector<Spring*> getBendSprings() { return bendMatrix; };
-
-    // Width oriented vector
-    Vertex* getVertex(int w, int h) { return vertexMatrix[h*width + w]; };
+    int getNumVertices() { return numVertices; };
+    bool isEuler() { return integrator == EULER; };
+    IntegratorType getIntegrator() { return integrator; };
+
+    // Non-owning views of the spring table
+    SpringSpan getStretchSprings() { return springs.getSpan(STRETCH); };
+    SpringSpan getShearSprings() { return springs.getSpan(SHEAR); };
+    SpringSpan getBendSprings() { return springs.getSpan(BEND); };
+    const SpringTable& getSprings() { return springs; };
+
+    // Width oriented index into the particle store
+    int getIndex(int w, int h) { return h*width + w; };
+    ParticleRef getVertex(int w, int h) { return ParticleRef(&particles, h*width + w); };
+    ParticleStore* getParticles() { return &particles; };
+
+    void setThreadPool(ThreadPool* p) { pool = p; };
+    ThreadPool* getThreadPool() { return pool; };
+    // Spring passes walk the grid stencil instead of the spring table
+    void setStencil(bool on) { useStencil = on; wakeAll(); };
+    bool isStencil() { return useStencil; };
+    const GridStencil& getStencil() { return stencil; };
+
+    void setSimdKernels(const SimdKernels* k) { kernels = k; };
+    const SimdKernels* getSimdKernels() { return kernels; };
+
+    void setParallelThreshold(int numVerts) { parallelThreshold = numVerts; };
+    int getParallelThreshold() { return parallelThreshold; };
+    // True when passes over this Cloth split across the pool
+    bool isParallel();
 
     // Update Cloth:
     void update(float timestep);
+    void integrate(float timestep);
+    void setEuler(bool isEuler) { setIntegrator(isEuler ? EULER : VERLET); };
+    void setIntegrator(IntegratorType type) { integrator = type; wakeAll(); };
+    ImplicitSolver& getImplicitSolver() { return implicitSolver; };
+    XPBDSolver& getXPBDSolver() { return xpbdSolver; };
+    ProjectiveDynamicsSolver& getProjectiveSolver() { return projectiveSolver; };
     void updateNormals();
 
+    // Tile Sleeping: explicit integrators on the spring table only, other setups stay awake
+    void setSleeping(bool on);
+    ClothTiles& getTiles() { return tiles; };
+    // After a step: lets settled tiles sleep & wakes disturbed ones
+    void updateSleep(float timestep);
+    // When a force or collider changes
+    void wakeAll();
+    // After the particles are overwritten from a copy: re-pins the sleeping ones and
+    // forgets the sides of the cloth its particles were on, where the step started & the tiles' boxes.
+    // Also call it after writing the particles directly
+    void onParticlesRestored() { tiles.restorePins(&particles); tiles.setBoxesStale(); selfCollision.reset(); continuous.reset(); };
+    int getAwakeTiles() { return (int) tiles.getAwakeTiles().size(); };
+    int getNumTiles() { return tiles.getNumTiles(); };
+    // Box around every particle
+    void getBox(glm::vec3& lo, glm::vec3& hi);
+
 
     // Call each spring to update Vertices
     void updateSprings();
@@ -95,10 +214,37 @@ class Cloth {
 
     void updateCollision(Shape* s);
 
+    // Shape k of the set, through the collision kernels
+    void updateCollision(const ColliderSet& colliders, int k);
+
+    // Every shape at once, each tile testing only those the broad phase (built over the same shapes) finds near it
+    void updateCollisions(const ColliderSet& colliders, const BroadPhase& broad);
+
+    // Self Collision: pushes apart parts of the cloth closer than its thickness
+    void setSelfCollision(bool on) { selfCollision.setEnabled(on); };
+    bool isSelfCollision() { return selfCollision.isEnabled(); };
+    void updateSelfCollision();
+    int getSelfContacts() { return selfCollision.getContacts(); };
+    int getSelfPatches() { return selfCollision.getActivePatches(); };
+    int getNumSelfPatches() { return selfCollision.getNumPatches(); };
+
+    // Continuous Collision: stops the cloth passing through the shapes' triangles in one step.
+    // begin before the step moves the particles, update after it
+    void setContinuousCollision(bool on) { continuous.setEnabled(on); };
+    bool isContinuousCollision() { return continuous.isEnabled(); };
+    void beginContinuousCollision() { continuous.begin(&particles); };
+    void updateContinuousCollision(const ColliderSet& colliders);
+    int getContinuousImpacts() { return continuous.getImpacts(); };
+    int getContinuousRebuilds() { return continuous.getRebuilds(); };
+
     // Update Acceleration due to Forces / accels
     void addConstantAccel(glm::vec3 accel);
     void addTriangleForce(glm::vec3 force);
+    void addWindField(const WindField& field);
 
+    void setAerodynamics(bool on) { useAerodynamics = on; };
+    bool isAerodynamics() { return useAerodynamics; };
+    Aerodynamics& getAerodynamics() { return aerodynamics; };
     void addAerodynamicDrag();
 
     void resetAccel();  
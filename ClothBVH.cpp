@@ -0,0 +1,274 @@
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "ClothBVH.h"
+
+
+//****************************************************
+// Cloth BVH - Constructors
+//****************************************************
+ClothBVH::ClothBVH() {
+    width = 0;
+    height = 0;
+    builtRatio = -1.0f;
+    rebuilds = 0;
+}
+
+//****************************************************
+// Build:
+//      - From the grid: squares of a leaf are a small
+//        rectangle, so its particles are close together
+//        in memory too
+//****************************************************
+void ClothBVH::build(int w, int h) {
+    width = w;
+    height = h;
+
+    nodes.clear();
+    order.clear();
+    leaves.clear();
+    builtRatio = -1.0f;
+    rebuilds = 0;
+
+    if(w < 2 || h < 2) {
+        return;
+    }
+
+    int numSquares = (w - 1) * (h - 1);
+    nodes.reserve(2 * numSquares);
+    order.reserve(numSquares);
+    centres.resize(numSquares);
+
+    addNode();
+    buildGrid(0, 0, w - 1, 0, h - 1);
+    listLeaves();
+}
+
+void ClothBVH::addNode() {
+    ClothBVHNode node;
+    node.lo = glm::vec3(0.0f);
+    node.hi = glm::vec3(0.0f);
+    node.first = 0;
+    node.count = 0;
+
+    nodes.push_back(node);
+}
+
+// Fills in node 'at' over squares [x0, x1) x [y0, y1)
+void ClothBVH::buildGrid(int at, int x0, int x1, int y0, int y1) {
+    if((x1 - x0) * (y1 - y0) <= BVH_LEAF_SQUARES) {
+        nodes[at].first = (int) order.size();
+        nodes[at].count = (x1 - x0) * (y1 - y0);
+
+        for(int y = y0; y < y1; y++) {
+            for(int x = x0; x < x1; x++) {
+                order.push_back(y * (width - 1) + x);
+            }
+        }
+        return;
+    }
+
+    // Children sit side by side, so an inner node only keeps its left child's index
+    int left = (int) nodes.size();
+    nodes[at].first = left;
+    nodes[at].count = 0;
+    addNode();
+    addNode();
+
+    if(x1 - x0 >= y1 - y0) {
+        int mid = (x0 + x1) / 2;
+        buildGrid(left, x0, mid, y0, y1);
+        buildGrid(left + 1, mid, x1, y0, y1);
+    } else {
+        int mid = (y0 + y1) / 2;
+        buildGrid(left, x0, x1, y0, mid);
+        buildGrid(left + 1, x0, x1, mid, y1);
+    }
+}
+
+// Fills in node 'at' over order[begin, end), split at the median centre, ties broken by index
+void ClothBVH::buildSpatial(int at, int begin, int end) {
+    if(end - begin <= BVH_LEAF_SQUARES) {
+        nodes[at].first = begin;
+        nodes[at].count = end - begin;
+        return;
+    }
+
+    glm::vec3 lo = centres[order[begin]];
+    glm::vec3 hi = lo;
+    for(int k = begin; k < end; k++) {
+        lo = glm::min(lo, centres[order[k]]);
+        hi = glm::max(hi, centres[order[k]]);
+    }
+
+    int axis = 0;
+    for(int a = 1; a < 3; a++) {
+        if(hi[a] - lo[a] > hi[axis] - lo[axis]) {
+            axis = a;
+        }
+    }
+
+    const std::vector<glm::vec3>& c = centres;
+    int mid = (begin + end) / 2;
+
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+        [&c, axis](int l, int r) {
+            return (c[l][axis] < c[r][axis]) || (c[l][axis] == c[r][axis] && l < r);
+        });
+
+    int left = (int) nodes.size();
+    nodes[at].first = left;
+    nodes[at].count = 0;
+    addNode();
+    addNode();
+
+    buildSpatial(left, begin, mid);
+    buildSpatial(left + 1, mid, end);
+}
+
+void ClothBVH::listLeaves() {
+    leaves.clear();
+
+    for(int n = 0; n < nodes.size(); n++) {
+        if(nodes[n].count > 0) {
+            leaves.push_back(n);
+        }
+    }
+}
+
+//****************************************************
+// Refit:
+//      - Leaves in parallel, then parents from their
+//        children, last node first
+//****************************************************
+void ClothBVH::refitBoxes(const ParticleStore* p, const float* startX, const float* startY, const float* startZ, float pad, ThreadPool* pool) {
+    int w = width;
+
+    std::function<void(int, int)> leafBody = [this, p, startX, startY, startZ, pad, w](int begin, int end) {
+        for(int l = begin; l < end; l++) {
+            ClothBVHNode& node = nodes[leaves[l]];
+            glm::vec3 lo(HUGE_VALF);
+            glm::vec3 hi(-HUGE_VALF);
+
+            for(int k = node.first; k < node.first + node.count; k++) {
+                int s = order[k];
+                int a = (s / (w - 1)) * w + s % (w - 1);
+                int corners[4] = { a, a + 1, a + w, a + w + 1 };
+
+                for(int c = 0; c < 4; c++) {
+                    int i = corners[c];
+                    glm::vec3 start(startX[i], startY[i], startZ[i]);
+
+                    lo = glm::min(lo, glm::min(start, p->getPos(i)));
+                    hi = glm::max(hi, glm::max(start, p->getPos(i)));
+                }
+            }
+
+            node.lo = lo - glm::vec3(pad);
+            node.hi = hi + glm::vec3(pad);
+        }
+    };
+
+    if(pool == NULL) {
+        leafBody(0, (int) leaves.size());
+    } else {
+        pool->parallelFor(0, (int) leaves.size(), leafBody);
+    }
+
+    for(int n = (int) nodes.size() - 1; n >= 0; n--) {
+        if(nodes[n].count == 0) {
+            int left = nodes[n].first;
+
+            nodes[n].lo = glm::min(nodes[left].lo, nodes[left + 1].lo);
+            nodes[n].hi = glm::max(nodes[left].hi, nodes[left + 1].hi);
+        }
+    }
+}
+
+// Summed surface area of the inner boxes over the root's
+float ClothBVH::getAreaRatio() const {
+    float inner = 0.0f;
+
+    for(int n = 0; n < nodes.size(); n++) {
+        if(nodes[n].count == 0) {
+            glm::vec3 d = nodes[n].hi - nodes[n].lo;
+            inner += d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+    }
+
+    glm::vec3 d = nodes[0].hi - nodes[0].lo;
+    float root = d.x * d.y + d.y * d.z + d.z * d.x;
+
+    return (root > 0.0f) ? inner / root : 0.0f;
+}
+
+void ClothBVH::refit(const ParticleStore* p, const float* startX, const float* startY, const float* startZ, float pad, ThreadPool* pool) {
+    if(nodes.empty()) {
+        return;
+    }
+
+    refitBoxes(p, startX, startY, startZ, pad, pool);
+    float ratio = getAreaRatio();
+
+    if(builtRatio < 0.0f) {
+        builtRatio = ratio;
+        return;
+    }
+
+    if(!(ratio > BVH_REBUILD_GROWTH * builtRatio)) {
+        return;
+    }
+
+    int w = width;
+    for(int s = 0; s < centres.size(); s++) {
+        int a = (s / (w - 1)) * w + s % (w - 1);
+        centres[s] = 0.25f * (p->getPos(a) + p->getPos(a + 1) + p->getPos(a + w) + p->getPos(a + w + 1));
+    }
+
+    nodes.clear();
+    addNode();
+    buildSpatial(0, 0, (int) order.size());
+    listLeaves();
+
+    refitBoxes(p, startX, startY, startZ, pad, pool);
+    builtRatio = getAreaRatio();
+    rebuilds++;
+}
+
+//****************************************************
+// Query:
+//      - Walks the tree with a small stack; both
+//        builds halve their squares, so it stays
+//        shallow
+//****************************************************
+void ClothBVH::query(glm::vec3 lo, glm::vec3 hi, std::vector<int>& found) const {
+    found.clear();
+
+    if(nodes.empty()) {
+        return;
+    }
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while(top > 0) {
+        int n = stack[--top];
+        const ClothBVHNode& node = nodes[n];
+
+        if(node.lo.x > hi.x || node.hi.x < lo.x ||
+           node.lo.y > hi.y || node.hi.y < lo.y ||
+           node.lo.z > hi.z || node.hi.z < lo.z) {
+            continue;
+        }
+
+        if(node.count > 0) {
+            found.push_back(n);
+        } else {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef CLOTHBVH_H
+#define CLOTHBVH_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Cloth BVH Header Definition
+//      - Bounding volume hierarchy over the squares of
+//        a cloth's grid, each leaf a handful of squares
+//      - Built once from the grid itself: the rectangle
+//        of squares is halved along its longer side
+//        until the pieces are small. After that only
+//        refit runs each step, leaves first then every
+//        parent from its children, with boxes that hold
+//        each square's corners at both ends of the step
+//      - A fold can bring far apart squares into one
+//        leaf's neighbourhood, and boxes that overlap
+//        a lot cull little. When the summed area of the
+//        inner boxes (over the root's) grows past
+//        BVH_REBUILD_GROWTH times what it was after the
+//        last build, the tree is rebuilt from the
+//        squares' current centres, split at the median
+//        along the widest axis
+//****************************************************
+
+// Squares per leaf at most
+const int BVH_LEAF_SQUARES = 8;
+
+// Rebuild once the inner boxes' area ratio grows by this
+const float BVH_REBUILD_GROWTH = 1.5f;
+
+struct ClothBVHNode {
+    glm::vec3 lo, hi;
+    int first;                  // Leaf: first of its squares in order; inner: left child, right follows
+    int count;                  // Squares of a leaf, 0 for an inner node
+};
+
+class ClothBVH {
+  private:
+    int width;
+    int height;
+
+    // Parents come before their children, so refit walks the nodes backwards
+    std::vector<ClothBVHNode> nodes;
+    std::vector<int> order;             // Squares, a leaf's are a run
+    std::vector<int> leaves;
+    std::vector<glm::vec3> centres;
+
+    float builtRatio;
+    int rebuilds;
+
+    void addNode();
+    void buildGrid(int at, int x0, int x1, int y0, int y1);
+    void buildSpatial(int at, int begin, int end);
+    void listLeaves();
+    void refitBoxes(const ParticleStore* p, const float* startX, const float* startY, const float* startZ, float pad, ThreadPool* pool);
+    float getAreaRatio() const;
+
+  public:
+    ClothBVH();
+
+    // Builds the tree of a w x h grid from its topology
+    void build(int w, int h);
+
+    // Refits to each particle's path from start to now, boxes grown by pad; rebuilds if they
+    // have come to overlap too much. pool may be NULL
+    void refit(const ParticleStore* p, const float* startX, const float* startY, const float* startZ, float pad, ThreadPool* pool);
+
+    // Leaf nodes whose boxes overlap [lo, hi], in the order the tree is walked
+    void query(glm::vec3 lo, glm::vec3 hi, std::vector<int>& found) const;
+
+    // A leaf's squares; square s is the one with top left corner (s % (width - 1), s / (width - 1))
+    const int* getSquares(int node, int& count) const { count = nodes[node].count; return &order[nodes[node].first]; };
+
+    int getNumNodes() const { return (int) nodes.size(); };
+    int getRebuilds() const { return rebuilds; };
+};
+
+#endif
@@ -0,0 +1,443 @@
+#include <math.h>
+#include <vector>
+
+#include "ClothTiles.h"
+
+
+//****************************************************
+// Cloth Tiles Class - Constants
+//****************************************************
+
+// Defaults: a tile sleeps after 200 steps with no particle faster than 5 mm/s,
+// over which its largest stretch strain moved by under 0.5%
+const float DEFAULT_SLEEP_SPEED = 0.005f;
+const float DEFAULT_SLEEP_STRAIN = 0.005f;
+const int DEFAULT_SLEEP_STEPS = 200;
+
+// A tile faster than 10 cm/s for WAKE_STEPS steps in a row wakes its neighbours.
+// A tile falling asleep jolts the ones around it for a few steps: it no longer
+// moves with them before the length constraints pull the two back together
+const float DEFAULT_WAKE_SPEED = 0.1f;
+const int WAKE_STEPS = 8;
+
+//****************************************************
+// Cloth Tiles - Constructors
+//****************************************************
+ClothTiles::ClothTiles() {
+    width = 0;
+    height = 0;
+    tilesX = 0;
+    tilesY = 0;
+    numGroups = 0;
+
+    enabled = false;
+    sleepSpeed = DEFAULT_SLEEP_SPEED;
+    wakeSpeed = DEFAULT_WAKE_SPEED;
+    sleepStrain = DEFAULT_SLEEP_STRAIN;
+    sleepSteps = DEFAULT_SLEEP_STEPS;
+
+    clothLo = glm::vec3(0.0f);
+    clothHi = glm::vec3(0.0f);
+    boxesFresh = false;
+}
+
+//****************************************************
+// Build:
+//      - Every particle is keyed by its tile and each
+//        spring group sorted by the key of the
+//        spring's first particle
+//****************************************************
+void ClothTiles::build(int w, int h, SpringTable& springs) {
+    width = w;
+    height = h;
+    tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (h + TILE_SIZE - 1) / TILE_SIZE;
+    numGroups = springs.getNumGroups();
+
+    std::vector<int> particleTile(w * h);
+    for(int y = 0; y < h; y++) {
+        for(int x = 0; x < w; x++) {
+            particleTile[y * w + x] = getTile(x, y);
+        }
+    }
+
+    springs.sortGroupsByKey(particleTile, getNumTiles(), groupTileStart);
+
+    awake.assign(getNumTiles(), 1);
+    quietSteps.assign(getNumTiles(), 0);
+    fastSteps.assign(getNumTiles(), 0);
+    tileSpeed.assign(getNumTiles(), 0.0f);
+    pinned.assign(w * h, 0);
+    quietStrain.assign(getNumTiles(), 0.0f);
+
+    boxLo.assign(getNumTiles(), glm::vec3(0.0f));
+    boxHi.assign(getNumTiles(), glm::vec3(0.0f));
+    boxDirty.assign(getNumTiles(), 1);
+    boxesFresh = false;
+
+    rebuildLists();
+}
+
+void ClothTiles::getBounds(int t, int& w0, int& w1, int& h0, int& h1) const {
+    w0 = (t % tilesX) * TILE_SIZE;
+    h0 = (t / tilesX) * TILE_SIZE;
+    w1 = (w0 + TILE_SIZE < width) ? w0 + TILE_SIZE : width;
+    h1 = (h0 + TILE_SIZE < height) ? h0 + TILE_SIZE : height;
+}
+
+//****************************************************
+// Tile Boxes:
+//      - A tile's box is measured from its particles;
+//        the cloth's is the union of the tiles', so a
+//        shape missing it misses every tile
+//****************************************************
+void ClothTiles::measureBox(const ParticleStore* p, int t) {
+    int w0, w1, h0, h1;
+    getBounds(t, w0, w1, h0, h1);
+
+    glm::vec3 lo(HUGE_VALF);
+    glm::vec3 hi(-HUGE_VALF);
+
+    for(int y = h0; y < h1; y++) {
+        for(int i = y * width + w0; i < y * width + w1; i++) {
+            glm::vec3 pos = p->getPos(i);
+            lo = glm::min(lo, pos);
+            hi = glm::max(hi, pos);
+        }
+    }
+
+    boxLo[t] = lo;
+    boxHi[t] = hi;
+    boxDirty[t] = 0;
+}
+
+bool ClothTiles::isAnyDirty() const {
+    for(int t = 0; t < getNumTiles(); t++) {
+        if(boxDirty[t] != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ClothTiles::uniteBoxes() {
+    clothLo = glm::vec3(HUGE_VALF);
+    clothHi = glm::vec3(-HUGE_VALF);
+
+    for(int t = 0; t < getNumTiles(); t++) {
+        clothLo = glm::min(clothLo, boxLo[t]);
+        clothHi = glm::max(clothHi, boxHi[t]);
+    }
+
+    boxesFresh = true;
+}
+
+bool ClothTiles::overlapsBox(int t, glm::vec3 lo, glm::vec3 hi) const {
+    return !(boxLo[t].x > hi.x || boxHi[t].x < lo.x ||
+             boxLo[t].y > hi.y || boxHi[t].y < lo.y ||
+             boxLo[t].z > hi.z || boxHi[t].z < lo.z);
+}
+
+bool ClothTiles::overlapsCloth(glm::vec3 lo, glm::vec3 hi) const {
+    return !(clothLo.x > hi.x || clothHi.x < lo.x ||
+             clothLo.y > hi.y || clothHi.y < lo.y ||
+             clothLo.z > hi.z || clothHi.z < lo.z);
+}
+
+//****************************************************
+// Rebuild Lists:
+//      - Awake tiles in index order, then every tile
+//        within one tile of an awake one
+//****************************************************
+void ClothTiles::rebuildLists() {
+    awakeTiles.clear();
+    activeTiles.clear();
+
+    for(int t = 0; t < getNumTiles(); t++) {
+        if(awake[t]) {
+            awakeTiles.push_back(t);
+            activeTiles.push_back(t);
+            continue;
+        }
+
+        int tx = t % tilesX;
+        int ty = t / tilesX;
+        bool nearAwake = false;
+
+        for(int y = ty - 1; y <= ty + 1 && !nearAwake; y++) {
+            for(int x = tx - 1; x <= tx + 1; x++) {
+                if(x >= 0 && x < tilesX && y >= 0 && y < tilesY && awake[y * tilesX + x]) {
+                    nearAwake = true;
+                    break;
+                }
+            }
+        }
+
+        if(nearAwake) {
+            activeTiles.push_back(t);
+        }
+    }
+}
+
+//****************************************************
+// Sleep / Wake Tile:
+//      - Sleeping pins every free particle at rest, so
+//        the length constraints hold it still as well;
+//        waking frees them & clears the forces the
+//        neighbouring springs left while asleep
+//      - A particle stays marked as pinned by the
+//        tiles until wakeAll, so restored particles
+//        can be pinned or freed again to match
+//****************************************************
+void ClothTiles::sleepTile(ParticleStore* p, int t) {
+    int w0, w1, h0, h1;
+    getBounds(t, w0, w1, h0, h1);
+
+    for(int y = h0; y < h1; y++) {
+        for(int i = y * width + w0; i < y * width + w1; i++) {
+            if(p->invMass[i] != 0.0f) {
+                p->invMass[i] = 0.0f;
+                pinned[i] = 1;
+            }
+
+            p->vx[i] = 0.0f;
+            p->vy[i] = 0.0f;
+            p->vz[i] = 0.0f;
+
+            p->ox[i] = p->px[i];
+            p->oy[i] = p->py[i];
+            p->oz[i] = p->pz[i];
+        }
+    }
+
+    awake[t] = 0;
+}
+
+void ClothTiles::wakeTile(ParticleStore* p, int t) {
+    int w0, w1, h0, h1;
+    getBounds(t, w0, w1, h0, h1);
+
+    for(int y = h0; y < h1; y++) {
+        for(int i = y * width + w0; i < y * width + w1; i++) {
+            if(pinned[i]) {
+                p->invMass[i] = 1.0f / p->mass[i];
+            }
+
+            p->fx[i] = 0.0f;
+            p->fy[i] = 0.0f;
+            p->fz[i] = 0.0f;
+        }
+    }
+
+    awake[t] = 1;
+    quietSteps[t] = 0;
+    fastSteps[t] = 0;
+    tileSpeed[t] = 0.0f;
+}
+
+void ClothTiles::wakeAll(ParticleStore* p) {
+    if(!isAllAwake()) {
+        for(int t = 0; t < getNumTiles(); t++) {
+            if(!awake[t]) {
+                wakeTile(p, t);
+            }
+        }
+
+        rebuildLists();
+    }
+
+    // Every particle is back to its own invMass; one fixed from now on must stay fixed
+    pinned.assign(pinned.size(), 0);
+}
+
+void ClothTiles::restorePins(ParticleStore* p) {
+    for(int t = 0; t < getNumTiles(); t++) {
+        int w0, w1, h0, h1;
+        getBounds(t, w0, w1, h0, h1);
+
+        for(int y = h0; y < h1; y++) {
+            for(int i = y * width + w0; i < y * width + w1; i++) {
+                if(pinned[i]) {
+                    p->invMass[i] = awake[t] ? 1.0f / p->mass[i] : 0.0f;
+                }
+
+                if(!awake[t]) {
+                    p->vx[i] = 0.0f;
+                    p->vy[i] = 0.0f;
+                    p->vz[i] = 0.0f;
+
+                    p->ox[i] = p->px[i];
+                    p->oy[i] = p->py[i];
+                    p->oz[i] = p->pz[i];
+                }
+            }
+        }
+    }
+}
+
+//****************************************************
+// Measure:
+//      - Fastest free particle of a tile, as speed^2
+//      - Largest |l / L - 1| of the stretch springs
+//        starting in a tile. A settled tile can still
+//        be stretched (one hanging from a pinned
+//        corner), so it is the drift of this over the
+//        quiet steps that must be small
+//****************************************************
+float ClothTiles::measureSpeed(const ParticleStore* p, int t, bool verlet, float h) {
+    int w0, w1, h0, h1;
+    getBounds(t, w0, w1, h0, h1);
+
+    float inverseStep = (h > 0.0f) ? 1.0f / h : 0.0f;
+    float fastest = 0.0f;
+
+    for(int y = h0; y < h1; y++) {
+        for(int i = y * width + w0; i < y * width + w1; i++) {
+            if(p->invMass[i] == 0.0f) {
+                continue;
+            }
+
+            float vx = p->vx[i];
+            float vy = p->vy[i];
+            float vz = p->vz[i];
+
+            if(verlet) {
+                vx = (p->px[i] - p->ox[i]) * inverseStep;
+                vy = (p->py[i] - p->oy[i]) * inverseStep;
+                vz = (p->pz[i] - p->oz[i]) * inverseStep;
+            }
+
+            float speed = vx * vx + vy * vy + vz * vz;
+
+            // NaN never counts as still
+            if(!(speed <= fastest)) {
+                fastest = (speed == speed) ? speed : HUGE_VALF;
+            }
+        }
+    }
+
+    return fastest;
+}
+
+float ClothTiles::measureStrain(const ParticleStore* p, const SpringTable& springs, int t) {
+    int familyBegin = springs.getFamilyStart(STRETCH);
+    int familyEnd = familyBegin + springs.getCount(STRETCH);
+
+    SpringSpan all = springs.getAll();
+    float largest = 0.0f;
+
+    for(int g = 0; g < numGroups; g++) {
+        if(springs.getGroupStart(g) < familyBegin || springs.getGroupEnd(g) > familyEnd) {
+            continue;
+        }
+
+        for(int s = getSpringBegin(g, t); s < getSpringEnd(g, t); s++) {
+            glm::vec3 springVec = p->getPos(all.i1[s]) - p->getPos(all.i0[s]);
+            float strain = fabsf(glm::length(springVec) / all.restLength[s] - 1.0f);
+
+            if(strain > largest) {
+                largest = strain;
+            }
+        }
+    }
+
+    return largest;
+}
+
+//****************************************************
+// Update:
+//      - Measures every awake tile, wakes sleeping
+//        tiles next to one that stayed fast, then puts
+//        to sleep each tile that has been quiet long
+//        enough, whose strain held steady meanwhile
+//        and which has no moving neighbour
+//****************************************************
+void ClothTiles::update(ParticleStore* p, const SpringTable& springs, bool verlet, float h) {
+    if(!enabled) {
+        return;
+    }
+
+    float sleepSpeed2 = sleepSpeed * sleepSpeed;
+    float wakeSpeed2 = wakeSpeed * wakeSpeed;
+
+    for(int a = 0; a < awakeTiles.size(); a++) {
+        int t = awakeTiles[a];
+
+        tileSpeed[t] = measureSpeed(p, t, verlet, h);
+        fastSteps[t] = (tileSpeed[t] >= wakeSpeed2) ? fastSteps[t] + 1 : 0;
+
+        if(tileSpeed[t] >= sleepSpeed2) {
+            quietSteps[t] = 0;
+        } else if(++quietSteps[t] == 1) {
+            quietStrain[t] = measureStrain(p, springs, t);
+        }
+    }
+
+    bool changed = false;
+
+    // Wake
+    std::vector<int> moving;
+    for(int a = 0; a < awakeTiles.size(); a++) {
+        if(fastSteps[awakeTiles[a]] >= WAKE_STEPS) {
+            moving.push_back(awakeTiles[a]);
+        }
+    }
+
+    for(int m = 0; m < moving.size(); m++) {
+        int tx = moving[m] % tilesX;
+        int ty = moving[m] / tilesX;
+
+        for(int y = ty - 1; y <= ty + 1; y++) {
+            for(int x = tx - 1; x <= tx + 1; x++) {
+                if(x >= 0 && x < tilesX && y >= 0 && y < tilesY && !awake[y * tilesX + x]) {
+                    wakeTile(p, y * tilesX + x);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Sleep
+    for(int a = 0; a < awakeTiles.size(); a++) {
+        int t = awakeTiles[a];
+
+        if(!awake[t] || quietSteps[t] < sleepSteps) {
+            continue;
+        }
+
+        int tx = t % tilesX;
+        int ty = t / tilesX;
+        bool stillNeighbours = true;
+
+        for(int y = ty - 1; y <= ty + 1 && stillNeighbours; y++) {
+            for(int x = tx - 1; x <= tx + 1; x++) {
+                int n = y * tilesX + x;
+
+                if(x >= 0 && x < tilesX && y >= 0 && y < tilesY && awake[n] && quietSteps[n] == 0) {
+                    stillNeighbours = false;
+                    break;
+                }
+            }
+        }
+
+        if(!stillNeighbours) {
+            continue;
+        }
+
+        float strain = measureStrain(p, springs, t);
+
+        if(fabsf(strain - quietStrain[t]) < sleepStrain) {
+            sleepTile(p, t);
+            changed = true;
+        } else {
+            // Still creeping; measure the drift over a fresh window
+            quietSteps[t] = 1;
+            quietStrain[t] = strain;
+        }
+    }
+
+    if(changed) {
+        rebuildLists();
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef CLOTHTILES_H
+#define CLOTHTILES_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "ParticleStore.h"
+#include "Spring.h"
+
+//****************************************************
+// Cloth Tiles Header Definition
+//      - Splits the cloth's grid into TILE_SIZE square
+//        tiles and lets settled tiles sleep
+//      - A tile whose fastest particle stayed under
+//        sleepSpeed for sleepSteps steps, whose largest
+//        stretch strain moved less than sleepStrain over
+//        them and whose neighbours are as still, falls
+//        asleep: its particles are pinned (invMass 0)
+//        at rest and the Cloth's passes skip it, so it
+//        holds its shape as a still boundary for the
+//        awake tiles around it
+//      - A sleeping tile wakes when an awake neighbour
+//        stays faster than wakeSpeed for a few steps,
+//        or on wakeAll (a force or collider changed)
+//      - Springs are sorted by the tile of their first
+//        particle within each color group. A group's
+//        springs of one tile are one range, so spring
+//        passes run over the ranges of the active
+//        tiles: awake ones and their neighbours, whose
+//        springs reach into an awake tile
+//      - Forces left on a sleeping particle by those
+//        springs are cleared when it wakes
+//      - Particles restored from a copy (a rolled back
+//        step) may be pinned differently from the tile
+//        state; restorePins makes them agree again
+//      - Each tile also keeps the box around its
+//        particles, and the cloth the box around those:
+//        the two levels collisions cull shapes with. The
+//        Cloth measures them as the last pass of a step.
+//        A tile a collision moved is marked dirty and
+//        measured again before its box is next read.
+//        Once the particles are moved any other way all
+//        are stale until every tile is measured again
+//****************************************************
+
+// Vertices along each side of a tile
+const int TILE_SIZE = 16;
+
+class ClothTiles {
+  private:
+    int width;
+    int height;
+    int tilesX;
+    int tilesY;
+    int numGroups;
+
+    // Group g's springs of tile t: [groupTileStart[g*(numTiles+1) + t], ... + t + 1)
+    std::vector<int> groupTileStart;
+
+    // Tile State
+    std::vector<unsigned char> awake;
+    std::vector<int> quietSteps;
+    std::vector<int> fastSteps;
+    std::vector<float> tileSpeed;           // Fastest particle's speed^2, last measured
+    std::vector<float> quietStrain;         // Largest stretch strain when the quiet steps began
+
+    // Tile Boxes
+    std::vector<glm::vec3> boxLo;
+    std::vector<glm::vec3> boxHi;
+    std::vector<unsigned char> boxDirty;
+    glm::vec3 clothLo;
+    glm::vec3 clothHi;
+    bool boxesFresh;
+
+    // Free particles this has pinned since the last wakeAll
+    std::vector<unsigned char> pinned;
+
+    // Awake tiles, and awake tiles plus their neighbours
+    std::vector<int> awakeTiles;
+    std::vector<int> activeTiles;
+
+    bool enabled;
+    float sleepSpeed;
+    float wakeSpeed;
+    float sleepStrain;
+    int sleepSteps;
+
+    void sleepTile(ParticleStore* p, int t);
+    void wakeTile(ParticleStore* p, int t);
+    void rebuildLists();
+
+    float measureSpeed(const ParticleStore* p, int t, bool verlet, float h);
+    float measureStrain(const ParticleStore* p, const SpringTable& springs, int t);
+
+  public:
+    ClothTiles();
+
+    // Sizes the tiles for a w x h grid & sorts the springs' groups by tile; every tile starts awake
+    void build(int w, int h, SpringTable& springs);
+
+    // After a step: counts quiet steps, wakes disturbed tiles and puts settled ones to sleep.
+    // Verlet has no velocity, it is measured as (x - x_prev) / h
+    void update(ParticleStore* p, const SpringTable& springs, bool verlet, float h);
+
+    // Wakes every tile, e.g. when a force or collider changes
+    void wakeAll(ParticleStore* p);
+
+    // Re-pins (or frees) restored particles to match the tiles' state
+    void restorePins(ParticleStore* p);
+
+    // Tile Geometry
+    int getNumTiles() const { return tilesX * tilesY; };
+    int getTilesX() const { return tilesX; };
+    int getTilesY() const { return tilesY; };
+    int getTile(int w, int h) const { return (h / TILE_SIZE) * tilesX + (w / TILE_SIZE); };
+    void getBounds(int t, int& w0, int& w1, int& h0, int& h1) const;
+
+    // Tile Boxes: measureBox & markDirty may run for different tiles at once; uniteBoxes then
+    // sets the cloth's box around them all & marks them fresh. The cloth's box is only
+    // right while no tile is dirty
+    void measureBox(const ParticleStore* p, int t);
+    void markDirty(int t) { boxDirty[t] = 1; };
+    bool isDirty(int t) const { return boxDirty[t] != 0; };
+    bool isAnyDirty() const;
+    void uniteBoxes();
+    void getBox(int t, glm::vec3& lo, glm::vec3& hi) const { lo = boxLo[t]; hi = boxHi[t]; };
+    bool overlapsBox(int t, glm::vec3 lo, glm::vec3 hi) const;
+    bool overlapsCloth(glm::vec3 lo, glm::vec3 hi) const;
+    void getClothBox(glm::vec3& lo, glm::vec3& hi) const { lo = clothLo; hi = clothHi; };
+    bool areBoxesFresh() const { return boxesFresh; };
+    void setBoxesStale() { boxesFresh = false; };
+
+    int getSpringBegin(int g, int t) const { return groupTileStart[g * (getNumTiles() + 1) + t]; };
+    int getSpringEnd(int g, int t) const { return groupTileStart[g * (getNumTiles() + 1) + t + 1]; };
+
+    // Tile State
+    bool isAwake(int t) const { return awake[t] != 0; };
+    bool isAllAwake() const { return (int) awakeTiles.size() == getNumTiles(); };
+    const std::vector<int>& getAwakeTiles() const { return awakeTiles; };
+    const std::vector<int>& getActiveTiles() const { return activeTiles; };
+
+    // Settings
+    void setEnabled(bool on) { enabled = on; };
+    bool isEnabled() const { return enabled; };
+    void setSleepSpeed(float s) { sleepSpeed = s; };
+    float getSleepSpeed() const { return sleepSpeed; };
+    void setWakeSpeed(float s) { wakeSpeed = s; };
+    float getWakeSpeed() const { return wakeSpeed; };
+    void setSleepStrain(float s) { sleepStrain = s; };
+    void setSleepSteps(int n) { sleepSteps = n; };
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include <math.h>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Colliders.h"
+#include "SimdKernels.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "TriangleMeshShape.h"
+
+
+//****************************************************
+// Collide Sphere:
+//      - A particle inside the sphere is pushed out
+//        along the line from the centre and its
+//        velocity scaled by 0.4
+//      - Same operations in the same order as glm's
+//        length & normalize, which Sphere used
+//****************************************************
+bool collideSphere(ParticleStore* p, const SphereCollider& s, int begin, int end) {
+    bool hit = false;
+
+    for(int i = begin; i < end; i++) {
+        float tx = p->px[i] - s.cx;
+        float ty = p->py[i] - s.cy;
+        float tz = p->pz[i] - s.cz;
+
+        float d = tx * tx + ty * ty + tz * tz;
+        if(!(d < s.reach2)) {
+            continue;
+        }
+
+        float length = sqrtf(d);
+        if(length < s.radius) {
+            float inv = 1.0f / length;
+
+            p->px[i] = tx * inv * s.radius + s.cx;
+            p->py[i] = ty * inv * s.radius + s.cy;
+            p->pz[i] = tz * inv * s.radius + s.cz;
+
+            p->vx[i] *= 0.4f;
+            p->vy[i] *= 0.4f;
+            p->vz[i] *= 0.4f;
+
+            hit = true;
+        }
+    }
+
+    return hit;
+}
+
+//****************************************************
+// Collide Plane:
+//      - Point to plane collision: a particle within
+//        the contact distance in front of the plane
+//        (or behind it), moving along the normal and
+//        over the quad, steps back by its velocity,
+//        which is scaled by 0.4
+//****************************************************
+bool collidePlane(ParticleStore* p, const PlaneCollider& s, int begin, int end) {
+    bool hit = false;
+
+    for(int i = begin; i < end; i++) {
+        float qx = p->px[i] - s.ox;
+        float qy = p->py[i] - s.oy;
+        float qz = p->pz[i] - s.oz;
+
+        float dist = -(qx * s.nx + qy * s.ny + qz * s.nz);
+        if(!(dist < PLANE_CONTACT_DISTANCE)) {
+            continue;
+        }
+
+        float vx = p->vx[i];
+        float vy = p->vy[i];
+        float vz = p->vz[i];
+
+        if(!(s.nx * vx + s.ny * vy + s.nz * vz > 0.0f)) {
+            continue;
+        }
+
+        // Projection onto the plane, from the top left corner
+        float ux = (p->px[i] - dist * s.nx) - s.ox;
+        float uy = (p->py[i] - dist * s.ny) - s.oy;
+        float uz = (p->pz[i] - dist * s.nz) - s.oz;
+
+        float right = s.rx * ux + s.ry * uy + s.rz * uz;
+        float low = s.lx * ux + s.ly * uy + s.lz * uz;
+
+        if(right <= s.rightLimit && right >= -PLANE_EDGE_BUFFER && low <= s.lowLimit && low >= -PLANE_EDGE_BUFFER) {
+            p->px[i] -= vx;
+            p->py[i] -= vy;
+            p->pz[i] -= vz;
+
+            p->vx[i] = vx * 0.4f;
+            p->vy[i] = vy * 0.4f;
+            p->vz[i] = vz * 0.4f;
+
+            hit = true;
+        }
+    }
+
+    return hit;
+}
+
+//****************************************************
+// Collider Set - Constructors
+//****************************************************
+ColliderSet::ColliderSet() {
+}
+
+void ColliderSet::build(const std::vector<Shape*>& s) {
+    shapes = s;
+    kind.resize(s.size());
+    slot.resize(s.size());
+    shapeLo.resize(s.size());
+    shapeHi.resize(s.size());
+    spheres.clear();
+    planes.clear();
+    meshes.clear();
+    triangles.clear();
+
+    for(int k = 0; k < s.size(); k++) {
+        s[k]->getBounds(shapeLo[k], shapeHi[k]);
+
+        for(int t = 0; t < s[k]->getNumTriangles(); t++) {
+            ColliderTriangle triangle;
+            s[k]->getTriangle(t, triangle.a, triangle.b, triangle.c);
+
+            triangle.lo = glm::min(triangle.a, glm::min(triangle.b, triangle.c));
+            triangle.hi = glm::max(triangle.a, glm::max(triangle.b, triangle.c));
+            triangles.push_back(triangle);
+        }
+
+        std::string type = s[k]->getType();
+
+        if(type == "SPHERE") {
+            kind[k] = COLLIDER_SPHERE;
+            slot[k] = (int) spheres.size();
+            spheres.push_back(static_cast<Sphere*>(s[k])->getCollider());
+        } else if(type == "PLANE") {
+            kind[k] = COLLIDER_PLANE;
+            slot[k] = (int) planes.size();
+            planes.push_back(static_cast<Plane*>(s[k])->getCollider());
+        } else if(type == "MESH") {
+            kind[k] = COLLIDER_MESH;
+            slot[k] = (int) meshes.size();
+            meshes.push_back(static_cast<TriangleMeshShape*>(s[k]));
+        } else {
+            kind[k] = COLLIDER_SHAPE;
+            slot[k] = k;
+        }
+    }
+}
+
+void ColliderSet::setNumParticles(int n) const {
+    for(int m = 0; m < meshes.size(); m++) {
+        meshes[m]->setNumParticles(n);
+    }
+}
+
+//****************************************************
+// Collide:
+//      - One switch per call, then a kernel over the
+//        whole range
+//****************************************************
+bool ColliderSet::collide(const SimdKernels* kernels, ParticleStore* p, int k, int begin, int end) const {
+    switch(kind[k]) {
+        case COLLIDER_SPHERE:
+            return kernels->collideSphere(p, spheres[slot[k]], begin, end);
+        case COLLIDER_PLANE:
+            return kernels->collidePlane(p, planes[slot[k]], begin, end);
+        case COLLIDER_MESH:
+            return meshes[slot[k]]->collideRange(p, begin, end);
+        default:
+            break;
+    }
+
+    bool hit = false;
+    for(int i = begin; i < end; i++) {
+        hit |= shapes[k]->collide(p, i);
+    }
+
+    return hit;
+}
@@ -0,0 +1,104 @@
+#ifndef COLLIDERS_H
+#define COLLIDERS_H
+
+#include <vector>
+#include "ParticleStore.h"
+#include "Shape.h"
+
+struct SimdKernels;
+class TriangleMeshShape;
+
+//****************************************************
+// Colliders Header Definition
+//      - What a Sphere or Plane's collide needs, worked
+//        out once per shape instead of once per call,
+//        and the reference kernels that collide a
+//        range of particles with one of them
+//      - A ColliderSet copies a scene's Shapes into one
+//        array per kind, so a pass over many particles
+//        calls a kernel of the SimdKernels table per
+//        shape rather than a virtual collide per
+//        particle. Triangle meshes collide a range at
+//        a time through their own tree; other kinds
+//        fall back to Shape::collide
+//      - Kernels give exactly the results of the
+//        shapes' own collide
+//      - The set also copies out the triangles of every
+//        shape that has any, for continuous collision,
+//        and each shape's bounds, for culling
+//****************************************************
+
+// collide acts within this distance (in units of the unnormalized normal) in front of a Plane,
+// and this far outside its edges
+const float PLANE_CONTACT_DISTANCE = 0.1f;
+const float PLANE_EDGE_BUFFER = 0.15f;
+
+// sqrt(d) < r is decided exactly, d < r^2 * this only rules out particles clearly outside
+const float SPHERE_REACH_SLACK = 1.0001f;
+
+struct SphereCollider {
+    float cx, cy, cz;
+    float radius;
+    float reach2;           // Just over radius^2: no particle further away collides
+};
+
+struct PlaneCollider {
+    float ox, oy, oz;       // Top left corner
+    float nx, ny, nz;       // Unnormalized normal
+    float rx, ry, rz;       // Unit vector to the top right corner
+    float rightLimit;       // Its length plus the edge buffer
+    float lx, ly, lz;       // Unit vector to the low left corner
+    float lowLimit;
+};
+
+// Reference kernels: collide particles [begin, end) with one shape, true if any collided
+bool collideSphere(ParticleStore* p, const SphereCollider& s, int begin, int end);
+bool collidePlane(ParticleStore* p, const PlaneCollider& s, int begin, int end);
+
+// A shape's triangle & its box
+struct ColliderTriangle {
+    glm::vec3 a, b, c;
+    glm::vec3 lo, hi;
+};
+
+enum ColliderKind {
+    COLLIDER_SPHERE = 0,
+    COLLIDER_PLANE = 1,
+    COLLIDER_SHAPE = 2,     // Any other Shape, through its virtual collide
+    COLLIDER_MESH = 3       // A TriangleMeshShape, through its collideRange
+};
+
+class ColliderSet {
+  private:
+    std::vector<Shape*> shapes;         // Not owned
+    std::vector<unsigned char> kind;
+    std::vector<int> slot;              // Index into the kind's array
+
+    std::vector<SphereCollider> spheres;
+    std::vector<PlaneCollider> planes;
+    std::vector<TriangleMeshShape*> meshes;     // Not owned
+
+    std::vector<ColliderTriangle> triangles;
+
+    std::vector<glm::vec3> shapeLo;
+    std::vector<glm::vec3> shapeHi;
+
+  public:
+    ColliderSet();
+
+    // Reads every shape; shapes must not move or change until the next build
+    void build(const std::vector<Shape*>& s);
+
+    // Sizes the meshes' per particle hints for a cloth of n particles; call before colliding
+    void setNumParticles(int n) const;
+
+    int size() const { return (int) shapes.size(); };
+    ColliderKind getKind(int k) const { return (ColliderKind) kind[k]; };
+    const std::vector<ColliderTriangle>& getTriangles() const { return triangles; };
+    void getBounds(int k, glm::vec3& lo, glm::vec3& hi) const { lo = shapeLo[k]; hi = shapeHi[k]; };
+
+    // Collides shape k with particles [begin, end) using the kernels' table; true if any collided
+    bool collide(const SimdKernels* kernels, ParticleStore* p, int k, int begin, int end) const;
+};
+
+#endif
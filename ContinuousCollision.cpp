@@ -0,0 +1,500 @@
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "glm/glm.hpp"
+
+#include "ContinuousCollision.h"
+
+
+//****************************************************
+// Continuous Collision Class - Constants
+//****************************************************
+
+// Particles stop this many (mean stretch) rest lengths off a face. Every particle moved back
+// is lifted by it, so a cloth resting on a face gets kicked each step: much more than this
+// and the solvers pick up the energy and blow up
+const float CCD_GAP = 0.001f;
+
+// Barycentric & edge parameters may be this far outside [0, 1] and still touch
+const double CCD_INSIDE_SLACK = 1e-4;
+
+// Bisection steps per root, enough to pin it to a double's precision on [0, 1]
+const int CCD_ROOT_ITERATIONS = 52;
+
+//****************************************************
+// Cubic Helpers:
+//      - Coplanarity of moving points is a cubic in t;
+//        its roots in [0, 1] are found by bisection
+//        between the turning points, earliest first
+//****************************************************
+
+static glm::dvec3 toDouble(glm::vec3 v) {
+    return glm::dvec3(v.x, v.y, v.z);
+}
+
+// ((u0 + t du) x (v0 + t dv)) . (w0 + t dw) = c3 t^3 + c2 t^2 + c1 t + c0
+static void getCoplanarCubic(glm::dvec3 u0, glm::dvec3 du, glm::dvec3 v0, glm::dvec3 dv, glm::dvec3 w0, glm::dvec3 dw, double c[4]) {
+    glm::dvec3 uv = glm::cross(u0, v0);
+    glm::dvec3 mixed = glm::cross(u0, dv) + glm::cross(du, v0);
+    glm::dvec3 duv = glm::cross(du, dv);
+
+    c[0] = glm::dot(uv, w0);
+    c[1] = glm::dot(uv, dw) + glm::dot(mixed, w0);
+    c[2] = glm::dot(mixed, dw) + glm::dot(duv, w0);
+    c[3] = glm::dot(duv, dw);
+}
+
+static double evalCubic(const double c[4], double t) {
+    return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+}
+
+static int findCubicRoots(const double c[4], double roots[3]) {
+    // Turning points split [0, 1] into pieces where the cubic is monotonic
+    double ends[4];
+    int numEnds = 0;
+    ends[numEnds++] = 0.0;
+
+    double q2 = 3.0 * c[3];
+    double q1 = 2.0 * c[2];
+    double q0 = c[1];
+    double turns[2];
+    int numTurns = 0;
+
+    if(q2 == 0.0) {
+        if(q1 != 0.0) {
+            turns[numTurns++] = -q0 / q1;
+        }
+    } else {
+        double discriminant = q1 * q1 - 4.0 * q2 * q0;
+
+        if(discriminant >= 0.0) {
+            double root = sqrt(discriminant);
+            double t0 = (-q1 - root) / (2.0 * q2);
+            double t1 = (-q1 + root) / (2.0 * q2);
+
+            turns[numTurns++] = std::min(t0, t1);
+            turns[numTurns++] = std::max(t0, t1);
+        }
+    }
+
+    for(int k = 0; k < numTurns; k++) {
+        if(turns[k] > 0.0 && turns[k] < 1.0) {
+            ends[numEnds++] = turns[k];
+        }
+    }
+    ends[numEnds++] = 1.0;
+
+    int numRoots = 0;
+    for(int k = 0; k + 1 < numEnds; k++) {
+        double lo = ends[k];
+        double hi = ends[k + 1];
+        double fLo = evalCubic(c, lo);
+        double fHi = evalCubic(c, hi);
+
+        if(fLo == 0.0) {
+            if(numRoots == 0 || roots[numRoots - 1] < lo) {
+                roots[numRoots++] = lo;
+            }
+            continue;
+        }
+
+        if(fHi == 0.0 || (fLo < 0.0) == (fHi < 0.0)) {
+            continue;
+        }
+
+        for(int n = 0; n < CCD_ROOT_ITERATIONS; n++) {
+            double mid = 0.5 * (lo + hi);
+            double fMid = evalCubic(c, mid);
+
+            if((fMid < 0.0) == (fLo < 0.0)) {
+                lo = mid;
+                fLo = fMid;
+            } else {
+                hi = mid;
+            }
+        }
+
+        roots[numRoots++] = lo;
+    }
+
+    if(evalCubic(c, 1.0) == 0.0 && (numRoots == 0 || roots[numRoots - 1] < 1.0)) {
+        roots[numRoots++] = 1.0;
+    }
+
+    return numRoots;
+}
+
+//****************************************************
+// Contact Tests:
+//      - Start & end positions of each point. Returns
+//        the earliest time the point is on the
+//        triangle, or the edges cross, else -1
+//****************************************************
+static double testVertexFace(glm::vec3 p0, glm::vec3 p1, glm::vec3 a0, glm::vec3 a1, glm::vec3 b0, glm::vec3 b1, glm::vec3 c0, glm::vec3 c1) {
+    glm::dvec3 pa0 = toDouble(a0), pa1 = toDouble(a1);
+    glm::dvec3 u0 = toDouble(b0) - pa0, du = (toDouble(b1) - pa1) - u0;
+    glm::dvec3 v0 = toDouble(c0) - pa0, dv = (toDouble(c1) - pa1) - v0;
+    glm::dvec3 w0 = toDouble(p0) - pa0, dw = (toDouble(p1) - pa1) - w0;
+
+    double c[4];
+    double roots[3];
+    getCoplanarCubic(u0, du, v0, dv, w0, dw, c);
+    int numRoots = findCubicRoots(c, roots);
+
+    for(int r = 0; r < numRoots; r++) {
+        double t = roots[r];
+        glm::dvec3 u = u0 + t * du;
+        glm::dvec3 v = v0 + t * dv;
+        glm::dvec3 w = w0 + t * dw;
+
+        double d00 = glm::dot(u, u);
+        double d01 = glm::dot(u, v);
+        double d11 = glm::dot(v, v);
+        double d20 = glm::dot(w, u);
+        double d21 = glm::dot(w, v);
+        double denominator = d00 * d11 - d01 * d01;
+
+        if(!(denominator > 0.0)) {
+            continue;
+        }
+
+        double bv = (d11 * d20 - d01 * d21) / denominator;
+        double bw = (d00 * d21 - d01 * d20) / denominator;
+
+        if(bv >= -CCD_INSIDE_SLACK && bw >= -CCD_INSIDE_SLACK && bv + bw <= 1.0 + CCD_INSIDE_SLACK) {
+            return t;
+        }
+    }
+
+    return -1.0;
+}
+
+static double testEdgeEdge(glm::vec3 a0, glm::vec3 a1, glm::vec3 b0, glm::vec3 b1, glm::vec3 c0, glm::vec3 c1, glm::vec3 d0, glm::vec3 d1) {
+    glm::dvec3 u0 = toDouble(b0) - toDouble(a0), du = (toDouble(b1) - toDouble(a1)) - u0;
+    glm::dvec3 v0 = toDouble(d0) - toDouble(c0), dv = (toDouble(d1) - toDouble(c1)) - v0;
+    glm::dvec3 w0 = toDouble(c0) - toDouble(a0), dw = (toDouble(c1) - toDouble(a1)) - w0;
+
+    double c[4];
+    double roots[3];
+    getCoplanarCubic(u0, du, v0, dv, w0, dw, c);
+    int numRoots = findCubicRoots(c, roots);
+
+    for(int r = 0; r < numRoots; r++) {
+        double t = roots[r];
+        glm::dvec3 d1 = u0 + t * du;
+        glm::dvec3 d2 = v0 + t * dv;
+        glm::dvec3 between = -(w0 + t * dw);      // a - c
+
+        double e11 = glm::dot(d1, d1);
+        double e12 = glm::dot(d1, d2);
+        double e22 = glm::dot(d2, d2);
+        double f1 = glm::dot(d1, between);
+        double f2 = glm::dot(d2, between);
+        double denominator = e11 * e22 - e12 * e12;
+
+        // Parallel edges only meet end on, which the vertex tests of the faces around them catch
+        if(!(denominator > 1e-12 * e11 * e22)) {
+            continue;
+        }
+
+        double s = (e12 * f2 - f1 * e22) / denominator;
+        double q = (e11 * f2 - e12 * f1) / denominator;
+
+        if(s < -CCD_INSIDE_SLACK || s > 1.0 + CCD_INSIDE_SLACK || q < -CCD_INSIDE_SLACK || q > 1.0 + CCD_INSIDE_SLACK) {
+            continue;
+        }
+
+        glm::dvec3 apart = between + s * d1 - q * d2;
+        if(glm::dot(apart, apart) <= 1e-6 * (e11 + e22)) {
+            return t;
+        }
+    }
+
+    return -1.0;
+}
+
+//****************************************************
+// Continuous Collision - Constructors
+//****************************************************
+ContinuousCollision::ContinuousCollision() {
+    width = 0;
+    height = 0;
+    gap = 0.0f;
+    enabled = false;
+    haveStart = false;
+    impacts = 0;
+}
+
+void ContinuousCollision::build(int w, int h, const SpringTable& springs) {
+    width = w;
+    height = h;
+
+    SpringSpan stretch = springs.getSpan(STRETCH);
+    float restSum = 0.0f;
+    for(int s = 0; s < stretch.count; s++) {
+        restSum += stretch.restLength[s];
+    }
+    gap = CCD_GAP * ((stretch.count > 0) ? restSum / stretch.count : 1.0f);
+
+    int numParticles = w * h;
+    startX.resize(numParticles);
+    startY.resize(numParticles);
+    startZ.resize(numParticles);
+    impactTime.assign(numParticles, 2.0f);
+    impactNormal.resize(numParticles);
+    hitParticles.clear();
+    haveStart = false;
+    impacts = 0;
+
+    bvh.build(w, h);
+}
+
+void ContinuousCollision::begin(const ParticleStore* p) {
+    if(!enabled) {
+        return;
+    }
+
+    for(int i = 0; i < width * height; i++) {
+        startX[i] = p->px[i];
+        startY[i] = p->py[i];
+        startZ[i] = p->pz[i];
+    }
+
+    haveStart = true;
+}
+
+//****************************************************
+// Find Impacts:
+//      - Every feature a leaf's squares own against one
+//        shape triangle. Square (x, y) owns its top
+//        left particle, its top, left & diagonal edges
+//        and its two triangles; squares on the far
+//        sides also own the edges & particles there
+//****************************************************
+void ContinuousCollision::findImpacts(const ParticleStore* p, const ColliderTriangle& triangle, int leaf, std::vector<ContinuousImpact>& out) const {
+    glm::vec3 ta = triangle.a;
+    glm::vec3 tb = triangle.b;
+    glm::vec3 tc = triangle.c;
+
+    glm::vec3 normal = glm::cross(tb - ta, tc - ta);
+    float normalLength = glm::length(normal);
+    if(!(normalLength > 0.0f)) {
+        return;
+    }
+    normal *= 1.0f / normalLength;
+
+    glm::vec3 shapePoints[3] = { ta, tb, tc };
+    int count;
+    const int* squares = bvh.getSquares(leaf, count);
+
+    for(int k = 0; k < count; k++) {
+        int x = squares[k] % (width - 1);
+        int y = squares[k] / (width - 1);
+        int a = y * width + x;
+        int corners[4] = { a, a + 1, a + width, a + width + 1 };
+
+        // Corners that stay on one side of the plane all step cannot reach the triangle
+        bool above = true;
+        bool below = true;
+        for(int n = 0; n < 4; n++) {
+            float d0 = glm::dot(getStart(corners[n]) - ta, normal);
+            float d1 = glm::dot(p->getPos(corners[n]) - ta, normal);
+
+            above = above && d0 > gap && d1 > gap;
+            below = below && d0 < -gap && d1 < -gap;
+        }
+
+        if(above || below) {
+            continue;
+        }
+
+        // Particles, edges & triangles this square owns
+        int vertices[4] = { a, 0, 0, 0 };
+        int numVertices = 1;
+        int edges[5][2] = { { a, a + 1 }, { a, a + width }, { a + 1, a + width }, { 0, 0 }, { 0, 0 } };
+        int numEdges = 3;
+        int faces[2][3] = { { a, a + width, a + 1 }, { a + width + 1, a + 1, a + width } };
+
+        if(x == width - 2) {
+            vertices[numVertices++] = a + 1;
+            edges[numEdges][0] = a + 1;
+            edges[numEdges++][1] = a + width + 1;
+        }
+        if(y == height - 2) {
+            vertices[numVertices++] = a + width;
+            edges[numEdges][0] = a + width;
+            edges[numEdges++][1] = a + width + 1;
+        }
+        if(x == width - 2 && y == height - 2) {
+            vertices[numVertices++] = a + width + 1;
+        }
+
+        for(int n = 0; n < numVertices; n++) {
+            int i = vertices[n];
+            double t = testVertexFace(getStart(i), p->getPos(i), ta, ta, tb, tb, tc, tc);
+
+            if(t >= 0.0) {
+                ContinuousImpact impact;
+                impact.particle = i;
+                impact.time = (float) t;
+                impact.normal = (glm::dot(getStart(i) - ta, normal) >= 0.0f) ? normal : -normal;
+                out.push_back(impact);
+            }
+        }
+
+        for(int f = 0; f < 2; f++) {
+            int i0 = faces[f][0];
+            int i1 = faces[f][1];
+            int i2 = faces[f][2];
+
+            for(int n = 0; n < 3; n++) {
+                glm::vec3 q = shapePoints[n];
+                double t = testVertexFace(q, q, getStart(i0), p->getPos(i0), getStart(i1), p->getPos(i1), getStart(i2), p->getPos(i2));
+
+                if(t >= 0.0) {
+                    glm::vec3 centre = (getStart(i0) + getStart(i1) + getStart(i2)) * (1.0f / 3.0f);
+
+                    ContinuousImpact impact;
+                    impact.time = (float) t;
+                    impact.normal = (glm::dot(centre - ta, normal) >= 0.0f) ? normal : -normal;
+
+                    for(int c = 0; c < 3; c++) {
+                        impact.particle = faces[f][c];
+                        out.push_back(impact);
+                    }
+                }
+            }
+        }
+
+        for(int e = 0; e < numEdges; e++) {
+            int i0 = edges[e][0];
+            int i1 = edges[e][1];
+
+            for(int n = 0; n < 3; n++) {
+                glm::vec3 q0 = shapePoints[n];
+                glm::vec3 q1 = shapePoints[(n + 1) % 3];
+                double t = testEdgeEdge(getStart(i0), p->getPos(i0), getStart(i1), p->getPos(i1), q0, q0, q1, q1);
+
+                if(t >= 0.0) {
+                    glm::vec3 middle = 0.5f * (getStart(i0) + getStart(i1));
+
+                    ContinuousImpact impact;
+                    impact.time = (float) t;
+                    impact.normal = (glm::dot(middle - ta, normal) >= 0.0f) ? normal : -normal;
+
+                    impact.particle = i0;
+                    out.push_back(impact);
+                    impact.particle = i1;
+                    out.push_back(impact);
+                }
+            }
+        }
+    }
+}
+
+// Lists the (leaf, triangle) pairs whose boxes overlap, triangle by triangle
+int ContinuousCollision::findPairs(const std::vector<ColliderTriangle>& triangles) {
+    pairLeaf.clear();
+    pairTriangle.clear();
+
+    for(int t = 0; t < triangles.size(); t++) {
+        bvh.query(triangles[t].lo - glm::vec3(gap), triangles[t].hi + glm::vec3(gap), found);
+
+        for(int n = 0; n < found.size(); n++) {
+            pairLeaf.push_back(found[n]);
+            pairTriangle.push_back(t);
+        }
+    }
+
+    if(pairImpacts.size() < pairLeaf.size()) {
+        pairImpacts.resize(pairLeaf.size());
+    }
+
+    return (int) pairLeaf.size();
+}
+
+//****************************************************
+// Apply:
+//      - Refit, find impacts in parallel, merge them in
+//        pair order keeping each particle's earliest,
+//        move those particles back & repeat
+//****************************************************
+void ContinuousCollision::apply(ParticleStore* p, const std::vector<ColliderTriangle>& triangles, bool verlet, ThreadPool* pool) {
+    impacts = 0;
+
+    if(!enabled || !haveStart || triangles.empty() || width < 2 || height < 2) {
+        return;
+    }
+    haveStart = false;
+
+    for(int pass = 0; pass < CCD_PASSES; pass++) {
+        bvh.refit(p, &startX[0], &startY[0], &startZ[0], gap, pool);
+        int numPairs = findPairs(triangles);
+
+        std::function<void(int, int)> findBody = [this, p, &triangles](int begin, int end) {
+            for(int k = begin; k < end; k++) {
+                pairImpacts[k].clear();
+                findImpacts(p, triangles[pairTriangle[k]], pairLeaf[k], pairImpacts[k]);
+            }
+        };
+
+        if(pool == NULL) {
+            findBody(0, numPairs);
+        } else {
+            pool->parallelFor(0, numPairs, findBody);
+        }
+
+        for(int k = 0; k < numPairs; k++) {
+            for(int n = 0; n < pairImpacts[k].size(); n++) {
+                const ContinuousImpact& impact = pairImpacts[k][n];
+                int i = impact.particle;
+
+                if(p->invMass[i] == 0.0f || !(impact.time < impactTime[i])) {
+                    continue;
+                }
+
+                if(impactTime[i] > 1.0f) {
+                    hitParticles.push_back(i);
+                }
+                impactTime[i] = impact.time;
+                impactNormal[i] = impact.normal;
+            }
+        }
+
+        if(hitParticles.empty()) {
+            break;
+        }
+
+        // The last pass gives up on moving along the path: its start was clear of every face
+        bool last = (pass == CCD_PASSES - 1);
+
+        for(int n = 0; n < hitParticles.size(); n++) {
+            int i = hitParticles[n];
+            glm::vec3 start = getStart(i);
+            glm::vec3 pos = p->getPos(i);
+            glm::vec3 normal = impactNormal[i];
+
+            glm::vec3 velocity = verlet ? pos - p->getPrevPos(i) : p->getVelocity(i);
+            glm::vec3 back = last ? start : start + (pos - start) * impactTime[i] + normal * gap;
+            p->setPos(i, back);
+
+            float into = glm::dot(velocity, normal);
+            if(into < 0.0f) {
+                velocity -= into * normal;
+            }
+
+            if(verlet) {
+                p->setPrevPos(i, back - velocity);
+            } else {
+                p->setVelocity(i, velocity);
+            }
+
+            impactTime[i] = 2.0f;
+        }
+
+        impacts += (int) hitParticles.size();
+        hitParticles.clear();
+    }
+}
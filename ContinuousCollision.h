@@ -0,0 +1,110 @@
+#ifndef CONTINUOUSCOLLISION_H
+#define CONTINUOUSCOLLISION_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "ParticleStore.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+#include "Colliders.h"
+#include "ClothBVH.h"
+
+//****************************************************
+// Continuous Collision Header Definition
+//      - Catches the cloth passing through a shape's
+//        triangles during a step, however far it moved:
+//        each particle is taken to move in a straight
+//        line from where it started the step
+//      - Every cloth vertex against every shape face,
+//        every shape vertex against every cloth face,
+//        and every cloth edge against every shape edge.
+//        Each test solves the cubic for when its four
+//        points are coplanar, then checks they touch
+//      - The cloth's BVH (refit to the particles' paths
+//        every step) finds the squares near each shape
+//        triangle. A square whose corners stay on one
+//        side of the triangle's plane all step is
+//        skipped; each feature belongs to one square,
+//        so none is tested twice
+//      - A particle in any contact goes back along its
+//        path to its earliest one, stays CCD_GAP rest
+//        lengths off the face, and loses its velocity
+//        into it. Moving particles back can cause new
+//        contacts, so the test repeats; after
+//        CCD_PASSES, particles still in contact stay
+//        where they started
+//      - Impacts are found in parallel & merged in a
+//        fixed order, so the result does not depend on
+//        the thread count
+//****************************************************
+
+// Tests (and moves back) at most this many times a step
+const int CCD_PASSES = 4;
+
+// One contact: a cloth particle's earliest impact time and the shape's normal, pointing to
+// where the particle was at the start
+struct ContinuousImpact {
+    int particle;
+    float time;
+    glm::vec3 normal;
+};
+
+class ContinuousCollision {
+  private:
+    int width;
+    int height;
+
+    float gap;
+    bool enabled;
+
+    // Positions at the start of the step
+    std::vector<float> startX;
+    std::vector<float> startY;
+    std::vector<float> startZ;
+    bool haveStart;
+
+    ClothBVH bvh;
+
+    // (leaf, shape triangle) pairs to test & what each found
+    std::vector<int> pairLeaf;
+    std::vector<int> pairTriangle;
+    std::vector<std::vector<ContinuousImpact> > pairImpacts;
+    std::vector<int> found;
+
+    // Earliest impact per particle, time > 1 for none
+    std::vector<float> impactTime;
+    std::vector<glm::vec3> impactNormal;
+    std::vector<int> hitParticles;
+
+    int impacts;
+
+    glm::vec3 getStart(int i) const { return glm::vec3(startX[i], startY[i], startZ[i]); };
+
+    void findImpacts(const ParticleStore* p, const ColliderTriangle& triangle, int leaf, std::vector<ContinuousImpact>& out) const;
+    int findPairs(const std::vector<ColliderTriangle>& triangles);
+
+  public:
+    ContinuousCollision();
+
+    // Sizes for a w x h grid & builds its BVH; the gap comes from the stretch springs
+    void build(int w, int h, const SpringTable& springs);
+
+    // Call before the step moves the particles
+    void begin(const ParticleStore* p);
+
+    // Moves back every particle whose path crossed a triangle since begin. pool may be NULL
+    void apply(ParticleStore* p, const std::vector<ColliderTriangle>& triangles, bool verlet, ThreadPool* pool);
+
+    // Forgets the start, e.g. after the particles were overwritten
+    void reset() { haveStart = false; };
+
+    // Settings
+    void setEnabled(bool on) { enabled = on; haveStart = false; };
+    bool isEnabled() const { return enabled; };
+
+    // Particles moved back in the last step & times the BVH was rebuilt
+    int getImpacts() const { return impacts; };
+    int getRebuilds() const { return bvh.getRebuilds(); };
+};
+
+#endif
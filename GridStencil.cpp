@@ -0,0 +1,305 @@
+#include <iostream>
+#include <math.h>
+#include <functional>
+#include "glm/glm.hpp"
+
+#include "GridStencil.h"
+#include "ParticleStore.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+
+//****************************************************
+// Grid Stencil Class - Constants
+//****************************************************
+
+// Springs handled per tile, sized so a tile's forces stay on the stack
+const int STENCIL_TILE = 64;
+
+const int STENCIL_DX[NUM_STENCIL_OFFSETS] = { 1, 0, 1, -1, 2, 0 };
+const int STENCIL_DY[NUM_STENCIL_OFFSETS] = { 0, 1, 1, 1, 0, 2 };
+const SpringType STENCIL_TYPE[NUM_STENCIL_OFFSETS] = { STRETCH, STRETCH, SHEAR, SHEAR, BEND, BEND };
+
+//****************************************************
+// Grid Stencil - Constructors
+//****************************************************
+GridStencil::GridStencil() {
+    width = 0;
+    height = 0;
+
+    for(int k = 0; k < NUM_STENCIL_OFFSETS; k++) {
+        restLength[k] = 0.0f;
+        stiffness[k] = 0.0f;
+    }
+}
+
+int GridStencil::getDX(int offset) {
+    return STENCIL_DX[offset];
+}
+
+int GridStencil::getDY(int offset) {
+    return STENCIL_DY[offset];
+}
+
+SpringType GridStencil::getType(int offset) {
+    return STENCIL_TYPE[offset];
+}
+
+//****************************************************
+// Build:
+//      - Measures each offset once at the top left of
+//        the grid. Grids are built with a constant
+//        step, so every spring of an offset shares
+//        this rest length.
+//****************************************************
+void GridStencil::build(ParticleStore* p, int w, int h) {
+    width = w;
+    height = h;
+
+    for(int k = 0; k < NUM_STENCIL_OFFSETS; k++) {
+        int dx = STENCIL_DX[k];
+        int dy = STENCIL_DY[k];
+
+        int x0 = (dx < 0) ? -dx : 0;
+
+        if(x0 + dx >= width || x0 >= width || dy >= height) {
+            restLength[k] = 0.0f;
+            stiffness[k] = 0.0f;
+            continue;
+        }
+
+        int a = x0;
+        int b = dy * width + x0 + dx;
+
+        restLength[k] = glm::length(p->getPos(b) - p->getPos(a));
+
+        // Value Increases with smaller size, as in SpringTable
+        stiffness[k] = UNIT_SPRING / restLength[k];
+    }
+}
+
+//****************************************************
+// For Each Row:
+//      - Horizontal offsets only touch their own row,
+//        so every row runs in one phase
+//      - Vertical offsets touch rows h & h + dy, so
+//        rows are split in two colors by (h / dy) & 1
+//        and the colors run one after the other
+//****************************************************
+void GridStencil::forEachRow(ThreadPool* pool, int offset, const std::function<void(int)>& rowFunc) const {
+    int dy = STENCIL_DY[offset];
+    int numRows = height - dy;
+
+    if(numRows <= 0) {
+        return;
+    }
+
+    if(dy == 0) {
+        std::function<void(int, int)> body = [&rowFunc](int begin, int end) {
+            for(int h = begin; h < end; h++) {
+                rowFunc(h);
+            }
+        };
+
+        if(pool == NULL) {
+            body(0, numRows);
+        } else {
+            pool->parallelFor(0, numRows, body);
+        }
+        return;
+    }
+
+    for(int c = 0; c < 2; c++) {
+        // j-th row of color c
+        int count = 0;
+        while((count / dy) * 2 * dy + c * dy + count % dy < numRows) {
+            count++;
+        }
+
+        std::function<void(int, int)> body = [&rowFunc, dy, c](int begin, int end) {
+            for(int j = begin; j < end; j++) {
+                rowFunc((j / dy) * 2 * dy + c * dy + j % dy);
+            }
+        };
+
+        if(pool == NULL) {
+            body(0, count);
+        } else {
+            pool->parallelFor(0, count, body);
+        }
+    }
+}
+
+//****************************************************
+// Force Row:
+//      - Adds the force of every spring of offset
+//        starting in row h
+//      - Each tile computes its forces into stack
+//        arrays, then adds them to both ends in two
+//        separate loops, so no loop both reads and
+//        writes an overlapping range
+//****************************************************
+void GridStencil::forceRow(ParticleStore* p, int offset, int h) const {
+    int dx = STENCIL_DX[offset];
+    int dy = STENCIL_DY[offset];
+
+    int wBegin = (dx < 0) ? -dx : 0;
+    int wEnd = (dx > 0) ? width - dx : width;
+
+    float rest = restLength[offset];
+    float k = stiffness[offset];
+
+    float sx[STENCIL_TILE];
+    float sy[STENCIL_TILE];
+    float sz[STENCIL_TILE];
+
+    for(int w0 = wBegin; w0 < wEnd; w0 += STENCIL_TILE) {
+        int n = (wEnd - w0 < STENCIL_TILE) ? wEnd - w0 : STENCIL_TILE;
+
+        int a = h * width + w0;
+        int b = (h + dy) * width + w0 + dx;
+
+        const float* ax = p->px + a;  const float* ay = p->py + a;  const float* az = p->pz + a;
+        const float* bx = p->px + b;  const float* by = p->py + b;  const float* bz = p->pz + b;
+
+        for(int i = 0; i < n; i++) {
+            float ddx = bx[i] - ax[i];
+            float ddy = by[i] - ay[i];
+            float ddz = bz[i] - az[i];
+
+            float length = sqrtf(ddx*ddx + ddy*ddy + ddz*ddz);
+            float magnitude = k * (length - rest);
+            float invLength = 1.0f / length;
+
+            sx[i] = ddx * invLength * magnitude;
+            sy[i] = ddy * invLength * magnitude;
+            sz[i] = ddz * invLength * magnitude;
+        }
+
+        float* fax = p->fx + a;  float* fay = p->fy + a;  float* faz = p->fz + a;
+
+        for(int i = 0; i < n; i++) {
+            fax[i] += sx[i];
+            fay[i] += sy[i];
+            faz[i] += sz[i];
+        }
+
+        float* fbx = p->fx + b;  float* fby = p->fy + b;  float* fbz = p->fz + b;
+
+        for(int i = 0; i < n; i++) {
+            fbx[i] -= sx[i];
+            fby[i] -= sy[i];
+            fbz[i] -= sz[i];
+        }
+    }
+}
+
+//****************************************************
+// Constrain Span:
+//      - Length constraint for springs a[i] -> b[i]
+//        for i in [0, n) with a stride between springs
+//      - Most springs are within tolerance, so they
+//        skip the correction with a branch
+//****************************************************
+static inline void constrainSpan(float* px, float* py, float* pz, const float* invMass,
+                                 int a, int b, int n, int stride, float upperBound, float lowerBound) {
+    for(int i = 0; i < n; i++) {
+        int ia = a + i * stride;
+        int ib = b + i * stride;
+
+        float ddx = px[ib] - px[ia];
+        float ddy = py[ib] - py[ia];
+        float ddz = pz[ib] - pz[ia];
+
+        float length = sqrtf(ddx*ddx + ddy*ddy + ddz*ddz);
+
+        float bound;
+        if(length > upperBound) {
+            bound = upperBound;
+        } else if(length < lowerBound) {
+            bound = lowerBound;
+        } else {
+            continue;
+        }
+
+        float scale = 1.0f - bound/length;
+
+        float cx = ddx * scale * 0.5f;
+        float cy = ddy * scale * 0.5f;
+        float cz = ddz * scale * 0.5f;
+
+        // Fixed particles are never moved
+        if(invMass[ia] != 0.0f) {
+            px[ia] += cx;  py[ia] += cy;  pz[ia] += cz;
+        }
+
+        if(invMass[ib] != 0.0f) {
+            px[ib] -= cx;  py[ib] -= cy;  pz[ib] -= cz;
+        }
+    }
+}
+
+//****************************************************
+// Constraint Row:
+//      - Length constraint for every spring of offset
+//        starting in row h
+//      - Vertical & diagonal springs of one row never
+//        share a particle, so the row is one span
+//      - Horizontal springs of one row do, so they run
+//        by column color ((w / dx) & 1), matching the
+//        SpringTable's order: runs of dx springs every
+//        2 * dx columns
+//****************************************************
+void GridStencil::constraintRow(ParticleStore* p, int offset, int h) const {
+    int dx = STENCIL_DX[offset];
+    int dy = STENCIL_DY[offset];
+
+    int wBegin = (dx < 0) ? -dx : 0;
+    int wEnd = (dx > 0) ? width - dx : width;
+
+    float upperBound = restLength[offset] * (1.0f + tolerance);
+    float lowerBound = restLength[offset] * (1.0f - tolerance);
+
+    int a = h * width;
+    int b = (h + dy) * width + dx;
+
+    if(dy > 0) {
+        constrainSpan(p->px, p->py, p->pz, p->invMass, a + wBegin, b + wBegin, wEnd - wBegin, 1,
+                      upperBound, lowerBound);
+        return;
+    }
+
+    for(int c = 0; c < 2; c++) {
+        for(int j = 0; j < dx; j++) {
+            int w = c * dx + j;
+
+            if(w < wEnd) {
+                int n = (wEnd - w + 2 * dx - 1) / (2 * dx);
+
+                constrainSpan(p->px, p->py, p->pz, p->invMass, a + w, b + w, n, 2 * dx,
+                              upperBound, lowerBound);
+            }
+        }
+    }
+}
+
+//****************************************************
+// Apply Force / Length Constraint:
+//      - Offsets run in SpringTable family order:
+//        STRETCH, SHEAR then BEND
+//****************************************************
+void GridStencil::applyForce(ParticleStore* p, ThreadPool* pool) const {
+    for(int k = 0; k < NUM_STENCIL_OFFSETS; k++) {
+        forEachRow(pool, k, [this, p, k](int h) {
+            forceRow(p, k, h);
+        });
+    }
+}
+
+void GridStencil::lengthConstraint(ParticleStore* p, ThreadPool* pool) const {
+    for(int k = 0; k < NUM_STENCIL_OFFSETS; k++) {
+        forEachRow(pool, k, [this, p, k](int h) {
+            constraintRow(p, k, h);
+        });
+    }
+}
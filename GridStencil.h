@@ -0,0 +1,71 @@
+#ifndef GRIDSTENCIL_H
+#define GRIDSTENCIL_H
+
+#include <functional>
+#include "glm/glm.hpp"
+#include "ParticleStore.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Grid Stencil Header Definition
+//      - Spring forces for a regular width x height
+//        Cloth without a SpringTable: every spring is
+//        one of six fixed neighbour offsets, each with
+//        a single rest length & stiffness
+//      - Rows are walked in tiles so every inner loop
+//        is a straight run over contiguous particles
+//        the compiler can vectorize
+//      - Rows that could share a particle run in
+//        separate phases (the same coloring as the
+//        SpringTable), so the result does not depend
+//        on the number of threads
+//****************************************************
+
+// Neighbour Offsets, in the order their forces are added
+enum StencilOffset {
+    STENCIL_RIGHT = 0,          // (+1, 0)  STRETCH
+    STENCIL_DOWN = 1,           // (0, +1)  STRETCH
+    STENCIL_DOWN_RIGHT = 2,     // (+1, +1) SHEAR
+    STENCIL_DOWN_LEFT = 3,      // (-1, +1) SHEAR
+    STENCIL_RIGHT2 = 4,         // (+2, 0)  BEND
+    STENCIL_DOWN2 = 5,          // (0, +2)  BEND
+    NUM_STENCIL_OFFSETS = 6
+};
+
+class GridStencil {
+  private:
+    int width;
+    int height;
+
+    float restLength[NUM_STENCIL_OFFSETS];
+    float stiffness[NUM_STENCIL_OFFSETS];
+
+    // Per Row Kernels
+    void forceRow(ParticleStore* p, int offset, int h) const;
+    void constraintRow(ParticleStore* p, int offset, int h) const;
+
+    // Runs rowFunc over every row with a spring of offset, in color order
+    void forEachRow(ThreadPool* pool, int offset, const std::function<void(int)>& rowFunc) const;
+
+  public:
+    GridStencil();
+
+    // Takes rest lengths from the particles' current positions
+    void build(ParticleStore* p, int w, int h);
+
+    bool isBuilt() const { return width > 0 && height > 0; };
+
+    float getRestLength(int offset) const { return restLength[offset]; };
+    float getStiffness(int offset) const { return stiffness[offset]; };
+
+    static int getDX(int offset);
+    static int getDY(int offset);
+    static SpringType getType(int offset);
+
+    // Same passes as SpringTable over every spring of the grid, pool may be NULL
+    void applyForce(ParticleStore* p, ThreadPool* pool) const;
+    void lengthConstraint(ParticleStore* p, ThreadPool* pool) const;
+};
+
+#endif
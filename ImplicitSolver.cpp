@@ -0,0 +1,411 @@
+#include <math.h>
+#include <vector>
+#include <functional>
+
+#include "ImplicitSolver.h"
+#include "BlockSparseMatrix.h"
+#include "ParticleStore.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+
+//****************************************************
+// Implicit Solver Class - Constants
+//****************************************************
+
+// Relative residual (preconditioned norm) the solve stops at
+const float DEFAULT_CG_TOLERANCE = 1.0e-4f;
+const int DEFAULT_CG_ITERATIONS = 100;
+
+// Particles per partial sum of a dot product
+const int DOT_BLOCK = 256;
+
+//****************************************************
+// Implicit Solver - Constructors
+//****************************************************
+ImplicitSolver::ImplicitSolver() {
+    numVertices = 0;
+    numSprings = 0;
+
+    tolerance = DEFAULT_CG_TOLERANCE;
+    maxIterations = DEFAULT_CG_ITERATIONS;
+
+    lastIterations = 0;
+    lastResidual = 0.0f;
+
+    gridWidth = 0;
+    gridHeight = 0;
+    useMultigrid = false;
+    multigridBuilt = false;
+}
+
+//****************************************************
+// Prepare:
+//      - Builds the matrix structure from the springs
+//        the first time, or when the cloth changes
+//        size; later steps only refill its values, so
+//        a step allocates nothing
+//****************************************************
+void ImplicitSolver::prepare(int nv, const SpringTable& springs) {
+    if(nv == numVertices && springs.size() == numSprings) {
+        return;
+    }
+
+    numVertices = nv;
+    numSprings = springs.size();
+
+    SpringSpan all = springs.getAll();
+    matrix.build(nv, all.i0, all.i1, all.count);
+    multigridBuilt = false;
+
+    // Rest length & stiffness of each block's springs, found through the matrix's per spring slots
+    slotSpringStart.assign(matrix.getNumBlocks() + 1, 0);
+    slotRestLength.resize(2 * numSprings);
+    slotStiffness.resize(2 * numSprings);
+
+    for(int s = 0; s < numSprings; s++) {
+        slotSpringStart[matrix.getForwardSlot(s) + 1]++;
+        slotSpringStart[matrix.getReverseSlot(s) + 1]++;
+    }
+
+    for(int slot = 0; slot < matrix.getNumBlocks(); slot++) {
+        slotSpringStart[slot + 1] += slotSpringStart[slot];
+    }
+
+    std::vector<int> fill(slotSpringStart.begin(), slotSpringStart.end() - 1);
+    for(int s = 0; s < numSprings; s++) {
+        int forward = fill[matrix.getForwardSlot(s)]++;
+        int reverse = fill[matrix.getReverseSlot(s)]++;
+
+        slotRestLength[forward] = all.restLength[s];
+        slotStiffness[forward] = all.stiffness[s];
+        slotRestLength[reverse] = all.restLength[s];
+        slotStiffness[reverse] = all.stiffness[s];
+    }
+    damping.resize(nv);
+    preconditioner.resize(nv);
+
+    dv.resize(nv);
+    rhs.resize(nv);
+    residual.resize(nv);
+    precondResidual.resize(nv);
+    direction.resize(nv);
+    product.resize(nv);
+
+    partials.assign((nv + DOT_BLOCK - 1) / DOT_BLOCK, 0.0);
+}
+
+//****************************************************
+// Parallel Helper:
+//      - Particles split on DOT_BLOCK boundaries
+//****************************************************
+void ImplicitSolver::forEachVertexChunk(ThreadPool* pool, const std::function<void(int, int)>& body) {
+    if(pool == NULL) {
+        body(0, numVertices);
+        return;
+    }
+
+    int numBlocks = (numVertices + DOT_BLOCK - 1) / DOT_BLOCK;
+    int count = numVertices;
+
+    pool->parallelFor(0, numBlocks, [&body, count](int blockBegin, int blockEnd) {
+        int end = blockEnd * DOT_BLOCK;
+        body(blockBegin * DOT_BLOCK, end < count ? end : count);
+    });
+}
+
+//****************************************************
+// Assemble:
+//      - Refills the matrix, rhs & preconditioner in
+//        place for a step of h
+//      - For a spring along n with length l & rest L:
+//          K = k (n n^T + s (I - n n^T)),
+//          s = max(0, 1 - L / l)
+//        Clamping s drops the negative transverse term
+//        of compressed springs, keeping the system
+//        positive definite for conjugate gradient
+//      - Every block of a row is written by that row
+//        alone, reading the spring data copied in
+//        slot order, so rows run in parallel with no
+//        zeroing or coloring. Each spring's K is found
+//        twice, once per row, which is cheaper than
+//        scattering it. With B_ij = -h^2 sum K of the
+//        springs joining i & j:
+//          A_ii = m_i I + h D_i - sum B_ij
+//          rhs_i = h f_i - sum B_ij (v_j - v_i)
+//                = h (f + h df/dx v)_i
+//      - Also inverts A_ii by cofactors for the block
+//        Jacobi preconditioner, or refills the
+//        multigrid levels from the new matrix
+//****************************************************
+void ImplicitSolver::assemble(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool) {
+    prepare(p->size(), springs);
+
+    float h2 = h * h;
+
+    forEachVertexChunk(pool, [this, p, h, h2](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            float xx = p->mass[i] + h * damping.xx[i],  xy = h * damping.xy[i],  xz = h * damping.xz[i];
+            float yy = p->mass[i] + h * damping.yy[i],  yz = h * damping.yz[i],  zz = p->mass[i] + h * damping.zz[i];
+
+            float rx = h * p->fx[i];
+            float ry = h * p->fy[i];
+            float rz = h * p->fz[i];
+
+            int diagonalSlot = matrix.getDiagonalSlot(i);
+
+            for(int slot = matrix.getRowStart(i); slot < matrix.getRowEnd(i); slot++) {
+                if(slot == diagonalSlot) {
+                    continue;
+                }
+
+                int j = matrix.getColumn(slot);
+
+                float dx = p->px[j] - p->px[i];
+                float dy = p->py[j] - p->py[i];
+                float dz = p->pz[j] - p->pz[i];
+
+                float length = sqrtf(dx*dx + dy*dy + dz*dz);
+                float invLength = (length > 0.0f) ? 1.0f / length : 0.0f;
+
+                float nx = dx * invLength;
+                float ny = dy * invLength;
+                float nz = dz * invLength;
+
+                // Sum of K over the springs joining i & j, none for coincident particles
+                float axial = 0.0f;
+                float iso = 0.0f;
+
+                if(length > 0.0f) {
+                    for(int k = slotSpringStart[slot]; k < slotSpringStart[slot + 1]; k++) {
+                        float transverse = 1.0f - slotRestLength[k] * invLength;
+                        if(transverse < 0.0f) {
+                            transverse = 0.0f;
+                        }
+
+                        axial += slotStiffness[k] * (1.0f - transverse);
+                        iso += slotStiffness[k] * transverse;
+                    }
+                }
+
+                float kxx = axial * nx * nx + iso,  kxy = axial * nx * ny,  kxz = axial * nx * nz;
+                float kyy = axial * ny * ny + iso,  kyz = axial * ny * nz,  kzz = axial * nz * nz + iso;
+
+                float* b = matrix.getBlock(slot);
+
+                b[0] = -h2 * kxx;  b[1] = -h2 * kxy;  b[2] = -h2 * kxz;
+                b[3] = b[1];       b[4] = -h2 * kyy;  b[5] = -h2 * kyz;
+                b[6] = b[2];       b[7] = b[5];       b[8] = -h2 * kzz;
+
+                xx -= b[0];  xy -= b[1];  xz -= b[2];
+                yy -= b[4];  yz -= b[5];  zz -= b[8];
+
+                float ux = p->vx[j] - p->vx[i];
+                float uy = p->vy[j] - p->vy[i];
+                float uz = p->vz[j] - p->vz[i];
+
+                rx -= b[0] * ux + b[1] * uy + b[2] * uz;
+                ry -= b[3] * ux + b[4] * uy + b[5] * uz;
+                rz -= b[6] * ux + b[7] * uy + b[8] * uz;
+            }
+
+            float* d = matrix.getBlock(diagonalSlot);
+            d[0] = xx;  d[1] = xy;  d[2] = xz;
+            d[3] = xy;  d[4] = yy;  d[5] = yz;
+            d[6] = xz;  d[7] = yz;  d[8] = zz;
+
+            rhs.x[i] = rx;
+            rhs.y[i] = ry;
+            rhs.z[i] = rz;
+
+            // Symmetric 3x3 inverse by cofactors
+            float c00 = yy * zz - yz * yz;
+            float c01 = xz * yz - xy * zz;
+            float c02 = xy * yz - xz * yy;
+
+            float det = xx * c00 + xy * c01 + xz * c02;
+            float invDet = (det != 0.0f) ? 1.0f / det : 0.0f;
+
+            preconditioner.xx[i] = c00 * invDet;
+            preconditioner.xy[i] = c01 * invDet;
+            preconditioner.xz[i] = c02 * invDet;
+            preconditioner.yy[i] = (xx * zz - xz * xz) * invDet;
+            preconditioner.yz[i] = (xy * xz - xx * yz) * invDet;
+            preconditioner.zz[i] = (xx * yy - xy * xy) * invDet;
+        }
+    });
+
+    if(isMultigridActive()) {
+        if(!multigridBuilt) {
+            multigrid.build(&matrix, gridWidth, gridHeight);
+            multigridBuilt = true;
+        }
+
+        multigrid.setFixed(p->invMass);
+        multigrid.refill(pool);
+    }
+}
+
+void ImplicitSolver::precondition(SolverVector& in, SolverVector& out, ThreadPool* pool) {
+    if(isMultigridActive()) {
+        multigrid.precondition(in, out, pool);
+        return;
+    }
+
+    forEachVertexChunk(pool, [this, &in, &out](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            float x = in.x[i], y = in.y[i], z = in.z[i];
+
+            out.x[i] = preconditioner.xx[i] * x + preconditioner.xy[i] * y + preconditioner.xz[i] * z;
+            out.y[i] = preconditioner.xy[i] * x + preconditioner.yy[i] * y + preconditioner.yz[i] * z;
+            out.z[i] = preconditioner.xz[i] * x + preconditioner.yz[i] * y + preconditioner.zz[i] * z;
+        }
+    });
+}
+
+// Zeroes the rows of fixed particles
+void ImplicitSolver::filter(ParticleStore* p, SolverVector& v, ThreadPool* pool) {
+    forEachVertexChunk(pool, [p, &v](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            if(p->invMass[i] == 0.0f) {
+                v.x[i] = 0.0f;
+                v.y[i] = 0.0f;
+                v.z[i] = 0.0f;
+            }
+        }
+    });
+}
+
+double ImplicitSolver::dot(const SolverVector& a, const SolverVector& b, ThreadPool* pool) {
+    forEachVertexChunk(pool, [this, &a, &b](int begin, int end) {
+        for(int block = begin; block < end; block += DOT_BLOCK) {
+            int blockEnd = (block + DOT_BLOCK < end) ? block + DOT_BLOCK : end;
+
+            double sum = 0.0;
+            for(int i = block; i < blockEnd; i++) {
+                sum += (double) a.x[i] * b.x[i] + (double) a.y[i] * b.y[i] + (double) a.z[i] * b.z[i];
+            }
+
+            partials[block / DOT_BLOCK] = sum;
+        }
+    });
+
+    double total = 0.0;
+    for(int i = 0; i < partials.size(); i++) {
+        total += partials[i];
+    }
+
+    return total;
+}
+
+//****************************************************
+// Solve:
+//      - Filtered preconditioned conjugate gradient
+//        for dv, starting from the last step's dv
+//      - Stops once the preconditioned residual falls
+//        below tolerance relative to the rhs
+//****************************************************
+void ImplicitSolver::solve(ParticleStore* p, ThreadPool* pool) {
+    filter(p, rhs, pool);
+    filter(p, dv, pool);
+
+    precondition(rhs, precondResidual, pool);
+    double target = dot(rhs, precondResidual, pool) * (double) tolerance * (double) tolerance;
+
+    // r = b - A dv
+    matrix.multiply(dv, product, pool);
+    forEachVertexChunk(pool, [this](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            residual.x[i] = rhs.x[i] - product.x[i];
+            residual.y[i] = rhs.y[i] - product.y[i];
+            residual.z[i] = rhs.z[i] - product.z[i];
+        }
+    });
+    filter(p, residual, pool);
+
+    precondition(residual, direction, pool);
+    filter(p, direction, pool);
+
+    double delta = dot(residual, direction, pool);
+
+    int iteration = 0;
+    while(iteration < maxIterations && delta > target) {
+        matrix.multiply(direction, product, pool);
+        filter(p, product, pool);
+
+        double curvature = dot(direction, product, pool);
+        if(curvature <= 0.0) {
+            break;
+        }
+
+        float alpha = (float) (delta / curvature);
+
+        forEachVertexChunk(pool, [this, alpha](int begin, int end) {
+            for(int i = begin; i < end; i++) {
+                dv.x[i] += alpha * direction.x[i];
+                dv.y[i] += alpha * direction.y[i];
+                dv.z[i] += alpha * direction.z[i];
+
+                residual.x[i] -= alpha * product.x[i];
+                residual.y[i] -= alpha * product.y[i];
+                residual.z[i] -= alpha * product.z[i];
+            }
+        });
+
+        precondition(residual, precondResidual, pool);
+
+        double newDelta = dot(residual, precondResidual, pool);
+        float beta = (float) (newDelta / delta);
+        delta = newDelta;
+
+        forEachVertexChunk(pool, [this, beta](int begin, int end) {
+            for(int i = begin; i < end; i++) {
+                direction.x[i] = precondResidual.x[i] + beta * direction.x[i];
+                direction.y[i] = precondResidual.y[i] + beta * direction.y[i];
+                direction.z[i] = precondResidual.z[i] + beta * direction.z[i];
+            }
+        });
+        filter(p, direction, pool);
+
+        iteration++;
+    }
+
+    lastIterations = iteration;
+    lastResidual = (target > 0.0) ? (float) sqrt(delta / target) * tolerance : 0.0f;
+}
+
+//****************************************************
+// Step:
+//      - Solves for dv, then moves every free particle
+//        by h v'. Previous positions are kept so the
+//        Cloth can switch back to Verlet.
+//****************************************************
+void ImplicitSolver::step(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool) {
+    assemble(p, springs, h, pool);
+    solve(p, pool);
+
+    forEachVertexChunk(pool, [this, p, h](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            if(p->invMass[i] != 0.0f) {
+                p->vx[i] += dv.x[i];
+                p->vy[i] += dv.y[i];
+                p->vz[i] += dv.z[i];
+
+                p->ox[i] = p->px[i];
+                p->oy[i] = p->py[i];
+                p->oz[i] = p->pz[i];
+
+                p->px[i] += p->vx[i] * h;
+                p->py[i] += p->vy[i] * h;
+                p->pz[i] += p->vz[i] * h;
+            }
+
+            p->fx[i] = 0.0f;
+            p->fy[i] = 0.0f;
+            p->fz[i] = 0.0f;
+
+            damping.xx[i] = 0.0f;  damping.xy[i] = 0.0f;  damping.xz[i] = 0.0f;
+            damping.yy[i] = 0.0f;  damping.yz[i] = 0.0f;  damping.zz[i] = 0.0f;
+        }
+    });
+}
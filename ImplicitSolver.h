@@ -0,0 +1,119 @@
+#ifndef IMPLICITSOLVER_H
+#define IMPLICITSOLVER_H
+
+#include <vector>
+#include <functional>
+#include "glm/glm.hpp"
+#include "ParticleStore.h"
+#include "BlockSparseMatrix.h"
+#include "Multigrid.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Implicit Solver Header Definition
+//      - Backward Euler step after Baraff & Witkin,
+//        "Large Steps in Cloth Simulation":
+//          (M - h^2 df/dx) dv = h (f + h df/dx v)
+//          v' = v + dv,  x' = x + h v'
+//      - The system is a BlockSparseMatrix whose
+//        structure is built once from the springs and
+//        refilled every step; the solve is conjugate
+//        gradient with a block Jacobi preconditioner,
+//        or a multigrid V-cycle when the particles
+//        form a known width x height grid
+//      - Fixed particles are handled by filtering:
+//        their rows are zeroed in every residual and
+//        search direction, so their dv stays 0
+//      - Damping forces may add their velocity
+//        derivative (getDamping) before the step:
+//          (M - h df/dv - h^2 df/dx) dv = ...
+//****************************************************
+
+class ImplicitSolver {
+  private:
+    int numVertices;
+    int numSprings;
+
+    // M + h D - h^2 df/dx, one row of 3x3 blocks per particle
+    BlockSparseMatrix matrix;
+
+    // Spring data in block order: a block's springs are [slotSpringStart[slot], slotSpringStart[slot + 1])
+    std::vector<int> slotSpringStart;
+    std::vector<float> slotRestLength;
+    std::vector<float> slotStiffness;
+
+    // Per particle -df/dv from damping forces, cleared after every step
+    SymmetricBlocks damping;
+
+    // Inverse of each diagonal block of the matrix
+    SymmetricBlocks preconditioner;
+
+    // Particle grid the multigrid levels are built on, 0 x 0 = unknown
+    Multigrid multigrid;
+    int gridWidth;
+    int gridHeight;
+    bool useMultigrid;
+    bool multigridBuilt;
+
+    // Solve: dv is kept between steps as the next initial guess
+    SolverVector dv;
+    SolverVector rhs;
+    SolverVector residual;
+    SolverVector precondResidual;
+    SolverVector direction;
+    SolverVector product;
+
+    // Fixed size partial sums, so dot products do not depend on the thread count
+    std::vector<double> partials;
+
+    float tolerance;
+    int maxIterations;
+
+    int lastIterations;
+    float lastResidual;
+
+    // Conjugate Gradient
+    void precondition(SolverVector& in, SolverVector& out, ThreadPool* pool);
+    void filter(ParticleStore* p, SolverVector& v, ThreadPool* pool);
+    double dot(const SolverVector& a, const SolverVector& b, ThreadPool* pool);
+    void solve(ParticleStore* p, ThreadPool* pool);
+
+    // Parallel Helper, pool may be NULL
+    void forEachVertexChunk(ThreadPool* pool, const std::function<void(int, int)>& body);
+
+  public:
+    ImplicitSolver();
+
+    // Sizes every array for the cloth, allocating only when the size changes
+    void prepare(int nv, const SpringTable& springs);
+
+    // Per particle -df/dv; c * n n^T added to block i stands for a force -c n (n . v)
+    SymmetricBlocks& getDamping() { return damping; };
+
+    // Refills the system for a step of h from p's positions, velocities & forces
+    void assemble(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool);
+
+    // Advances p by h; forces must already hold every external & spring force
+    void step(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool);
+
+    // Solve Settings
+    void setTolerance(float tol) { tolerance = tol; };
+    void setMaxIterations(int iterations) { maxIterations = iterations; };
+    float getTolerance() { return tolerance; };
+    int getMaxIterations() { return maxIterations; };
+
+    // Multigrid preconditioning, used only when width * height matches the particle count
+    void setGrid(int width, int height) { gridWidth = width; gridHeight = height; multigridBuilt = false; };
+    void setMultigrid(bool enabled) { useMultigrid = enabled; };
+    bool getMultigrid() { return useMultigrid; };
+    bool isMultigridActive() { return useMultigrid && gridWidth * gridHeight == numVertices; };
+
+    const BlockSparseMatrix& getMatrix() { return matrix; };
+
+    // Stats of the last step
+    int getLastIterations() { return lastIterations; };
+    float getLastResidual() { return lastResidual; };
+};
+
+#endif
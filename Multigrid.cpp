@@ -0,0 +1,586 @@
+#include <math.h>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "Multigrid.h"
+#include "BlockSparseMatrix.h"
+#include "ThreadPool.h"
+
+
+//****************************************************
+// Multigrid Class - Constants
+//****************************************************
+
+// Axes this short are not halved any further
+const int MG_MIN_AXIS = 3;
+
+// Levels stop once a grid has at most this many nodes; solved densely
+const int MG_COARSEST_ROWS = 64;
+
+const int DEFAULT_MG_SMOOTHING = 2;
+const float DEFAULT_MG_JACOBI_WEIGHT = 0.6f;
+
+//****************************************************
+// Axis Transfers:
+//      - Along a halved axis, fine x sits on coarse
+//        x / 2 when even and halfway between
+//        (x - 1) / 2 & (x + 1) / 2 when odd
+//      - An axis that is not halved maps one to one
+//****************************************************
+static int axisParents(int x, bool coarsened, int parent[2], float weight[2]) {
+    if(!coarsened) {
+        parent[0] = x;
+        weight[0] = 1.0f;
+        return 1;
+    }
+
+    if(x % 2 == 0) {
+        parent[0] = x / 2;
+        weight[0] = 1.0f;
+        return 1;
+    }
+
+    parent[0] = (x - 1) / 2;
+    parent[1] = (x + 1) / 2;
+    weight[0] = 0.5f;
+    weight[1] = 0.5f;
+    return 2;
+}
+
+static int axisChildren(int X, bool coarsened, int fineSize, int child[3], float weight[3]) {
+    if(!coarsened) {
+        child[0] = X;
+        weight[0] = 1.0f;
+        return 1;
+    }
+
+    int count = 0;
+    for(int x = 2 * X - 1; x <= 2 * X + 1; x++) {
+        if(x >= 0 && x < fineSize) {
+            child[count] = x;
+            weight[count] = (x == 2 * X) ? 1.0f : 0.5f;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+//****************************************************
+// Multigrid - Constructors
+//****************************************************
+Multigrid::Multigrid() {
+    fine = NULL;
+    invMass = NULL;
+
+    preSmoothing = DEFAULT_MG_SMOOTHING;
+    postSmoothing = DEFAULT_MG_SMOOTHING;
+    jacobiWeight = DEFAULT_MG_JACOBI_WEIGHT;
+
+    coarseSize = 0;
+}
+
+void Multigrid::forEachRowChunk(ThreadPool* pool, int count, const std::function<void(int, int)>& body) {
+    if(pool == NULL) {
+        body(0, count);
+    } else {
+        pool->parallelFor(0, count, body);
+    }
+}
+
+//****************************************************
+// Build:
+//      - Halves the grid until it has at most
+//        MG_COARSEST_ROWS nodes, building each coarse
+//        level's block structure
+//****************************************************
+void Multigrid::build(const BlockSparseMatrix* fineMatrix, int width, int height) {
+    fine = fineMatrix;
+    levels.clear();
+
+    Level top;
+    top.width = width;
+    top.height = height;
+    levels.push_back(top);
+
+    while(levels.back().width * levels.back().height > MG_COARSEST_ROWS) {
+        Level& last = levels.back();
+
+        last.coarsenX = (last.width > MG_MIN_AXIS);
+        last.coarsenY = (last.height > MG_MIN_AXIS);
+
+        Level next;
+        next.width = last.coarsenX ? last.width / 2 + 1 : last.width;
+        next.height = last.coarsenY ? last.height / 2 + 1 : last.height;
+        levels.push_back(next);
+    }
+
+    levels.back().coarsenX = false;
+    levels.back().coarsenY = false;
+
+    for(int l = 0; l < levels.size(); l++) {
+        int rows = levels[l].width * levels[l].height;
+
+        levels[l].inverseDiagonal.resize(rows);
+        levels[l].b.resize(rows);
+        levels[l].x.resize(rows);
+        levels[l].r.resize(rows);
+
+        if(l > 0) {
+            buildCoarse(l - 1);
+        }
+    }
+
+    coarseSize = 3 * levels.back().width * levels.back().height;
+    coarseFactor.assign(coarseSize * coarseSize, 0.0);
+    coarseVector.assign(coarseSize, 0.0);
+}
+
+//****************************************************
+// Build Coarse:
+//      - The blocks of P^T A P below level l: coarse
+//        rows i & j are coupled when a fine child of i
+//        is coupled to a fine child of j
+//****************************************************
+void Multigrid::buildCoarse(int l) {
+    const Level& f = levels[l];
+    Level& c = levels[l + 1];
+    const BlockSparseMatrix& op = getOperator(l);
+
+    std::vector<int> i0;
+    std::vector<int> i1;
+    std::vector<int> neighbours;
+
+    for(int Y = 0; Y < c.height; Y++) {
+        for(int X = 0; X < c.width; X++) {
+            int row = Y * c.width + X;
+
+            int childX[3], childY[3];
+            float weightX[3], weightY[3];
+            int numX = axisChildren(X, f.coarsenX, f.width, childX, weightX);
+            int numY = axisChildren(Y, f.coarsenY, f.height, childY, weightY);
+
+            neighbours.clear();
+
+            for(int cy = 0; cy < numY; cy++) {
+                for(int cx = 0; cx < numX; cx++) {
+                    int f1 = childY[cy] * f.width + childX[cx];
+
+                    for(int slot = op.getRowStart(f1); slot < op.getRowEnd(f1); slot++) {
+                        int f2 = op.getColumn(slot);
+
+                        int parentX[2], parentY[2];
+                        float pwX[2], pwY[2];
+                        int numPX = axisParents(f2 % f.width, f.coarsenX, parentX, pwX);
+                        int numPY = axisParents(f2 / f.width, f.coarsenY, parentY, pwY);
+
+                        for(int py = 0; py < numPY; py++) {
+                            for(int px = 0; px < numPX; px++) {
+                                neighbours.push_back(parentY[py] * c.width + parentX[px]);
+                            }
+                        }
+                    }
+                }
+            }
+
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+            // Each coupling once, from its lower row
+            for(int n = 0; n < neighbours.size(); n++) {
+                if(neighbours[n] > row) {
+                    i0.push_back(row);
+                    i1.push_back(neighbours[n]);
+                }
+            }
+        }
+    }
+
+    c.matrix.build(c.width * c.height, i0.data(), i1.data(), (int) i0.size());
+}
+
+//****************************************************
+// Refill Coarse:
+//      - Recomputes level l + 1's blocks as P^T A P of
+//        level l, one coarse row per iteration so rows
+//        run in parallel
+//      - Fixed fine rows & columns are skipped, giving
+//        the Galerkin product of the filtered system
+//****************************************************
+void Multigrid::refillCoarse(int l, ThreadPool* pool) {
+    const Level& f = levels[l];
+    Level& c = levels[l + 1];
+    const BlockSparseMatrix& op = getOperator(l);
+    BlockSparseMatrix& coarse = c.matrix;
+
+    forEachRowChunk(pool, c.width * c.height, [this, l, &f, &c, &op, &coarse](int begin, int end) {
+        for(int row = begin; row < end; row++) {
+            int X = row % c.width;
+            int Y = row / c.width;
+
+            for(int slot = coarse.getRowStart(row); slot < coarse.getRowEnd(row); slot++) {
+                float* block = coarse.getBlock(slot);
+                for(int k = 0; k < BLOCK_VALUES; k++) {
+                    block[k] = 0.0f;
+                }
+            }
+
+            int childX[3], childY[3];
+            float weightX[3], weightY[3];
+            int numX = axisChildren(X, f.coarsenX, f.width, childX, weightX);
+            int numY = axisChildren(Y, f.coarsenY, f.height, childY, weightY);
+
+            for(int cy = 0; cy < numY; cy++) {
+                for(int cx = 0; cx < numX; cx++) {
+                    int f1 = childY[cy] * f.width + childX[cx];
+                    float w1 = weightY[cy] * weightX[cx];
+
+                    if(isFixed(l, f1)) {
+                        continue;
+                    }
+
+                    for(int slot = op.getRowStart(f1); slot < op.getRowEnd(f1); slot++) {
+                        int f2 = op.getColumn(slot);
+
+                        if(isFixed(l, f2)) {
+                            continue;
+                        }
+
+                        const float* a = op.getBlock(slot);
+
+                        int parentX[2], parentY[2];
+                        float pwX[2], pwY[2];
+                        int numPX = axisParents(f2 % f.width, f.coarsenX, parentX, pwX);
+                        int numPY = axisParents(f2 / f.width, f.coarsenY, parentY, pwY);
+
+                        for(int py = 0; py < numPY; py++) {
+                            for(int px = 0; px < numPX; px++) {
+                                float w = w1 * pwY[py] * pwX[px];
+                                float* block = coarse.getBlock(coarse.findSlot(row, parentY[py] * c.width + parentX[px]));
+
+                                for(int k = 0; k < BLOCK_VALUES; k++) {
+                                    block[k] += w * a[k];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+//****************************************************
+// Refill Inverse Diagonal:
+//      - Symmetric 3x3 inverse of each diagonal block
+//        by cofactors; singular blocks smooth nothing
+//****************************************************
+void Multigrid::refillInverseDiagonal(int l, ThreadPool* pool) {
+    const BlockSparseMatrix& op = getOperator(l);
+    SymmetricBlocks& inverse = levels[l].inverseDiagonal;
+
+    forEachRowChunk(pool, op.getNumRows(), [&op, &inverse](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            const float* d = op.getBlock(op.getDiagonalSlot(i));
+
+            float a = d[0], b = d[1], c = d[2];
+            float e = d[4], f = d[5], g = d[8];
+
+            float c00 = e * g - f * f;
+            float c01 = c * f - b * g;
+            float c02 = b * f - c * e;
+
+            float det = a * c00 + b * c01 + c * c02;
+            float invDet = (det != 0.0f) ? 1.0f / det : 0.0f;
+
+            inverse.xx[i] = c00 * invDet;
+            inverse.xy[i] = c01 * invDet;
+            inverse.xz[i] = c02 * invDet;
+            inverse.yy[i] = (a * g - c * c) * invDet;
+            inverse.yz[i] = (b * c - a * f) * invDet;
+            inverse.zz[i] = (a * e - b * b) * invDet;
+        }
+    });
+}
+
+//****************************************************
+// Factor Coarsest:
+//      - Dense Cholesky of the coarsest operator, in
+//        double; fixed rows become identity rows
+//      - A non-positive pivot is replaced by 1, which
+//        keeps the factor (and so the cycle) positive
+//        definite
+//****************************************************
+void Multigrid::factorCoarsest() {
+    int l = (int) levels.size() - 1;
+    const BlockSparseMatrix& op = getOperator(l);
+    int n = coarseSize;
+
+    std::fill(coarseFactor.begin(), coarseFactor.end(), 0.0);
+
+    for(int i = 0; i < op.getNumRows(); i++) {
+        if(isFixed(l, i)) {
+            for(int a = 0; a < 3; a++) {
+                coarseFactor[(3 * i + a) * n + 3 * i + a] = 1.0;
+            }
+            continue;
+        }
+
+        for(int slot = op.getRowStart(i); slot < op.getRowEnd(i); slot++) {
+            int j = op.getColumn(slot);
+
+            if(isFixed(l, j)) {
+                continue;
+            }
+
+            const float* block = op.getBlock(slot);
+            for(int a = 0; a < 3; a++) {
+                for(int b = 0; b < 3; b++) {
+                    coarseFactor[(3 * i + a) * n + 3 * j + b] = block[3 * a + b];
+                }
+            }
+        }
+    }
+
+    for(int k = 0; k < n; k++) {
+        double pivot = coarseFactor[k * n + k];
+        for(int m = 0; m < k; m++) {
+            pivot -= coarseFactor[k * n + m] * coarseFactor[k * n + m];
+        }
+
+        pivot = (pivot > 0.0) ? sqrt(pivot) : 1.0;
+        coarseFactor[k * n + k] = pivot;
+
+        for(int i = k + 1; i < n; i++) {
+            double sum = coarseFactor[i * n + k];
+            for(int m = 0; m < k; m++) {
+                sum -= coarseFactor[i * n + m] * coarseFactor[k * n + m];
+            }
+
+            coarseFactor[i * n + k] = sum / pivot;
+        }
+    }
+}
+
+//****************************************************
+// Refill:
+//      - Fine to coarse: each level's operator is
+//        built from the one above it
+//****************************************************
+void Multigrid::refill(ThreadPool* pool) {
+    for(int l = 0; l < levels.size(); l++) {
+        if(l > 0) {
+            refillCoarse(l - 1, pool);
+        }
+
+        refillInverseDiagonal(l, pool);
+    }
+
+    factorCoarsest();
+}
+
+//****************************************************
+// Smooth:
+//      - Damped block Jacobi sweeps,
+//          x += w D^-1 (b - A x)
+//****************************************************
+void Multigrid::smooth(int l, const SolverVector& b, SolverVector& x, int sweeps, ThreadPool* pool) {
+    const BlockSparseMatrix& op = getOperator(l);
+    Level& level = levels[l];
+    SolverVector& product = level.r;
+    float w = jacobiWeight;
+
+    for(int sweep = 0; sweep < sweeps; sweep++) {
+        op.multiply(x, product, pool);
+
+        forEachRowChunk(pool, op.getNumRows(), [this, l, &level, &b, &x, &product, w](int begin, int end) {
+            const SymmetricBlocks& inverse = level.inverseDiagonal;
+
+            for(int i = begin; i < end; i++) {
+                if(isFixed(l, i)) {
+                    x.x[i] = 0.0f;
+                    x.y[i] = 0.0f;
+                    x.z[i] = 0.0f;
+                    continue;
+                }
+
+                float rx = b.x[i] - product.x[i];
+                float ry = b.y[i] - product.y[i];
+                float rz = b.z[i] - product.z[i];
+
+                x.x[i] += w * (inverse.xx[i] * rx + inverse.xy[i] * ry + inverse.xz[i] * rz);
+                x.y[i] += w * (inverse.xy[i] * rx + inverse.yy[i] * ry + inverse.yz[i] * rz);
+                x.z[i] += w * (inverse.xz[i] * rx + inverse.yz[i] * ry + inverse.zz[i] * rz);
+            }
+        });
+    }
+}
+
+//****************************************************
+// Restrict Residual:
+//      - Level l + 1's rhs = P^T of level l's residual
+//****************************************************
+void Multigrid::restrictResidual(int l, ThreadPool* pool) {
+    const Level& f = levels[l];
+    Level& c = levels[l + 1];
+
+    forEachRowChunk(pool, c.width * c.height, [&f, &c](int begin, int end) {
+        for(int row = begin; row < end; row++) {
+            int childX[3], childY[3];
+            float weightX[3], weightY[3];
+            int numX = axisChildren(row % c.width, f.coarsenX, f.width, childX, weightX);
+            int numY = axisChildren(row / c.width, f.coarsenY, f.height, childY, weightY);
+
+            float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+
+            for(int cy = 0; cy < numY; cy++) {
+                for(int cx = 0; cx < numX; cx++) {
+                    int i = childY[cy] * f.width + childX[cx];
+                    float w = weightY[cy] * weightX[cx];
+
+                    sx += w * f.r.x[i];
+                    sy += w * f.r.y[i];
+                    sz += w * f.r.z[i];
+                }
+            }
+
+            c.b.x[row] = sx;
+            c.b.y[row] = sy;
+            c.b.z[row] = sz;
+        }
+    });
+}
+
+//****************************************************
+// Prolongate:
+//      - x of level l += P times level l + 1's x
+//****************************************************
+void Multigrid::prolongate(int l, SolverVector& x, ThreadPool* pool) {
+    const Level& f = levels[l];
+    const Level& c = levels[l + 1];
+
+    forEachRowChunk(pool, f.width * f.height, [this, l, &f, &c, &x](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            if(isFixed(l, i)) {
+                continue;
+            }
+
+            int parentX[2], parentY[2];
+            float weightX[2], weightY[2];
+            int numX = axisParents(i % f.width, f.coarsenX, parentX, weightX);
+            int numY = axisParents(i / f.width, f.coarsenY, parentY, weightY);
+
+            for(int py = 0; py < numY; py++) {
+                for(int px = 0; px < numX; px++) {
+                    int row = parentY[py] * c.width + parentX[px];
+                    float w = weightY[py] * weightX[px];
+
+                    x.x[i] += w * c.x.x[row];
+                    x.y[i] += w * c.x.y[row];
+                    x.z[i] += w * c.x.z[row];
+                }
+            }
+        }
+    });
+}
+
+//****************************************************
+// Solve Coarsest:
+//      - Forward & back substitution with the factor
+//****************************************************
+void Multigrid::solveCoarsest(const SolverVector& b, SolverVector& x) {
+    int n = coarseSize;
+    int l = (int) levels.size() - 1;
+
+    for(int i = 0; i < n / 3; i++) {
+        bool held = isFixed(l, i);
+
+        coarseVector[3 * i] = held ? 0.0 : b.x[i];
+        coarseVector[3 * i + 1] = held ? 0.0 : b.y[i];
+        coarseVector[3 * i + 2] = held ? 0.0 : b.z[i];
+    }
+
+    for(int i = 0; i < n; i++) {
+        double sum = coarseVector[i];
+        for(int k = 0; k < i; k++) {
+            sum -= coarseFactor[i * n + k] * coarseVector[k];
+        }
+        coarseVector[i] = sum / coarseFactor[i * n + i];
+    }
+
+    for(int i = n - 1; i >= 0; i--) {
+        double sum = coarseVector[i];
+        for(int k = i + 1; k < n; k++) {
+            sum -= coarseFactor[k * n + i] * coarseVector[k];
+        }
+        coarseVector[i] = sum / coarseFactor[i * n + i];
+    }
+
+    for(int i = 0; i < n / 3; i++) {
+        x.x[i] = (float) coarseVector[3 * i];
+        x.y[i] = (float) coarseVector[3 * i + 1];
+        x.z[i] = (float) coarseVector[3 * i + 2];
+    }
+}
+
+//****************************************************
+// Cycle:
+//      - One V-cycle on level l: smooth, correct from
+//        the level below, smooth again
+//****************************************************
+void Multigrid::cycle(int l, const SolverVector& b, SolverVector& x, ThreadPool* pool) {
+    if(l == levels.size() - 1) {
+        solveCoarsest(b, x);
+        return;
+    }
+
+    smooth(l, b, x, preSmoothing, pool);
+
+    // Residual of level l, held at zero on fixed rows
+    Level& level = levels[l];
+    getOperator(l).multiply(x, level.r, pool);
+
+    forEachRowChunk(pool, level.width * level.height, [this, l, &level, &b](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            bool held = isFixed(l, i);
+
+            level.r.x[i] = held ? 0.0f : b.x[i] - level.r.x[i];
+            level.r.y[i] = held ? 0.0f : b.y[i] - level.r.y[i];
+            level.r.z[i] = held ? 0.0f : b.z[i] - level.r.z[i];
+        }
+    });
+
+    restrictResidual(l, pool);
+
+    Level& coarse = levels[l + 1];
+    std::fill(coarse.x.x.begin(), coarse.x.x.end(), 0.0f);
+    std::fill(coarse.x.y.begin(), coarse.x.y.end(), 0.0f);
+    std::fill(coarse.x.z.begin(), coarse.x.z.end(), 0.0f);
+
+    cycle(l + 1, coarse.b, coarse.x, pool);
+
+    prolongate(l, x, pool);
+
+    smooth(l, b, x, postSmoothing, pool);
+}
+
+//****************************************************
+// Precondition / Solve:
+//      - precondition is one cycle from x = 0
+//      - solve runs cycles from the given x, as a
+//        stationary iteration
+//****************************************************
+void Multigrid::precondition(const SolverVector& b, SolverVector& x, ThreadPool* pool) {
+    std::fill(x.x.begin(), x.x.end(), 0.0f);
+    std::fill(x.y.begin(), x.y.end(), 0.0f);
+    std::fill(x.z.begin(), x.z.end(), 0.0f);
+
+    cycle(0, b, x, pool);
+}
+
+void Multigrid::solve(const SolverVector& b, SolverVector& x, int cycles, ThreadPool* pool) {
+    for(int i = 0; i < cycles; i++) {
+        cycle(0, b, x, pool);
+    }
+}
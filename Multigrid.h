@@ -0,0 +1,119 @@
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include <vector>
+#include <functional>
+#include "BlockSparseMatrix.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Multigrid Header Definition
+//      - Geometric multigrid for a 3x3 block system on
+//        a width x height grid (row = h * width + w),
+//        such as the implicit cloth system
+//      - Each level halves the grid in every direction
+//        longer than MG_MIN_AXIS; coarse node (X, Y)
+//        sits on fine node (2X, 2Y)
+//      - Prolongation is bilinear, restriction its
+//        transpose, and coarse operators are Galerkin
+//        products P^T A P, so no level needs to know
+//        where the fine matrix came from
+//      - Smoothing is damped block Jacobi, the same
+//        sweeps before & after the coarse correction,
+//        and the coarsest level is solved by a dense
+//        Cholesky factor, so a V-cycle from zero is a
+//        symmetric operator usable inside conjugate
+//        gradient
+//      - Rows marked fixed are held at zero on the
+//        finest level and left out of the coarse
+//        operators, matching a filtered solve
+//****************************************************
+
+class Multigrid {
+  private:
+    //****************************************************
+    // Level
+    //      - Level 0 is the caller's matrix; coarser
+    //        levels own theirs
+    //****************************************************
+    struct Level {
+        int width;
+        int height;
+
+        // Whether the next coarser level halves this axis
+        bool coarsenX;
+        bool coarsenY;
+
+        // Unused on level 0
+        BlockSparseMatrix matrix;
+
+        // Inverse diagonal blocks for the smoother
+        SymmetricBlocks inverseDiagonal;
+
+        // Right hand side & solution of the coarse levels, residual of every level
+        SolverVector b;
+        SolverVector x;
+        SolverVector r;
+    };
+
+    std::vector<Level> levels;
+    const BlockSparseMatrix* fine;
+
+    // Rows with invMass 0 are held at zero on the finest level, NULL = none
+    const float* invMass;
+
+    int preSmoothing;
+    int postSmoothing;
+    float jacobiWeight;
+
+    // Dense lower triangular Cholesky factor of the coarsest operator
+    std::vector<double> coarseFactor;
+    std::vector<double> coarseVector;
+    int coarseSize;
+
+    void buildCoarse(int l);
+    void refillCoarse(int l, ThreadPool* pool);
+    void refillInverseDiagonal(int l, ThreadPool* pool);
+    void factorCoarsest();
+
+    const BlockSparseMatrix& getOperator(int l) const { return (l == 0) ? *fine : levels[l].matrix; };
+    bool isFixed(int l, int row) const { return l == 0 && invMass != NULL && invMass[row] == 0.0f; };
+
+    void smooth(int l, const SolverVector& b, SolverVector& x, int sweeps, ThreadPool* pool);
+    void restrictResidual(int l, ThreadPool* pool);
+    void prolongate(int l, SolverVector& x, ThreadPool* pool);
+    void solveCoarsest(const SolverVector& b, SolverVector& x);
+    void cycle(int l, const SolverVector& b, SolverVector& x, ThreadPool* pool);
+
+    // Rows split into one contiguous range per thread, pool may be NULL
+    void forEachRowChunk(ThreadPool* pool, int count, const std::function<void(int, int)>& body);
+
+  public:
+    Multigrid();
+
+    // Builds the coarse levels' structure below fine, a width x height grid operator
+    void build(const BlockSparseMatrix* fine, int width, int height);
+
+    // invMass of the finest level's rows, rows with 0 are fixed; NULL = none
+    void setFixed(const float* w) { invMass = w; };
+
+    // Recomputes every coarse operator, smoother & the coarsest factor from the fine values
+    void refill(ThreadPool* pool);
+
+    // x = V-cycle applied to b from x = 0, as a preconditioner
+    void precondition(const SolverVector& b, SolverVector& x, ThreadPool* pool);
+
+    // Standalone: improves x towards A x = b with V-cycles, or with fine level sweeps only
+    void solve(const SolverVector& b, SolverVector& x, int cycles, ThreadPool* pool);
+    void smooth(const SolverVector& b, SolverVector& x, int sweeps, ThreadPool* pool) { smooth(0, b, x, sweeps, pool); };
+
+    // Settings
+    void setSmoothing(int pre, int post) { preSmoothing = pre; postSmoothing = post; };
+    void setJacobiWeight(float w) { jacobiWeight = w; };
+
+    int getNumLevels() { return (int) levels.size(); };
+    int getLevelWidth(int l) { return levels[l].width; };
+    int getLevelHeight(int l) { return levels[l].height; };
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include "glm/glm.hpp"
+
+#include "ParticleStore.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+//****************************************************
+// Particle Store - Constants
+//****************************************************
+
+// Number of float arrays carved out of the block
+const int NUM_PARTICLE_ARRAYS = 17;
+
+//****************************************************
+// Aligned Allocation Helpers
+//****************************************************
+static float* alignedAllocFloats(int n) {
+    void* ptr = NULL;
+
+#ifdef _WIN32
+    ptr = _aligned_malloc(n * sizeof(float), PARTICLE_ALIGN);
+#else
+    if(posix_memalign(&ptr, PARTICLE_ALIGN, n * sizeof(float)) != 0) {
+        ptr = NULL;
+    }
+#endif
+
+    if(ptr == NULL) {
+        std::cerr << "ParticleStore: Failed to allocate " << n << " floats" << std::endl;
+        std::exit(1);
+    }
+
+    return (float*) ptr;
+}
+
+static void alignedFree(float* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+//****************************************************
+// Particle Store - Constructors
+//****************************************************
+ParticleStore::ParticleStore() {
+    count = 0;
+    capacity = 0;
+    block = NULL;
+
+    resize(0);
+}
+
+ParticleStore::ParticleStore(int n) {
+    count = 0;
+    capacity = 0;
+    block = NULL;
+
+    resize(n);
+}
+
+ParticleStore::~ParticleStore() {
+    release();
+}
+
+void ParticleStore::release() {
+    if(block != NULL) {
+        alignedFree(block);
+        block = NULL;
+    }
+}
+
+//****************************************************
+// Resize:
+//      - Reallocates every array for n particles and
+//        zeroes them. Existing contents are discarded.
+//      - Capacity is padded so SIMD loops may run
+//        past count without a remainder loop.
+//****************************************************
+void ParticleStore::resize(int n) {
+    release();
+
+    count = n;
+    capacity = ((n + PARTICLE_PAD - 1) / PARTICLE_PAD) * PARTICLE_PAD;
+    if(capacity == 0) {
+        capacity = PARTICLE_PAD;
+    }
+
+    block = alignedAllocFloats(NUM_PARTICLE_ARRAYS * capacity);
+    memset(block, 0, NUM_PARTICLE_ARRAYS * capacity * sizeof(float));
+
+    float** arrays[NUM_PARTICLE_ARRAYS] = {
+        &px, &py, &pz,
+        &ox, &oy, &oz,
+        &vx, &vy, &vz,
+        &fx, &fy, &fz,
+        &nx, &ny, &nz,
+        &mass, &invMass
+    };
+
+    for(int a = 0; a < NUM_PARTICLE_ARRAYS; a++) {
+        *arrays[a] = block + a * capacity;
+    }
+}
+
+//****************************************************
+// Copy From:
+//      - Copies the whole store (used for snapshots)
+//****************************************************
+void ParticleStore::copyFrom(const ParticleStore& other) {
+    if(other.count != count) {
+        resize(other.count);
+    }
+
+    memcpy(block, other.block, NUM_PARTICLE_ARRAYS * capacity * sizeof(float));
+}
+
+//****************************************************
+// Particle Store - Setters
+//****************************************************
+void ParticleStore::setMass(int i, float m) {
+    bool wasFixed = (mass[i] != 0.0f) && isFixed(i);
+
+    mass[i] = m;
+    invMass[i] = wasFixed ? 0.0f : 1.0f / m;
+}
+
+void ParticleStore::setFixed(int i, bool isFixed) {
+    invMass[i] = isFixed ? 0.0f : 1.0f / mass[i];
+}
+
+//****************************************************
+// Update After Collide:
+//      - Called by a Shape when a collision is
+//        detected. Moves the particle to newPos and
+//        damps its velocity.
+//****************************************************
+void ParticleStore::updateAfterCollide(int i, glm::vec3 newPos, glm::vec3 newVel) {
+    setPos(i, newPos);
+
+    vx[i] *= .4f;
+    vy[i] *= .4f;
+    vz[i] *= .4f;
+}
+
+void ParticleStore::offsetCorrection(int i, glm::vec3 correctionVec) {
+    if(!isFixed(i)) {
+        px[i] += correctionVec.x;
+        py[i] += correctionVec.y;
+        pz[i] += correctionVec.z;
+    }
+}
+
+//****************************************************
+// Reset Forces / Normals
+//****************************************************
+void ParticleStore::resetForces(int begin, int end) {
+    for(int i = begin; i < end; i++) {
+        fx[i] = 0.0f;
+        fy[i] = 0.0f;
+        fz[i] = 0.0f;
+    }
+}
+
+void ParticleStore::resetNormals(int begin, int end) {
+    for(int i = begin; i < end; i++) {
+        nx[i] = 0.0f;
+        ny[i] = 0.0f;
+        nz[i] = 0.0f;
+    }
+}
+
+//****************************************************
+// Add Constant Accel:
+//      - Constant accelerations (i.e. Gravity) are
+//        stored as force so a single accumulator is
+//        integrated.
+//****************************************************
+void ParticleStore::addConstantAccel(glm::vec3 accel, int begin, int end) {
+    for(int i = begin; i < end; i++) {
+        fx[i] += accel.x * mass[i];
+        fy[i] += accel.y * mass[i];
+        fz[i] += accel.z * mass[i];
+    }
+}
+
+//****************************************************
+// Euler Integration - Update Position
+//      - Fixed particles are skipped, forces are
+//        cleared for every particle.
+//****************************************************
+void ParticleStore::updateEuler(float timeChange, int begin, int end) {
+    for(int i = begin; i < end; i++) {
+        float w = invMass[i];
+
+        if(w != 0.0f) {
+            vx[i] += fx[i] * w * timeChange;
+            vy[i] += fy[i] * w * timeChange;
+            vz[i] += fz[i] * w * timeChange;
+
+            px[i] += vx[i] * timeChange;
+            py[i] += vy[i] * timeChange;
+            pz[i] += vz[i] * timeChange;
+        }
+
+        fx[i] = 0.0f;
+        fy[i] = 0.0f;
+        fz[i] = 0.0f;
+    }
+}
+
+//****************************************************
+// Verlet Integration - Update Position
+//      - x' = x + (x - xOld)*(1 - damp) + a*dt^2
+//****************************************************
+void ParticleStore::updateVerlet(float timeChange, int begin, int end) {
+    float dt2 = timeChange * timeChange;
+    float keep = 1.0f - PARTICLE_DAMP_FACTOR;
+
+    for(int i = begin; i < end; i++) {
+        float w = invMass[i];
+
+        if(w != 0.0f) {
+            float tx = px[i];
+            float ty = py[i];
+            float tz = pz[i];
+
+            px[i] = tx + (tx - ox[i]) * keep + fx[i] * w * dt2;
+            py[i] = ty + (ty - oy[i]) * keep + fy[i] * w * dt2;
+            pz[i] = tz + (tz - oz[i]) * keep + fz[i] * w * dt2;
+
+            ox[i] = tx;
+            oy[i] = ty;
+            oz[i] = tz;
+        }
+
+        fx[i] = 0.0f;
+        fy[i] = 0.0f;
+        fz[i] = 0.0f;
+    }
+}
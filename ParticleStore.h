@@ -0,0 +1,113 @@
+#ifndef PARTICLESTORE_H
+#define PARTICLESTORE_H
+
+#include "glm/glm.hpp"
+
+//****************************************************
+// Particle Store Header Definition
+//      - Structure of Arrays holding every particle
+//        of a Cloth, indexed by h*width + w
+//      - Each component lives in its own aligned
+//        array so the per-step passes stream through
+//        memory instead of chasing Vertex pointers
+//****************************************************
+
+// Alignment (bytes) and padding (floats) of every array
+const int PARTICLE_ALIGN = 64;
+const int PARTICLE_PAD = 16;
+
+// Verlet Damping, matches Vertex::updateVerlet
+const float PARTICLE_DAMP_FACTOR = 0.01f;
+
+class ParticleStore {
+  private:
+    int count;
+    int capacity;       // count rounded up to PARTICLE_PAD
+
+    float* block;       // Single aligned allocation backing every array
+
+    void release();
+
+    // Owns raw memory, not copyable
+    ParticleStore(const ParticleStore&);
+    ParticleStore& operator=(const ParticleStore&);
+
+  public:
+    // Component Arrays (capacity floats each, padding is zeroed)
+    float* px;  float* py;  float* pz;      // Position
+    float* ox;  float* oy;  float* oz;      // Previous Position (Verlet)
+    float* vx;  float* vy;  float* vz;      // Velocity
+    float* fx;  float* fy;  float* fz;      // Accumulated Force
+    float* nx;  float* ny;  float* nz;      // Accumulated (unnormalized) Normal
+    float* mass;
+    float* invMass;                         // 0 for fixed particles
+
+    // Constructors
+    ParticleStore();
+    ParticleStore(int n);
+    ~ParticleStore();
+
+    void resize(int n);
+
+    // Copies every array of other, resizing if needed
+    void copyFrom(const ParticleStore& other);
+
+    int size() const { return count; };
+    int getCapacity() const { return capacity; };
+
+    // Single Particle Accessors
+    glm::vec3 getPos(int i) const { return glm::vec3(px[i], py[i], pz[i]); };
+    glm::vec3 getPrevPos(int i) const { return glm::vec3(ox[i], oy[i], oz[i]); };
+    glm::vec3 getVelocity(int i) const { return glm::vec3(vx[i], vy[i], vz[i]); };
+    glm::vec3 getForce(int i) const { return glm::vec3(fx[i], fy[i], fz[i]); };
+    glm::vec3 getNorm(int i) const { return glm::normalize(glm::vec3(nx[i], ny[i], nz[i])); };
+
+    void setPos(int i, glm::vec3 p) { px[i] = p.x; py[i] = p.y; pz[i] = p.z; };
+    void setPrevPos(int i, glm::vec3 p) { ox[i] = p.x; oy[i] = p.y; oz[i] = p.z; };
+    void setVelocity(int i, glm::vec3 v) { vx[i] = v.x; vy[i] = v.y; vz[i] = v.z; };
+
+    void addForce(int i, glm::vec3 f) { fx[i] += f.x; fy[i] += f.y; fz[i] += f.z; };
+    void addNormal(int i, glm::vec3 n) { nx[i] += n.x; ny[i] += n.y; nz[i] += n.z; };
+
+    bool isFixed(int i) const { return invMass[i] == 0.0f; };
+
+    void setMass(int i, float m);
+    void setFixed(int i, bool isFixed);
+
+    // Called by Shapes when a collision is detected
+    void updateAfterCollide(int i, glm::vec3 newPos, glm::vec3 newVel);
+
+    // Moves a non-fixed particle by correctionVec
+    void offsetCorrection(int i, glm::vec3 correctionVec);
+
+    // Whole Store Passes over [begin, end)
+    void resetForces(int begin, int end);
+    void resetNormals(int begin, int end);
+    void addConstantAccel(glm::vec3 accel, int begin, int end);
+
+    void updateEuler(float timeChange, int begin, int end);
+    void updateVerlet(float timeChange, int begin, int end);
+};
+
+//****************************************************
+// Particle Ref
+//      - Thin handle to a single particle, used by
+//        the viewer in place of the old Vertex*
+//****************************************************
+class ParticleRef {
+  private:
+    const ParticleStore* store;
+    int index;
+
+  public:
+    ParticleRef(const ParticleStore* s, int i) : store(s), index(i) {};
+
+    int getIndex() { return index; };
+
+    glm::vec3 getPos() { return store->getPos(index); };
+    glm::vec3 getVelocity() { return store->getVelocity(index); };
+    glm::vec3 getNorm() { return store->getNorm(index); };
+    bool isFixed() { return store->isFixed(index); };
+};
+
+#endif
@@ -4,7 +4,7 @@
 #include "glm/glm.hpp"
 
 #include "Plane.h"
-#include "Vertex.h"
+#include "ParticleStore.h"
 
 //****************************************************
 // Plane Class Definition
@@ -15,6 +15,7 @@ Plane::Plane(){
     lowRight = glm::vec3(0.5f, -1.0f, -0.5f);
     lowLeft = glm::vec3(-0.5f, -1.0f, -0.5f);
     normal = calcNormal();
+    initCollider();
 
     isFloor = false;
 }
@@ -25,6 +26,7 @@ Plane::Plane(glm::vec3 ul, glm::vec3 ur, glm::vec3 lr, glm::vec3 ll) {
     lowRight = lr;
     lowLeft = ll;
     normal = calcNormal();
+    initCollider();
 
     isFloor = false;
 }
@@ -35,6 +37,7 @@ Plane::Plane(glm::vec3 ul, glm::vec3 vecToRight, glm::vec3 vecToLow) {
     lowRight = ul+vecToRight + vecToLow;
     lowLeft = ul + vecToLow;
     normal = calcNormal();
+    initCollider();
 
     isFloor = false;
 }
@@ -67,7 +70,7 @@ bool Plane::isPointInPlane(glm::vec3 pointOnPlane) {
 
     //float buffer = 0.09;
     //float buffer = 0.15;
-    float buffer = 0.15;
+    float buffer = PLANE_EDGE_BUFFER;
 
     bool rightRange = (rightPtDist <= rightDist+buffer) && (rightPtDist >= - buffer);
     bool lowRange = (lowPtDist <= lowDist + buffer) && (lowPtDist >= - buffer);
@@ -83,71 +86,80 @@ bool Plane::isPointInPlane(glm::vec3 pointOnPlane) {
 //****************************************************
 // Test if the change in position vector newPos - oldPos, intersects the plane
 // Since velocity = currentPos - oldPos, check if vector (- velocity) going from current Position intersects the plane
-//
+//      - See collidePlane in Colliders.cpp
 //****************************************************
-bool Plane::collide(Vertex* v) {
-   
-    // Point to Plane Collision
-    //      Particle P with Velocity V moving towards Plane with Normal:
-    //      Collision occurs if (X - P) dot N < threshold
-    //      If N dot V is less than zero colliding, otherwise separating
-    //      - If Colliding:
-    //          Separate motion into Tangential and Parallel to Normal.
-    //      TODO: Perhaps change collision detection to be a part of update.
-    //      Thus if a vector collides it doesn't call update as it normally would
-
-    glm::vec3 path = - v->getVelocity();
-      
-    // (X - P) dot N < threshold
-
-    // X to any point in the plane dot N, is the distance to the palne
-
-    float distToPlane = - glm::dot((v->getPos() - topLeft), normal);
-    // TODO: CHECK if negative values are appropriate
-
-    glm::vec3 pointOnPlane = v->getPos() - (distToPlane * normal);    
-
-    if(distToPlane < 0.1) {
- 
-        if(glm::dot(normal, v->getVelocity()) > 0.0f) {
+bool Plane::collide(ParticleStore* p, int i) {
+    return collidePlane(p, collider, i, i + 1);
+}
 
-            if(isPointInPlane(pointOnPlane)) {
+//****************************************************
+// Init Collider:
+//      - The edge directions & lengths isPointInPlane
+//        measures, so collide does not normalize them
+//        for every particle
+//****************************************************
+void Plane::initCollider() {
+    glm::vec3 vecToRight = glm::normalize(topRight - topLeft);
+    glm::vec3 vecToLow = glm::normalize(lowLeft - topLeft);
+
+    collider.ox = topLeft.x;
+    collider.oy = topLeft.y;
+    collider.oz = topLeft.z;
+    collider.nx = normal.x;
+    collider.ny = normal.y;
+    collider.nz = normal.z;
+
+    collider.rx = vecToRight.x;
+    collider.ry = vecToRight.y;
+    collider.rz = vecToRight.z;
+    collider.rightLimit = glm::length(topRight - topLeft) + PLANE_EDGE_BUFFER;
+
+    collider.lx = vecToLow.x;
+    collider.ly = vecToLow.y;
+    collider.lz = vecToLow.z;
+    collider.lowLimit = glm::length(lowLeft - topLeft) + PLANE_EDGE_BUFFER;
+}
 
-    
-                glm::vec3 parallel = glm::dot(glm::normalize(normal), v->getVelocity()) * normal;
-                glm::vec3 tangential = v->getVelocity() - parallel;
 
-                // V' = tangential - Kf * parallel
-                float kf = 0.0f;
 
-//                glm::vec3 newVel = - v->getVelocity() ;
 
-               //glm::vec3 direction = glm::normalize(-v->getVelocity());
 
-                //glm::vec3 newPos = v->getOldPosition();
+//****************************************************
+// Get Bounds:
+//      - collide acts on points within 0.1 (in units
+//        of the unnormalized normal) on the normal's
+//        side of the plane or anywhere beyond it,
+//        whose projection is inside the quad plus the
+//        0.15 buffer of isPointInPlane
+//      - So the box is the quad's, grown by both, and
+//        open on every axis the normal points along
+//****************************************************
+void Plane::getBounds(glm::vec3& lo, glm::vec3& hi) {
+    lo = glm::min(glm::min(topLeft, topRight), glm::min(lowRight, lowLeft));
+    hi = glm::max(glm::max(topLeft, topRight), glm::max(lowRight, lowLeft));
 
-                //glm::vec3 newVel = tangential - kf * parallel;
-                //::vec3 newPos = v->getPos() - 0.6f * v->getVelocity();
-                
-                glm::vec3 newPos = v->getPos() - v->getVelocity();
-    
-                glm::vec3 testVel = v->getVelocity();
+    float normalLength = glm::length(normal);
+    float grow = PLANE_EDGE_BUFFER + ((normalLength > 0.0f) ? PLANE_CONTACT_DISTANCE / normalLength : 0.0f);
 
-                glm::vec3 newVel(testVel.x*0.2, testVel.y*0.2, testVel.z*0.2);
-//                glm::vec3 newPos = v->getPos() - v->getVelocity();
+    lo -= glm::vec3(grow);
+    hi += glm::vec3(grow);
 
-                v->updateAfterCollide(newPos, newVel);
-            
-                return true; 
-            }
+    for(int a = 0; a < 3; a++) {
+        if(normal[a] > 0.0f) {
+            hi[a] = HUGE_VALF;
+        } else if(normal[a] < 0.0f) {
+            lo[a] = -HUGE_VALF;
         }
-
     }
-
-    return false;
-
 }
 
-
-
-
+//****************************************************
+// Get Triangle:
+//      - The quad split along its top left to low
+//        right diagonal
+//****************************************************
+void Plane::getTriangle(int t, glm::vec3& a, glm::vec3& b, glm::vec3& c) {
+    a = topLeft;
+    b = (t == 0) ? topRight : lowRight;
+    c = (t == 0) ? lowRight : lowLeft;
+}
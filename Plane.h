@@ -3,7 +3,8 @@
 
 #include "glm/glm.hpp"
 #include "Shape.h"
-#include "Vertex.h"
+#include "ParticleStore.h"
+#include "Colliders.h"
 
 //****************************************************
 // Plane Header Definition
@@ -17,8 +18,13 @@ class Plane : public Shape {
     glm::vec3 lowLeft;
     glm::vec3 normal;
 
+    // Unit edge vectors & extents, worked out once for collide
+    PlaneCollider collider;
+
     bool isFloor;
 
+    void initCollider();
+
   public:
     // Constructors
     Plane();
@@ -37,8 +43,12 @@ class Plane : public Shape {
     void setFloor() {isFloor = true;};
 
     // Shape - Abstract Functions
-    bool collide(Vertex* v); 
+    bool collide(ParticleStore* p, int i); 
     std::string getType() { return "PLANE"; };
+    void getBounds(glm::vec3& lo, glm::vec3& hi);
+    int getNumTriangles() { return 2; };
+    void getTriangle(int t, glm::vec3& a, glm::vec3& b, glm::vec3& c);
+    PlaneCollider getCollider() { return collider; };
     bool isTypeFloor() { return isFloor; };
 
     glm::vec3 getNormal() {return normal;};
@@ -0,0 +1,453 @@
+#include <math.h>
+#include <vector>
+#include <functional>
+
+#include "ProjectiveDynamicsSolver.h"
+#include "BlockSparseMatrix.h"
+#include "ParticleStore.h"
+#include "SparseCholesky.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+
+//****************************************************
+// Projective Dynamics Solver Class - Constants
+//****************************************************
+
+const int DEFAULT_PD_ITERATIONS = 10;
+
+// Particles per partial sum of a residual
+const int PD_BLOCK = 256;
+
+//****************************************************
+// Projective Dynamics Solver - Constructors
+//****************************************************
+ProjectiveDynamicsSolver::ProjectiveDynamicsSolver() {
+    numVertices = 0;
+    numSprings = 0;
+
+    factoredTimestep = 0.0f;
+    correctionsValid = false;
+
+    iterations = DEFAULT_PD_ITERATIONS;
+    warmStart = true;
+}
+
+//****************************************************
+// Prepare:
+//      - Builds the matrix pattern from the springs &
+//        analyzes it the first time, or when the cloth
+//        changes size; a step allocates nothing
+//      - The pattern is the BlockSparseMatrix's, one
+//        scalar per block
+//****************************************************
+void ProjectiveDynamicsSolver::prepare(int nv, const SpringTable& springs) {
+    residuals.reserve(iterations);
+
+    if(nv == numVertices && springs.size() == numSprings) {
+        return;
+    }
+
+    numVertices = nv;
+    numSprings = springs.size();
+
+    SpringSpan all = springs.getAll();
+
+    BlockSparseMatrix pattern;
+    pattern.build(nv, all.i0, all.i1, all.count);
+
+    rowStart.resize(nv + 1);
+    columns.resize(pattern.getNumBlocks());
+    diagonalEntry.resize(nv);
+    forwardEntry.resize(numSprings);
+    reverseEntry.resize(numSprings);
+
+    for(int i = 0; i <= nv; i++) {
+        rowStart[i] = (i < nv) ? pattern.getRowStart(i) : pattern.getNumBlocks();
+    }
+
+    for(int e = 0; e < pattern.getNumBlocks(); e++) {
+        columns[e] = pattern.getColumn(e);
+    }
+
+    for(int i = 0; i < nv; i++) {
+        diagonalEntry[i] = pattern.getDiagonalSlot(i);
+    }
+
+    for(int s = 0; s < numSprings; s++) {
+        forwardEntry[s] = pattern.getForwardSlot(s);
+        reverseEntry[s] = pattern.getReverseSlot(s);
+    }
+
+    values.assign(columns.size(), 0.0);
+    cholesky.analyze(nv, rowStart.data(), columns.data());
+
+    // Springs of each particle, in table order
+    incidentStart.assign(nv + 1, 0);
+    for(int s = 0; s < numSprings; s++) {
+        incidentStart[all.i0[s] + 1]++;
+        incidentStart[all.i1[s] + 1]++;
+    }
+
+    for(int i = 0; i < nv; i++) {
+        incidentStart[i + 1] += incidentStart[i];
+    }
+
+    incidentSpring.resize(incidentStart[nv]);
+    std::vector<int> fill(incidentStart.begin(), incidentStart.end() - 1);
+
+    for(int s = 0; s < numSprings; s++) {
+        incidentSpring[fill[all.i0[s]]++] = s;
+        incidentSpring[fill[all.i1[s]]++] = s;
+    }
+
+    projectionX.assign(numSprings, 0.0f);
+    projectionY.assign(numSprings, 0.0f);
+    projectionZ.assign(numSprings, 0.0f);
+
+    damping.resize(nv);
+
+    inertialX.assign(nv, 0.0f);
+    inertialY.assign(nv, 0.0f);
+    inertialZ.assign(nv, 0.0f);
+
+    correctionX.assign(nv, 0.0f);
+    correctionY.assign(nv, 0.0f);
+    correctionZ.assign(nv, 0.0f);
+    correctionsValid = false;
+
+    rhs.assign(3 * nv, 0.0);
+    scratch.assign(3 * nv, 0.0);
+
+    // 2 matches no particle, forcing the first factorization
+    factoredFixed.assign(nv, 2);
+    factoredTimestep = 0.0f;
+
+    partials.assign((nv + PD_BLOCK - 1) / PD_BLOCK, 0.0);
+}
+
+//****************************************************
+// Refactor:
+//      - Refills & refactors M + h^2 L only when h or
+//        the set of fixed particles has changed since
+//        the last factorization
+//****************************************************
+void ProjectiveDynamicsSolver::refactor(ParticleStore* p, const SpringTable& springs, float h) {
+    bool changed = !cholesky.isFactored() || h != factoredTimestep;
+
+    for(int i = 0; i < numVertices; i++) {
+        unsigned char fixed = (p->invMass[i] == 0.0f) ? 1 : 0;
+
+        if(factoredFixed[i] != fixed) {
+            factoredFixed[i] = fixed;
+            changed = true;
+        }
+    }
+
+    if(!changed) {
+        return;
+    }
+
+    SpringSpan all = springs.getAll();
+    double h2 = (double) h * h;
+
+    for(int e = 0; e < values.size(); e++) {
+        values[e] = 0.0;
+    }
+
+    for(int i = 0; i < numVertices; i++) {
+        values[diagonalEntry[i]] = factoredFixed[i] ? 1.0 : (double) p->mass[i];
+    }
+
+    for(int s = 0; s < numSprings; s++) {
+        int a = all.i0[s];
+        int b = all.i1[s];
+        double weight = h2 * all.stiffness[s];
+
+        if(!factoredFixed[a]) {
+            values[diagonalEntry[a]] += weight;
+        }
+
+        if(!factoredFixed[b]) {
+            values[diagonalEntry[b]] += weight;
+        }
+
+        if(!factoredFixed[a] && !factoredFixed[b]) {
+            values[forwardEntry[s]] -= weight;
+            values[reverseEntry[s]] -= weight;
+        }
+    }
+
+    factoredTimestep = cholesky.factor(values.data()) ? h : 0.0f;
+}
+
+//****************************************************
+// Parallel Helpers:
+//      - Particles split on PD_BLOCK boundaries
+//      - Springs split into one contiguous range per
+//        thread; the local step has no shared writes
+//****************************************************
+void ProjectiveDynamicsSolver::forEachVertexBlock(ThreadPool* pool, const std::function<void(int, int)>& body) {
+    if(pool == NULL) {
+        body(0, numVertices);
+        return;
+    }
+
+    int numBlocks = (numVertices + PD_BLOCK - 1) / PD_BLOCK;
+    int count = numVertices;
+
+    pool->parallelFor(0, numBlocks, [&body, count](int blockBegin, int blockEnd) {
+        int end = blockEnd * PD_BLOCK;
+        body(blockBegin * PD_BLOCK, end < count ? end : count);
+    });
+}
+
+void ProjectiveDynamicsSolver::forEachSpringChunk(ThreadPool* pool, const std::function<void(int, int)>& body) {
+    if(pool == NULL) {
+        body(0, numSprings);
+    } else {
+        pool->parallelFor(0, numSprings, body);
+    }
+}
+
+//****************************************************
+// Predict:
+//      - v += (m + h D)^-1 h f, y = x + h v; with no
+//        damping y = x + h v + h^2 M^-1 f
+//      - The first guess is y, plus the last step's
+//        correction when warm starting. The start of
+//        the step is kept in the previous positions
+//        for the velocity update.
+//****************************************************
+void ProjectiveDynamicsSolver::predict(ParticleStore* p, float h, ThreadPool* pool) {
+    bool warm = warmStart && correctionsValid;
+
+    forEachVertexBlock(pool, [this, p, h, warm](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            p->ox[i] = p->px[i];
+            p->oy[i] = p->py[i];
+            p->oz[i] = p->pz[i];
+
+            if(p->invMass[i] != 0.0f) {
+                float m = p->mass[i];
+
+                float xx = m + h * damping.xx[i],  xy = h * damping.xy[i],  xz = h * damping.xz[i];
+                float yy = m + h * damping.yy[i],  yz = h * damping.yz[i],  zz = m + h * damping.zz[i];
+
+                // Symmetric 3x3 inverse by cofactors
+                float c00 = yy * zz - yz * yz;
+                float c01 = xz * yz - xy * zz;
+                float c02 = xy * yz - xz * yy;
+                float invDet = 1.0f / (xx * c00 + xy * c01 + xz * c02);
+
+                float fx = p->fx[i] * h;
+                float fy = p->fy[i] * h;
+                float fz = p->fz[i] * h;
+
+                p->vx[i] += (c00 * fx + c01 * fy + c02 * fz) * invDet;
+                p->vy[i] += (c01 * fx + (xx * zz - xz * xz) * fy + (xy * xz - xx * yz) * fz) * invDet;
+                p->vz[i] += (c02 * fx + (xy * xz - xx * yz) * fy + (xx * yy - xy * xy) * fz) * invDet;
+
+                p->px[i] += p->vx[i] * h;
+                p->py[i] += p->vy[i] * h;
+                p->pz[i] += p->vz[i] * h;
+            }
+
+            inertialX[i] = p->px[i];
+            inertialY[i] = p->py[i];
+            inertialZ[i] = p->pz[i];
+
+            if(warm && p->invMass[i] != 0.0f) {
+                p->px[i] += correctionX[i];
+                p->py[i] += correctionY[i];
+                p->pz[i] += correctionZ[i];
+            }
+
+            p->fx[i] = 0.0f;
+            p->fy[i] = 0.0f;
+            p->fz[i] = 0.0f;
+
+            damping.xx[i] = 0.0f;  damping.xy[i] = 0.0f;  damping.xz[i] = 0.0f;
+            damping.yy[i] = 0.0f;  damping.yz[i] = 0.0f;  damping.zz[i] = 0.0f;
+        }
+    });
+}
+
+//****************************************************
+// Project Springs:
+//      - Local step: the closest vector of rest length
+//        to each spring's current x_i0 - x_i1. A
+//        collapsed spring keeps its last projection.
+//****************************************************
+void ProjectiveDynamicsSolver::projectSprings(ParticleStore* p, const SpringTable& springs, ThreadPool* pool) {
+    SpringSpan all = springs.getAll();
+
+    forEachSpringChunk(pool, [this, p, &all](int begin, int end) {
+        for(int s = begin; s < end; s++) {
+            int a = all.i0[s];
+            int b = all.i1[s];
+
+            float dx = p->px[a] - p->px[b];
+            float dy = p->py[a] - p->py[b];
+            float dz = p->pz[a] - p->pz[b];
+
+            float length = sqrtf(dx*dx + dy*dy + dz*dz);
+            if(length <= 0.0f) {
+                continue;
+            }
+
+            float scale = all.restLength[s] / length;
+            projectionX[s] = dx * scale;
+            projectionY[s] = dy * scale;
+            projectionZ[s] = dz * scale;
+        }
+    });
+}
+
+//****************************************************
+// Global Solve:
+//      - Gathers M y + h^2 J d per particle from its
+//        incident springs (no scatter, so particles
+//        run in parallel), then back substitutes all
+//        three axes in one pass over the factor, which
+//        is bound by reading L
+//****************************************************
+void ProjectiveDynamicsSolver::globalSolve(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool) {
+    SpringSpan all = springs.getAll();
+    float h2 = h * h;
+
+    forEachVertexBlock(pool, [this, p, &all, h2](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            if(factoredFixed[i]) {
+                rhs[3 * i] = p->px[i];
+                rhs[3 * i + 1] = p->py[i];
+                rhs[3 * i + 2] = p->pz[i];
+                continue;
+            }
+
+            double bx = (double) p->mass[i] * inertialX[i];
+            double by = (double) p->mass[i] * inertialY[i];
+            double bz = (double) p->mass[i] * inertialZ[i];
+
+            for(int k = incidentStart[i]; k < incidentStart[i + 1]; k++) {
+                int s = incidentSpring[k];
+                int other = (all.i0[s] == i) ? all.i1[s] : all.i0[s];
+                float weight = h2 * all.stiffness[s];
+                float sign = (all.i0[s] == i) ? weight : -weight;
+
+                bx += sign * projectionX[s];
+                by += sign * projectionY[s];
+                bz += sign * projectionZ[s];
+
+                // A fixed neighbour's coupling, moved to this side
+                if(factoredFixed[other]) {
+                    bx += weight * p->px[other];
+                    by += weight * p->py[other];
+                    bz += weight * p->pz[other];
+                }
+            }
+
+            rhs[3 * i] = bx;
+            rhs[3 * i + 1] = by;
+            rhs[3 * i + 2] = bz;
+        }
+    });
+
+    cholesky.solve(rhs.data(), 3, scratch.data());
+}
+
+//****************************************************
+// Update Positions:
+//      - Moves free particles to the solve's result,
+//        returning the RMS move, summed in fixed
+//        blocks so it is the same for any thread count
+//****************************************************
+float ProjectiveDynamicsSolver::updatePositions(ParticleStore* p, ThreadPool* pool) {
+    if(numVertices == 0) {
+        return 0.0f;
+    }
+
+    forEachVertexBlock(pool, [this, p](int begin, int end) {
+        for(int block = begin; block < end; block += PD_BLOCK) {
+            int blockEnd = (block + PD_BLOCK < end) ? block + PD_BLOCK : end;
+
+            double sum = 0.0;
+            for(int i = block; i < blockEnd; i++) {
+                if(factoredFixed[i]) {
+                    continue;
+                }
+
+                float x = (float) rhs[3 * i];
+                float y = (float) rhs[3 * i + 1];
+                float z = (float) rhs[3 * i + 2];
+
+                double dx = x - p->px[i];
+                double dy = y - p->py[i];
+                double dz = z - p->pz[i];
+                sum += dx*dx + dy*dy + dz*dz;
+
+                p->px[i] = x;
+                p->py[i] = y;
+                p->pz[i] = z;
+            }
+
+            partials[block / PD_BLOCK] = sum;
+        }
+    });
+
+    double total = 0.0;
+    for(int i = 0; i < partials.size(); i++) {
+        total += partials[i];
+    }
+
+    return (float) sqrt(total / numVertices);
+}
+
+//****************************************************
+// Update Velocities:
+//      - v = (x - x_start) / h, keeping x - y for the
+//        next step's warm start
+//****************************************************
+void ProjectiveDynamicsSolver::updateVelocities(ParticleStore* p, float h, ThreadPool* pool) {
+    float invH = 1.0f / h;
+
+    forEachVertexBlock(pool, [this, p, invH](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            correctionX[i] = p->px[i] - inertialX[i];
+            correctionY[i] = p->py[i] - inertialY[i];
+            correctionZ[i] = p->pz[i] - inertialZ[i];
+
+            if(p->invMass[i] != 0.0f) {
+                p->vx[i] = (p->px[i] - p->ox[i]) * invH;
+                p->vy[i] = (p->py[i] - p->oy[i]) * invH;
+                p->vz[i] = (p->pz[i] - p->oz[i]) * invH;
+            }
+        }
+    });
+}
+
+//****************************************************
+// Step:
+//      - Predicts, then alternates local & global
+//        steps
+//      - If the factorization failed the step stays
+//        at the prediction
+//****************************************************
+void ProjectiveDynamicsSolver::step(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool) {
+    prepare(p->size(), springs);
+    residuals.clear();
+
+    refactor(p, springs, h);
+    predict(p, h, pool);
+
+    if(cholesky.isFactored()) {
+        for(int it = 0; it < iterations; it++) {
+            projectSprings(p, springs, pool);
+            globalSolve(p, springs, h, pool);
+            residuals.push_back(updatePositions(p, pool));
+        }
+    }
+
+    updateVelocities(p, h, pool);
+    correctionsValid = cholesky.isFactored();
+}
@@ -0,0 +1,132 @@
+#ifndef PROJECTIVEDYNAMICSSOLVER_H
+#define PROJECTIVEDYNAMICSSOLVER_H
+
+#include <vector>
+#include <functional>
+#include "ParticleStore.h"
+#include "BlockSparseMatrix.h"
+#include "SparseCholesky.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Projective Dynamics Solver Header Definition
+//      - Implicit Euler as local / global iterations
+//        after Liu, Bargteil, O'Brien & Kavan, "Fast
+//        Simulation of Mass-Spring Systems"
+//      - Local: every spring projects its current
+//        direction onto its rest length,
+//          d_s = L (x_a - x_b) / |x_a - x_b|
+//        independently, so springs split freely
+//        across threads
+//      - Global: one solve, for all three axes, of
+//          (M + h^2 L) x = M y + h^2 J d
+//        where y is the inertial prediction and L the
+//        stiffness weighted Laplacian of the springs.
+//        The matrix only depends on the topology, the
+//        masses, h & which particles are fixed, so it
+//        is factored once and kept until one changes;
+//        a step is back substitutions
+//      - Fixed particles keep identity rows, their
+//        couplings moved to the right hand side
+//      - Damping forces (getDamping) are implicit in
+//        the prediction, per particle:
+//          (m + h D) dv = h f
+//        so they leave the factored matrix alone
+//      - Warm start: the first guess is the inertial
+//        prediction plus the correction the springs
+//        made to the last step's prediction, which for
+//        cloth near rest is most of this step's
+//****************************************************
+
+class ProjectiveDynamicsSolver {
+  private:
+    int numVertices;
+    int numSprings;
+
+    // M + h^2 L as CSR over both triangles; the entries of each row, and of each spring's two ends
+    std::vector<int> rowStart;
+    std::vector<int> columns;
+    std::vector<int> diagonalEntry;
+    std::vector<int> forwardEntry;
+    std::vector<int> reverseEntry;
+    std::vector<double> values;
+
+    SparseCholesky cholesky;
+
+    // What the factor was built for
+    float factoredTimestep;
+    std::vector<unsigned char> factoredFixed;
+
+    // Springs touching each particle: [incidentStart[i], incidentStart[i + 1])
+    std::vector<int> incidentStart;
+    std::vector<int> incidentSpring;
+
+    // Projected spring vector d_s, along x_i0 - x_i1
+    std::vector<float> projectionX;
+    std::vector<float> projectionY;
+    std::vector<float> projectionZ;
+
+    // Per particle -df/dv from damping forces, cleared after every step
+    SymmetricBlocks damping;
+
+    // Inertial prediction y
+    std::vector<float> inertialX;
+    std::vector<float> inertialY;
+    std::vector<float> inertialZ;
+
+    // x - y at the end of the last step, for the warm start
+    std::vector<float> correctionX;
+    std::vector<float> correctionY;
+    std::vector<float> correctionZ;
+    bool correctionsValid;
+
+    // Right hand side, x y z interleaved per particle & solved in place
+    std::vector<double> rhs;
+    std::vector<double> scratch;
+
+    int iterations;
+    bool warmStart;
+
+    // Fixed size partial sums, so residuals do not depend on the thread count
+    std::vector<double> partials;
+
+    // RMS position change of each iteration of the last step
+    std::vector<float> residuals;
+
+    void refactor(ParticleStore* p, const SpringTable& springs, float h);
+
+    void predict(ParticleStore* p, float h, ThreadPool* pool);
+    void projectSprings(ParticleStore* p, const SpringTable& springs, ThreadPool* pool);
+    void globalSolve(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool);
+    float updatePositions(ParticleStore* p, ThreadPool* pool);
+    void updateVelocities(ParticleStore* p, float h, ThreadPool* pool);
+
+    // Parallel Helpers, pool may be NULL
+    void forEachVertexBlock(ThreadPool* pool, const std::function<void(int, int)>& body);
+    void forEachSpringChunk(ThreadPool* pool, const std::function<void(int, int)>& body);
+
+  public:
+    ProjectiveDynamicsSolver();
+
+    // Sizes every array & analyzes the matrix, only when the cloth changes size
+    void prepare(int nv, const SpringTable& springs);
+
+    // Per particle -df/dv; c * n n^T added to block i stands for a force -c n (n . v)
+    SymmetricBlocks& getDamping() { return damping; };
+
+    // Advances p by h; forces must already hold every external force, springs are solved here
+    void step(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool);
+
+    // Solve Settings
+    void setIterations(int n) { iterations = n; };
+    int getIterations() { return iterations; };
+    void setWarmStart(bool enabled) { warmStart = enabled; };
+    bool getWarmStart() { return warmStart; };
+
+    // Stats
+    const std::vector<float>& getResiduals() { return residuals; };
+    int getFactorNonZeros() { return cholesky.getFactorNonZeros(); };
+};
+
+#endif
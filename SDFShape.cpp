@@ -0,0 +1,403 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <functional>
+#include <math.h>
+
+#include "glm/glm.hpp"
+
+#include "SDFShape.h"
+
+
+//****************************************************
+// SDF Shape Class - Constants
+//****************************************************
+
+// Bumped whenever the baked values or the file layout change
+const int SDF_CACHE_VERSION = 1;
+
+// Rows counted for the signs run this far (in cells) off the nodes, so they never pass
+// exactly through a mesh edge or vertex lying on the grid
+const double SDF_ROW_JITTER_Y = 1.0e-4 * 1.41421356;
+const double SDF_ROW_JITTER_Z = 1.0e-4 * 1.73205081;
+
+//****************************************************
+// SDF Shape - Constructors
+//****************************************************
+SDFShape::SDFShape() {
+    origin = glm::vec3(0.0f);
+    cell = 1.0f;
+    nx = 0;
+    ny = 0;
+    nz = 0;
+    cached = false;
+}
+
+//****************************************************
+// Load:
+//      - The cache key hashes the mesh's hash with the
+//        grid settings, so a moved, scaled or edited
+//        mesh, or another resolution, bakes afresh
+//****************************************************
+bool SDFShape::load(const char* objFile, glm::vec3 offset, float scale, int resolution, ThreadPool* pool) {
+    cached = false;
+
+    if(!mesh.loadOBJ(objFile, offset, scale) || resolution < 1) {
+        return false;
+    }
+
+    glm::vec3 lo, hi;
+    mesh.getBounds(lo, hi);
+    glm::vec3 extent = hi - lo;
+
+    float longest = glm::max(extent.x, glm::max(extent.y, extent.z));
+    cell = (longest > 0.0f) ? longest / resolution : 1.0f;
+    origin = lo - glm::vec3(SDF_PAD_CELLS * cell);
+
+    nx = (int) ceil(extent.x / cell) + 2 * SDF_PAD_CELLS + 1;
+    ny = (int) ceil(extent.y / cell) + 2 * SDF_PAD_CELLS + 1;
+    nz = (int) ceil(extent.z / cell) + 2 * SDF_PAD_CELLS + 1;
+
+    unsigned long long settings[5] = { mesh.getHash(), (unsigned long long) resolution,
+        (unsigned long long) SDF_PAD_CELLS, (unsigned long long) SDF_BAND_CELLS, (unsigned long long) SDF_CACHE_VERSION };
+
+    unsigned long long key = 14695981039346656037ULL;
+    const unsigned char* bytes = (const unsigned char*) settings;
+    for(int b = 0; b < sizeof(settings); b++) {
+        key ^= bytes[b];
+        key *= 1099511628211ULL;
+    }
+
+    std::ostringstream name;
+    name << objFile << "." << std::hex << std::setw(16) << std::setfill('0') << key << ".sdf";
+
+    if(readCache(name.str(), key)) {
+        cached = true;
+        return true;
+    }
+
+    bake(pool);
+    writeCache(name.str(), key);
+
+    return true;
+}
+
+//****************************************************
+// Bake:
+//      - Unsigned distances first, the band then the
+//        sweeps in each of the 8 diagonal directions,
+//        twice over; then the signs
+//****************************************************
+void SDFShape::bake(ThreadPool* pool) {
+    std::vector<int> closest(nx * ny * nz, -1);
+    phi.assign(nx * ny * nz, (nx + ny + nz) * cell);
+
+    bakeBand(closest, pool);
+
+    for(int pass = 0; pass < 2; pass++) {
+        sweep(closest, +1, +1, +1);
+        sweep(closest, -1, -1, -1);
+        sweep(closest, +1, +1, -1);
+        sweep(closest, -1, -1, +1);
+        sweep(closest, +1, -1, +1);
+        sweep(closest, -1, +1, -1);
+        sweep(closest, +1, -1, -1);
+        sweep(closest, -1, +1, +1);
+    }
+
+    bakeSigns(pool);
+}
+
+// Each slab of z walks every triangle, so a node is only ever written by one thread;
+// lower numbered triangles win ties, as serially
+void SDFShape::bakeBand(std::vector<int>& closest, ThreadPool* pool) {
+    std::function<void(int, int)> body = [this, &closest](int kBegin, int kEnd) {
+        for(int t = 0; t < mesh.getNumTriangles(); t++) {
+            glm::vec3 a, b, c;
+            mesh.getTriangle(t, a, b, c);
+
+            glm::vec3 lo = (glm::min(a, glm::min(b, c)) - origin) / cell;
+            glm::vec3 hi = (glm::max(a, glm::max(b, c)) - origin) / cell;
+
+            int i0 = glm::max((int) floor(lo.x) - SDF_BAND_CELLS, 0);
+            int j0 = glm::max((int) floor(lo.y) - SDF_BAND_CELLS, 0);
+            int k0 = glm::max((int) floor(lo.z) - SDF_BAND_CELLS, kBegin);
+            int i1 = glm::min((int) ceil(hi.x) + SDF_BAND_CELLS, nx - 1);
+            int j1 = glm::min((int) ceil(hi.y) + SDF_BAND_CELLS, ny - 1);
+            int k1 = glm::min((int) ceil(hi.z) + SDF_BAND_CELLS, kEnd - 1);
+
+            for(int k = k0; k <= k1; k++) {
+                for(int j = j0; j <= j1; j++) {
+                    for(int i = i0; i <= i1; i++) {
+                        glm::vec3 p = getNodePos(i, j, k);
+                        float d = glm::length(p - closestPointOnTriangle(p, a, b, c));
+                        int n = getNode(i, j, k);
+
+                        if(d < phi[n]) {
+                            phi[n] = d;
+                            closest[n] = t;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    if(pool == NULL) {
+        body(0, nz);
+    } else {
+        pool->parallelFor(0, nz, body);
+    }
+}
+
+// Offers each node the closest triangles of its neighbours behind it in the sweep's direction
+void SDFShape::sweep(std::vector<int>& closest, int di, int dj, int dk) {
+    int iBegin = (di > 0) ? 1 : nx - 2;
+    int jBegin = (dj > 0) ? 1 : ny - 2;
+    int kBegin = (dk > 0) ? 1 : nz - 2;
+    int iEnd = (di > 0) ? nx : -1;
+    int jEnd = (dj > 0) ? ny : -1;
+    int kEnd = (dk > 0) ? nz : -1;
+
+    int offsets[7] = {
+        -di, -dj * nx, -dk * nx * ny,
+        -di - dj * nx, -di - dk * nx * ny, -dj * nx - dk * nx * ny,
+        -di - dj * nx - dk * nx * ny
+    };
+
+    for(int k = kBegin; k != kEnd; k += dk) {
+        for(int j = jBegin; j != jEnd; j += dj) {
+            for(int i = iBegin; i != iEnd; i += di) {
+                int n = getNode(i, j, k);
+                glm::vec3 p = getNodePos(i, j, k);
+
+                for(int o = 0; o < 7; o++) {
+                    int t = closest[n + offsets[o]];
+
+                    if(t < 0 || t == closest[n]) {
+                        continue;
+                    }
+
+                    glm::vec3 a, b, c;
+                    mesh.getTriangle(t, a, b, c);
+                    float d = glm::length(p - closestPointOnTriangle(p, a, b, c));
+
+                    if(d < phi[n]) {
+                        phi[n] = d;
+                        closest[n] = t;
+                    }
+                }
+            }
+        }
+    }
+}
+
+//****************************************************
+// Bake Signs:
+//      - Every row of nodes along x counts the mesh's
+//        crossings before each node; an odd count is
+//        inside. Needs a closed mesh
+//****************************************************
+void SDFShape::bakeSigns(ThreadPool* pool) {
+    std::function<void(int, int)> body = [this](int kBegin, int kEnd) {
+        std::vector<int> crossings(nx * ny);
+
+        for(int k = kBegin; k < kEnd; k++) {
+            std::fill(crossings.begin(), crossings.end(), 0);
+            double z = origin.z + (k + SDF_ROW_JITTER_Z) * cell;
+
+            for(int t = 0; t < mesh.getNumTriangles(); t++) {
+                glm::vec3 a, b, c;
+                mesh.getTriangle(t, a, b, c);
+
+                if(z < glm::min(a.z, glm::min(b.z, c.z)) || z > glm::max(a.z, glm::max(b.z, c.z))) {
+                    continue;
+                }
+
+                int j0 = glm::max((int) ceil((glm::min(a.y, glm::min(b.y, c.y)) - origin.y) / cell - SDF_ROW_JITTER_Y), 0);
+                int j1 = glm::min((int) floor((glm::max(a.y, glm::max(b.y, c.y)) - origin.y) / cell - SDF_ROW_JITTER_Y), ny - 1);
+
+                for(int j = j0; j <= j1; j++) {
+                    double y = origin.y + (j + SDF_ROW_JITTER_Y) * cell;
+
+                    // Signed areas of the row's point against each edge, in the yz plane
+                    double wa = (b.y - y) * (c.z - z) - (b.z - z) * (c.y - y);
+                    double wb = (c.y - y) * (a.z - z) - (c.z - z) * (a.y - y);
+                    double wc = (a.y - y) * (b.z - z) - (a.z - z) * (b.y - y);
+
+                    bool inside = (wa > 0.0 && wb > 0.0 && wc > 0.0) || (wa < 0.0 && wb < 0.0 && wc < 0.0);
+                    if(!inside) {
+                        continue;
+                    }
+
+                    double x = (wa * a.x + wb * b.x + wc * c.x) / (wa + wb + wc);
+                    int i = (int) ceil((x - origin.x) / cell);
+
+                    if(i < nx) {
+                        crossings[j * nx + glm::max(i, 0)]++;
+                    }
+                }
+            }
+
+            for(int j = 0; j < ny; j++) {
+                int count = 0;
+
+                for(int i = 0; i < nx; i++) {
+                    count += crossings[j * nx + i];
+
+                    if(count & 1) {
+                        phi[getNode(i, j, k)] = -phi[getNode(i, j, k)];
+                    }
+                }
+            }
+        }
+    };
+
+    if(pool == NULL) {
+        body(0, nz);
+    } else {
+        pool->parallelFor(0, nz, body);
+    }
+}
+
+//****************************************************
+// Cache:
+//      - "SDF1", the key, the node counts, origin &
+//        cell size, then the distances in node order
+//****************************************************
+bool SDFShape::readCache(const std::string& file, unsigned long long key) {
+    std::ifstream in(file.c_str(), std::ifstream::in | std::ifstream::binary);
+
+    if(!in.good()) {
+        return false;
+    }
+
+    char magic[4];
+    unsigned long long fileKey;
+    int counts[3];
+    float frame[4];
+
+    in.read(magic, 4);
+    in.read((char*) &fileKey, sizeof(fileKey));
+    in.read((char*) counts, sizeof(counts));
+    in.read((char*) frame, sizeof(frame));
+
+    if(!in.good() || std::string(magic, 4) != "SDF1" || fileKey != key ||
+       counts[0] != nx || counts[1] != ny || counts[2] != nz) {
+        return false;
+    }
+
+    phi.resize(nx * ny * nz);
+    in.read((char*) &phi[0], phi.size() * sizeof(float));
+
+    if(!in.good()) {
+        phi.clear();
+        return false;
+    }
+
+    origin = glm::vec3(frame[0], frame[1], frame[2]);
+    cell = frame[3];
+
+    return true;
+}
+
+void SDFShape::writeCache(const std::string& file, unsigned long long key) const {
+    std::ofstream out(file.c_str(), std::ofstream::out | std::ofstream::binary);
+
+    if(!out.good()) {
+        std::cerr << "Unable to write SDF cache: " << file << std::endl;
+        return;
+    }
+
+    int counts[3] = { nx, ny, nz };
+    float frame[4] = { origin.x, origin.y, origin.z, cell };
+
+    out.write("SDF1", 4);
+    out.write((const char*) &key, sizeof(key));
+    out.write((const char*) counts, sizeof(counts));
+    out.write((const char*) frame, sizeof(frame));
+    out.write((const char*) &phi[0], phi.size() * sizeof(float));
+}
+
+//****************************************************
+// Get Distance:
+//      - Trilinear in the node's cell; the gradient is
+//        that interpolant's, so it is continuous
+//        across each cell
+//****************************************************
+float SDFShape::getDistance(glm::vec3 p, glm::vec3& gradient) const {
+    glm::vec3 g = (p - origin) / cell;
+
+    if(!(g.x >= 0.0f && g.y >= 0.0f && g.z >= 0.0f && g.x < nx - 1 && g.y < ny - 1 && g.z < nz - 1)) {
+        gradient = glm::vec3(0.0f);
+        return HUGE_VALF;
+    }
+
+    int i = (int) g.x;
+    int j = (int) g.y;
+    int k = (int) g.z;
+    float fx = g.x - i;
+    float fy = g.y - j;
+    float fz = g.z - k;
+
+    const float* c = &phi[getNode(i, j, k)];
+    int dy = nx;
+    int dz = nx * ny;
+
+    float c000 = c[0],       c100 = c[1];
+    float c010 = c[dy],      c110 = c[dy + 1];
+    float c001 = c[dz],      c101 = c[dz + 1];
+    float c011 = c[dz + dy], c111 = c[dz + dy + 1];
+
+    float x00 = c000 + (c100 - c000) * fx;
+    float x10 = c010 + (c110 - c010) * fx;
+    float x01 = c001 + (c101 - c001) * fx;
+    float x11 = c011 + (c111 - c011) * fx;
+
+    float y0 = x00 + (x10 - x00) * fy;
+    float y1 = x01 + (x11 - x01) * fy;
+
+    float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+    float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+
+    gradient.x = (dx0 + (dx1 - dx0) * fz) / cell;
+    gradient.y = ((x10 - x00) + ((x11 - x01) - (x10 - x00)) * fz) / cell;
+    gradient.z = (y1 - y0) / cell;
+
+    return y0 + (y1 - y0) * fz;
+}
+
+//****************************************************
+// Collide:
+//      - Out along the gradient by the depth, velocity
+//        scaled by 0.4
+//****************************************************
+bool SDFShape::collide(ParticleStore* p, int i) {
+    glm::vec3 pos = p->getPos(i);
+    glm::vec3 gradient;
+    float d = getDistance(pos, gradient);
+
+    if(!(d < 0.0f)) {
+        return false;
+    }
+
+    float length = glm::length(gradient);
+    if(!(length > 0.0f)) {
+        return false;
+    }
+
+    p->setPos(i, pos - gradient * (d / length));
+    p->setVelocity(i, p->getVelocity(i) * 0.4f);
+
+    return true;
+}
+
+// Negative only inside the mesh, give or take the cell the interpolation spreads it over
+void SDFShape::getBounds(glm::vec3& lo, glm::vec3& hi) {
+    mesh.getBounds(lo, hi);
+    lo -= glm::vec3(cell);
+    hi += glm::vec3(cell);
+}
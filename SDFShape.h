@@ -0,0 +1,86 @@
+#ifndef SDFSHAPE_H
+#define SDFSHAPE_H
+
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Shape.h"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include "TriangleMesh.h"
+
+//****************************************************
+// SDF Shape Header Definition
+//      - A collider baked from a closed triangle mesh
+//        into a grid of signed distances, negative
+//        inside, so a particle costs one trilinear
+//        lookup however many triangles the mesh has
+//      - The grid spans the mesh's box plus
+//        SDF_PAD_CELLS cells each side, with
+//        'resolution' cells along its longest side
+//      - Baking: exact distances for the nodes within
+//        SDF_BAND_CELLS of each triangle, then fast
+//        sweeping hands each node's closest triangle on
+//        to its neighbours. Signs come from counting the
+//        crossings along each row of nodes in x. The
+//        band & the signs bake slab by slab in parallel
+//      - The grid is cached next to the OBJ file, named
+//        by the hash of the placed mesh & the grid
+//        settings, and read back instead of baked
+//      - A particle where the field is negative is
+//        pushed out along the field's gradient by its
+//        depth, and its velocity scaled by 0.4, as for
+//        a Sphere
+//****************************************************
+
+// Cells of empty space around the mesh
+const int SDF_PAD_CELLS = 3;
+
+// Nodes this many cells from a triangle's box get its exact distance before sweeping
+const int SDF_BAND_CELLS = 2;
+
+class SDFShape : public Shape {
+  private:
+    TriangleMesh mesh;
+
+    // Node (i, j, k) is at origin + cell * (i, j, k)
+    glm::vec3 origin;
+    float cell;
+    int nx, ny, nz;
+    std::vector<float> phi;
+
+    bool cached;
+
+    int getNode(int i, int j, int k) const { return (k * ny + j) * nx + i; };
+    glm::vec3 getNodePos(int i, int j, int k) const { return origin + cell * glm::vec3((float) i, (float) j, (float) k); };
+
+    void bake(ThreadPool* pool);
+    void bakeBand(std::vector<int>& closest, ThreadPool* pool);
+    void sweep(std::vector<int>& closest, int di, int dj, int dk);
+    void bakeSigns(ThreadPool* pool);
+
+    bool readCache(const std::string& file, unsigned long long key);
+    void writeCache(const std::string& file, unsigned long long key) const;
+
+  public:
+    SDFShape();
+
+    // Reads the OBJ, scaled then moved by offset, and bakes it (or reads it from the cache).
+    // False if the mesh can't be read. pool may be NULL
+    bool load(const char* objFile, glm::vec3 offset, float scale, int resolution, ThreadPool* pool);
+
+    // Trilinear distance at p and its gradient; HUGE_VALF outside the grid
+    float getDistance(glm::vec3 p, glm::vec3& gradient) const;
+
+    // True if the last load read the grid from the cache
+    bool wasCached() const { return cached; };
+
+    // Shape - Abstract Functions
+    bool collide(ParticleStore* p, int i);
+    std::string getType() { return "SDF"; };
+    void getBounds(glm::vec3& lo, glm::vec3& hi);
+    int getNumTriangles() { return mesh.getNumTriangles(); };
+    void getTriangle(int t, glm::vec3& a, glm::vec3& b, glm::vec3& c) { mesh.getTriangle(t, a, b, c); };
+};
+
+#endif
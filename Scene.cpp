@@ -28,6 +28,10 @@
 #include "Shape.h"
 #include "Sphere.h"
 #include "Plane.h"
+#include "SimClock.h"
+#include "AdaptiveStepper.h"
+#include "Simulation.h"
+#include "SceneLoader.h"
 
 #define PI 3.14159265
 
@@ -42,10 +46,11 @@ class Viewport {
 // Global Variables 
 //****************************************************
 Viewport                viewport;
-Cloth*                  cloth;
+Simulation*             simulation;
+Cloth*                  cloth;          // Owned by simulation
+AdaptiveStepper*        stepper;        // Picks the timestep when adaptiveStep
 const char*             inputFile;
 const char*             shapeFile;
-std::vector<Shape*>     shapes;
 GLuint*                 shapeDrawLists;
 int                     numShapes;
 
@@ -83,25 +88,28 @@ const GLfloat Z_TRANSLATE_INC = 0.2f;
 const GLfloat ROTATE_INC = 3.0f;
 
 // Animation Variables:
-float framesPerSecond = 30.0f;
-float frameDuration; // in Milliseconds
 float currentFPS = 0.0f;
 int frameNum = 0;
 int cameraNum = 0;
 
 float calcsPerFrame = 0.0f;
+float substepsPerSecond = 0.0f;
 int numCalculations = 0;
 
+// Real time is paid out in fixed timestep substeps, at most MAX_SUBSTEPS per frame
+const int MAX_SUBSTEPS = 8;
+SimClock simClock;
+
 // Drawing Cloth Structure Variables:
 bool spherePoints = true;
 
 
-// If true, use constant STEP value. If false use constant FPS value
+// If true, step numTimeSteps per frame. If false keep pace with real time
 bool constantStep;  
 
 // FPS Calculation Variables
 int oldFrameNum = 0;
-float lastFPStime = 0.0f;
+double lastFPStime = 0.0;
 
 int numTimeSteps = 15;
 const float STEP = 0.005f;
@@ -109,20 +117,28 @@ const float STEP = 0.005f;
 const float STEP_INC = 0.001f;
 float timestep = 0.005f;
 
-// Position Update Method Variables: Command Lines
-bool euler;
+// If true, timestep only starts the adaptive stepper, which then picks its own
+bool adaptiveStep = false;
 
-// Forces:
-bool gravity;
-glm::vec3 gravityAccel(0.0f, -9.81f, 0.0f);// -9.81f, 0.0f);
+// If true, settled tiles of the cloth sleep (Euler & Verlet only)
+bool tileSleep = false;
 
-//TODO: WIND INFO
-bool wind;
-glm::vec3 windForce(0.0f, 0.0f, -1.0f);
+// If true, the cloth collides with itself
+bool selfCollide = false;
+bool continuousCollide = false;
 
+// Position Update Method Variables: Command Lines
+IntegratorType integrator;
+
+// Forces: gravity & wind are owned by simulation
 float windScale = 1.0f;
 float windINC = 0.4f;
 
+// Turbulence & gusts the wind field starts with, restored when turbulent wind is toggled back on
+bool turbulentWind = true;
+float windTurbulence = 0.0f;
+float windGusts = 0.0f;
+
 // Debug Variables:
 bool debugFunc = false;
 bool debugStats = true;
@@ -390,12 +406,16 @@ void initScene() {
     useFloor = true;
     
     // Initialize Animation Variables:
-    frameDuration = 1000.0f / framesPerSecond;  
+    simClock.setStep(timestep);
+    simClock.setMaxSubsteps(MAX_SUBSTEPS);
     constantStep = false;
 
     // Initialize External Force Variables
-    gravity = true;
-    wind = false;
+    simulation->setGravity(true);
+    simulation->setWind(false);
+
+    windTurbulence = simulation->getWindField().getTurbulence();
+    windGusts = simulation->getWindField().getGustStrength();
 
     saveImage = false;
 }
@@ -548,7 +568,7 @@ void printHUD() {
     
     // Print Gravity:
     std::string gravOut;
-    if(gravity) {
+    if(simulation->isGravityOn()) {
         gravOut = "Gravity: ON";
     } else {
         gravOut = "Gravity: OFF";
@@ -558,7 +578,7 @@ void printHUD() {
 
     // Print Wind:
     std::string windOut;
-    if(wind) {
+    if(simulation->isWindOn()) {
         windOut = "Wind: ON";
     } else {
         windOut = "Wind: OFF";
@@ -569,7 +589,7 @@ void printHUD() {
     std::stringstream windForceStream;
 
     // Print Wind Force
-    windForceStream << "Wind Force: " << glm::length(windForce);
+    windForceStream << "Wind Force: " << glm::length(simulation->getWindForce());
     std::string windForceOut = windForceStream.str();
 
     printText(5, 6*LINE_SIZE, r, g, b, windForceOut, GLUT_BITMAP_HELVETICA_12);
@@ -588,6 +608,77 @@ void printHUD() {
 
     printText(5, 8*LINE_SIZE, r, g, b, calcOut, GLUT_BITMAP_HELVETICA_12);
 
+    // Print Simulation Throughput:
+    std::stringstream substepStream;
+    substepStream << "Substeps/sec: " << substepsPerSecond;
+    std::string substepOut = substepStream.str();
+
+    printText(5, 9*LINE_SIZE, r, g, b, substepOut, GLUT_BITMAP_HELVETICA_12);
+
+    // Print Adaptive Timestep:
+    std::stringstream adaptiveStream;
+    if(adaptiveStep) {
+        adaptiveStream << "Adaptive Timestep (A): " << stepper->getStep() << "s, " << stepper->getRejectedSteps() << " rolled back";
+    } else {
+        adaptiveStream << "Adaptive Timestep (A): OFF";
+    }
+    std::string adaptiveOut = adaptiveStream.str();
+
+    printText(5, 10*LINE_SIZE, r, g, b, adaptiveOut, GLUT_BITMAP_HELVETICA_12);
+
+    // Print Tile Sleeping:
+    std::stringstream sleepStream;
+    if(tileSleep) {
+        sleepStream << "Tile Sleeping (Z): " << cloth->getAwakeTiles() << " / " << cloth->getNumTiles() << " awake";
+    } else {
+        sleepStream << "Tile Sleeping (Z): OFF";
+    }
+    std::string sleepOut = sleepStream.str();
+
+    printText(5, 11*LINE_SIZE, r, g, b, sleepOut, GLUT_BITMAP_HELVETICA_12);
+
+    // Print Self Collision:
+    std::stringstream selfStream;
+    if(selfCollide) {
+        selfStream << "Self Collision (X): " << cloth->getSelfContacts() << " contacts";
+    } else {
+        selfStream << "Self Collision (X): OFF";
+    }
+    std::string selfOut = selfStream.str();
+
+    printText(5, 12*LINE_SIZE, r, g, b, selfOut, GLUT_BITMAP_HELVETICA_12);
+
+    // Print Continuous Collision:
+    std::stringstream continuousStream;
+    if(continuousCollide) {
+        continuousStream << "Continuous Collision (V): " << cloth->getContinuousImpacts() << " impacts";
+    } else {
+        continuousStream << "Continuous Collision (V): OFF";
+    }
+    std::string continuousOut = continuousStream.str();
+
+    printText(5, 13*LINE_SIZE, r, g, b, continuousOut, GLUT_BITMAP_HELVETICA_12);
+
+    // Print Aerodynamics:
+    std::string aeroOut;
+    if(simulation->isAerodynamicsOn()) {
+        aeroOut = "Drag & Lift (D): ON";
+    } else {
+        aeroOut = "Drag & Lift (D): OFF";
+    }
+
+    printText(5, 14*LINE_SIZE, r, g, b, aeroOut, GLUT_BITMAP_HELVETICA_12);
+
+    // Print Turbulent Wind:
+    std::string turbulentOut;
+    if(turbulentWind) {
+        turbulentOut = "Turbulent Wind (B): ON";
+    } else {
+        turbulentOut = "Turbulent Wind (B): OFF";
+    }
+
+    printText(5, 15*LINE_SIZE, r, g, b, turbulentOut, GLUT_BITMAP_HELVETICA_12);
+
     
 }
 
@@ -604,21 +695,17 @@ void displayPerformance(int leftBound, int upBound, glm::vec3 color) {
 
     // Print Integration Type:
     std::string intType;
-    if(euler) {
-        intType = "Method: Euler Integration";
-    } else {
-        intType = "Method: Verlet Integration";
-    }
+    intType = std::string("Method: ") + INTEGRATOR_NAMES[integrator] + " Integration";
 
     printText(leftBound, upBound + LARGE_LINE_SIZE + 5 + LINE_SIZE, color.x, color.y, color.z, intType, GLUT_BITMAP_HELVETICA_12);
 
-    // Toggle Constant FPS v.s. Constant Timestep (Variable v.s. Fixed Timestep)
+    // Toggle Steps Per Frame v.s. Real Time (both with a fixed timestep)
     std::string constantOut;
 
     if(constantStep) {
-        constantOut = "Toggle Timestep (C): Fixed";
+        constantOut = "Toggle Pacing (C): Per Frame";
     } else {
-        constantOut = "Toggle Timestep (C): Variable";
+        constantOut = "Toggle Pacing (C): Real Time";
     }
 
     printText(leftBound, upBound + LARGE_LINE_SIZE + 5 + 2*LINE_SIZE, color.x, color.y, color.z, constantOut, GLUT_BITMAP_HELVETICA_12);
@@ -647,7 +734,7 @@ void displayForce(int leftBound, int upBound, glm::vec3 color) {
 
     // Print Gravity Info:
     std::string gravBool;
-    if(gravity) {
+    if(simulation->isGravityOn()) {
         gravBool = "ON";
     } else {
         gravBool = "OFF";
@@ -659,7 +746,7 @@ void displayForce(int leftBound, int upBound, glm::vec3 color) {
 
     // Print Wind Info:
     std::string windBool;
-    if(wind) {
+    if(simulation->isWindOn()) {
         windBool = "ON";
     } else {
         windBool = "OFF";
@@ -669,6 +756,8 @@ void displayForce(int leftBound, int upBound, glm::vec3 color) {
 
     printText(leftBound, upBound + LARGE_LINE_SIZE + 5 + 2*LINE_SIZE, color.x, color.y, color.z, windOut, GLUT_BITMAP_HELVETICA_12);
 
+    glm::vec3 windForce = simulation->getWindForce();
+
     // Print Wind Direction
     std::stringstream windDirStream;
     windDirStream << "Wind Direction: " << "(" << windForce.x << ", " << windForce.y << ", " << windForce.z << ")";
@@ -954,11 +1043,11 @@ void drawClothPoints() {
          for(int h = 0; h < cloth->getHeight(); h++) {
 
             for(int w = 0; w < cloth->getWidth(); w++) {
-                Vertex* vert = cloth->getVertex(w, h);
+                ParticleRef vert = cloth->getVertex(w, h);
 
                 glColor3f(1.0, 1.0, 1.0);
 
-                glm::vec3 center = vert->getPos();
+                glm::vec3 center = vert.getPos();
 
                 glPushMatrix();
                 glTranslatef(center.x, center.y, center.z);
@@ -981,11 +1070,11 @@ void drawClothPoints() {
         for(int h = 0; h < cloth->getHeight(); h++) {
 
             for(int w = 0; w < cloth->getWidth(); w++) {
-                Vertex* vert = cloth->getVertex(w, h);
+                ParticleRef vert = cloth->getVertex(w, h);
 
                 glColor3f(1.0, 1.0, 1.0);
 
-                glm::vec3 v = vert->getPos();
+                glm::vec3 v = vert.getPos();
 
                 glVertex3f(v.x, v.y, v.z);
 
@@ -1002,7 +1091,8 @@ void drawClothPoints() {
 //****************************************************
 void drawStretchSprings() {
 
-    vector<Spring*> temp = cloth->getStretchSprings();
+    SpringSpan temp = cloth->getStretchSprings();
+    ParticleStore* particles = cloth->getParticles();
 
     glPushMatrix();
     glBegin(GL_LINES);
@@ -1011,8 +1101,8 @@ void drawStretchSprings() {
 
 
     for(int i = 0; i < temp.size(); i++) {
-        glm::vec3 p1 = temp[i]->getPos1();
-        glm::vec3 p2 = temp[i]->getPos2();
+        glm::vec3 p1 = particles->getPos(temp.getV1(i));
+        glm::vec3 p2 = particles->getPos(temp.getV2(i));
 
         glVertex3f(p1.x, p1.y, p1.z);
         glVertex3f(p2.x, p2.y, p2.z);
@@ -1030,7 +1120,8 @@ void drawStretchSprings() {
 //     - Draws all of the shear springs in cloth
 //****************************************************
 void drawShearSprings() {
-    vector<Spring*> temp = cloth->getShearSprings();
+    SpringSpan temp = cloth->getShearSprings();
+    ParticleStore* particles = cloth->getParticles();
 
     glBegin(GL_LINES);
 
@@ -1038,8 +1129,8 @@ void drawShearSprings() {
 
 
     for(int i = 0; i < temp.size(); i++) {
-        glm::vec3 p1 = temp[i]->getPos1();
-        glm::vec3 p2 = temp[i]->getPos2();
+        glm::vec3 p1 = particles->getPos(temp.getV1(i));
+        glm::vec3 p2 = particles->getPos(temp.getV2(i));
 
         glVertex3f(p1.x, p1.y, p1.z);
         glVertex3f(p2.x, p2.y, p2.z);
@@ -1057,7 +1148,8 @@ void drawShearSprings() {
 //          movement
 //****************************************************
 void drawBendSprings() {
-    vector<Spring*> temp = cloth->getBendSprings();
+    SpringSpan temp = cloth->getBendSprings();
+    ParticleStore* particles = cloth->getParticles();
 
     glBegin(GL_LINES);
 
@@ -1065,8 +1157,8 @@ void drawBendSprings() {
 
 
     for(int i = 0; i < temp.size(); i++) {
-        glm::vec3 p1 = temp[i]->getPos1();
-        glm::vec3 p2 = temp[i]->getPos2();
+        glm::vec3 p1 = particles->getPos(temp.getV1(i));
+        glm::vec3 p2 = particles->getPos(temp.getV2(i));
 
         glVertex3f(p1.x, p1.y, p1.z);
         glVertex3f(p2.x, p2.y, p2.z);
@@ -1131,10 +1223,10 @@ void renderCloth() {
             //glColor4f(0.0f,0.4f,0.6f,0.4f);
             glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 
-            Vertex* temp = cloth->getVertex(w, h);
+            ParticleRef temp = cloth->getVertex(w, h);
 
             // Sets Normal Values from Vertex.
-            glNormal3f(temp->getNorm().x, temp->getNorm().y, temp->getNorm().z);
+            glNormal3f(temp.getNorm().x, temp.getNorm().y, temp.getNorm().z);
 
             // Sets the Texture Coordinate Values to map to Current Texture
             float s = (float) w / (float) (cloth->getWidth()-1);
@@ -1142,19 +1234,19 @@ void renderCloth() {
             glTexCoord2d(s,t);
 
             // Sets actual Vertex
-            glVertex3f(temp->getPos().x, temp->getPos().y, temp->getPos().z);
+            glVertex3f(temp.getPos().x, temp.getPos().y, temp.getPos().z);
 
             // Vertex 2:
             temp = cloth->getVertex(w, h+1);
 
             // Vertex 2's Normal values
-            glNormal3f(temp->getNorm().x, temp->getNorm().y, temp->getNorm().z);
+            glNormal3f(temp.getNorm().x, temp.getNorm().y, temp.getNorm().z);
 
             // Texture Coordinates, only t value changes.
             t = (float) (h+1) / (float) (cloth->getHeight()-1);
 
             glTexCoord2d(s,t);
-            glVertex3f(temp->getPos().x, temp->getPos().y, temp->getPos().z);
+            glVertex3f(temp.getPos().x, temp.getPos().y, temp.getPos().z);
 
         }
         glEnd();
@@ -1221,93 +1313,32 @@ void writeImage(int imageNum) {
 }
 
 
-//****************************************************
-// Update Collisions:
-//      - Iterates through each Shape and tests the
-//      Cloth for collisions
-//****************************************************
-void updateCollisions() {
-    for(int i = 0; i < shapes.size(); i++) {
-        cloth->updateCollision(shapes[i]);
-    }
-}
-
-//****************************************************
-// Pre Update Calculation:
-//      - Performs all the updates that occur before
-//        doing the time sensitive cloth->update
-//****************************************************
-void preUpdateCalculation() {
-    // Clear Acceleration Here:
-   // cloth->resetAccel();
-
-    // Note: Needs to be done before wind
-    //cloth->updateNormals();
-
-    if(gravity) {
-        cloth->addConstantAccel(gravityAccel);
-    }
-
-    if(wind) {
-        cloth->updateNormals(); // Only update Normals if NEEDED
-        cloth->addTriangleForce(windForce);
-    }
-
-}
-
-
-//****************************************************
-// Process Calculation
-//      - Performs a single Cloth Update, for the time
-//          period (lastUpdateTime - currentTime) 
-//****************************************************
-float processCalculation(float lastUpdateTime) {
-    
-    preUpdateCalculation();
-
-
-    float currentTime = glutGet(GLUT_ELAPSED_TIME);
-
-    float timeChange = (currentTime - lastUpdateTime + 0.0f)/1000.0f;
-
-    cloth->update(timeChange);
-
-    updateCollisions();
-
-    return currentTime;
-
-}
-
 //****************************************************
 // Process Frame:
-//      - Handles a single drawn Frame, performing
-//          cloth updates, until the frameDuration is
-//          met.
-//      - Setting lastUpdateTime to the returned value
-//          ensures that the change in time passed to
-//          cloth->update is the time difference from
-//          the start of one update to the start of
-//          the next.
+//      - Handles a single drawn Frame in real time:
+//          simClock turns the real time since the
+//          last frame into whole timestep substeps,
+//          so the cloth only ever sees the fixed
+//          timestep & the same updates on any machine
+//      - Past MAX_SUBSTEPS the owed time is dropped,
+//          so a slow frame cannot make the next one
+//          slower still
 //****************************************************
 void processFrame() {
-    float frameStartTime = glutGet(GLUT_ELAPSED_TIME);
-    float lastUpdateTime = glutGet(GLUT_ELAPSED_TIME);
-
-    while((lastUpdateTime - frameStartTime) < frameDuration) {
+    simClock.setStep(timestep);
 
-        if(glutGet(GLUT_ELAPSED_TIME) - lastUpdateTime > 1) {
+    int substeps = simClock.advance();
 
-            lastUpdateTime = processCalculation(lastUpdateTime);
+    if(adaptiveStep) {
+        numCalculations += stepper->advance(substeps * timestep);
+    } else {
+        for(int i = 0; i < substeps; i++) {
+            simulation->step(timestep);
 
             numCalculations++;
-
         }
-
-
-        // Set lastTimeUpdated to be right after we updated the Cloth
-        //lastUpdateTime = glutGet(GLUT_ELAPSED_TIME);
-
     }
+
     if(saveImage) {
         writeImage(frameNum);
     }
@@ -1324,16 +1355,15 @@ void processFrame() {
 //          - Graph it
 //****************************************************
 void stepFrame() {
-    for(int i = 0; i < numTimeSteps; i++) {
-        
-        preUpdateCalculation();
-
-        // 
-        cloth->update(timestep);
+    if(adaptiveStep) {
+        numCalculations += stepper->advance(numTimeSteps * timestep);
+    } else {
+        for(int i = 0; i < numTimeSteps; i++) {
 
-        updateCollisions();
+            simulation->step(timestep);
 
-        numCalculations++;
+            numCalculations++;
+        }
     }
 
     if(saveImage) {
@@ -1348,21 +1378,22 @@ void stepFrame() {
 // Calc FPS:
 //      - Called every time a frame is drawn
 //      - After 1 seconds will calculate the number of
-//          frames drawn in that time
+//          frames drawn & substeps taken in that time
 //      - Updates the currentFPS variables which is
 //          then added to the HUD
 //****************************************************
 void calcFPS () {
 
-    float currentFPStime = glutGet(GLUT_ELAPSED_TIME);
-    int timeChange = currentFPStime - lastFPStime;
+    double currentFPStime = SimClock::now();
+    double timeChange = currentFPStime - lastFPStime;
 
     // If a second has elapsed
-    if(timeChange > 1000) {
-        currentFPS = (frameNum - oldFrameNum)/ (timeChange / 1000.0f);
+    if(timeChange > 1.0) {
+        currentFPS = (frameNum - oldFrameNum) / timeChange;
 
-        // Calculations Per Frame
-        calcsPerFrame = (numCalculations / (frameNum - oldFrameNum));
+        // Calculations Per Frame & Per Second
+        calcsPerFrame = (numCalculations / (float) (frameNum - oldFrameNum));
+        substepsPerSecond = numCalculations / timeChange;
 
         lastFPStime = currentFPStime;
 
@@ -1523,10 +1554,38 @@ void drawFloor(glm::vec3 ul, glm::vec3 ur, glm::vec3 lr, glm::vec3 ll, glm::vec3
     glBindTexture(GL_TEXTURE_2D, textures[currentTex]);
 }
 
+//****************************************************
+// Draw Triangles:
+//      - Draws every triangle of a meshed shape flat
+//        shaded by its facing, as there is no lighting
+//      - Used in conjunction with drawShape to create
+//        drawLists
+//****************************************************
+void drawTriangles(Shape* s, glm::vec3 color) {
+    glm::vec3 light = glm::normalize(glm::vec3(0.3f, 1.0f, 0.5f));
+
+    glBegin(GL_TRIANGLES);
+    for(int t = 0; t < s->getNumTriangles(); t++) {
+        glm::vec3 a, b, c;
+        s->getTriangle(t, a, b, c);
+
+        glm::vec3 norm = glm::cross(b - a, c - a);
+        float length = glm::length(norm);
+        float shade = (length > 0.0f) ? 0.6f + 0.4f * glm::dot(norm / length, light) : 1.0f;
+
+        glColor3f(color.x * shade, color.y * shade, color.z * shade);
+        glVertex3f(a.x, a.y, a.z);
+        glVertex3f(b.x, b.y, b.z);
+        glVertex3f(c.x, c.y, c.z);
+    }
+    glEnd();
+}
+
 //****************************************************
 // Draw Shape
 //      - Returns the draw list for a given shape
-//      - Can handle different shapes: Spheres, Planes
+//      - Can handle different shapes: Spheres, Planes,
+//        SDFs & Meshes (drawn from their triangles)
 //****************************************************
 GLuint drawShape(Shape* s) {
   
@@ -1553,6 +1612,13 @@ GLuint drawShape(Shape* s) {
         }
     }
 
+    if(s->getType() == "SDF" || s->getType() == "MESH") {
+
+        glm::vec3 color(0.3f, 0.6f, 0.3f);
+
+        drawTriangles(s, color);
+    }
+
     glEndList();
 
     return shapeList;
@@ -1562,20 +1628,7 @@ void addFloor() {
 
     numShapes++;
 
-    Shape* s;
-
-    float width = 5.0f;
-    float height = -2.0f;
-
-    glm::vec3 topLeft(-width, height, -width);
-    glm::vec3 topRight(width, height, -width);
-    glm::vec3 lowRight(width, height, width);
-    glm::vec3 lowLeft(-width, height, width);
-
-    s = new Plane(topLeft, topRight, lowRight, lowLeft);
-    s->setFloor();
-
-    shapes.push_back(s);
+    simulation->addFloor();
 }
 
 
@@ -1585,127 +1638,38 @@ void addFloor() {
 //****************************************************
 void makeDrawLists() {
     for(int i = 0; i < numShapes; i++) {
-        shapeDrawLists[i] = drawShape(shapes[i]);
+        shapeDrawLists[i] = drawShape(simulation->getShapes()[i]);
     }
 }
 
 //****************************************************
 // LoadShapes Function
-//      - Creates the draw list for all the shapes
+//      - Reads the shapes into the simulation
 //****************************************************
 void loadShapes(const char* shapeInput) {
-    std::ifstream inpfile(shapeInput, ifstream::in);
-
-    if(inpfile.good()){
-        inpfile >> numShapes;
-        std::string type;
-    
-        for(int i = 0; i < numShapes; i++) {
-
-            inpfile >> type;
-            Shape* s;
-        
-            if(string(type) == "sphere") {
-                float x,y,z,r;
-                inpfile >> x;
-                inpfile >> y;
-                inpfile >> z;
-                inpfile >> r;
-
-                glm::vec3 center(x,y,z);
-
-                s = new Sphere(center, r); 
-            }
-
-            if(string(type) == "plane") {
-                float x1, y1, z1;
-                float x2, y2, z2;
-                float x3, y3, z3;
-                float x4, y4, z4;
-
-                inpfile >> x1;
-                inpfile >> y1;
-                inpfile >> z1;
-
-                inpfile >> x2;
-                inpfile >> y2;
-                inpfile >> z2;
-
-                inpfile >> x3;
-                inpfile >> y3;
-                inpfile >> z3;
-
-                inpfile >> x4;
-                inpfile >> y4;
-                inpfile >> z4;
-
-                glm::vec3 topLeft(x1, y1, z1);
-                glm::vec3 topRight(x2, y2, z2);
-                glm::vec3 lowRight(x3, y3, z3);
-                glm::vec3 lowLeft(x4, y4, z4);
-            
-                s = new Plane(topLeft, topRight, lowRight, lowLeft);    
-            }
-            
-            shapes.push_back(s);
-        }
-    }
+    numShapes = loadShapeFile(shapeInput, simulation->getShapes(), simulation->getPool());
 }
 
 //****************************************************
 // LoadCloth  Function
-//      - Reads in Cloth Information from file
-//      - First line Width Height
-//      - Next 4 lines four corners of cloth
+//      - Reads in Cloth Information from file and
+//        hands the Cloth to the simulation
 //****************************************************
 void loadCloth(const char* input) {
-    std::ifstream inpfile(input, ifstream::in);
-    
-    //int width, height;
-    int density;
-    bool c1, c2, c3, c4;
-    bool euler;
-
-    Vertex* corners[4];
+    cloth = loadClothFile(input, integrator);
 
-    if(inpfile.good()) {
-        //inpfile >> width;
-        //inpfile >> height; 
-        
-        inpfile >> density;
-
-        for(int i = 0; i < 4; i++) {
-            float x,y,z;
-            inpfile >> x;
-            inpfile >> y;
-            inpfile >> z;
-
-            corners[i] = new Vertex(x,y,z);
-        }
-
-        std::string temp;
-    
-        inpfile >> temp;
-        c1 = (temp == "true");
-        inpfile >> temp;
-        c2 = (temp == "true");
-        inpfile >> temp;
-        c3 = (temp == "true");
-        inpfile >> temp;
-        c4 = (temp == "true");
+    if(cloth == NULL) {
+        std::exit(1);
     }
-    
-    inpfile.close();
-    
-    cloth = new Cloth(density, corners[0], corners[1], corners[2], corners[3], euler);
+
+    cloth->setSleeping(tileSleep);
+    cloth->setSelfCollision(selfCollide);
+    cloth->setContinuousCollision(continuousCollide);
+    simulation->setCloth(cloth);
 
     if(debugStats) {
         cloth->printStats();
     }
-
-    //cloth = new Cloth(width, height, corners[0], corners[1], corners[2], corners[3], euler);
-    cloth->setFixedCorners(c1, c2, c3, c4);
-
 }
 
 //****************************************************
@@ -1722,6 +1686,9 @@ void processInputs(int argc, char *argv[]) {
         std::cout << std::endl;
         std::cout << "USAGE: ./Scene <cloth_file> <shape_file> [OPTIONAL]" << std::endl;
         std::cout << "OPTIONAL: '-v' = Verlet Integration" << std::endl;
+        std::cout << "          '-i' = Implicit Euler Integration" << std::endl;
+        std::cout << "          '-x' = XPBD, springs solved as constraints" << std::endl;
+        std::cout << "          '-pd' = Projective Dynamics" << std::endl;
         std::cout << "          blank = Euler Integration" << std::endl;
         std::cout << std::endl;
         std::exit(1);
@@ -1737,16 +1704,22 @@ void processInputs(int argc, char *argv[]) {
 
             if(argc == 4) {
                 if(string(argv[3])== "-v") {
-                    euler = false;
+                    integrator = VERLET;
+                } else if(string(argv[3]) == "-i") {
+                    integrator = IMPLICIT_EULER;
+                } else if(string(argv[3]) == "-x") {
+                    integrator = XPBD;
+                } else if(string(argv[3]) == "-pd") {
+                    integrator = PROJECTIVE_DYNAMICS;
                 } else {
                     std::cerr << "Incorrect Flag Parameter" << std::endl;
                     std::exit(1);
                 }
             } else {
-                euler = true;
+                integrator = EULER;
             }
         } else {
-            euler = true;
+            integrator = EULER;
             inputFile = "test/cloth.test";
             shapeFile = "shapes/4spheres.test";
         }
@@ -1760,6 +1733,7 @@ void processInputs(int argc, char *argv[]) {
 //      'r':  Toggle Run Simulation / Pause Simulation 
 //      'g':  Toggle Gravity
 //      TODO:' ':  Toggle Wind
+//      'a':  Toggle Adaptive Timestep
 //      't':  Step through by timestep
 //      's':  Toggle Flat & Smooth Shading
 //      'w':  Toggle Filled & Wire Framing
@@ -1774,10 +1748,32 @@ void keyPress(unsigned char key, int x, int y) {
         // Performance Modifying Keys
         case 'r':           // Toggles if program is running
             running = !running;
+            simClock.reset();
             break;
 
-        case 'c':           // Switches between Constant FPS & TimeStep
+        case 'c':           // Switches between Real Time & Steps Per Frame
             constantStep = !constantStep;
+            simClock.reset();
+            break;
+
+        case 'a':           // Toggles the Adaptive Timestep
+            adaptiveStep = !adaptiveStep;
+            stepper->reset(timestep);
+            break;
+
+        case 'z':           // Toggles Tile Sleeping
+            tileSleep = !tileSleep;
+            cloth->setSleeping(tileSleep);
+            break;
+
+        case 'x':           // Toggles Self Collision
+            selfCollide = !selfCollide;
+            cloth->setSelfCollision(selfCollide);
+            break;
+
+        case 'v':           // Toggles Continuous Collision
+            continuousCollide = !continuousCollide;
+            cloth->setContinuousCollision(continuousCollide);
             break;
 
         case 't':           // Steps through numTimeStep Calculations
@@ -1800,13 +1796,15 @@ void keyPress(unsigned char key, int x, int y) {
             cloth = NULL;
             loadCloth(inputFile);
             frameNum = 0;
+            simClock.reset();
+            stepper->reset(timestep);
             break;
         
         // Force Modifying Keys
         case 'g':           // Toggle Gravity
-            gravity = !gravity;
+            simulation->setGravity(!simulation->isGravityOn());
             std::cout << "Gravity is now ";
-            if(gravity) {
+            if(simulation->isGravityOn()) {
                 std::cout << "ON" << std::endl;
             } else {
                 std::cout << "OFF" << std::endl;
@@ -1814,15 +1812,25 @@ void keyPress(unsigned char key, int x, int y) {
             break;
 
         case 'f':           // Toggle Wind
-            wind = !wind;
+            simulation->setWind(!simulation->isWindOn());
+            break;
+
+        case 'b':           // Toggle Turbulence & Gusts of the Wind
+            turbulentWind = !turbulentWind;
+            simulation->getWindField().setTurbulence(turbulentWind ? windTurbulence : 0.0f);
+            simulation->getWindField().setGustStrength(turbulentWind ? windGusts : 0.0f);
+            break;
+
+        case 'd':           // Toggle Aerodynamic Drag & Lift
+            simulation->setAerodynamics(!simulation->isAerodynamicsOn());
             break;
 
         case 'j':           // Increment Wind Force
-            windForce = glm::normalize(windForce) * (glm::length(windForce) + windINC);
+            simulation->setWindForce(glm::normalize(simulation->getWindForce()) * (glm::length(simulation->getWindForce()) + windINC));
             break;
 
         case 'k':           // Decrement Wind Force
-            windForce = glm::normalize(windForce) * (glm::length(windForce) - windINC);
+            simulation->setWindForce(glm::normalize(simulation->getWindForce()) * (glm::length(simulation->getWindForce()) - windINC));
             break;
 
         // Shading, Drawing and Texture Modifying Keys
@@ -1976,10 +1984,12 @@ int main(int argc, char *argv[]) {
     // Initialize GLUT
     glutInit(&argc, argv);
     
-    // Process Inputs & sets variables: inputFule, shapeFile, euler
+    // Process Inputs & sets variables: inputFule, shapeFile, integrator
     processInputs(argc, argv);
 
     // Loads Cloth & Shapes Info
+    simulation = new Simulation();
+    stepper = new AdaptiveStepper(simulation);
     loadCloth(inputFile);
     loadShapes(shapeFile);
 
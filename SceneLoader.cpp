@@ -0,0 +1,169 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "SceneLoader.h"
+#include "Cloth.h"
+#include "Vertex.h"
+#include "Shape.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "SDFShape.h"
+#include "TriangleMeshShape.h"
+
+//****************************************************
+// Load Cloth File
+//      - Reads in Cloth Information from file
+//      - First line density
+//      - Next 4 lines four corners of cloth
+//      - Last 4 lines whether each corner is fixed
+//****************************************************
+Cloth* loadClothFile(const char* input, IntegratorType integrator) {
+    std::ifstream inpfile(input, std::ifstream::in);
+
+    if(!inpfile.good()) {
+        std::cerr << "Unable to read cloth file: " << input << std::endl;
+        return NULL;
+    }
+
+    int density;
+    bool c1, c2, c3, c4;
+
+    Vertex corners[4];
+
+    inpfile >> density;
+
+    for(int i = 0; i < 4; i++) {
+        float x,y,z;
+        inpfile >> x;
+        inpfile >> y;
+        inpfile >> z;
+
+        corners[i] = Vertex(x,y,z);
+    }
+
+    std::string temp;
+
+    inpfile >> temp;
+    c1 = (temp == "true");
+    inpfile >> temp;
+    c2 = (temp == "true");
+    inpfile >> temp;
+    c3 = (temp == "true");
+    inpfile >> temp;
+    c4 = (temp == "true");
+
+    inpfile.close();
+
+    Cloth* cloth = new Cloth(density, &corners[0], &corners[1], &corners[2], &corners[3], integrator);
+    cloth->setFixedCorners(c1, c2, c3, c4);
+
+    return cloth;
+}
+
+//****************************************************
+// Load Shape File
+//      - First line is the number of shapes
+//      - Each following entry is either:
+//          sphere x y z r
+//          plane  ul ur lr ll  (4 x,y,z corners)
+//          sdf    mesh.obj x y z scale resolution
+//          mesh   mesh.obj x y z scale
+//      - OBJ paths are relative to the shape file; the
+//        mesh is scaled then moved to x,y,z
+//****************************************************
+int loadShapeFile(const char* input, std::vector<Shape*>& shapes, ThreadPool* pool) {
+    std::ifstream inpfile(input, std::ifstream::in);
+
+    if(!inpfile.good()) {
+        std::cerr << "Unable to read shape file: " << input << std::endl;
+        return 0;
+    }
+
+    int numShapes = 0;
+    int numRead = 0;
+    std::string type;
+
+    inpfile >> numShapes;
+
+    for(int i = 0; i < numShapes; i++) {
+
+        inpfile >> type;
+        Shape* s = NULL;
+
+        if(type == "sphere") {
+            float x,y,z,r;
+            inpfile >> x;
+            inpfile >> y;
+            inpfile >> z;
+            inpfile >> r;
+
+            glm::vec3 center(x,y,z);
+
+            s = new Sphere(center, r);
+        }
+
+        if(type == "plane") {
+            glm::vec3 corners[4];
+
+            for(int c = 0; c < 4; c++) {
+                inpfile >> corners[c].x;
+                inpfile >> corners[c].y;
+                inpfile >> corners[c].z;
+            }
+
+            s = new Plane(corners[0], corners[1], corners[2], corners[3]);
+        }
+
+        if(type == "sdf" || type == "mesh") {
+            std::string mesh;
+            glm::vec3 offset;
+            float scale;
+            int resolution = 0;
+
+            inpfile >> mesh;
+            inpfile >> offset.x;
+            inpfile >> offset.y;
+            inpfile >> offset.z;
+            inpfile >> scale;
+
+            if(type == "sdf") {
+                inpfile >> resolution;
+            }
+
+            std::string path(input);
+            size_t slash = path.find_last_of('/');
+            path = (slash == std::string::npos) ? mesh : path.substr(0, slash + 1) + mesh;
+
+            if(type == "mesh") {
+                TriangleMeshShape* m = new TriangleMeshShape();
+                if(!m->load(path.c_str(), offset, scale)) {
+                    delete m;
+                    break;
+                }
+
+                s = m;
+            } else {
+                SDFShape* sdf = new SDFShape();
+                if(!sdf->load(path.c_str(), offset, scale, resolution, pool)) {
+                    delete sdf;
+                    break;
+                }
+
+                s = sdf;
+            }
+        }
+
+        if(s == NULL) {
+            std::cerr << "Unknown shape type: " << type << std::endl;
+            break;
+        }
+
+        shapes.push_back(s);
+        numRead++;
+    }
+
+    return numRead;
+}
@@ -0,0 +1,24 @@
+#ifndef SCENELOADER_H
+#define SCENELOADER_H
+
+#include <vector>
+#include "Cloth.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Scene Loader Header Definition
+//      - Parses the test/*.test cloth files and the
+//        shapes/*.test shape files
+//      - Shared by the viewer and the batch runner,
+//        so it must not depend on OpenGL
+//****************************************************
+
+// Returns a new Cloth with its fixed corners set, or NULL if the file can't be read
+Cloth* loadClothFile(const char* input, IntegratorType integrator);
+
+// Appends the shapes in the file to shapes, returns the number read.
+// Meshes bake their distance fields on the pool, which may be NULL
+int loadShapeFile(const char* input, std::vector<Shape*>& shapes, ThreadPool* pool);
+
+#endif
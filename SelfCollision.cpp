@@ -0,0 +1,631 @@
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "glm/glm.hpp"
+
+#include "SelfCollision.h"
+
+
+//****************************************************
+// Self Collision Class - Constants
+//****************************************************
+
+// Thickness as a fraction of the mean stretch rest length
+const float SELF_THICKNESS = 0.5f;
+
+// A triangle's centre is within 0.75 rest lengths of its corners; this allows for
+// some stretch
+const float SELF_CENTRE_REACH = 0.85f;
+
+// A patch (or two neighbouring patches together) whose normals are all within this
+// angle of their mean is left out (radians, about 43 degrees)
+const float SELF_FLAT_SPREAD = 0.75f;
+
+// Hash buckets per item, rounded up to a power of two
+const int SELF_BUCKETS_PER_ITEM = 1;
+
+// Items further out than this many cells (or not finite) are not hashed
+const float SELF_CELL_LIMIT = 1e8f;
+
+const float SELF_PI = 3.14159265f;
+
+//****************************************************
+// Self Collision - Constructors
+//****************************************************
+SelfCollision::SelfCollision() {
+    width = 0;
+    height = 0;
+    numTriangles = 0;
+    thickness = 0.0f;
+    cellSize = 1.0f;
+    enabled = false;
+    patchesX = 0;
+    patchesY = 0;
+    tableMask = 0;
+    haveLast = false;
+    contacts = 0;
+}
+
+void SelfCollision::build(int w, int h, const SpringTable& springs) {
+    width = w;
+    height = h;
+    numTriangles = (w > 1 && h > 1) ? 2 * (w - 1) * (h - 1) : 0;
+
+    SpringSpan stretch = springs.getSpan(STRETCH);
+    float restSum = 0.0f;
+    for(int s = 0; s < stretch.count; s++) {
+        restSum += stretch.restLength[s];
+    }
+
+    float rest = (stretch.count > 0) ? restSum / stretch.count : 1.0f;
+    thickness = SELF_THICKNESS * rest;
+    cellSize = thickness + SELF_CENTRE_REACH * rest;
+
+    patchesX = (numTriangles > 0) ? (w - 1 + SELF_PATCH_SQUARES - 1) / SELF_PATCH_SQUARES : 0;
+    patchesY = (numTriangles > 0) ? (h - 1 + SELF_PATCH_SQUARES - 1) / SELF_PATCH_SQUARES : 0;
+
+    int numPatches = patchesX * patchesY;
+    patchLo.resize(numPatches);
+    patchHi.resize(numPatches);
+    patchAxis.resize(numPatches);
+    patchSpread.resize(numPatches);
+    patchActive.resize(numPatches);
+    activePatches.clear();
+    activeOffset.resize(numPatches + 1);
+    squareNormal.resize(numTriangles / 2);
+
+    int numParticles = w * h;
+    int numItems = numParticles + numTriangles;
+
+    int tableSize = 1;
+    while(tableSize < SELF_BUCKETS_PER_ITEM * numItems) {
+        tableSize *= 2;
+    }
+    tableMask = tableSize - 1;
+
+    SelfBucket unused = { 0, 0, 0, 0, 0, 0 };
+    itemBucket.resize(numItems);
+    keyed.resize(numItems);
+    items.resize(numItems);
+    buckets.assign(tableSize, unused);
+    usedBuckets.clear();
+
+    pushX.resize(numParticles);
+    pushY.resize(numParticles);
+    pushZ.resize(numParticles);
+    pushCount.assign(numParticles, 0);
+
+    lastX.resize(numParticles);
+    lastY.resize(numParticles);
+    lastZ.resize(numParticles);
+    haveLast = false;
+    contacts = 0;
+}
+
+//****************************************************
+// Grid Helpers:
+//      - Square (x, y) holds triangles (x, y), (x, y+1),
+//        (x+1, y) and (x+1, y+1), (x+1, y), (x, y+1),
+//        as Cloth::updateNormals splits it
+//      - A patch holds its squares' triangles and the
+//        particles at their top left corners; the last
+//        patch of a row or column also takes the
+//        particles of the far edge
+//****************************************************
+void SelfCollision::getTriangle(int t, int& a, int& b, int& c) const {
+    int square = t >> 1;
+    int x = square % (width - 1);
+    int y = square / (width - 1);
+
+    if((t & 1) == 0) {
+        a = y * width + x;
+        b = (y + 1) * width + x;
+        c = y * width + x + 1;
+    } else {
+        a = (y + 1) * width + x + 1;
+        b = y * width + x + 1;
+        c = (y + 1) * width + x;
+    }
+}
+
+void SelfCollision::getPatchSquares(int patch, int& x0, int& x1, int& y0, int& y1) const {
+    x0 = (patch % patchesX) * SELF_PATCH_SQUARES;
+    y0 = (patch / patchesX) * SELF_PATCH_SQUARES;
+    x1 = std::min(x0 + SELF_PATCH_SQUARES, width - 1);
+    y1 = std::min(y0 + SELF_PATCH_SQUARES, height - 1);
+}
+
+void SelfCollision::getPatchParticles(int patch, int& x0, int& x1, int& y0, int& y1) const {
+    getPatchSquares(patch, x0, x1, y0, y1);
+    x1 += (x1 == width - 1) ? 1 : 0;
+    y1 += (y1 == height - 1) ? 1 : 0;
+}
+
+// False when the point is too far out (or not finite) to hash
+bool SelfCollision::getCell(float x, float y, float z, int& cx, int& cy, int& cz) const {
+    float inverseCell = 1.0f / cellSize;
+
+    if(!(fabsf(x * inverseCell) < SELF_CELL_LIMIT && fabsf(y * inverseCell) < SELF_CELL_LIMIT && fabsf(z * inverseCell) < SELF_CELL_LIMIT)) {
+        return false;
+    }
+
+    cx = (int) floorf(x * inverseCell);
+    cy = (int) floorf(y * inverseCell);
+    cz = (int) floorf(z * inverseCell);
+    return true;
+}
+
+int SelfCollision::getBucket(int x, int y, int z) const {
+    unsigned int hash = ((unsigned int) x * 73856093u) ^ ((unsigned int) y * 19349663u) ^ ((unsigned int) z * 83492791u);
+    return (int) (hash & (unsigned int) tableMask);
+}
+
+//****************************************************
+// Update Patch:
+//      - Box of every corner of the patch's squares,
+//        and the cone around their mean normal. A
+//        square's normal is the cross of its diagonals
+//****************************************************
+void SelfCollision::updatePatch(const ParticleStore* p, int patch) {
+    int x0, x1, y0, y1;
+    getPatchSquares(patch, x0, x1, y0, y1);
+
+    glm::vec3 lo = p->getPos(y0 * width + x0);
+    glm::vec3 hi = lo;
+
+    for(int y = y0; y <= y1; y++) {
+        for(int x = x0; x <= x1; x++) {
+            glm::vec3 pos = p->getPos(y * width + x);
+            lo = glm::min(lo, pos);
+            hi = glm::max(hi, pos);
+        }
+    }
+
+    glm::vec3 sum(0.0f);
+    for(int y = y0; y < y1; y++) {
+        for(int x = x0; x < x1; x++) {
+            int a = y * width + x;
+            glm::vec3 normal = glm::cross(p->getPos(a + width + 1) - p->getPos(a), p->getPos(a + width) - p->getPos(a + 1));
+            float length2 = glm::dot(normal, normal);
+
+            normal = (length2 > 0.0f) ? normal * (1.0f / sqrtf(length2)) : glm::vec3(0.0f);
+            squareNormal[y * (width - 1) + x] = normal;
+            sum += normal;
+        }
+    }
+
+    float spread = SELF_PI;
+    float length2 = glm::dot(sum, sum);
+    glm::vec3 axis(0.0f);
+
+    // Not finite fails both tests & leaves the patch as curved as can be
+    if(length2 > 0.0f && length2 < HUGE_VALF) {
+        axis = sum * (1.0f / sqrtf(length2));
+
+        float least = 1.0f;
+        for(int y = y0; y < y1; y++) {
+            for(int x = x0; x < x1; x++) {
+                least = std::min(least, glm::dot(axis, squareNormal[y * (width - 1) + x]));
+            }
+        }
+
+        spread = acosf(std::max(least, -1.0f));
+    }
+
+    patchLo[patch] = lo - glm::vec3(0.5f * thickness);
+    patchHi[patch] = hi + glm::vec3(0.5f * thickness);
+    patchAxis[patch] = axis;
+    patchSpread[patch] = spread;
+}
+
+//****************************************************
+// Find Active Patches:
+//      - A patch is searched when it curves too much
+//        to rule out folding onto itself, or when its
+//        box overlaps a patch it cannot be ruled out
+//        against: any that is not a neighbour, or a
+//        neighbour whose cone together with its own is
+//        too wide
+//****************************************************
+void SelfCollision::findActivePatches() {
+    int numPatches = patchesX * patchesY;
+    std::fill(patchActive.begin(), patchActive.end(), 0);
+
+    for(int a = 0; a < numPatches; a++) {
+        if(!(patchSpread[a] <= SELF_FLAT_SPREAD)) {
+            patchActive[a] = 1;
+        }
+
+        for(int b = a + 1; b < numPatches; b++) {
+            if(patchLo[a].x > patchHi[b].x || patchHi[a].x < patchLo[b].x ||
+               patchLo[a].y > patchHi[b].y || patchHi[a].y < patchLo[b].y ||
+               patchLo[a].z > patchHi[b].z || patchHi[a].z < patchLo[b].z) {
+                continue;
+            }
+
+            bool neighbour = abs(a % patchesX - b % patchesX) <= 1 && abs(a / patchesX - b / patchesX) <= 1;
+            if(neighbour) {
+                float between = acosf(std::max(-1.0f, std::min(1.0f, glm::dot(patchAxis[a], patchAxis[b]))));
+
+                if(0.5f * (between + patchSpread[a] + patchSpread[b]) <= SELF_FLAT_SPREAD) {
+                    continue;
+                }
+            }
+
+            patchActive[a] = 1;
+            patchActive[b] = 1;
+        }
+    }
+
+    activePatches.clear();
+    for(int a = 0; a < numPatches; a++) {
+        if(patchActive[a]) {
+            activePatches.push_back(a);
+        }
+    }
+}
+
+//****************************************************
+// Build Hash:
+//      - Every particle & triangle centre of the active
+//        patches finds its bucket in parallel; a
+//        counting sort then copies them into bucket
+//        order, touching only the buckets in use
+//****************************************************
+void SelfCollision::buildHash(const ParticleStore* p, ThreadPool* pool) {
+    int numParticles = width * height;
+    int numActive = (int) activePatches.size();
+
+    activeOffset[0] = 0;
+    for(int n = 0; n < numActive; n++) {
+        int x0, x1, y0, y1, sx0, sx1, sy0, sy1;
+        getPatchParticles(activePatches[n], x0, x1, y0, y1);
+        getPatchSquares(activePatches[n], sx0, sx1, sy0, sy1);
+
+        activeOffset[n + 1] = activeOffset[n] + (x1 - x0) * (y1 - y0) + 2 * (sx1 - sx0) * (sy1 - sy0);
+    }
+
+    std::function<void(int, int)> keyBody = [this, p, numParticles](int begin, int end) {
+        for(int n = begin; n < end; n++) {
+            int patch = activePatches[n];
+            int at = activeOffset[n];
+            int x0, x1, y0, y1;
+
+            getPatchParticles(patch, x0, x1, y0, y1);
+            for(int y = y0; y < y1; y++) {
+                for(int x = x0; x < x1; x++) {
+                    SelfItem& item = keyed[at];
+                    int k = y * width + x;
+
+                    item.x = p->px[k];
+                    item.y = p->py[k];
+                    item.z = p->pz[k];
+                    item.index = k;
+                    item.column0 = x - SELF_GRID_RING;
+                    item.column1 = x + SELF_GRID_RING;
+                    item.row0 = y - SELF_GRID_RING;
+                    item.row1 = y + SELF_GRID_RING;
+
+                    itemBucket[at++] = getCell(item.x, item.y, item.z, item.cellX, item.cellY, item.cellZ) ? getBucket(item.cellX, item.cellY, item.cellZ) : -1;
+                }
+            }
+
+            // A triangle's corners span one column & row past its square's
+            getPatchSquares(patch, x0, x1, y0, y1);
+            for(int y = y0; y < y1; y++) {
+                for(int x = x0; x < x1; x++) {
+                    for(int t = 2 * (y * (width - 1) + x); t < 2 * (y * (width - 1) + x) + 2; t++) {
+                        SelfItem& item = keyed[at];
+                        int a, b, c;
+                        getTriangle(t, a, b, c);
+
+                        item.x = (p->px[a] + p->px[b] + p->px[c]) * (1.0f / 3.0f);
+                        item.y = (p->py[a] + p->py[b] + p->py[c]) * (1.0f / 3.0f);
+                        item.z = (p->pz[a] + p->pz[b] + p->pz[c]) * (1.0f / 3.0f);
+                        item.index = numParticles + t;
+                        item.column0 = x - SELF_GRID_RING;
+                        item.column1 = x + 1 + SELF_GRID_RING;
+                        item.row0 = y - SELF_GRID_RING;
+                        item.row1 = y + 1 + SELF_GRID_RING;
+
+                        itemBucket[at++] = getCell(item.x, item.y, item.z, item.cellX, item.cellY, item.cellZ) ? getBucket(item.cellX, item.cellY, item.cellZ) : -1;
+                    }
+                }
+            }
+        }
+    };
+
+    if(pool == NULL) {
+        keyBody(0, numActive);
+    } else {
+        pool->parallelFor(0, numActive, keyBody);
+    }
+
+    // Count into end; a bucket is in use from its first item on
+    int numKeyed = activeOffset[numActive];
+    for(int k = 0; k < numKeyed; k++) {
+        int b = itemBucket[k];
+
+        if(b >= 0 && buckets[b].end++ == 0) {
+            usedBuckets.push_back(b);
+        }
+    }
+
+    int running = 0;
+    for(int n = 0; n < usedBuckets.size(); n++) {
+        SelfBucket& bucket = buckets[usedBuckets[n]];
+        int count = bucket.end;
+
+        bucket.start = running;
+        bucket.end = running;
+        running += count;
+    }
+
+    // end walks through the bucket, which keeps the grid box shared by all of its items
+    for(int k = 0; k < numKeyed; k++) {
+        if(itemBucket[k] < 0) {
+            continue;
+        }
+
+        SelfBucket& bucket = buckets[itemBucket[k]];
+        const SelfItem& item = keyed[k];
+
+        if(bucket.end == bucket.start) {
+            bucket.column0 = item.column0;
+            bucket.column1 = item.column1;
+            bucket.row0 = item.row0;
+            bucket.row1 = item.row1;
+        } else {
+            bucket.column0 = std::max(bucket.column0, item.column0);
+            bucket.column1 = std::min(bucket.column1, item.column1);
+            bucket.row0 = std::max(bucket.row0, item.row0);
+            bucket.row1 = std::min(bucket.row1, item.row1);
+        }
+
+        items[bucket.end++] = item;
+    }
+}
+
+//****************************************************
+// Find Pushes:
+//      - For each free particle of active patches
+//        [begin, end), sums the pushes from every
+//        particle & face within the thickness, reading
+//        only positions from before the pass
+//****************************************************
+void SelfCollision::findPushes(const ParticleStore* p, int begin, int end) {
+    int numParticles = width * height;
+    float thickness2 = thickness * thickness;
+    float reach2 = cellSize * cellSize;
+
+    for(int n = begin; n < end; n++) {
+        int x0, x1, y0, y1;
+        getPatchParticles(activePatches[n], x0, x1, y0, y1);
+
+        for(int row = y0; row < y1; row++) {
+            for(int column = x0; column < x1; column++) {
+                int i = row * width + column;
+                float wi = p->invMass[i];
+                float xi = p->px[i];
+                float yi = p->py[i];
+                float zi = p->pz[i];
+                int cx, cy, cz;
+
+                pushX[i] = 0.0f;
+                pushY[i] = 0.0f;
+                pushZ[i] = 0.0f;
+                pushCount[i] = 0;
+
+                if(wi == 0.0f || !getCell(xi, yi, zi, cx, cy, cz)) {
+                    continue;
+                }
+
+                for(int dz = -1; dz <= 1; dz++) {
+                    for(int dy = -1; dy <= 1; dy++) {
+                        for(int dx = -1; dx <= 1; dx++) {
+                            const SelfBucket& bucket = buckets[getBucket(cx + dx, cy + dy, cz + dz)];
+
+                            if(bucket.start == bucket.end ||
+                               (column >= bucket.column0 && column <= bucket.column1 && row >= bucket.row0 && row <= bucket.row1)) {
+                                continue;
+                            }
+
+                            for(int e = bucket.start; e < bucket.end; e++) {
+                                const SelfItem& item = items[e];
+
+                                if(column >= item.column0 && column <= item.column1 && row >= item.row0 && row <= item.row1) {
+                                    continue;
+                                }
+
+                                // Neighbouring cells can share a bucket; take each item from its own cell only
+                                if(item.cellX != cx + dx || item.cellY != cy + dy || item.cellZ != cz + dz) {
+                                    continue;
+                                }
+
+                                float rx = xi - item.x;
+                                float ry = yi - item.y;
+                                float rz = zi - item.z;
+                                float d2 = rx * rx + ry * ry + rz * rz;
+
+                                // Particle - particle
+                                if(item.index < numParticles) {
+                                    if(d2 >= thickness2 || d2 == 0.0f) {
+                                        continue;
+                                    }
+
+                                    float d = sqrtf(d2);
+                                    float share = wi / (wi + p->invMass[item.index]);
+                                    float scale = (thickness - d) / d * share;
+
+                                    pushX[i] += rx * scale;
+                                    pushY[i] += ry * scale;
+                                    pushZ[i] += rz * scale;
+                                    pushCount[i]++;
+                                    continue;
+                                }
+
+                                // Particle - face, only where the particle is over the face
+                                if(d2 >= reach2) {
+                                    continue;
+                                }
+
+                                int a, b, c;
+                                getTriangle(item.index - numParticles, a, b, c);
+
+                                glm::vec3 pa = p->getPos(a);
+                                glm::vec3 e1 = p->getPos(b) - pa;
+                                glm::vec3 e2 = p->getPos(c) - pa;
+                                glm::vec3 q = glm::vec3(xi, yi, zi) - pa;
+
+                                glm::vec3 normal = glm::cross(e1, e2);
+                                float area2 = glm::dot(normal, normal);
+                                if(area2 == 0.0f) {
+                                    continue;
+                                }
+                                normal *= 1.0f / sqrtf(area2);
+
+                                float h = glm::dot(q, normal);
+                                if(!(fabsf(h) < thickness)) {
+                                    continue;
+                                }
+
+                                float d00 = glm::dot(e1, e1);
+                                float d01 = glm::dot(e1, e2);
+                                float d11 = glm::dot(e2, e2);
+                                float d20 = glm::dot(q, e1);
+                                float d21 = glm::dot(q, e2);
+                                float denominator = d00 * d11 - d01 * d01;
+
+                                float v = (d11 * d20 - d01 * d21) / denominator;
+                                float w = (d00 * d21 - d01 * d20) / denominator;
+                                if(!(v >= 0.0f && w >= 0.0f && v + w <= 1.0f)) {
+                                    continue;
+                                }
+
+                                // The side the particle was on before this step, or is on now the first time
+                                float side = h;
+                                if(haveLast) {
+                                    glm::vec3 la(lastX[a], lastY[a], lastZ[a]);
+                                    glm::vec3 lastNormal = glm::cross(glm::vec3(lastX[b], lastY[b], lastZ[b]) - la,
+                                                                      glm::vec3(lastX[c], lastY[c], lastZ[c]) - la);
+                                    side = glm::dot(glm::vec3(lastX[i], lastY[i], lastZ[i]) - la, lastNormal);
+                                }
+
+                                float sign = (side >= 0.0f) ? 1.0f : -1.0f;
+                                float depth = thickness - h * sign;
+
+                                pushX[i] += normal.x * sign * depth;
+                                pushY[i] += normal.y * sign * depth;
+                                pushZ[i] += normal.z * sign * depth;
+                                pushCount[i]++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+//****************************************************
+// Apply:
+//      - Each particle moves by the mean of its pushes
+//        & loses its velocity into them. Verlet's
+//        velocity is pos - old, so old moves along
+//        with the particle
+//****************************************************
+void SelfCollision::apply(ParticleStore* p, bool verlet, ThreadPool* pool) {
+    contacts = 0;
+
+    if(!enabled || numTriangles == 0) {
+        return;
+    }
+
+    int numParticles = width * height;
+
+    std::function<void(int, int)> patchBody = [this, p](int begin, int end) {
+        for(int patch = begin; patch < end; patch++) {
+            updatePatch(p, patch);
+        }
+    };
+
+    if(pool == NULL) {
+        patchBody(0, patchesX * patchesY);
+    } else {
+        pool->parallelFor(0, patchesX * patchesY, patchBody);
+    }
+
+    findActivePatches();
+    buildHash(p, pool);
+
+    std::function<void(int, int)> findBody = [this, p](int begin, int end) {
+        findPushes(p, begin, end);
+    };
+
+    // pushCount is 0 outside the active patches
+    std::function<void(int, int)> moveBody = [this, p, verlet](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            if(pushCount[i] > 0) {
+                float scale = 1.0f / pushCount[i];
+                glm::vec3 push(pushX[i] * scale, pushY[i] * scale, pushZ[i] * scale);
+
+                glm::vec3 velocity = verlet ? p->getPos(i) - p->getPrevPos(i) : p->getVelocity(i);
+                glm::vec3 pos = p->getPos(i) + push;
+                p->setPos(i, pos);
+
+                float length2 = glm::dot(push, push);
+                if(length2 > 0.0f) {
+                    glm::vec3 direction = push * (1.0f / sqrtf(length2));
+                    float into = glm::dot(velocity, direction);
+
+                    if(into < 0.0f) {
+                        velocity -= into * direction;
+                    }
+                }
+
+                if(verlet) {
+                    p->setPrevPos(i, pos - velocity);
+                } else {
+                    p->setVelocity(i, velocity);
+                }
+            }
+
+            lastX[i] = p->px[i];
+            lastY[i] = p->py[i];
+            lastZ[i] = p->pz[i];
+        }
+    };
+
+    int numActive = (int) activePatches.size();
+    if(pool == NULL) {
+        findBody(0, numActive);
+        moveBody(0, numParticles);
+    } else {
+        pool->parallelFor(0, numActive, findBody);
+        pool->parallelFor(0, numParticles, moveBody);
+    }
+
+    // Count the contacts, then leave every bucket & count as unused for the next pass
+    for(int n = 0; n < numActive; n++) {
+        int x0, x1, y0, y1;
+        getPatchParticles(activePatches[n], x0, x1, y0, y1);
+
+        for(int y = y0; y < y1; y++) {
+            for(int x = x0; x < x1; x++) {
+                contacts += (pushCount[y * width + x] > 0) ? 1 : 0;
+                pushCount[y * width + x] = 0;
+            }
+        }
+    }
+
+    for(int n = 0; n < usedBuckets.size(); n++) {
+        buckets[usedBuckets[n]].start = 0;
+        buckets[usedBuckets[n]].end = 0;
+    }
+    usedBuckets.clear();
+
+    haveLast = true;
+}
@@ -0,0 +1,153 @@
+#ifndef SELFCOLLISION_H
+#define SELFCOLLISION_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "ParticleStore.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Self Collision Header Definition
+//      - Keeps the cloth from passing through itself:
+//        particles closer than the thickness to another
+//        particle, or to a triangle's face, are pushed
+//        apart after every step
+//      - The grid is cut into patches of squares. A
+//        patch whose normals all lie in a narrow cone
+//        cannot fold onto itself, nor onto a neighbour
+//        when both share such a cone; any other pair of
+//        patches needs their boxes to overlap. Only
+//        patches left in a pair are hashed & searched,
+//        so a smooth cloth costs little more than the
+//        patch boxes & normals
+//      - The thickness is a fraction of the mean
+//        stretch rest length. Particles & triangle
+//        centres are hashed into cells a little over a
+//        rest length across, so everything within the
+//        thickness of a particle is in the 27 cells
+//        around it. The hash is rebuilt every step:
+//        cells are worked out in parallel, then
+//        counting sorted into buckets whose items sit
+//        side by side
+//      - Pairs within SELF_GRID_RING grid steps of each
+//        other never collide, the springs keep them
+//        apart. Each bucket keeps the grid box near all
+//        of its items, so a particle skips the buckets
+//        holding only its own neighbourhood
+//      - Every particle sums its own pushes from the
+//        positions before the pass & they are applied
+//        after, so threads never write a shared
+//        particle and the result does not depend on
+//        the thread count. A particle is pushed away
+//        from another by its share of their inverse
+//        masses, and off a face all the way; the
+//        face's corners get their own push when they
+//        meet this particle's faces
+//      - A face is left on the side the particle was on
+//        after the last pass. Velocity into the contact
+//        is removed
+//****************************************************
+
+// Grid steps within which two particles never collide; past the bend springs' two, a
+// fold this tight is not something the grid can show anyway
+const int SELF_GRID_RING = 3;
+
+// Squares along each side of a patch
+const int SELF_PATCH_SQUARES = 16;
+
+// A particle, or a triangle by its centre, copied into bucket order
+struct SelfItem {
+    float x, y, z;
+    int cellX, cellY, cellZ;
+    int index;                  // Particle, or width * height + triangle
+    int column0, column1;       // Grid columns & rows of the particles it never collides with
+    int row0, row1;
+};
+
+// A bucket's run of items & the columns & rows near every one of them
+struct SelfBucket {
+    int start, end;             // Both 0 while unused
+    int column0, column1;
+    int row0, row1;
+};
+
+class SelfCollision {
+  private:
+    int width;
+    int height;
+    int numTriangles;           // Two per grid square
+
+    float thickness;
+    float cellSize;
+    bool enabled;
+
+    // Patches: box (grown by half the thickness), normal cone & whether it is searched
+    int patchesX;
+    int patchesY;
+    std::vector<glm::vec3> patchLo;
+    std::vector<glm::vec3> patchHi;
+    std::vector<glm::vec3> patchAxis;
+    std::vector<float> patchSpread;             // Cone half angle, radians
+    std::vector<unsigned char> patchActive;
+    std::vector<int> activePatches;
+    std::vector<int> activeOffset;              // Where each active patch's items start
+    std::vector<glm::vec3> squareNormal;
+
+    // Hash of the active patches' items
+    int tableMask;
+    std::vector<int> itemBucket;                // -1 for items too far out to hash
+    std::vector<SelfItem> keyed;
+    std::vector<SelfItem> items;
+    std::vector<SelfBucket> buckets;
+    std::vector<int> usedBuckets;
+
+    // Summed pushes per particle & their count
+    std::vector<float> pushX;
+    std::vector<float> pushY;
+    std::vector<float> pushZ;
+    std::vector<int> pushCount;
+
+    // Positions after the last pass, to tell which side of a face a particle belongs on
+    std::vector<float> lastX;
+    std::vector<float> lastY;
+    std::vector<float> lastZ;
+    bool haveLast;
+
+    int contacts;
+
+    void getTriangle(int t, int& a, int& b, int& c) const;
+    void getPatchSquares(int patch, int& x0, int& x1, int& y0, int& y1) const;
+    void getPatchParticles(int patch, int& x0, int& x1, int& y0, int& y1) const;
+    bool getCell(float x, float y, float z, int& cx, int& cy, int& cz) const;
+    int getBucket(int x, int y, int z) const;
+
+    void updatePatch(const ParticleStore* p, int patch);
+    void findActivePatches();
+    void buildHash(const ParticleStore* p, ThreadPool* pool);
+    void findPushes(const ParticleStore* p, int begin, int end);
+
+  public:
+    SelfCollision();
+
+    // Sizes the hash for a w x h grid; the thickness comes from the stretch springs
+    void build(int w, int h, const SpringTable& springs);
+
+    // Pushes apart every pair closer than the thickness. pool may be NULL
+    void apply(ParticleStore* p, bool verlet, ThreadPool* pool);
+
+    // Forgets the sides particles were on, e.g. after the particles were overwritten
+    void reset() { haveLast = false; };
+
+    // Settings
+    void setEnabled(bool on) { enabled = on; haveLast = false; };
+    bool isEnabled() const { return enabled; };
+    float getThickness() const { return thickness; };
+
+    // Particles pushed by the last pass & patches searched
+    int getContacts() const { return contacts; };
+    int getActivePatches() const { return (int) activePatches.size(); };
+    int getNumPatches() const { return patchesX * patchesY; };
+};
+
+#endif
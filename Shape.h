@@ -1,8 +1,10 @@
 #ifndef SHAPE_H
 #define SHAPE_H
 
+#include <string>
+#include <math.h>
 #include "glm/glm.hpp"
-#include "Vertex.h"
+#include "ParticleStore.h"
 
 //****************************************************
 // Shape Header Definition
@@ -10,14 +12,28 @@
 
 class Shape {
   public:
-    // If Collides return true and updates Vertex, else return false
-    virtual bool collide(Vertex* v) = 0;
+    virtual ~Shape() {};
+
+    // If Collides return true and updates particle i, else return false
+    virtual bool collide(ParticleStore* p, int i) = 0;
     virtual std::string getType() = 0;  
 
+    // Axis aligned box holding every position collide can act on, for the broad phase.
+    // Sides may be infinite; the default never culls the shape
+    virtual void getBounds(glm::vec3& lo, glm::vec3& hi) {
+        lo = glm::vec3(-HUGE_VALF);
+        hi = glm::vec3(HUGE_VALF);
+    };
+
+    // Triangles of the surface, for continuous collision; shapes without any are only
+    // collided with at the end of a step
+    virtual int getNumTriangles() { return 0; };
+    virtual void getTriangle(int t, glm::vec3& a, glm::vec3& b, glm::vec3& c) {};
+
     // Functions for Sphere
     virtual float getRadius() { return -1.0f; };
     virtual glm::vec3 getCenter() {return glm::vec3(0.0f, 0.0f, 0.0f);};
-    virtual glm::vec3 getNormal(Vertex* v) { return glm::vec3(0.0f, 0.0f, 0.0f);};
+    virtual glm::vec3 getNormal(glm::vec3 point) { return glm::vec3(0.0f, 0.0f, 0.0f);};
 
     // Functions for Plane
     virtual glm::vec3 getNormal() { return glm::vec3(0.0f, 0.0f, 0.0f); };
@@ -0,0 +1,82 @@
+#include <chrono>
+
+#include "SimClock.h"
+
+//****************************************************
+// Sim Clock - Constructors
+//****************************************************
+SimClock::SimClock(double s, int maxSteps) {
+    step = (s > 0.0) ? s : 0.005;
+    maxSubsteps = (maxSteps < 1) ? 1 : maxSteps;
+
+    reset();
+}
+
+void SimClock::reset() {
+    accumulator = 0.0;
+    started = false;
+
+    totalSubsteps = 0;
+    simulatedTime = 0.0;
+    droppedTime = 0.0;
+}
+
+//****************************************************
+// Advance:
+//      - Adds the elapsed time to the accumulator and
+//        takes out as many whole steps as fit, up to
+//        maxSubsteps. Whatever is still owed past the
+//        clamp is dropped, keeping only the fraction
+//        of a step
+//****************************************************
+int SimClock::advance() {
+    std::chrono::steady_clock::time_point current = std::chrono::steady_clock::now();
+
+    if(!started) {
+        last = current;
+        started = true;
+        return 0;
+    }
+
+    double elapsed = std::chrono::duration<double>(current - last).count();
+    last = current;
+
+    return advance(elapsed);
+}
+
+int SimClock::advance(double elapsed) {
+    if(elapsed > 0.0) {
+        accumulator += elapsed;
+    }
+
+    int substeps = 0;
+    while(accumulator >= step && substeps < maxSubsteps) {
+        accumulator -= step;
+        substeps++;
+    }
+
+    if(accumulator >= step) {
+        double kept = accumulator - step * (long) (accumulator / step);
+        droppedTime += accumulator - kept;
+        accumulator = kept;
+    }
+
+    totalSubsteps += substeps;
+    simulatedTime += substeps * step;
+
+    return substeps;
+}
+
+double SimClock::now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//****************************************************
+// Sim Clock - Settings
+//****************************************************
+void SimClock::setStep(double s) {
+    // Owed time stays owed; only the size it is paid out in changes
+    if(s > 0.0) {
+        step = s;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+#include <chrono>
+
+//****************************************************
+// Sim Clock Header Definition
+//      - Turns real elapsed time into a whole number
+//        of fixed size substeps: elapsed time goes
+//        into an accumulator and every full step taken
+//        out of it is one substep, the remainder
+//        carried to the next frame
+//      - The simulation only ever sees the fixed step,
+//        so a run is the same sequence of updates on
+//        any machine; only how many land in a frame
+//        depends on the frame rate
+//      - At most maxSubsteps are taken per advance;
+//        time beyond that is dropped rather than owed,
+//        so a slow step cannot fall further & further
+//        behind (spiral of death)
+//      - Real time comes from steady_clock, which is
+//        monotonic & much finer than GLUT's ms counter
+//****************************************************
+
+class SimClock {
+  private:
+    double step;                // Fixed step in seconds
+    int maxSubsteps;
+
+    double accumulator;         // Real time owed to the simulation, < step after an advance
+    std::chrono::steady_clock::time_point last;
+    bool started;
+
+    // Stats since the last reset
+    long totalSubsteps;
+    double simulatedTime;
+    double droppedTime;
+
+  public:
+    SimClock(double s = 0.005, int maxSteps = 8);
+
+    // Forgets the accumulated time, next advance() starts measuring from its own call
+    void reset();
+
+    // Substeps owed for the real time since the last advance (the first advance takes none)
+    int advance();
+
+    // Substeps owed for elapsed seconds, independent of real time
+    int advance(double elapsed);
+
+    // Fraction of a step left in the accumulator, for interpolating the drawn state
+    double getAlpha() { return accumulator / step; };
+
+    // Seconds on the monotonic clock
+    static double now();
+
+    // Settings
+    void setStep(double s);
+    double getStep() { return step; };
+    void setMaxSubsteps(int n) { maxSubsteps = (n < 1) ? 1 : n; };
+    int getMaxSubsteps() { return maxSubsteps; };
+
+    // Stats
+    long getTotalSubsteps() { return totalSubsteps; };
+    double getSimulatedTime() { return simulatedTime; };
+    double getDroppedTime() { return droppedTime; };
+};
+
+#endif
@@ -0,0 +1,389 @@
+#include "SimdKernels.h"
+#include "ParticleStore.h"
+#include "Spring.h"
+
+//****************************************************
+// AVX2 Kernels
+//      - 8 springs or particles per instruction
+//      - Built with -mavx2 -mfma; only called once
+//        CPUID reports AVX2 & FMA
+//****************************************************
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+
+const int AVX2_LANES = 8;
+
+//****************************************************
+// Load Block:
+//      - Loads the n <= 8 springs starting at s. Lanes
+//        past n reuse spring s, so the arithmetic of a
+//        lane never depends on where a block ends;
+//        their results are never written back.
+//****************************************************
+static inline void loadBlock(const SpringSpan& springs, int s, int n, __m256i& ia, __m256i& ib,
+                             __m256& rest, __m256& stiff) {
+    if(n == AVX2_LANES) {
+        ia = _mm256_loadu_si256((const __m256i*) (springs.i0 + s));
+        ib = _mm256_loadu_si256((const __m256i*) (springs.i1 + s));
+        rest = _mm256_loadu_ps(springs.restLength + s);
+        stiff = _mm256_loadu_ps(springs.stiffness + s);
+        return;
+    }
+
+    alignas(32) int a[AVX2_LANES];
+    alignas(32) int b[AVX2_LANES];
+    alignas(32) float r[AVX2_LANES];
+    alignas(32) float k[AVX2_LANES];
+
+    for(int j = 0; j < AVX2_LANES; j++) {
+        int src = s + ((j < n) ? j : 0);
+
+        a[j] = springs.i0[src];
+        b[j] = springs.i1[src];
+        r[j] = springs.restLength[src];
+        k[j] = springs.stiffness[src];
+    }
+
+    ia = _mm256_load_si256((const __m256i*) a);
+    ib = _mm256_load_si256((const __m256i*) b);
+    rest = _mm256_load_ps(r);
+    stiff = _mm256_load_ps(k);
+}
+
+//****************************************************
+// Spring Force:
+//      - 1 / length from rsqrt plus one Newton step
+//        instead of a sqrt & divide per spring
+//      - AVX2 has gathers but no scatter, so forces
+//        are written back one lane at a time
+//****************************************************
+static void avx2SpringForce(ParticleStore* p, SpringSpan springs) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+
+    alignas(32) int a[AVX2_LANES];
+    alignas(32) int b[AVX2_LANES];
+    alignas(32) float sx[AVX2_LANES];
+    alignas(32) float sy[AVX2_LANES];
+    alignas(32) float sz[AVX2_LANES];
+
+    for(int s = 0; s < springs.count; s += AVX2_LANES) {
+        int n = (springs.count - s < AVX2_LANES) ? springs.count - s : AVX2_LANES;
+
+        __m256i ia, ib;
+        __m256 rest, stiff;
+        loadBlock(springs, s, n, ia, ib, rest, stiff);
+
+        __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(p->px, ib, 4), _mm256_i32gather_ps(p->px, ia, 4));
+        __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(p->py, ib, 4), _mm256_i32gather_ps(p->py, ia, 4));
+        __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(p->pz, ib, 4), _mm256_i32gather_ps(p->pz, ia, 4));
+
+        __m256 len2 = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+
+        // inv = r * (1.5 - 0.5 * len2 * r * r)
+        __m256 r = _mm256_rsqrt_ps(len2);
+        __m256 inv = _mm256_mul_ps(r, _mm256_fnmadd_ps(_mm256_mul_ps(half, len2), _mm256_mul_ps(r, r), threeHalves));
+
+        __m256 length = _mm256_mul_ps(len2, inv);
+        __m256 magnitude = _mm256_mul_ps(stiff, _mm256_sub_ps(length, rest));
+        __m256 scale = _mm256_mul_ps(inv, magnitude);
+
+        _mm256_store_ps(sx, _mm256_mul_ps(dx, scale));
+        _mm256_store_ps(sy, _mm256_mul_ps(dy, scale));
+        _mm256_store_ps(sz, _mm256_mul_ps(dz, scale));
+        _mm256_store_si256((__m256i*) a, ia);
+        _mm256_store_si256((__m256i*) b, ib);
+
+        for(int j = 0; j < n; j++) {
+            p->fx[a[j]] += sx[j];  p->fy[a[j]] += sy[j];  p->fz[a[j]] += sz[j];
+            p->fx[b[j]] -= sx[j];  p->fy[b[j]] -= sy[j];  p->fz[b[j]] -= sz[j];
+        }
+    }
+}
+
+//****************************************************
+// Length Constraint:
+//      - Full sqrt & divide, only springs outside the
+//        bounds are written back
+//****************************************************
+static void avx2LengthConstraint(ParticleStore* p, SpringSpan springs, float tol) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 upperScale = _mm256_set1_ps(1.0f + tol);
+    const __m256 lowerScale = _mm256_set1_ps(1.0f - tol);
+
+    alignas(32) int a[AVX2_LANES];
+    alignas(32) int b[AVX2_LANES];
+    alignas(32) float cx[AVX2_LANES];
+    alignas(32) float cy[AVX2_LANES];
+    alignas(32) float cz[AVX2_LANES];
+
+    for(int s = 0; s < springs.count; s += AVX2_LANES) {
+        int n = (springs.count - s < AVX2_LANES) ? springs.count - s : AVX2_LANES;
+
+        __m256i ia, ib;
+        __m256 rest, stiff;
+        loadBlock(springs, s, n, ia, ib, rest, stiff);
+
+        __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(p->px, ib, 4), _mm256_i32gather_ps(p->px, ia, 4));
+        __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(p->py, ib, 4), _mm256_i32gather_ps(p->py, ia, 4));
+        __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(p->pz, ib, 4), _mm256_i32gather_ps(p->pz, ia, 4));
+
+        __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                                     _mm256_mul_ps(dz, dz)));
+
+        __m256 upperBound = _mm256_mul_ps(rest, upperScale);
+        __m256 lowerBound = _mm256_mul_ps(rest, lowerScale);
+
+        __m256 isLong = _mm256_cmp_ps(length, upperBound, _CMP_GT_OQ);
+        __m256 isShort = _mm256_cmp_ps(length, lowerBound, _CMP_LT_OQ);
+
+        int active = _mm256_movemask_ps(_mm256_or_ps(isLong, isShort)) & ((1 << n) - 1);
+        if(active == 0) {
+            continue;
+        }
+
+        __m256 bound = _mm256_blendv_ps(lowerBound, upperBound, isLong);
+        __m256 scale = _mm256_sub_ps(one, _mm256_div_ps(bound, length));
+
+        _mm256_store_ps(cx, _mm256_mul_ps(_mm256_mul_ps(dx, scale), half));
+        _mm256_store_ps(cy, _mm256_mul_ps(_mm256_mul_ps(dy, scale), half));
+        _mm256_store_ps(cz, _mm256_mul_ps(_mm256_mul_ps(dz, scale), half));
+        _mm256_store_si256((__m256i*) a, ia);
+        _mm256_store_si256((__m256i*) b, ib);
+
+        for(int j = 0; j < n; j++) {
+            if(active & (1 << j)) {
+                p->offsetCorrection(a[j], glm::vec3(cx[j], cy[j], cz[j]));
+                p->offsetCorrection(b[j], -glm::vec3(cx[j], cy[j], cz[j]));
+            }
+        }
+    }
+}
+
+//****************************************************
+// Euler / Verlet:
+//      - Same operations in the same order as
+//        ParticleStore, so results match it exactly;
+//        fixed particles are blended back unchanged
+//****************************************************
+static void avx2UpdateEuler(ParticleStore* p, float timeChange, int begin, int end) {
+    const __m256 dt = _mm256_set1_ps(timeChange);
+    const __m256 zero = _mm256_setzero_ps();
+
+    int i = begin;
+    for(; i + AVX2_LANES <= end; i += AVX2_LANES) {
+        __m256 w = _mm256_loadu_ps(p->invMass + i);
+        __m256 moves = _mm256_cmp_ps(w, zero, _CMP_NEQ_UQ);
+
+        float* v[3] = { p->vx + i, p->vy + i, p->vz + i };
+        float* x[3] = { p->px + i, p->py + i, p->pz + i };
+        float* f[3] = { p->fx + i, p->fy + i, p->fz + i };
+
+        for(int c = 0; c < 3; c++) {
+            __m256 vel = _mm256_loadu_ps(v[c]);
+            __m256 pos = _mm256_loadu_ps(x[c]);
+
+            __m256 newVel = _mm256_add_ps(vel, _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(f[c]), w), dt));
+            __m256 newPos = _mm256_add_ps(pos, _mm256_mul_ps(newVel, dt));
+
+            _mm256_storeu_ps(v[c], _mm256_blendv_ps(vel, newVel, moves));
+            _mm256_storeu_ps(x[c], _mm256_blendv_ps(pos, newPos, moves));
+            _mm256_storeu_ps(f[c], zero);
+        }
+    }
+
+    p->updateEuler(timeChange, i, end);
+}
+
+static void avx2UpdateVerlet(ParticleStore* p, float timeChange, int begin, int end) {
+    const __m256 dt2 = _mm256_set1_ps(timeChange * timeChange);
+    const __m256 keep = _mm256_set1_ps(1.0f - PARTICLE_DAMP_FACTOR);
+    const __m256 zero = _mm256_setzero_ps();
+
+    int i = begin;
+    for(; i + AVX2_LANES <= end; i += AVX2_LANES) {
+        __m256 w = _mm256_loadu_ps(p->invMass + i);
+        __m256 moves = _mm256_cmp_ps(w, zero, _CMP_NEQ_UQ);
+
+        float* x[3] = { p->px + i, p->py + i, p->pz + i };
+        float* o[3] = { p->ox + i, p->oy + i, p->oz + i };
+        float* f[3] = { p->fx + i, p->fy + i, p->fz + i };
+
+        for(int c = 0; c < 3; c++) {
+            __m256 pos = _mm256_loadu_ps(x[c]);
+            __m256 old = _mm256_loadu_ps(o[c]);
+
+            __m256 newPos = _mm256_add_ps(_mm256_add_ps(pos, _mm256_mul_ps(_mm256_sub_ps(pos, old), keep)),
+                                          _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(f[c]), w), dt2));
+
+            _mm256_storeu_ps(x[c], _mm256_blendv_ps(pos, newPos, moves));
+            _mm256_storeu_ps(o[c], _mm256_blendv_ps(old, pos, moves));
+            _mm256_storeu_ps(f[c], zero);
+        }
+    }
+
+    p->updateVerlet(timeChange, i, end);
+}
+
+//****************************************************
+// Collide Sphere / Plane:
+//      - Same operations in the same order as the
+//        reference kernels in Colliders, so results
+//        match them exactly
+//      - A block with no particle near the shape stops
+//        after the first compare; other lanes are blended back unchanged
+//****************************************************
+static bool avx2CollideSphere(ParticleStore* p, const SphereCollider& s, int begin, int end) {
+    const __m256 cx = _mm256_set1_ps(s.cx);
+    const __m256 cy = _mm256_set1_ps(s.cy);
+    const __m256 cz = _mm256_set1_ps(s.cz);
+    const __m256 radius = _mm256_set1_ps(s.radius);
+    const __m256 reach2 = _mm256_set1_ps(s.reach2);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 damp = _mm256_set1_ps(0.4f);
+
+    bool hit = false;
+
+    int i = begin;
+    for(; i + AVX2_LANES <= end; i += AVX2_LANES) {
+        __m256 x = _mm256_loadu_ps(p->px + i);
+        __m256 y = _mm256_loadu_ps(p->py + i);
+        __m256 z = _mm256_loadu_ps(p->pz + i);
+
+        __m256 tx = _mm256_sub_ps(x, cx);
+        __m256 ty = _mm256_sub_ps(y, cy);
+        __m256 tz = _mm256_sub_ps(z, cz);
+
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, tx), _mm256_mul_ps(ty, ty)), _mm256_mul_ps(tz, tz));
+
+        __m256 near = _mm256_cmp_ps(d, reach2, _CMP_LT_OQ);
+        if(_mm256_movemask_ps(near) == 0) {
+            continue;
+        }
+
+        __m256 length = _mm256_sqrt_ps(d);
+        __m256 inside = _mm256_and_ps(near, _mm256_cmp_ps(length, radius, _CMP_LT_OQ));
+        if(_mm256_movemask_ps(inside) == 0) {
+            continue;
+        }
+
+        __m256 inv = _mm256_div_ps(one, length);
+
+        _mm256_storeu_ps(p->px + i, _mm256_blendv_ps(x, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(tx, inv), radius), cx), inside));
+        _mm256_storeu_ps(p->py + i, _mm256_blendv_ps(y, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ty, inv), radius), cy), inside));
+        _mm256_storeu_ps(p->pz + i, _mm256_blendv_ps(z, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(tz, inv), radius), cz), inside));
+
+        float* v[3] = { p->vx + i, p->vy + i, p->vz + i };
+        for(int c = 0; c < 3; c++) {
+            __m256 vel = _mm256_loadu_ps(v[c]);
+            _mm256_storeu_ps(v[c], _mm256_blendv_ps(vel, _mm256_mul_ps(vel, damp), inside));
+        }
+
+        hit = true;
+    }
+
+    return collideSphere(p, s, i, end) || hit;
+}
+
+static bool avx2CollidePlane(ParticleStore* p, const PlaneCollider& s, int begin, int end) {
+    const __m256 ox = _mm256_set1_ps(s.ox);
+    const __m256 oy = _mm256_set1_ps(s.oy);
+    const __m256 oz = _mm256_set1_ps(s.oz);
+    const __m256 nx = _mm256_set1_ps(s.nx);
+    const __m256 ny = _mm256_set1_ps(s.ny);
+    const __m256 nz = _mm256_set1_ps(s.nz);
+    const __m256 rx = _mm256_set1_ps(s.rx);
+    const __m256 ry = _mm256_set1_ps(s.ry);
+    const __m256 rz = _mm256_set1_ps(s.rz);
+    const __m256 lx = _mm256_set1_ps(s.lx);
+    const __m256 ly = _mm256_set1_ps(s.ly);
+    const __m256 lz = _mm256_set1_ps(s.lz);
+    const __m256 rightLimit = _mm256_set1_ps(s.rightLimit);
+    const __m256 lowLimit = _mm256_set1_ps(s.lowLimit);
+    const __m256 edge = _mm256_set1_ps(-PLANE_EDGE_BUFFER);
+    const __m256 contact = _mm256_set1_ps(PLANE_CONTACT_DISTANCE);
+    const __m256 minusOne = _mm256_set1_ps(-1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 damp = _mm256_set1_ps(0.4f);
+
+    bool hit = false;
+
+    int i = begin;
+    for(; i + AVX2_LANES <= end; i += AVX2_LANES) {
+        __m256 x = _mm256_loadu_ps(p->px + i);
+        __m256 y = _mm256_loadu_ps(p->py + i);
+        __m256 z = _mm256_loadu_ps(p->pz + i);
+
+        __m256 along = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(x, ox), nx),
+                                                   _mm256_mul_ps(_mm256_sub_ps(y, oy), ny)),
+                                     _mm256_mul_ps(_mm256_sub_ps(z, oz), nz));
+        __m256 dist = _mm256_mul_ps(along, minusOne);
+
+        __m256 near = _mm256_cmp_ps(dist, contact, _CMP_LT_OQ);
+        if(_mm256_movemask_ps(near) == 0) {
+            continue;
+        }
+
+        __m256 vx = _mm256_loadu_ps(p->vx + i);
+        __m256 vy = _mm256_loadu_ps(p->vy + i);
+        __m256 vz = _mm256_loadu_ps(p->vz + i);
+
+        __m256 approach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, vx), _mm256_mul_ps(ny, vy)), _mm256_mul_ps(nz, vz));
+        __m256 moving = _mm256_and_ps(near, _mm256_cmp_ps(approach, zero, _CMP_GT_OQ));
+        if(_mm256_movemask_ps(moving) == 0) {
+            continue;
+        }
+
+        __m256 ux = _mm256_sub_ps(_mm256_sub_ps(x, _mm256_mul_ps(dist, nx)), ox);
+        __m256 uy = _mm256_sub_ps(_mm256_sub_ps(y, _mm256_mul_ps(dist, ny)), oy);
+        __m256 uz = _mm256_sub_ps(_mm256_sub_ps(z, _mm256_mul_ps(dist, nz)), oz);
+
+        __m256 right = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rx, ux), _mm256_mul_ps(ry, uy)), _mm256_mul_ps(rz, uz));
+        __m256 low = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lx, ux), _mm256_mul_ps(ly, uy)), _mm256_mul_ps(lz, uz));
+
+        __m256 over = _mm256_and_ps(moving, _mm256_and_ps(_mm256_cmp_ps(right, rightLimit, _CMP_LE_OQ),
+                                                          _mm256_cmp_ps(right, edge, _CMP_GE_OQ)));
+        over = _mm256_and_ps(over, _mm256_and_ps(_mm256_cmp_ps(low, lowLimit, _CMP_LE_OQ),
+                                                 _mm256_cmp_ps(low, edge, _CMP_GE_OQ)));
+        if(_mm256_movemask_ps(over) == 0) {
+            continue;
+        }
+
+        _mm256_storeu_ps(p->px + i, _mm256_blendv_ps(x, _mm256_sub_ps(x, vx), over));
+        _mm256_storeu_ps(p->py + i, _mm256_blendv_ps(y, _mm256_sub_ps(y, vy), over));
+        _mm256_storeu_ps(p->pz + i, _mm256_blendv_ps(z, _mm256_sub_ps(z, vz), over));
+
+        _mm256_storeu_ps(p->vx + i, _mm256_blendv_ps(vx, _mm256_mul_ps(vx, damp), over));
+        _mm256_storeu_ps(p->vy + i, _mm256_blendv_ps(vy, _mm256_mul_ps(vy, damp), over));
+        _mm256_storeu_ps(p->vz + i, _mm256_blendv_ps(vz, _mm256_mul_ps(vz, damp), over));
+
+        hit = true;
+    }
+
+    return collidePlane(p, s, i, end) || hit;
+}
+
+static const SimdKernels AVX2_KERNELS = {
+    SIMD_AVX2, "avx2", AVX2_LANES,
+    avx2SpringForce,
+    avx2LengthConstraint,
+    avx2UpdateEuler,
+    avx2UpdateVerlet,
+    avx2CollideSphere,
+    avx2CollidePlane
+};
+
+const SimdKernels* getAVX2Kernels() {
+    return &AVX2_KERNELS;
+}
+
+#else
+
+const SimdKernels* getAVX2Kernels() {
+    return NULL;
+}
+
+#endif
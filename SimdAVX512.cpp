@@ -0,0 +1,365 @@
+#include "SimdKernels.h"
+#include "ParticleStore.h"
+#include "Spring.h"
+
+//****************************************************
+// AVX-512 Kernels
+//      - 16 springs or particles per instruction
+//      - Built with -mavx512f; only called once CPUID
+//        reports AVX-512F
+//      - Springs of a span share no particle, so
+//        forces & corrections are scattered straight
+//        back with masked scatters
+//****************************************************
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+const int AVX512_LANES = 16;
+
+//****************************************************
+// Load Block:
+//      - Loads the n <= 16 springs starting at s.
+//        Lanes past n are masked off: they read
+//        particle 0 and are never written back.
+//****************************************************
+static inline __mmask16 loadBlock(const ParticleStore* p, const SpringSpan& springs, int s, int n,
+                                  __m512i& ia, __m512i& ib, __m512& rest, __m512& stiff,
+                                  __m512& dx, __m512& dy, __m512& dz) {
+    __mmask16 valid = (__mmask16) ((1u << n) - 1u);
+
+    ia = _mm512_maskz_loadu_epi32(valid, springs.i0 + s);
+    ib = _mm512_maskz_loadu_epi32(valid, springs.i1 + s);
+    rest = _mm512_maskz_loadu_ps(valid, springs.restLength + s);
+    stiff = _mm512_maskz_loadu_ps(valid, springs.stiffness + s);
+
+    dx = _mm512_sub_ps(_mm512_i32gather_ps(ib, p->px, 4), _mm512_i32gather_ps(ia, p->px, 4));
+    dy = _mm512_sub_ps(_mm512_i32gather_ps(ib, p->py, 4), _mm512_i32gather_ps(ia, p->py, 4));
+    dz = _mm512_sub_ps(_mm512_i32gather_ps(ib, p->pz, 4), _mm512_i32gather_ps(ia, p->pz, 4));
+
+    return valid;
+}
+
+// array[index] += value for every lane of mask
+static inline void scatterAdd(float* array, __mmask16 mask, __m512i index, __m512 value) {
+    __m512 current = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, index, array, 4);
+    _mm512_mask_i32scatter_ps(array, mask, index, _mm512_add_ps(current, value), 4);
+}
+
+static inline void scatterSub(float* array, __mmask16 mask, __m512i index, __m512 value) {
+    __m512 current = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, index, array, 4);
+    _mm512_mask_i32scatter_ps(array, mask, index, _mm512_sub_ps(current, value), 4);
+}
+
+//****************************************************
+// Spring Force:
+//      - 1 / length from rsqrt14 plus one Newton step
+//        instead of a sqrt & divide per spring
+//****************************************************
+static void avx512SpringForce(ParticleStore* p, SpringSpan springs) {
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 threeHalves = _mm512_set1_ps(1.5f);
+
+    for(int s = 0; s < springs.count; s += AVX512_LANES) {
+        int n = (springs.count - s < AVX512_LANES) ? springs.count - s : AVX512_LANES;
+
+        __m512i ia, ib;
+        __m512 rest, stiff, dx, dy, dz;
+        __mmask16 valid = loadBlock(p, springs, s, n, ia, ib, rest, stiff, dx, dy, dz);
+
+        __m512 len2 = _mm512_fmadd_ps(dz, dz, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx)));
+
+        // inv = r * (1.5 - 0.5 * len2 * r * r)
+        __m512 r = _mm512_rsqrt14_ps(len2);
+        __m512 inv = _mm512_mul_ps(r, _mm512_fnmadd_ps(_mm512_mul_ps(half, len2), _mm512_mul_ps(r, r), threeHalves));
+
+        __m512 length = _mm512_mul_ps(len2, inv);
+        __m512 magnitude = _mm512_mul_ps(stiff, _mm512_sub_ps(length, rest));
+        __m512 scale = _mm512_mul_ps(inv, magnitude);
+
+        __m512 sx = _mm512_mul_ps(dx, scale);
+        __m512 sy = _mm512_mul_ps(dy, scale);
+        __m512 sz = _mm512_mul_ps(dz, scale);
+
+        scatterAdd(p->fx, valid, ia, sx);
+        scatterAdd(p->fy, valid, ia, sy);
+        scatterAdd(p->fz, valid, ia, sz);
+
+        scatterSub(p->fx, valid, ib, sx);
+        scatterSub(p->fy, valid, ib, sy);
+        scatterSub(p->fz, valid, ib, sz);
+    }
+}
+
+//****************************************************
+// Length Constraint:
+//      - Full sqrt & divide; only springs outside the
+//        bounds move, and never a fixed particle
+//****************************************************
+static void avx512LengthConstraint(ParticleStore* p, SpringSpan springs, float tol) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 upperScale = _mm512_set1_ps(1.0f + tol);
+    const __m512 lowerScale = _mm512_set1_ps(1.0f - tol);
+
+    for(int s = 0; s < springs.count; s += AVX512_LANES) {
+        int n = (springs.count - s < AVX512_LANES) ? springs.count - s : AVX512_LANES;
+
+        __m512i ia, ib;
+        __m512 rest, stiff, dx, dy, dz;
+        __mmask16 valid = loadBlock(p, springs, s, n, ia, ib, rest, stiff, dx, dy, dz);
+
+        __m512 length = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)),
+                                                     _mm512_mul_ps(dz, dz)));
+
+        __m512 upperBound = _mm512_mul_ps(rest, upperScale);
+        __m512 lowerBound = _mm512_mul_ps(rest, lowerScale);
+
+        __mmask16 isLong = _mm512_cmp_ps_mask(length, upperBound, _CMP_GT_OQ);
+        __mmask16 isShort = _mm512_cmp_ps_mask(length, lowerBound, _CMP_LT_OQ);
+
+        __mmask16 active = (isLong | isShort) & valid;
+        if(active == 0) {
+            continue;
+        }
+
+        __m512 bound = _mm512_mask_blend_ps(isLong, lowerBound, upperBound);
+        __m512 scale = _mm512_sub_ps(one, _mm512_div_ps(bound, length));
+
+        __m512 cx = _mm512_mul_ps(_mm512_mul_ps(dx, scale), half);
+        __m512 cy = _mm512_mul_ps(_mm512_mul_ps(dy, scale), half);
+        __m512 cz = _mm512_mul_ps(_mm512_mul_ps(dz, scale), half);
+
+        // Fixed particles are never moved
+        __m512 wa = _mm512_mask_i32gather_ps(zero, active, ia, p->invMass, 4);
+        __m512 wb = _mm512_mask_i32gather_ps(zero, active, ib, p->invMass, 4);
+
+        __mmask16 movesA = _mm512_mask_cmp_ps_mask(active, wa, zero, _CMP_NEQ_UQ);
+        __mmask16 movesB = _mm512_mask_cmp_ps_mask(active, wb, zero, _CMP_NEQ_UQ);
+
+        scatterAdd(p->px, movesA, ia, cx);
+        scatterAdd(p->py, movesA, ia, cy);
+        scatterAdd(p->pz, movesA, ia, cz);
+
+        scatterSub(p->px, movesB, ib, cx);
+        scatterSub(p->py, movesB, ib, cy);
+        scatterSub(p->pz, movesB, ib, cz);
+    }
+}
+
+//****************************************************
+// Euler / Verlet:
+//      - Same operations in the same order as
+//        ParticleStore, so results match it exactly;
+//        fixed particles are masked out of the stores
+//****************************************************
+static void avx512UpdateEuler(ParticleStore* p, float timeChange, int begin, int end) {
+    const __m512 dt = _mm512_set1_ps(timeChange);
+    const __m512 zero = _mm512_setzero_ps();
+
+    int i = begin;
+    for(; i + AVX512_LANES <= end; i += AVX512_LANES) {
+        __m512 w = _mm512_loadu_ps(p->invMass + i);
+        __mmask16 moves = _mm512_cmp_ps_mask(w, zero, _CMP_NEQ_UQ);
+
+        float* v[3] = { p->vx + i, p->vy + i, p->vz + i };
+        float* x[3] = { p->px + i, p->py + i, p->pz + i };
+        float* f[3] = { p->fx + i, p->fy + i, p->fz + i };
+
+        for(int c = 0; c < 3; c++) {
+            __m512 newVel = _mm512_add_ps(_mm512_loadu_ps(v[c]), _mm512_mul_ps(_mm512_mul_ps(_mm512_loadu_ps(f[c]), w), dt));
+            __m512 newPos = _mm512_add_ps(_mm512_loadu_ps(x[c]), _mm512_mul_ps(newVel, dt));
+
+            _mm512_mask_storeu_ps(v[c], moves, newVel);
+            _mm512_mask_storeu_ps(x[c], moves, newPos);
+            _mm512_storeu_ps(f[c], zero);
+        }
+    }
+
+    p->updateEuler(timeChange, i, end);
+}
+
+static void avx512UpdateVerlet(ParticleStore* p, float timeChange, int begin, int end) {
+    const __m512 dt2 = _mm512_set1_ps(timeChange * timeChange);
+    const __m512 keep = _mm512_set1_ps(1.0f - PARTICLE_DAMP_FACTOR);
+    const __m512 zero = _mm512_setzero_ps();
+
+    int i = begin;
+    for(; i + AVX512_LANES <= end; i += AVX512_LANES) {
+        __m512 w = _mm512_loadu_ps(p->invMass + i);
+        __mmask16 moves = _mm512_cmp_ps_mask(w, zero, _CMP_NEQ_UQ);
+
+        float* x[3] = { p->px + i, p->py + i, p->pz + i };
+        float* o[3] = { p->ox + i, p->oy + i, p->oz + i };
+        float* f[3] = { p->fx + i, p->fy + i, p->fz + i };
+
+        for(int c = 0; c < 3; c++) {
+            __m512 pos = _mm512_loadu_ps(x[c]);
+
+            __m512 newPos = _mm512_add_ps(_mm512_add_ps(pos, _mm512_mul_ps(_mm512_sub_ps(pos, _mm512_loadu_ps(o[c])), keep)),
+                                          _mm512_mul_ps(_mm512_mul_ps(_mm512_loadu_ps(f[c]), w), dt2));
+
+            _mm512_mask_storeu_ps(x[c], moves, newPos);
+            _mm512_mask_storeu_ps(o[c], moves, pos);
+            _mm512_storeu_ps(f[c], zero);
+        }
+    }
+
+    p->updateVerlet(timeChange, i, end);
+}
+
+//****************************************************
+// Collide Sphere / Plane:
+//      - Same operations in the same order as the
+//        reference kernels in Colliders, so results
+//        match them exactly
+//      - A block with no particle near the shape stops
+//        after the first compare
+//****************************************************
+static bool avx512CollideSphere(ParticleStore* p, const SphereCollider& s, int begin, int end) {
+    const __m512 cx = _mm512_set1_ps(s.cx);
+    const __m512 cy = _mm512_set1_ps(s.cy);
+    const __m512 cz = _mm512_set1_ps(s.cz);
+    const __m512 radius = _mm512_set1_ps(s.radius);
+    const __m512 reach2 = _mm512_set1_ps(s.reach2);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 damp = _mm512_set1_ps(0.4f);
+
+    bool hit = false;
+
+    int i = begin;
+    for(; i + AVX512_LANES <= end; i += AVX512_LANES) {
+        __m512 tx = _mm512_sub_ps(_mm512_loadu_ps(p->px + i), cx);
+        __m512 ty = _mm512_sub_ps(_mm512_loadu_ps(p->py + i), cy);
+        __m512 tz = _mm512_sub_ps(_mm512_loadu_ps(p->pz + i), cz);
+
+        __m512 d = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(tx, tx), _mm512_mul_ps(ty, ty)), _mm512_mul_ps(tz, tz));
+
+        __mmask16 near = _mm512_cmp_ps_mask(d, reach2, _CMP_LT_OQ);
+        if(near == 0) {
+            continue;
+        }
+
+        __m512 length = _mm512_sqrt_ps(d);
+        __mmask16 inside = _mm512_mask_cmp_ps_mask(near, length, radius, _CMP_LT_OQ);
+        if(inside == 0) {
+            continue;
+        }
+
+        __m512 inv = _mm512_div_ps(one, length);
+
+        _mm512_mask_storeu_ps(p->px + i, inside, _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(tx, inv), radius), cx));
+        _mm512_mask_storeu_ps(p->py + i, inside, _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(ty, inv), radius), cy));
+        _mm512_mask_storeu_ps(p->pz + i, inside, _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(tz, inv), radius), cz));
+
+        _mm512_mask_storeu_ps(p->vx + i, inside, _mm512_mul_ps(_mm512_loadu_ps(p->vx + i), damp));
+        _mm512_mask_storeu_ps(p->vy + i, inside, _mm512_mul_ps(_mm512_loadu_ps(p->vy + i), damp));
+        _mm512_mask_storeu_ps(p->vz + i, inside, _mm512_mul_ps(_mm512_loadu_ps(p->vz + i), damp));
+
+        hit = true;
+    }
+
+    return collideSphere(p, s, i, end) || hit;
+}
+
+static bool avx512CollidePlane(ParticleStore* p, const PlaneCollider& s, int begin, int end) {
+    const __m512 ox = _mm512_set1_ps(s.ox);
+    const __m512 oy = _mm512_set1_ps(s.oy);
+    const __m512 oz = _mm512_set1_ps(s.oz);
+    const __m512 nx = _mm512_set1_ps(s.nx);
+    const __m512 ny = _mm512_set1_ps(s.ny);
+    const __m512 nz = _mm512_set1_ps(s.nz);
+    const __m512 rx = _mm512_set1_ps(s.rx);
+    const __m512 ry = _mm512_set1_ps(s.ry);
+    const __m512 rz = _mm512_set1_ps(s.rz);
+    const __m512 lx = _mm512_set1_ps(s.lx);
+    const __m512 ly = _mm512_set1_ps(s.ly);
+    const __m512 lz = _mm512_set1_ps(s.lz);
+    const __m512 rightLimit = _mm512_set1_ps(s.rightLimit);
+    const __m512 lowLimit = _mm512_set1_ps(s.lowLimit);
+    const __m512 edge = _mm512_set1_ps(-PLANE_EDGE_BUFFER);
+    const __m512 contact = _mm512_set1_ps(PLANE_CONTACT_DISTANCE);
+    const __m512 minusOne = _mm512_set1_ps(-1.0f);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 damp = _mm512_set1_ps(0.4f);
+
+    bool hit = false;
+
+    int i = begin;
+    for(; i + AVX512_LANES <= end; i += AVX512_LANES) {
+        __m512 x = _mm512_loadu_ps(p->px + i);
+        __m512 y = _mm512_loadu_ps(p->py + i);
+        __m512 z = _mm512_loadu_ps(p->pz + i);
+
+        __m512 along = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_sub_ps(x, ox), nx),
+                                                   _mm512_mul_ps(_mm512_sub_ps(y, oy), ny)),
+                                     _mm512_mul_ps(_mm512_sub_ps(z, oz), nz));
+        __m512 dist = _mm512_mul_ps(along, minusOne);
+
+        __mmask16 near = _mm512_cmp_ps_mask(dist, contact, _CMP_LT_OQ);
+        if(near == 0) {
+            continue;
+        }
+
+        __m512 vx = _mm512_loadu_ps(p->vx + i);
+        __m512 vy = _mm512_loadu_ps(p->vy + i);
+        __m512 vz = _mm512_loadu_ps(p->vz + i);
+
+        __m512 approach = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(nx, vx), _mm512_mul_ps(ny, vy)), _mm512_mul_ps(nz, vz));
+        __mmask16 moving = _mm512_mask_cmp_ps_mask(near, approach, zero, _CMP_GT_OQ);
+        if(moving == 0) {
+            continue;
+        }
+
+        __m512 ux = _mm512_sub_ps(_mm512_sub_ps(x, _mm512_mul_ps(dist, nx)), ox);
+        __m512 uy = _mm512_sub_ps(_mm512_sub_ps(y, _mm512_mul_ps(dist, ny)), oy);
+        __m512 uz = _mm512_sub_ps(_mm512_sub_ps(z, _mm512_mul_ps(dist, nz)), oz);
+
+        __m512 right = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(rx, ux), _mm512_mul_ps(ry, uy)), _mm512_mul_ps(rz, uz));
+        __m512 low = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(lx, ux), _mm512_mul_ps(ly, uy)), _mm512_mul_ps(lz, uz));
+
+        __mmask16 over = _mm512_mask_cmp_ps_mask(moving, right, rightLimit, _CMP_LE_OQ);
+        over = _mm512_mask_cmp_ps_mask(over, right, edge, _CMP_GE_OQ);
+        over = _mm512_mask_cmp_ps_mask(over, low, lowLimit, _CMP_LE_OQ);
+        over = _mm512_mask_cmp_ps_mask(over, low, edge, _CMP_GE_OQ);
+        if(over == 0) {
+            continue;
+        }
+
+        _mm512_mask_storeu_ps(p->px + i, over, _mm512_sub_ps(x, vx));
+        _mm512_mask_storeu_ps(p->py + i, over, _mm512_sub_ps(y, vy));
+        _mm512_mask_storeu_ps(p->pz + i, over, _mm512_sub_ps(z, vz));
+
+        _mm512_mask_storeu_ps(p->vx + i, over, _mm512_mul_ps(vx, damp));
+        _mm512_mask_storeu_ps(p->vy + i, over, _mm512_mul_ps(vy, damp));
+        _mm512_mask_storeu_ps(p->vz + i, over, _mm512_mul_ps(vz, damp));
+
+        hit = true;
+    }
+
+    return collidePlane(p, s, i, end) || hit;
+}
+
+static const SimdKernels AVX512_KERNELS = {
+    SIMD_AVX512, "avx512", AVX512_LANES,
+    avx512SpringForce,
+    avx512LengthConstraint,
+    avx512UpdateEuler,
+    avx512UpdateVerlet,
+    avx512CollideSphere,
+    avx512CollidePlane
+};
+
+const SimdKernels* getAVX512Kernels() {
+    return &AVX512_KERNELS;
+}
+
+#else
+
+const SimdKernels* getAVX512Kernels() {
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "SimdKernels.h"
+#include "ParticleStore.h"
+#include "Spring.h"
+
+
+//****************************************************
+// Scalar Kernels
+//      - Wrap the reference passes of SpringTable,
+//        ParticleStore and Colliders
+//****************************************************
+static void scalarUpdateEuler(ParticleStore* p, float timeChange, int begin, int end) {
+    p->updateEuler(timeChange, begin, end);
+}
+
+static void scalarUpdateVerlet(ParticleStore* p, float timeChange, int begin, int end) {
+    p->updateVerlet(timeChange, begin, end);
+}
+
+static const SimdKernels SCALAR_KERNELS = {
+    SIMD_SCALAR, "scalar", 1,
+    applySpringForce,
+    applyLengthConstraint,
+    scalarUpdateEuler,
+    scalarUpdateVerlet,
+    collideSphere,
+    collidePlane
+};
+
+//****************************************************
+// CPU Support
+//      - Asks CPUID whether the instruction set (and
+//        the OS saving its registers) is available
+//****************************************************
+static bool isSupported(SimdISA isa) {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+
+    switch(isa) {
+        case SIMD_SCALAR:
+            return true;
+        case SIMD_SSE:
+            return __builtin_cpu_supports("sse2");
+        case SIMD_AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case SIMD_AVX512:
+            return __builtin_cpu_supports("avx512f");
+        default:
+            return false;
+    }
+#else
+    return isa == SIMD_SCALAR;
+#endif
+}
+
+//****************************************************
+// Kernel Tables
+//****************************************************
+const SimdKernels* getSimdKernels(SimdISA isa) {
+    const SimdKernels* table = NULL;
+
+    switch(isa) {
+        case SIMD_SCALAR:
+            table = &SCALAR_KERNELS;
+            break;
+        case SIMD_SSE:
+            table = getSSEKernels();
+            break;
+        case SIMD_AVX2:
+            table = getAVX2Kernels();
+            break;
+        case SIMD_AVX512:
+            table = getAVX512Kernels();
+            break;
+        default:
+            break;
+    }
+
+    if(table == NULL || !isSupported(isa)) {
+        return NULL;
+    }
+
+    return table;
+}
+
+static const SimdKernels* selectBestKernels() {
+    for(int isa = NUM_SIMD_ISAS - 1; isa > 0; isa--) {
+        const SimdKernels* table = getSimdKernels((SimdISA) isa);
+
+        if(table != NULL) {
+            return table;
+        }
+    }
+
+    return &SCALAR_KERNELS;
+}
+
+const SimdKernels* getBestSimdKernels() {
+    static const SimdKernels* best = selectBestKernels();
+
+    return best;
+}
+
+const SimdKernels* findSimdKernels(const char* name) {
+    for(int isa = 0; isa < NUM_SIMD_ISAS; isa++) {
+        const SimdKernels* table = getSimdKernels((SimdISA) isa);
+
+        if(table != NULL && strcmp(table->name, name) == 0) {
+            return table;
+        }
+    }
+
+    return NULL;
+}
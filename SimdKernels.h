@@ -0,0 +1,65 @@
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include "ParticleStore.h"
+#include "Spring.h"
+#include "Colliders.h"
+
+//****************************************************
+// SIMD Kernels Header Definition
+//      - One table of kernel functions per instruction
+//        set. Each ISA lives in its own file, built
+//        with only that file's -m flags, so a single
+//        binary runs on every x86-64 CPU and picks the
+//        widest table the CPU supports at startup
+//      - The scalar table is the reference: every
+//        other table must agree with it within
+//        tolerance (./cloth_bench -verify)
+//      - Spring kernels update both ends of every
+//        spring at once, so a span must not contain
+//        two springs sharing a particle (i.e. it must
+//        lie within one SpringTable color group)
+//      - Collision kernels test a run of particles
+//        against one shape's Collider and must match
+//        the reference ones exactly, as the shapes'
+//        own collide does
+//****************************************************
+
+enum SimdISA {
+    SIMD_SCALAR = 0,
+    SIMD_SSE = 1,           // SSE2, 4 lanes
+    SIMD_AVX2 = 2,          // AVX2 + FMA, 8 lanes
+    SIMD_AVX512 = 3,        // AVX-512F, 16 lanes
+    NUM_SIMD_ISAS = 4
+};
+
+struct SimdKernels {
+    SimdISA isa;
+    const char* name;
+    int lanes;
+
+    void (*springForce)(ParticleStore* p, SpringSpan springs);
+    void (*lengthConstraint)(ParticleStore* p, SpringSpan springs, float tol);
+
+    void (*updateEuler)(ParticleStore* p, float timeChange, int begin, int end);
+    void (*updateVerlet)(ParticleStore* p, float timeChange, int begin, int end);
+
+    bool (*collideSphere)(ParticleStore* p, const SphereCollider& s, int begin, int end);
+    bool (*collidePlane)(ParticleStore* p, const PlaneCollider& s, int begin, int end);
+};
+
+// Table for isa, NULL if not built in or not supported by this CPU
+const SimdKernels* getSimdKernels(SimdISA isa);
+
+// Widest supported table, chosen once from CPUID
+const SimdKernels* getBestSimdKernels();
+
+// Table named "scalar", "sse", "avx2" or "avx512", NULL if unknown or unsupported
+const SimdKernels* findSimdKernels(const char* name);
+
+// Per ISA tables, NULL when the file was built without its instruction set
+const SimdKernels* getSSEKernels();
+const SimdKernels* getAVX2Kernels();
+const SimdKernels* getAVX512Kernels();
+
+#endif
@@ -0,0 +1,376 @@
+#include "SimdKernels.h"
+#include "ParticleStore.h"
+#include "Spring.h"
+
+//****************************************************
+// SSE Kernels
+//      - 4 springs or particles per instruction
+//      - SSE2 only, the x86-64 baseline, so this is
+//        the fallback on every x86 CPU without AVX2
+//      - SSE2 has no gather or blendv: positions are
+//        loaded lane by lane and blends are and/andnot
+//****************************************************
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+const int SSE_LANES = 4;
+
+static inline __m128 blend(__m128 a, __m128 b, __m128 mask) {
+    return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+//****************************************************
+// Load Block:
+//      - Loads the n <= 4 springs starting at s and
+//        the positions of both ends. Lanes past n
+//        reuse spring s and are never written back.
+//****************************************************
+static inline void loadBlock(const ParticleStore* p, const SpringSpan& springs, int s, int n,
+                             int a[SSE_LANES], int b[SSE_LANES], __m128& rest, __m128& stiff,
+                             __m128& dx, __m128& dy, __m128& dz) {
+    alignas(16) float r[SSE_LANES];
+    alignas(16) float k[SSE_LANES];
+    alignas(16) float x[SSE_LANES];
+    alignas(16) float y[SSE_LANES];
+    alignas(16) float z[SSE_LANES];
+
+    for(int j = 0; j < SSE_LANES; j++) {
+        int src = s + ((j < n) ? j : 0);
+
+        a[j] = springs.i0[src];
+        b[j] = springs.i1[src];
+        r[j] = springs.restLength[src];
+        k[j] = springs.stiffness[src];
+
+        x[j] = p->px[b[j]] - p->px[a[j]];
+        y[j] = p->py[b[j]] - p->py[a[j]];
+        z[j] = p->pz[b[j]] - p->pz[a[j]];
+    }
+
+    rest = _mm_load_ps(r);
+    stiff = _mm_load_ps(k);
+    dx = _mm_load_ps(x);
+    dy = _mm_load_ps(y);
+    dz = _mm_load_ps(z);
+}
+
+//****************************************************
+// Spring Force:
+//      - 1 / length from rsqrt plus one Newton step
+//        instead of a sqrt & divide per spring
+//****************************************************
+static void sseSpringForce(ParticleStore* p, SpringSpan springs) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+
+    int a[SSE_LANES];
+    int b[SSE_LANES];
+    alignas(16) float sx[SSE_LANES];
+    alignas(16) float sy[SSE_LANES];
+    alignas(16) float sz[SSE_LANES];
+
+    for(int s = 0; s < springs.count; s += SSE_LANES) {
+        int n = (springs.count - s < SSE_LANES) ? springs.count - s : SSE_LANES;
+
+        __m128 rest, stiff, dx, dy, dz;
+        loadBlock(p, springs, s, n, a, b, rest, stiff, dx, dy, dz);
+
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+        // inv = r * (1.5 - 0.5 * len2 * r * r)
+        __m128 r = _mm_rsqrt_ps(len2);
+        __m128 inv = _mm_mul_ps(r, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, len2), _mm_mul_ps(r, r))));
+
+        __m128 length = _mm_mul_ps(len2, inv);
+        __m128 magnitude = _mm_mul_ps(stiff, _mm_sub_ps(length, rest));
+        __m128 scale = _mm_mul_ps(inv, magnitude);
+
+        _mm_store_ps(sx, _mm_mul_ps(dx, scale));
+        _mm_store_ps(sy, _mm_mul_ps(dy, scale));
+        _mm_store_ps(sz, _mm_mul_ps(dz, scale));
+
+        for(int j = 0; j < n; j++) {
+            p->fx[a[j]] += sx[j];  p->fy[a[j]] += sy[j];  p->fz[a[j]] += sz[j];
+            p->fx[b[j]] -= sx[j];  p->fy[b[j]] -= sy[j];  p->fz[b[j]] -= sz[j];
+        }
+    }
+}
+
+//****************************************************
+// Length Constraint:
+//      - Full sqrt & divide, only springs outside the
+//        bounds are written back
+//****************************************************
+static void sseLengthConstraint(ParticleStore* p, SpringSpan springs, float tol) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 upperScale = _mm_set1_ps(1.0f + tol);
+    const __m128 lowerScale = _mm_set1_ps(1.0f - tol);
+
+    int a[SSE_LANES];
+    int b[SSE_LANES];
+    alignas(16) float cx[SSE_LANES];
+    alignas(16) float cy[SSE_LANES];
+    alignas(16) float cz[SSE_LANES];
+
+    for(int s = 0; s < springs.count; s += SSE_LANES) {
+        int n = (springs.count - s < SSE_LANES) ? springs.count - s : SSE_LANES;
+
+        __m128 rest, stiff, dx, dy, dz;
+        loadBlock(p, springs, s, n, a, b, rest, stiff, dx, dy, dz);
+
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+
+        __m128 upperBound = _mm_mul_ps(rest, upperScale);
+        __m128 lowerBound = _mm_mul_ps(rest, lowerScale);
+
+        __m128 isLong = _mm_cmpgt_ps(length, upperBound);
+        __m128 isShort = _mm_cmplt_ps(length, lowerBound);
+
+        int active = _mm_movemask_ps(_mm_or_ps(isLong, isShort)) & ((1 << n) - 1);
+        if(active == 0) {
+            continue;
+        }
+
+        __m128 bound = blend(lowerBound, upperBound, isLong);
+        __m128 scale = _mm_sub_ps(one, _mm_div_ps(bound, length));
+
+        _mm_store_ps(cx, _mm_mul_ps(_mm_mul_ps(dx, scale), half));
+        _mm_store_ps(cy, _mm_mul_ps(_mm_mul_ps(dy, scale), half));
+        _mm_store_ps(cz, _mm_mul_ps(_mm_mul_ps(dz, scale), half));
+
+        for(int j = 0; j < n; j++) {
+            if(active & (1 << j)) {
+                p->offsetCorrection(a[j], glm::vec3(cx[j], cy[j], cz[j]));
+                p->offsetCorrection(b[j], -glm::vec3(cx[j], cy[j], cz[j]));
+            }
+        }
+    }
+}
+
+//****************************************************
+// Euler / Verlet:
+//      - Same operations in the same order as
+//        ParticleStore, so results match it exactly;
+//        fixed particles are blended back unchanged
+//****************************************************
+static void sseUpdateEuler(ParticleStore* p, float timeChange, int begin, int end) {
+    const __m128 dt = _mm_set1_ps(timeChange);
+    const __m128 zero = _mm_setzero_ps();
+
+    int i = begin;
+    for(; i + SSE_LANES <= end; i += SSE_LANES) {
+        __m128 w = _mm_loadu_ps(p->invMass + i);
+        __m128 moves = _mm_cmpneq_ps(w, zero);
+
+        float* v[3] = { p->vx + i, p->vy + i, p->vz + i };
+        float* x[3] = { p->px + i, p->py + i, p->pz + i };
+        float* f[3] = { p->fx + i, p->fy + i, p->fz + i };
+
+        for(int c = 0; c < 3; c++) {
+            __m128 vel = _mm_loadu_ps(v[c]);
+            __m128 pos = _mm_loadu_ps(x[c]);
+
+            __m128 newVel = _mm_add_ps(vel, _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(f[c]), w), dt));
+            __m128 newPos = _mm_add_ps(pos, _mm_mul_ps(newVel, dt));
+
+            _mm_storeu_ps(v[c], blend(vel, newVel, moves));
+            _mm_storeu_ps(x[c], blend(pos, newPos, moves));
+            _mm_storeu_ps(f[c], zero);
+        }
+    }
+
+    p->updateEuler(timeChange, i, end);
+}
+
+static void sseUpdateVerlet(ParticleStore* p, float timeChange, int begin, int end) {
+    const __m128 dt2 = _mm_set1_ps(timeChange * timeChange);
+    const __m128 keep = _mm_set1_ps(1.0f - PARTICLE_DAMP_FACTOR);
+    const __m128 zero = _mm_setzero_ps();
+
+    int i = begin;
+    for(; i + SSE_LANES <= end; i += SSE_LANES) {
+        __m128 w = _mm_loadu_ps(p->invMass + i);
+        __m128 moves = _mm_cmpneq_ps(w, zero);
+
+        float* x[3] = { p->px + i, p->py + i, p->pz + i };
+        float* o[3] = { p->ox + i, p->oy + i, p->oz + i };
+        float* f[3] = { p->fx + i, p->fy + i, p->fz + i };
+
+        for(int c = 0; c < 3; c++) {
+            __m128 pos = _mm_loadu_ps(x[c]);
+            __m128 old = _mm_loadu_ps(o[c]);
+
+            __m128 newPos = _mm_add_ps(_mm_add_ps(pos, _mm_mul_ps(_mm_sub_ps(pos, old), keep)),
+                                       _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(f[c]), w), dt2));
+
+            _mm_storeu_ps(x[c], blend(pos, newPos, moves));
+            _mm_storeu_ps(o[c], blend(old, pos, moves));
+            _mm_storeu_ps(f[c], zero);
+        }
+    }
+
+    p->updateVerlet(timeChange, i, end);
+}
+
+//****************************************************
+// Collide Sphere / Plane:
+//      - Same operations in the same order as the
+//        reference kernels in Colliders, so results
+//        match them exactly
+//      - A block with no particle near the shape stops
+//        after the first compare; other lanes are blended back unchanged
+//****************************************************
+static bool sseCollideSphere(ParticleStore* p, const SphereCollider& s, int begin, int end) {
+    const __m128 cx = _mm_set1_ps(s.cx);
+    const __m128 cy = _mm_set1_ps(s.cy);
+    const __m128 cz = _mm_set1_ps(s.cz);
+    const __m128 radius = _mm_set1_ps(s.radius);
+    const __m128 reach2 = _mm_set1_ps(s.reach2);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 damp = _mm_set1_ps(0.4f);
+
+    bool hit = false;
+
+    int i = begin;
+    for(; i + SSE_LANES <= end; i += SSE_LANES) {
+        __m128 x = _mm_loadu_ps(p->px + i);
+        __m128 y = _mm_loadu_ps(p->py + i);
+        __m128 z = _mm_loadu_ps(p->pz + i);
+
+        __m128 tx = _mm_sub_ps(x, cx);
+        __m128 ty = _mm_sub_ps(y, cy);
+        __m128 tz = _mm_sub_ps(z, cz);
+
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz));
+
+        __m128 near = _mm_cmplt_ps(d, reach2);
+        if(_mm_movemask_ps(near) == 0) {
+            continue;
+        }
+
+        __m128 length = _mm_sqrt_ps(d);
+        __m128 inside = _mm_and_ps(near, _mm_cmplt_ps(length, radius));
+        if(_mm_movemask_ps(inside) == 0) {
+            continue;
+        }
+
+        __m128 inv = _mm_div_ps(one, length);
+
+        _mm_storeu_ps(p->px + i, blend(x, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(tx, inv), radius), cx), inside));
+        _mm_storeu_ps(p->py + i, blend(y, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ty, inv), radius), cy), inside));
+        _mm_storeu_ps(p->pz + i, blend(z, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(tz, inv), radius), cz), inside));
+
+        float* v[3] = { p->vx + i, p->vy + i, p->vz + i };
+        for(int c = 0; c < 3; c++) {
+            __m128 vel = _mm_loadu_ps(v[c]);
+            _mm_storeu_ps(v[c], blend(vel, _mm_mul_ps(vel, damp), inside));
+        }
+
+        hit = true;
+    }
+
+    return collideSphere(p, s, i, end) || hit;
+}
+
+static bool sseCollidePlane(ParticleStore* p, const PlaneCollider& s, int begin, int end) {
+    const __m128 ox = _mm_set1_ps(s.ox);
+    const __m128 oy = _mm_set1_ps(s.oy);
+    const __m128 oz = _mm_set1_ps(s.oz);
+    const __m128 nx = _mm_set1_ps(s.nx);
+    const __m128 ny = _mm_set1_ps(s.ny);
+    const __m128 nz = _mm_set1_ps(s.nz);
+    const __m128 rx = _mm_set1_ps(s.rx);
+    const __m128 ry = _mm_set1_ps(s.ry);
+    const __m128 rz = _mm_set1_ps(s.rz);
+    const __m128 lx = _mm_set1_ps(s.lx);
+    const __m128 ly = _mm_set1_ps(s.ly);
+    const __m128 lz = _mm_set1_ps(s.lz);
+    const __m128 rightLimit = _mm_set1_ps(s.rightLimit);
+    const __m128 lowLimit = _mm_set1_ps(s.lowLimit);
+    const __m128 edge = _mm_set1_ps(-PLANE_EDGE_BUFFER);
+    const __m128 contact = _mm_set1_ps(PLANE_CONTACT_DISTANCE);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 damp = _mm_set1_ps(0.4f);
+
+    bool hit = false;
+
+    int i = begin;
+    for(; i + SSE_LANES <= end; i += SSE_LANES) {
+        __m128 x = _mm_loadu_ps(p->px + i);
+        __m128 y = _mm_loadu_ps(p->py + i);
+        __m128 z = _mm_loadu_ps(p->pz + i);
+
+        __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(x, ox), nx),
+                                                   _mm_mul_ps(_mm_sub_ps(y, oy), ny)),
+                                     _mm_mul_ps(_mm_sub_ps(z, oz), nz));
+        __m128 dist = _mm_mul_ps(along, minusOne);
+
+        __m128 near = _mm_cmplt_ps(dist, contact);
+        if(_mm_movemask_ps(near) == 0) {
+            continue;
+        }
+
+        __m128 vx = _mm_loadu_ps(p->vx + i);
+        __m128 vy = _mm_loadu_ps(p->vy + i);
+        __m128 vz = _mm_loadu_ps(p->vz + i);
+
+        __m128 approach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, vx), _mm_mul_ps(ny, vy)), _mm_mul_ps(nz, vz));
+        __m128 moving = _mm_and_ps(near, _mm_cmpgt_ps(approach, zero));
+        if(_mm_movemask_ps(moving) == 0) {
+            continue;
+        }
+
+        __m128 ux = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(dist, nx)), ox);
+        __m128 uy = _mm_sub_ps(_mm_sub_ps(y, _mm_mul_ps(dist, ny)), oy);
+        __m128 uz = _mm_sub_ps(_mm_sub_ps(z, _mm_mul_ps(dist, nz)), oz);
+
+        __m128 right = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, ux), _mm_mul_ps(ry, uy)), _mm_mul_ps(rz, uz));
+        __m128 low = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, ux), _mm_mul_ps(ly, uy)), _mm_mul_ps(lz, uz));
+
+        __m128 over = _mm_and_ps(moving, _mm_and_ps(_mm_cmple_ps(right, rightLimit),
+                                                          _mm_cmpge_ps(right, edge)));
+        over = _mm_and_ps(over, _mm_and_ps(_mm_cmple_ps(low, lowLimit),
+                                                 _mm_cmpge_ps(low, edge)));
+        if(_mm_movemask_ps(over) == 0) {
+            continue;
+        }
+
+        _mm_storeu_ps(p->px + i, blend(x, _mm_sub_ps(x, vx), over));
+        _mm_storeu_ps(p->py + i, blend(y, _mm_sub_ps(y, vy), over));
+        _mm_storeu_ps(p->pz + i, blend(z, _mm_sub_ps(z, vz), over));
+
+        _mm_storeu_ps(p->vx + i, blend(vx, _mm_mul_ps(vx, damp), over));
+        _mm_storeu_ps(p->vy + i, blend(vy, _mm_mul_ps(vy, damp), over));
+        _mm_storeu_ps(p->vz + i, blend(vz, _mm_mul_ps(vz, damp), over));
+
+        hit = true;
+    }
+
+    return collidePlane(p, s, i, end) || hit;
+}
+
+static const SimdKernels SSE_KERNELS = {
+    SIMD_SSE, "sse", SSE_LANES,
+    sseSpringForce,
+    sseLengthConstraint,
+    sseUpdateEuler,
+    sseUpdateVerlet,
+    sseCollideSphere,
+    sseCollidePlane
+};
+
+const SimdKernels* getSSEKernels() {
+    return &SSE_KERNELS;
+}
+
+#else
+
+const SimdKernels* getSSEKernels() {
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,241 @@
+#include <iostream>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Simulation.h"
+#include "Cloth.h"
+#include "Shape.h"
+#include "Plane.h"
+
+//****************************************************
+// Simulation Class - Constants
+//****************************************************
+
+// Floor added beneath every scene
+const float FLOOR_HALF_WIDTH = 5.0f;
+const float FLOOR_HEIGHT = -2.0f;
+
+//****************************************************
+// Simulation Class - Constructors
+//****************************************************
+Simulation::Simulation() {
+    cloth = NULL;
+    pool = new ThreadPool(0);
+    parallelThreshold = 0;
+
+    gravity = true;
+    gravityAccel = glm::vec3(0.0f, -9.81f, 0.0f);
+
+    wind = false;
+    windForce = glm::vec3(0.0f, 0.0f, -1.0f);
+    windField.setMeanForce(windForce);
+    time = 0.0;
+
+    aerodynamics = true;
+    windVelocity = glm::vec3(0.0f);
+}
+
+Simulation::~Simulation() {
+    delete cloth;
+
+    for(int i = 0; i < shapes.size(); i++) {
+        delete shapes[i];
+    }
+
+    delete pool;
+}
+
+//****************************************************
+// Simulation Class - Setup
+//****************************************************
+void Simulation::setCloth(Cloth* c) {
+    if(cloth != c) {
+        delete cloth;
+    }
+
+    cloth = c;
+    time = 0.0;
+    windField.invalidate();
+
+    if(cloth != NULL) {
+        cloth->setThreadPool(pool);
+        cloth->setAerodynamics(aerodynamics);
+        cloth->getAerodynamics().setWindVelocity(windVelocity);
+
+        if(parallelThreshold > 0) {
+            cloth->setParallelThreshold(parallelThreshold);
+        }
+    }
+}
+
+//****************************************************
+// Set Num Threads:
+//      - Replaces the pool, workers are only created
+//        here and never per step
+//****************************************************
+void Simulation::setNumThreads(int numThreads) {
+    delete pool;
+    pool = new ThreadPool(numThreads);
+
+    if(cloth != NULL) {
+        cloth->setThreadPool(pool);
+    }
+}
+
+void Simulation::setParallelThreshold(int numVerts) {
+    parallelThreshold = numVerts;
+
+    if(cloth != NULL && parallelThreshold > 0) {
+        cloth->setParallelThreshold(parallelThreshold);
+    }
+}
+
+void Simulation::addShape(Shape* s) {
+    shapes.push_back(s);
+    wakeCloth();
+}
+
+//****************************************************
+// Add Floor:
+//      - Adds the floor plane every scene rests on
+//****************************************************
+void Simulation::addFloor() {
+    glm::vec3 topLeft(-FLOOR_HALF_WIDTH, FLOOR_HEIGHT, -FLOOR_HALF_WIDTH);
+    glm::vec3 topRight(FLOOR_HALF_WIDTH, FLOOR_HEIGHT, -FLOOR_HALF_WIDTH);
+    glm::vec3 lowRight(FLOOR_HALF_WIDTH, FLOOR_HEIGHT, FLOOR_HALF_WIDTH);
+    glm::vec3 lowLeft(-FLOOR_HALF_WIDTH, FLOOR_HEIGHT, FLOOR_HALF_WIDTH);
+
+    Shape* s = new Plane(topLeft, topRight, lowRight, lowLeft);
+    s->setFloor();
+
+    addShape(s);
+}
+
+//****************************************************
+// Forces:
+//      - A sleeping tile only wakes when a neighbour
+//        moves, so any change to the forces wakes them
+//        all
+//****************************************************
+void Simulation::setGravity(bool on) {
+    if(gravity != on) {
+        wakeCloth();
+    }
+
+    gravity = on;
+}
+
+void Simulation::setWind(bool on) {
+    if(wind != on) {
+        wakeCloth();
+    }
+
+    wind = on;
+}
+
+void Simulation::setWindForce(glm::vec3 force) {
+    if(windForce != force) {
+        wakeCloth();
+    }
+
+    windForce = force;
+    windField.setMeanForce(force);
+}
+
+void Simulation::setAerodynamics(bool on) {
+    if(aerodynamics != on) {
+        wakeCloth();
+    }
+
+    aerodynamics = on;
+
+    if(cloth != NULL) {
+        cloth->setAerodynamics(on);
+    }
+}
+
+void Simulation::setWindVelocity(glm::vec3 velocity) {
+    if(windVelocity != velocity) {
+        wakeCloth();
+    }
+
+    windVelocity = velocity;
+
+    if(cloth != NULL) {
+        cloth->getAerodynamics().setWindVelocity(velocity);
+    }
+}
+
+void Simulation::wakeCloth() {
+    if(cloth != NULL) {
+        cloth->wakeAll();
+    }
+}
+
+//****************************************************
+// Pre Update Calculation:
+//      - Performs all the updates that occur before
+//        doing the time sensitive cloth->update
+//      - The wind field's grid is only re-evaluated
+//        once its refresh period has passed, so the
+//        substeps of a frame share it
+//****************************************************
+void Simulation::preUpdateCalculation() {
+    if(gravity) {
+        cloth->addConstantAccel(gravityAccel);
+    }
+
+    if(wind) {
+        glm::vec3 lo, hi;
+        cloth->getBox(lo, hi);
+
+        windField.update(time, lo, hi, pool);
+        cloth->addWindField(windField);
+    }
+}
+
+//****************************************************
+// Update Collisions:
+//      - Tests the Cloth against every Shape, each
+//        patch of it only against the Shapes the
+//        broad phase finds near it
+//      - A changed list of Shapes rebuilds the broad
+//        phase & the batched colliders, and wakes the
+//        Cloth: a new collider may reach a sleeping tile
+//****************************************************
+void Simulation::updateCollisions() {
+    if(shapes != broadPhaseShapes) {
+        broadPhase.build(shapes);
+        colliders.build(shapes);
+        broadPhaseShapes = shapes;
+        wakeCloth();
+    }
+
+    colliders.setNumParticles(cloth->getParticles()->size());
+
+    cloth->updateContinuousCollision(colliders);
+    cloth->updateCollisions(colliders, broadPhase);
+}
+
+//****************************************************
+// Step:
+//      - Applies external forces, updates the Cloth
+//        for timestep and resolves collisions
+//****************************************************
+void Simulation::step(float timestep) {
+    if(cloth == NULL) {
+        return;
+    }
+
+    preUpdateCalculation();
+
+    cloth->beginContinuousCollision();
+    cloth->update(timestep);
+
+    cloth->updateSelfCollision();
+    updateCollisions();
+
+    cloth->updateSleep(timestep);
+
+    time += timestep;
+}
@@ -0,0 +1,109 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "Cloth.h"
+#include "Shape.h"
+#include "BroadPhase.h"
+#include "Colliders.h"
+#include "ThreadPool.h"
+#include "WindField.h"
+
+//****************************************************
+// Simulation Header Definition
+//      - Owns the Cloth, the Shapes it collides with
+//        and the external forces acting on it
+//      - Advances the physics by a given timestep,
+//        independent of any windowing or timing code
+//****************************************************
+
+class Simulation {
+  private:
+    Cloth* cloth;
+    std::vector<Shape*> shapes;
+
+    // Built over the shapes as they were last step; rebuilt when the list changes
+    BroadPhase broadPhase;
+    ColliderSet colliders;
+    std::vector<Shape*> broadPhaseShapes;
+
+    // Workers shared by every parallel pass of the Cloth
+    ThreadPool* pool;
+
+    // Passed to every Cloth, <= 0 keeps the Cloth's default
+    int parallelThreshold;
+
+    // External Forces
+    bool gravity;
+    glm::vec3 gravityAccel;
+
+    bool wind;
+    glm::vec3 windForce;
+
+    // Turbulence & gusts around windForce, its grid refreshed once a frame
+    WindField windField;
+
+    // Simulated time since the Cloth was set
+    double time;
+
+    // Drag & lift against air moving at windVelocity
+    bool aerodynamics;
+    glm::vec3 windVelocity;
+
+    void wakeCloth();
+
+    // Owns raw pointers, not copyable
+    Simulation(const Simulation&);
+    Simulation& operator=(const Simulation&);
+
+  public:
+    Simulation();
+    ~Simulation();
+
+    // Thread count includes the calling thread, <= 0 uses every hardware thread
+    void setNumThreads(int numThreads);
+    int getNumThreads() { return pool->getNumThreads(); };
+    ThreadPool* getPool() { return pool; };
+
+    // Cloths with fewer vertices than this step on one thread
+    void setParallelThreshold(int numVerts);
+
+    // Takes ownership of the Cloth, deleting the previous one
+    void setCloth(Cloth* c);
+    Cloth* getCloth() { return cloth; };
+
+    // Takes ownership of the Shape, waking any sleeping tiles of the Cloth.
+    // Shapes must not move once added; ones pushed to getShapes() directly are found next step
+    void addShape(Shape* s);
+    void addFloor();
+    std::vector<Shape*>& getShapes() { return shapes; };
+
+    // Forces, changing one wakes any sleeping tiles of the Cloth
+    bool isGravityOn() { return gravity; };
+    void setGravity(bool on);
+    glm::vec3 getGravityAccel() { return gravityAccel; };
+
+    bool isWindOn() { return wind; };
+    void setWind(bool on);
+    glm::vec3 getWindForce() { return windForce; };
+    void setWindForce(glm::vec3 force);
+    WindField& getWindField() { return windField; };
+
+    bool isAerodynamicsOn() { return aerodynamics; };
+    void setAerodynamics(bool on);
+    glm::vec3 getWindVelocity() { return windVelocity; };
+    void setWindVelocity(glm::vec3 velocity);
+
+    // Undoing steps must put the time back too
+    double getTime() { return time; };
+    void setTime(double t) { time = t; };
+
+    // Advances the Cloth by one timestep, then lets its settled tiles sleep
+    void step(float timestep);
+
+    void preUpdateCalculation();
+    void updateCollisions();
+};
+
+#endif
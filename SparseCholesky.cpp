@@ -0,0 +1,412 @@
+#include <math.h>
+#include <vector>
+
+#include "SparseCholesky.h"
+
+
+//****************************************************
+// Sparse Cholesky Class - Constants
+//****************************************************
+
+// Parts this small are not dissected any further
+const int ND_LEAF_SIZE = 16;
+
+//****************************************************
+// Sparse Cholesky - Constructors
+//****************************************************
+SparseCholesky::SparseCholesky() {
+    n = 0;
+    factored = false;
+}
+
+//****************************************************
+// Order:
+//      - Nested dissection: each part is split by one
+//        breadth first level set into the rows before
+//        & after it, which then share no entry. Both
+//        halves are ordered first, the separator last,
+//        so eliminating one half never fills the other.
+//      - A part that is not connected is split into
+//        its components instead
+//****************************************************
+void SparseCholesky::order(const int* rowStart, const int* columns) {
+    ordered.clear();
+    ordered.reserve(n);
+
+    // Rows of a part share a region label; ordered rows are -1
+    std::vector<int> region(n, 0);
+    std::vector<int> level(n, -1);
+
+    std::vector<int> all(n);
+    for(int i = 0; i < n; i++) {
+        all[i] = i;
+    }
+
+    int nextLabel = 1;
+    dissect(all, rowStart, columns, region, level, 0, nextLabel);
+}
+
+// Breadth first search from root within one region; fills queue in visiting order
+static int levelSets(int root, int label, const int* rowStart, const int* columns,
+                     const std::vector<int>& region, std::vector<int>& level, std::vector<int>& queue) {
+    queue.clear();
+    queue.push_back(root);
+    level[root] = 0;
+
+    for(int head = 0; head < queue.size(); head++) {
+        int i = queue[head];
+
+        for(int e = rowStart[i]; e < rowStart[i + 1]; e++) {
+            int j = columns[e];
+
+            if(region[j] == label && level[j] < 0) {
+                level[j] = level[i] + 1;
+                queue.push_back(j);
+            }
+        }
+    }
+
+    return level[queue.back()];
+}
+
+static void clearLevels(const std::vector<int>& queue, std::vector<int>& level) {
+    for(int q = 0; q < queue.size(); q++) {
+        level[queue[q]] = -1;
+    }
+}
+
+void SparseCholesky::dissect(std::vector<int>& part, const int* rowStart, const int* columns,
+                             std::vector<int>& region, std::vector<int>& level, int label, int& nextLabel) {
+    if(part.size() <= ND_LEAF_SIZE) {
+        for(int q = 0; q < part.size(); q++) {
+            ordered.push_back(part[q]);
+            region[part[q]] = -1;
+        }
+        return;
+    }
+
+    // Start from a pseudo peripheral row: the last row reached, until the depth stops growing
+    std::vector<int> queue;
+    int depth = levelSets(part[0], label, rowStart, columns, region, level, queue);
+
+    for(int tries = 0; tries < 4; tries++) {
+        int root = queue.back();
+        clearLevels(queue, level);
+
+        int newDepth = levelSets(root, label, rowStart, columns, region, level, queue);
+        if(newDepth <= depth) {
+            break;
+        }
+        depth = newDepth;
+    }
+
+    if(queue.size() < part.size()) {
+        // Not connected: each component becomes its own part
+        clearLevels(queue, level);
+
+        std::vector<std::vector<int> > components;
+        for(int q = 0; q < part.size(); q++) {
+            int root = part[q];
+            if(region[root] != label) {
+                continue;
+            }
+
+            levelSets(root, label, rowStart, columns, region, level, queue);
+            clearLevels(queue, level);
+
+            int componentLabel = nextLabel++;
+            for(int c = 0; c < queue.size(); c++) {
+                region[queue[c]] = componentLabel;
+            }
+
+            components.push_back(queue);
+        }
+
+        part.clear();
+        for(int c = 0; c < components.size(); c++) {
+            dissect(components[c], rowStart, columns, region, level, region[components[c][0]], nextLabel);
+        }
+        return;
+    }
+
+    // Separator: the level holding the middle row
+    int middle = level[queue[queue.size() / 2]];
+
+    std::vector<int> before;
+    std::vector<int> after;
+    std::vector<int> separator;
+
+    int beforeLabel = nextLabel++;
+    int afterLabel = nextLabel++;
+
+    for(int q = 0; q < queue.size(); q++) {
+        int i = queue[q];
+
+        if(level[i] < middle) {
+            before.push_back(i);
+            region[i] = beforeLabel;
+        } else if(level[i] > middle) {
+            after.push_back(i);
+            region[i] = afterLabel;
+        } else {
+            separator.push_back(i);
+            region[i] = -1;
+        }
+    }
+
+    clearLevels(queue, level);
+    part.clear();
+
+    dissect(before, rowStart, columns, region, level, beforeLabel, nextLabel);
+    dissect(after, rowStart, columns, region, level, afterLabel, nextLabel);
+
+    for(int q = 0; q < separator.size(); q++) {
+        ordered.push_back(separator[q]);
+    }
+}
+
+//****************************************************
+// Analyze:
+//      - Orders the rows, keeps the upper triangle of
+//        P A P^T, then finds the elimination tree and
+//        every column count of L
+//****************************************************
+void SparseCholesky::analyze(int rows, const int* rowStart, const int* columns) {
+    n = rows;
+    factored = false;
+
+    order(rowStart, columns);
+
+    position.resize(n);
+    for(int k = 0; k < n; k++) {
+        position[ordered[k]] = k;
+    }
+
+    // Upper triangle by column
+    upperStart.assign(n + 1, 0);
+    for(int i = 0; i < n; i++) {
+        for(int e = rowStart[i]; e < rowStart[i + 1]; e++) {
+            if(position[i] <= position[columns[e]]) {
+                upperStart[position[columns[e]] + 1]++;
+            }
+        }
+    }
+
+    for(int k = 0; k < n; k++) {
+        upperStart[k + 1] += upperStart[k];
+    }
+
+    upperRow.resize(upperStart[n]);
+    upperSource.resize(upperStart[n]);
+    fill.assign(upperStart.begin(), upperStart.end() - 1);
+
+    for(int i = 0; i < n; i++) {
+        for(int e = rowStart[i]; e < rowStart[i + 1]; e++) {
+            if(position[i] <= position[columns[e]]) {
+                int slot = fill[position[columns[e]]]++;
+                upperRow[slot] = position[i];
+                upperSource[slot] = e;
+            }
+        }
+    }
+
+    // Elimination tree, with path compressed ancestors
+    parent.assign(n, -1);
+    std::vector<int> ancestor(n, -1);
+
+    for(int k = 0; k < n; k++) {
+        for(int slot = upperStart[k]; slot < upperStart[k + 1]; slot++) {
+            int i = upperRow[slot];
+
+            while(i != -1 && i < k) {
+                int next = ancestor[i];
+                ancestor[i] = k;
+                if(next == -1) {
+                    parent[i] = k;
+                }
+                i = next;
+            }
+        }
+    }
+
+    // Column counts of L: row k of L holds the rows reached from column k
+    work.assign(n, 0.0);
+    pattern.resize(n);
+    stack.resize(n);
+    flag.assign(n, -1);
+
+    std::vector<int> counts(n, 1);
+    for(int k = 0; k < n; k++) {
+        for(int t = reach(k); t < n; t++) {
+            counts[pattern[t]]++;
+        }
+    }
+
+    factorStart.assign(n + 1, 0);
+    for(int k = 0; k < n; k++) {
+        factorStart[k + 1] = factorStart[k] + counts[k];
+    }
+
+    factorRow.resize(factorStart[n]);
+    factorValue.resize(factorStart[n]);
+}
+
+//****************************************************
+// Reach:
+//      - Walks the elimination tree up from every row
+//        of column k's upper entries, stopping at rows
+//        already seen; the paths, in reverse, are a
+//        valid order to eliminate row k's entries in
+//****************************************************
+int SparseCholesky::reach(int k) {
+    int top = n;
+    flag[k] = k;
+
+    for(int slot = upperStart[k]; slot < upperStart[k + 1]; slot++) {
+        int i = upperRow[slot];
+        int length = 0;
+
+        for(; flag[i] != k; i = parent[i]) {
+            stack[length++] = i;
+            flag[i] = k;
+        }
+
+        while(length > 0) {
+            pattern[--top] = stack[--length];
+        }
+    }
+
+    return top;
+}
+
+//****************************************************
+// Factor:
+//      - Up-looking: row k of L solves
+//          L[0:k, 0:k] l_k = A[0:k, k]
+//        sparsely over the rows reach(k) finds, then
+//          L_kk = sqrt(A_kk - l_k . l_k)
+//****************************************************
+bool SparseCholesky::factor(const double* values) {
+    factored = false;
+
+    for(int k = 0; k < n; k++) {
+        fill[k] = factorStart[k];
+        flag[k] = -1;
+    }
+
+    for(int k = 0; k < n; k++) {
+        int top = reach(k);
+
+        for(int slot = upperStart[k]; slot < upperStart[k + 1]; slot++) {
+            work[upperRow[slot]] += values[upperSource[slot]];
+        }
+
+        double diagonal = work[k];
+        work[k] = 0.0;
+
+        for(int t = top; t < n; t++) {
+            int i = pattern[t];
+
+            double lki = work[i] / factorValue[factorStart[i]];
+            work[i] = 0.0;
+
+            for(int p = factorStart[i] + 1; p < fill[i]; p++) {
+                work[factorRow[p]] -= factorValue[p] * lki;
+            }
+
+            diagonal -= lki * lki;
+
+            int p = fill[i]++;
+            factorRow[p] = k;
+            factorValue[p] = lki;
+        }
+
+        if(diagonal <= 0.0) {
+            for(int i = 0; i < n; i++) {
+                work[i] = 0.0;
+            }
+            return false;
+        }
+
+        int p = fill[k]++;
+        factorRow[p] = k;
+        factorValue[p] = sqrt(diagonal);
+    }
+
+    factored = true;
+    return true;
+}
+
+//****************************************************
+// Solve:
+//      - Permute, L y = P b, L^T z = y, permute back,
+//        every right hand side in the same pass
+//      - The substitutions are templated on the count,
+//        1 to 4, so each y_j stays in registers
+//****************************************************
+template<int COUNT>
+static void substitute(int n, const int* start, const int* row, const double* value, double* y) {
+    for(int j = 0; j < n; j++) {
+        double* yj = y + j * COUNT;
+        double inverse = 1.0 / value[start[j]];
+
+        double sum[COUNT];
+        for(int c = 0; c < COUNT; c++) {
+            sum[c] = yj[c] * inverse;
+            yj[c] = sum[c];
+        }
+
+        for(int p = start[j] + 1; p < start[j + 1]; p++) {
+            double* yi = y + row[p] * COUNT;
+            for(int c = 0; c < COUNT; c++) {
+                yi[c] -= value[p] * sum[c];
+            }
+        }
+    }
+
+    for(int j = n - 1; j >= 0; j--) {
+        double* yj = y + j * COUNT;
+
+        double sum[COUNT];
+        for(int c = 0; c < COUNT; c++) {
+            sum[c] = yj[c];
+        }
+
+        for(int p = start[j] + 1; p < start[j + 1]; p++) {
+            const double* yi = y + row[p] * COUNT;
+            for(int c = 0; c < COUNT; c++) {
+                sum[c] -= value[p] * yi[c];
+            }
+        }
+
+        double inverse = 1.0 / value[start[j]];
+        for(int c = 0; c < COUNT; c++) {
+            yj[c] = sum[c] * inverse;
+        }
+    }
+}
+
+void SparseCholesky::solve(double* x, int count, double* scratch) const {
+    for(int k = 0; k < n; k++) {
+        for(int c = 0; c < count; c++) {
+            scratch[k * count + c] = x[ordered[k] * count + c];
+        }
+    }
+
+    const int* start = factorStart.data();
+    const int* row = factorRow.data();
+    const double* value = factorValue.data();
+
+    switch(count) {
+        case 1: substitute<1>(n, start, row, value, scratch); break;
+        case 2: substitute<2>(n, start, row, value, scratch); break;
+        case 3: substitute<3>(n, start, row, value, scratch); break;
+        case 4: substitute<4>(n, start, row, value, scratch); break;
+    }
+
+    for(int k = 0; k < n; k++) {
+        for(int c = 0; c < count; c++) {
+            x[ordered[k] * count + c] = scratch[k * count + c];
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef SPARSECHOLESKY_H
+#define SPARSECHOLESKY_H
+
+#include <vector>
+
+//****************************************************
+// Sparse Cholesky Header Definition
+//      - Factors a symmetric positive definite n x n
+//        matrix as P A P^T = L L^T and solves with it
+//      - analyze works on the pattern alone: a nested
+//        dissection ordering P found from breadth
+//        first level sets, the elimination tree and
+//        the pattern of L. It runs once per pattern.
+//      - factor refills L's values (up-looking, one
+//        row of L at a time) & may run again whenever
+//        the values change but the pattern does not
+//      - solve only reads the factor, so it may run on
+//        several threads at once; right hand sides
+//        solved together share each pass over L
+//****************************************************
+
+class SparseCholesky {
+  private:
+    int n;
+
+    // P: ordered[k] = row placed k-th, position[row] = k
+    std::vector<int> ordered;
+    std::vector<int> position;
+
+    // Upper triangle of P A P^T by column, with the index of each entry in the caller's values
+    std::vector<int> upperStart;
+    std::vector<int> upperRow;
+    std::vector<int> upperSource;
+
+    std::vector<int> parent;
+
+    // L by column, diagonal first
+    std::vector<int> factorStart;
+    std::vector<int> factorRow;
+    std::vector<double> factorValue;
+
+    bool factored;
+
+    // Factor Workspace
+    std::vector<double> work;
+    std::vector<int> fill;
+    std::vector<int> pattern;
+    std::vector<int> stack;
+    std::vector<int> flag;
+
+    void order(const int* rowStart, const int* columns);
+    void dissect(std::vector<int>& part, const int* rowStart, const int* columns,
+                 std::vector<int>& region, std::vector<int>& level, int label, int& nextLabel);
+
+    // Rows of L's row k, left in pattern[top, n); returns top
+    int reach(int k);
+
+  public:
+    SparseCholesky();
+
+    // Pattern of A as CSR over both triangles, the diagonal included
+    void analyze(int rows, const int* rowStart, const int* columns);
+
+    // values[e] belongs to entry e of the analyzed CSR. False if A is not positive definite
+    bool factor(const double* values);
+
+    // x = A^-1 x in place for 1 to 4 interleaved right hand sides (x[row * count + c]);
+    // scratch must hold count * getSize() doubles
+    void solve(double* x, int count, double* scratch) const;
+
+    int getSize() const { return n; };
+    bool isFactored() const { return factored; };
+    int getFactorNonZeros() const { return (int) factorRow.size(); };
+};
+
+#endif
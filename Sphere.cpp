@@ -18,29 +18,30 @@ Sphere::Sphere(glm::vec3 cent, float rad) {
     radius = rad;
 }
 
-bool Sphere::collide(Vertex* v) {
-    
-    glm::vec3 temp = v->getPos() - center;
-    float n = glm::length(temp);
-
-    if(n < this->radius) {
-        // Update Vertex Position & Velocity
-        
-        glm::vec3 newPos = glm::normalize(temp) * radius + center;
-        glm::vec3 newVel(0.4f, 0.4f, 0.4f);
-
-        v->updateAfterCollide(newPos, newVel);
-
-        return true;
-    }
-    
-    return false;
+bool Sphere::collide(ParticleStore* p, int i) {
+    SphereCollider s = getCollider();
+    return collideSphere(p, s, i, i + 1);
 }
 
+SphereCollider Sphere::getCollider() {
+    SphereCollider s;
+    s.cx = center.x;
+    s.cy = center.y;
+    s.cz = center.z;
+    s.radius = radius;
+    s.reach2 = radius * radius * SPHERE_REACH_SLACK;
 
+    return s;
+}
+
+// Only particles inside the sphere collide
+void Sphere::getBounds(glm::vec3& lo, glm::vec3& hi) {
+    lo = center - glm::vec3(radius);
+    hi = center + glm::vec3(radius);
+}
 
-glm::vec3 Sphere::getNormal(Vertex* v) {
-    glm::vec3 returnVec = v->getPos() - center;
+glm::vec3 Sphere::getNormal(glm::vec3 point) {
+    glm::vec3 returnVec = point - center;
     return glm::normalize(returnVec);
 }
 
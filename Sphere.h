@@ -3,7 +3,8 @@
 
 #include "glm/glm.hpp"
 #include "Shape.h"
-#include "Vertex.h"
+#include "ParticleStore.h"
+#include "Colliders.h"
 
 //****************************************************
 // Sphere Header Definition
@@ -20,9 +21,11 @@ class Sphere : public Shape {
     Sphere(glm::vec3 cent, float rad);
 
     // Shape - Abstract Functions
-    bool collide(Vertex* v); 
-    glm::vec3 getNormal(Vertex* v);
+    bool collide(ParticleStore* p, int i); 
+    glm::vec3 getNormal(glm::vec3 point);
     std::string getType() { return "SPHERE"; };
+    void getBounds(glm::vec3& lo, glm::vec3& hi);
+    SphereCollider getCollider();
     float getRadius() { return radius; };
     glm::vec3 getCenter() { return center; };
     glm::vec3 getNormal() { return glm::vec3(1.0f, 0.0f, 0.0f); };
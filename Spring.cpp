@@ -1,167 +1,351 @@
 #include <iostream>
 #include <math.h>
 #include <vector>
+#include <algorithm>
 #include "glm/glm.hpp"
 
 #include "Spring.h"
-#include "Vertex.h"
+#include "ParticleStore.h"
 
 
 //****************************************************
 // Spring Class - Constants
 //****************************************************
-const float UNIT_SPRING = 100.0f;
-int stretchCount = 0;
-int shearCount = 0;
-int bendCount = 0;
-
-// Class Variables
-int stretchConst;
-int shearConst;
-int bendConst;
+extern const float UNIT_SPRING = 100.0f;
 
 // Distance Constraint Variables
 float tolerance = 0.01f;
 
+const char* SPRING_TYPE_NAMES[NUM_SPRING_TYPES] = { "STRETCH", "SHEAR", "BEND" };
+
 //****************************************************
-// Spring Class - Constructors
+// Spring Table - Constructors
 //****************************************************
-Spring::Spring(Vertex* v1, Vertex* v2, std::string t) {
-	vertex1 = v1;
-	vertex2 = v2;
+SpringTable::SpringTable() {
+	for(int t = 0; t <= NUM_SPRING_TYPES; t++) {
+		familyStart[t] = 0;
+	}
 
-	type = t;
+	for(int t = 0; t < NUM_SPRING_TYPES; t++) {
+		familyCursor[t] = 0;
+	}
 
-	restDistance = glm::length(v2->getPos() - v1->getPos());
+	groupStart.push_back(0);
+}
 
-	// Value Increases with smaller size
-	springConstant = UNIT_SPRING / restDistance;
+//****************************************************
+// Allocate:
+//		- Sizes every array once for the total number
+//		  of springs, so building the table never
+//		  reallocates
+//****************************************************
+void SpringTable::allocate(const int counts[NUM_SPRING_TYPES]) {
+	familyStart[0] = 0;
 
-/*
-	if(t == "STRETCH") {
-		springConstant = 2450;
+	for(int t = 0; t < NUM_SPRING_TYPES; t++) {
+		familyStart[t + 1] = familyStart[t] + counts[t];
+		familyCursor[t] = familyStart[t];
 	}
 
+	int total = familyStart[NUM_SPRING_TYPES];
 
-	if(t == "SHEAR") {
-		springConstant = 1732;
-	}
+	i0.resize(total);
+	i1.resize(total);
+	restLength.resize(total);
+	stiffness.resize(total);
+	colors.assign(total, -1);
+
+	groupStart.assign(1, 0);
+}
 
+//****************************************************
+// Add Spring:
+//		- Writes the next slot of the family, using the
+//		  current distance as the rest length
+//		- Returns the slot, or -1 if the family is full
+//****************************************************
+int SpringTable::addSpring(ParticleStore* p, SpringType type, int v1, int v2, int color) {
+	int slot = familyCursor[type];
 
-	if(t == "BEND") {
-		springConstant = 612;
+	if(slot >= familyStart[type + 1]) {
+		std::cerr << "SpringTable: Too many " << SPRING_TYPE_NAMES[type] << " springs" << std::endl;
+		return -1;
 	}
-*/
 
+	familyCursor[type]++;
 
-	// Sets the Constants to Class Variables for Display
-	if(t == "STRETCH" && stretchCount == 0) {
-		stretchConst = springConstant;
-		stretchCount++;
+	float rest = glm::length(p->getPos(v2) - p->getPos(v1));
+
+	i0[slot] = v1;
+	i1[slot] = v2;
+	restLength[slot] = rest;
+
+	// Value Increases with smaller size
+	stiffness[slot] = UNIT_SPRING / rest;
+
+	colors[slot] = color;
+
+	return slot;
+}
+
+//****************************************************
+// Color Greedy:
+//		- Gives each uncolored spring in [begin, end)
+//		  the lowest color neither endpoint uses yet
+//		- Used for meshes without a known coloring
+//****************************************************
+void SpringTable::colorGreedy(int begin, int end) {
+	int maxIndex = 0;
+	for(int s = begin; s < end; s++) {
+		maxIndex = std::max(maxIndex, std::max(i0[s], i1[s]));
 	}
 
-	if(t == "SHEAR" && shearCount == 0) {
-		shearConst = springConstant;
-		shearCount++;
+	// Bit c set if the particle already has a spring of color c
+	std::vector<unsigned long long> used(maxIndex + 1, 0ULL);
+
+	for(int s = begin; s < end; s++) {
+		if(colors[s] >= 0 && colors[s] < 64) {
+			used[i0[s]] |= 1ULL << colors[s];
+			used[i1[s]] |= 1ULL << colors[s];
+		}
 	}
 
-	if(t == "BEND" && bendCount == 0) {
+	for(int s = begin; s < end; s++) {
+		if(colors[s] >= 0) {
+			continue;
+		}
+
+		unsigned long long taken = used[i0[s]] | used[i1[s]];
 
+		int c = 0;
+		while(c < 63 && (taken & (1ULL << c))) {
+			c++;
+		}
 
-		bendConst = springConstant;
-		bendCount++;
+		colors[s] = c;
+		used[i0[s]] |= 1ULL << c;
+		used[i1[s]] |= 1ULL << c;
 	}
 }
 
-Spring::Spring(Vertex* v1, Vertex* v2, float kconstant, std::string t) {
-	vertex1 = v1;
-	vertex2 = v2;
+//****************************************************
+// Build Color Groups:
+//		- Stable counting sort of each family by color,
+//		  keeping the order springs were added within
+//		  a color
+//		- Every pass walks groups in order, so the
+//		  serial and parallel paths add forces to each
+//		  particle in the same order
+//****************************************************
+void SpringTable::buildColorGroups() {
+	groupStart.assign(1, 0);
+
+	std::vector<int> newI0(i0.size());
+	std::vector<int> newI1(i1.size());
+	std::vector<float> newRest(restLength.size());
+	std::vector<float> newStiffness(stiffness.size());
+
+	for(int t = 0; t < NUM_SPRING_TYPES; t++) {
+		int begin = familyStart[t];
+		int end = familyStart[t + 1];
+
+		colorGreedy(begin, end);
+
+		int numColors = 0;
+		for(int s = begin; s < end; s++) {
+			numColors = std::max(numColors, colors[s] + 1);
+		}
+
+		std::vector<int> offsets(numColors + 1, 0);
+		for(int s = begin; s < end; s++) {
+			offsets[colors[s] + 1]++;
+		}
+
+		for(int c = 0; c < numColors; c++) {
+			offsets[c + 1] += offsets[c];
+		}
+
+		for(int c = 0; c < numColors; c++) {
+			if(offsets[c + 1] > offsets[c]) {
+				groupStart.push_back(begin + offsets[c + 1]);
+			}
+		}
+
+		for(int s = begin; s < end; s++) {
+			int dest = begin + offsets[colors[s]]++;
+
+			newI0[dest] = i0[s];
+			newI1[dest] = i1[s];
+			newRest[dest] = restLength[s];
+			newStiffness[dest] = stiffness[s];
+		}
+	}
 
-	restDistance = glm::length(v2-v1);
-	springConstant = kconstant;
+	i0.swap(newI0);
+	i1.swap(newI1);
+	restLength.swap(newRest);
+	stiffness.swap(newStiffness);
 
-	type = t;
+	// Colors are only needed while building
+	std::vector<int>().swap(colors);
 }
 
 //****************************************************
-// Spring Class - Magnitude of Force due to Spring
+// Sort Groups By Key:
+//		- Stable counting sort of each color group by
+//		  the key of each spring's first particle, so
+//		  a caller can walk one key's springs of a
+//		  group as a single range
+//		- A group's springs share no particle, so the
+//		  order within it changes no result
 //****************************************************
-glm::vec3 Spring::getForce() {
-	glm::vec3 v1 = vertex1->getPos();
-	glm::vec3 v2 = vertex2->getPos();
-
-	float displacement = glm::length(v2-v1);
-	glm::vec3 springVec = vertex1->vectorTo(vertex2);
+void SpringTable::sortGroupsByKey(const std::vector<int>& particleKey, int numKeys, std::vector<int>& keyStart) {
+	int numGroups = getNumGroups();
+	keyStart.assign(numGroups * (numKeys + 1), 0);
+
+	std::vector<int> newI0(i0.size());
+	std::vector<int> newI1(i1.size());
+	std::vector<float> newRest(restLength.size());
+	std::vector<float> newStiffness(stiffness.size());
+
+	for(int g = 0; g < numGroups; g++) {
+		int begin = groupStart[g];
+		int end = groupStart[g + 1];
+		int* offsets = keyStart.data() + g * (numKeys + 1);
+
+		for(int s = begin; s < end; s++) {
+			offsets[particleKey[i0[s]] + 1]++;
+		}
+
+		offsets[0] = begin;
+		for(int k = 0; k < numKeys; k++) {
+			offsets[k + 1] += offsets[k];
+		}
+
+		// offsets[k] walks key k's range, then is moved back to its start
+		for(int s = begin; s < end; s++) {
+			int dest = offsets[particleKey[i0[s]]]++;
+
+			newI0[dest] = i0[s];
+			newI1[dest] = i1[s];
+			newRest[dest] = restLength[s];
+			newStiffness[dest] = stiffness[s];
+		}
+
+		for(int k = numKeys; k > 0; k--) {
+			offsets[k] = offsets[k - 1];
+		}
+		offsets[0] = begin;
+	}
 
-	return springVec * springConstant * displacement;
+	i0.swap(newI0);
+	i1.swap(newI1);
+	restLength.swap(newRest);
+	stiffness.swap(newStiffness);
 }
 
 //****************************************************
-// Apply Force:
-//		For the given Position of the vertices it
-//		Adds the new forces due to springs to the
-//		Vertices
+// Spans:
+//		- Non-owning views into the table
 //****************************************************
-void Spring::applyForce() {
-	glm::vec3 v1 = vertex1->getPos();
-	glm::vec3 v2 = vertex2->getPos();
-
-	glm::vec3 springVec = v2-v1;
+SpringSpan SpringTable::getSpan(SpringType type) const {
+	return getSpan(familyStart[type], familyStart[type + 1]);
+}
 
-	float displacement = glm::length(springVec) - restDistance;
-	float magnitude = springConstant * displacement;
+SpringSpan SpringTable::getSpan(int begin, int end) const {
+	SpringSpan span;
 
-	glm::vec3 dir = glm::normalize(springVec);
+	span.i0 = i0.empty() ? NULL : i0.data() + begin;
+	span.i1 = i1.empty() ? NULL : i1.data() + begin;
+	span.restLength = restLength.empty() ? NULL : restLength.data() + begin;
+	span.stiffness = stiffness.empty() ? NULL : stiffness.data() + begin;
+	span.count = end - begin;
 
-	vertex1->addForce(dir * magnitude);
-	vertex2->addForce(dir * magnitude * (-1.0f));
+	return span;
+}
 
+//****************************************************
+// Apply Force:
+//		For the given Position of the particles it
+//		Adds the new forces due to springs [begin, end)
+//****************************************************
+void SpringTable::applyForce(ParticleStore* p, int begin, int end) const {
+	applySpringForce(p, getSpan(begin, end));
 }
 
-void Spring::applyCorrection() {
-	glm::vec3 v1 = vertex1->getPos();
-	glm::vec3 v2 = vertex2->getPos();
+void SpringTable::applyCorrection(ParticleStore* p, int begin, int end) const {
+	for(int s = begin; s < end; s++) {
+		int a = i0[s];
+		int b = i1[s];
 
-	glm::vec3 springVec = v2-v1;
+		glm::vec3 springVec = p->getPos(b) - p->getPos(a);
 
-	float length = glm::length(springVec);
+		float length = glm::length(springVec);
 
-	glm::vec3 correction = springVec * (1.0f - restDistance/length)*0.5f;
+		glm::vec3 correction = springVec * (1.0f - restLength[s]/length)*0.5f;
 
-	vertex1->offsetCorrection(correction);
-	vertex2->offsetCorrection(-correction);
+		p->offsetCorrection(a, correction);
+		p->offsetCorrection(b, -correction);
+	}
+}
 
+void SpringTable::lengthConstraint(ParticleStore* p, int begin, int end) const {
+	applyLengthConstraint(p, getSpan(begin, end), tolerance);
 }
 
+//****************************************************
+// Span Kernels:
+//		- Scalar reference for the SIMD kernels, which
+//		  must agree with these within tolerance
+//****************************************************
+void applySpringForce(ParticleStore* p, SpringSpan springs) {
+	for(int s = 0; s < springs.count; s++) {
+		int a = springs.i0[s];
+		int b = springs.i1[s];
 
-void Spring::lengthConstraint() {
+		glm::vec3 springVec = p->getPos(b) - p->getPos(a);
 
-	glm::vec3 v1 = vertex1->getPos();
-	glm::vec3 v2 = vertex2->getPos();
+		float displacement = glm::length(springVec) - springs.restLength[s];
+		float magnitude = springs.stiffness[s] * displacement;
 
-	glm::vec3 springVec = v2-v1;
+		glm::vec3 dir = glm::normalize(springVec);
 
-	float length = glm::length(springVec);
+		p->addForce(a, dir * magnitude);
+		p->addForce(b, dir * magnitude * (-1.0f));
+	}
+}
 
-	float upperBound = restDistance * (1.0f + tolerance);
-	float lowerBound = restDistance * (1.0f - tolerance);
+//****************************************************
+// Length Constraint:
+//		- Projects springs stretched or compressed by
+//		  more than tol back onto the bound
+//****************************************************
+void applyLengthConstraint(ParticleStore* p, SpringSpan springs, float tol) {
+	for(int s = 0; s < springs.count; s++) {
+		int a = springs.i0[s];
+		int b = springs.i1[s];
 
-	// If Longer Than Tolerance
-	if(length > upperBound) {
+		glm::vec3 springVec = p->getPos(b) - p->getPos(a);
 
-		glm::vec3 correction = springVec * (1.0f - upperBound/length)*0.5f;
+		float length = glm::length(springVec);
 
-		vertex1->offsetCorrection(correction);
-		vertex2->offsetCorrection(-correction);
+		float upperBound = springs.restLength[s] * (1.0f + tol);
+		float lowerBound = springs.restLength[s] * (1.0f - tol);
 
-	}
+		// If Longer Than Tolerance
+		if(length > upperBound) {
+			glm::vec3 correction = springVec * (1.0f - upperBound/length)*0.5f;
 
-	if(length < lowerBound) {
-		glm::vec3 correction = springVec * (1.0f - lowerBound/length)*0.5f;
+			p->offsetCorrection(a, correction);
+			p->offsetCorrection(b, -correction);
+		}
 
-		vertex1->offsetCorrection(correction);
-		vertex2->offsetCorrection(-correction);
+		if(length < lowerBound) {
+			glm::vec3 correction = springVec * (1.0f - lowerBound/length)*0.5f;
 
+			p->offsetCorrection(a, correction);
+			p->offsetCorrection(b, -correction);
+		}
 	}
 }
 
@@ -170,11 +354,19 @@ void Spring::lengthConstraint() {
 // Print Stats
 //      - Prints Spring Stats:
 //****************************************************
-void Spring::printStats() {
+void SpringTable::printStats() const {
     std::cout << "---------------------------------------" << std::endl;
     std::cout << " Spring Information: " << std::endl;
-    std::cout << "---------------------------------------" << std::endl;    
-    std::cout << "Spring constant STRETCH: " << stretchConst << std::endl;
-    std::cout << "Spring constant   SHEAR: " << shearConst << std::endl;
-    std::cout << "Spring constant    BEND: " << bendConst << std::endl;
+    std::cout << "---------------------------------------" << std::endl;
+
+    for(int t = 0; t < NUM_SPRING_TYPES; t++) {
+        float k = 0.0f;
+        if(getCount((SpringType) t) > 0) {
+            k = stiffness[familyStart[t]];
+        }
+
+        std::cout << "Spring constant " << SPRING_TYPE_NAMES[t] << ": " << k << std::endl;
+    }
+
+    std::cout << "Spring memory: " << size() * (2 * sizeof(int) + 2 * sizeof(float)) << " bytes" << std::endl;
 }
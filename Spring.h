@@ -1,49 +1,119 @@
 #ifndef SPRING_H
 #define SPRING_H
 
+#include <vector>
 #include "glm/glm.hpp"
-#include "Vertex.h"
+#include "ParticleStore.h"
 
 //****************************************************
 // Spring Header Definition
+//      - Springs are stored in a SpringTable: parallel
+//        arrays of (i0, i1, restLength, stiffness),
+//        grouped by family.
+//      - Within a family springs are sorted into
+//        color groups: no two springs of a group share
+//        a particle, so a group can be processed in
+//        parallel without atomics.
 //****************************************************
 
-class Spring {
+// Stiffness of a spring of rest length 1, scaled by 1 / rest length
+extern const float UNIT_SPRING;
+
+// Fraction a spring may stretch or compress before lengthConstraint corrects it
+extern float tolerance;
+
+// Spring Families
+enum SpringType {
+    STRETCH = 0,
+    SHEAR = 1,
+    BEND = 2,
+    NUM_SPRING_TYPES = 3
+};
+
+//****************************************************
+// Spring Span
+//      - Non-owning view over a contiguous range of
+//        the SpringTable. Invalidated if the table
+//        is rebuilt.
+//****************************************************
+struct SpringSpan {
+    const int* i0;
+    const int* i1;
+    const float* restLength;
+    const float* stiffness;
+    int count;
+
+    int size() const { return count; };
+
+    int getV1(int s) const { return i0[s]; };
+    int getV2(int s) const { return i1[s]; };
+};
+
+// Scalar span kernels, used by SpringTable and as the SIMD reference
+void applySpringForce(ParticleStore* p, SpringSpan springs);
+void applyLengthConstraint(ParticleStore* p, SpringSpan springs, float tol);
+
+class SpringTable {
   private:
-  	Vertex* vertex1;
-  	Vertex* vertex2;
+    std::vector<int> i0;
+    std::vector<int> i1;
+    std::vector<float> restLength;
+    std::vector<float> stiffness;
+
+    // Family t occupies [familyStart[t], familyStart[t+1])
+    int familyStart[NUM_SPRING_TYPES + 1];
+
+    // Next free slot of each family while building
+    int familyCursor[NUM_SPRING_TYPES];
 
-  	// Spring Information
-  	float springConstant;
-  	float restDistance;
+    // Color of each spring while building, -1 = not given
+    std::vector<int> colors;
 
-  	// Type, "STRETCH", "SHEAR", "BEND"
-  	std::string type;
+    // Group g occupies [groupStart[g], groupStart[g+1])
+    std::vector<int> groupStart;
+
+    void colorGreedy(int begin, int end);
 
   public:
-  	// Constructors
-    Spring(Vertex* v1, Vertex* v2, std::string t);
-  	Spring(Vertex* v1, Vertex* v2, float kconstant, std::string t);
+    SpringTable();
 
-  	// Getters
-  	std::string getType() { return type; };
+    // Sizes the table for the given number of springs per family
+    void allocate(const int counts[NUM_SPRING_TYPES]);
 
-    Vertex* getV1() { return vertex1; };
-    Vertex* getV2() { return vertex2; };
+    // Adds a Spring at rest at the particles' current positions.
+    // Springs of one family with the same color must not share a particle.
+    int addSpring(ParticleStore* p, SpringType type, int v1, int v2, int color = -1);
 
-    glm::vec3 getPos1() { return vertex1->getPos(); };
-    glm::vec3 getPos2() { return vertex2->getPos(); };
+    // Sorts each family into color groups. Springs added without a
+    // color are colored greedily. Must be called once all springs are added.
+    void buildColorGroups();
 
-  	// Force Due to Spring:
-  	glm::vec3 getForce();
-  	void applyForce();
+    // Getters
+    int size() const { return (int) i0.size(); };
+    int getCount(SpringType type) const { return familyStart[type + 1] - familyStart[type]; };
+    int getFamilyStart(SpringType type) const { return familyStart[type]; };
 
-    // Directly moves position instead of adding force
-    void applyCorrection();
-    void lengthConstraint();
+    SpringSpan getSpan(SpringType type) const;
+    SpringSpan getSpan(int begin, int end) const;
+    SpringSpan getAll() const { return getSpan(0, size()); };
 
-    // Prints Stats about Springs
-    void static printStats();
+    // Reorders each group so the springs whose first particle has key k are contiguous:
+    // group g, key k is [keyStart[g*(numKeys+1) + k], keyStart[g*(numKeys+1) + k + 1])
+    void sortGroupsByKey(const std::vector<int>& particleKey, int numKeys, std::vector<int>& keyStart);
 
+    int getNumGroups() const { return (int) groupStart.size() - 1; };
+    int getGroupStart(int g) const { return groupStart[g]; };
+    int getGroupEnd(int g) const { return groupStart[g + 1]; };
+
+    // Force Due to Springs in [begin, end)
+    void applyForce(ParticleStore* p, int begin, int end) const;
+
+    // Directly moves positions instead of adding force
+    void applyCorrection(ParticleStore* p, int begin, int end) const;
+    void lengthConstraint(ParticleStore* p, int begin, int end) const;
+
+    // Prints Stats about Springs
+    void printStats() const;
 };
+
 #endif
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "ThreadPool.h"
+
+//****************************************************
+// Thread Pool - Constructors
+//****************************************************
+ThreadPool::ThreadPool(int numThreads) {
+    task = NULL;
+    taskBegin = 0;
+    taskEnd = 0;
+    pending = 0;
+    generation = 0;
+    stopping = false;
+
+    if(numThreads <= 0) {
+        numThreads = hardwareThreads();
+    }
+
+    // The calling thread is thread 0
+    for(int i = 1; i < numThreads; i++) {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    workReady.notify_all();
+
+    for(int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+int ThreadPool::hardwareThreads() {
+    int n = (int) std::thread::hardware_concurrency();
+    return (n > 0) ? n : 1;
+}
+
+//****************************************************
+// Run Chunk:
+//      - Thread id runs its static share of the
+//        current task
+//****************************************************
+void ThreadPool::runChunk(int id) {
+    long n = taskEnd - taskBegin;
+    int numThreads = getNumThreads();
+
+    int chunkBegin = taskBegin + (int) ((n * id) / numThreads);
+    int chunkEnd = taskBegin + (int) ((n * (id + 1)) / numThreads);
+
+    if(chunkBegin < chunkEnd) {
+        (*task)(chunkBegin, chunkEnd);
+    }
+}
+
+//****************************************************
+// Worker Loop:
+//      - Sleeps until a new generation of work is
+//        posted, runs its chunk, reports back
+//****************************************************
+void ThreadPool::workerLoop(int id) {
+    unsigned long seen = 0;
+
+    while(true) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while(!stopping && generation == seen) {
+            workReady.wait(lock);
+        }
+
+        if(stopping) {
+            return;
+        }
+
+        seen = generation;
+        lock.unlock();
+
+        runChunk(id);
+
+        lock.lock();
+        pending--;
+
+        if(pending == 0) {
+            workDone.notify_one();
+        }
+    }
+}
+
+//****************************************************
+// Parallel For:
+//      - Runs body over [begin, end) on every thread
+//        and returns once all chunks have finished
+//****************************************************
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)>& body) {
+    if(end <= begin) {
+        return;
+    }
+
+    if(workers.empty()) {
+        body(begin, end);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        task = &body;
+        taskBegin = begin;
+        taskEnd = end;
+        pending = (int) workers.size();
+        generation++;
+    }
+
+    workReady.notify_all();
+
+    runChunk(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(pending > 0) {
+        workDone.wait(lock);
+    }
+
+    task = NULL;
+}
@@ -0,0 +1,59 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//****************************************************
+// Thread Pool Header Definition
+//      - Persistent workers, created once and woken
+//        for every parallelFor
+//      - parallelFor splits [begin, end) into one
+//        contiguous chunk per thread (static
+//        schedule), so a given range always maps to
+//        the same chunks
+//      - The calling thread runs chunk 0 and blocks
+//        until every chunk is done
+//****************************************************
+
+class ThreadPool {
+  private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+
+    // Current task, valid while pending > 0
+    const std::function<void(int, int)>* task;
+    int taskBegin;
+    int taskEnd;
+
+    int pending;                    // Workers still running the current task
+    unsigned long generation;       // Incremented for every task
+    bool stopping;
+
+    void workerLoop(int id);
+    void runChunk(int id);
+
+    // Owns threads, not copyable
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+  public:
+    // numThreads includes the calling thread, <= 0 uses every hardware thread
+    ThreadPool(int numThreads);
+    ~ThreadPool();
+
+    int getNumThreads() { return (int) workers.size() + 1; };
+
+    // Calls body(chunkBegin, chunkEnd) over disjoint chunks covering [begin, end)
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& body);
+
+    static int hardwareThreads();
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <math.h>
+
+#include "glm/glm.hpp"
+
+#include "TriangleMesh.h"
+
+
+//****************************************************
+// Triangle Mesh - Constructors
+//****************************************************
+TriangleMesh::TriangleMesh() {
+    lo = glm::vec3(0.0f);
+    hi = glm::vec3(0.0f);
+}
+
+//****************************************************
+// Load OBJ:
+//      - A face's corners are 'v', 'v/t', 'v//n' or
+//        'v/t/n'; only v is used. Negative indices
+//        count back from the last vertex read
+//****************************************************
+bool TriangleMesh::loadOBJ(const char* file, glm::vec3 offset, float scale) {
+    std::ifstream inpfile(file, std::ifstream::in);
+
+    if(!inpfile.good()) {
+        std::cerr << "Unable to read mesh file: " << file << std::endl;
+        return false;
+    }
+
+    vertices.clear();
+    indices.clear();
+
+    std::string line;
+    std::vector<int> corners;
+
+    while(std::getline(inpfile, line)) {
+        std::istringstream in(line);
+        std::string type;
+        in >> type;
+
+        if(type == "v") {
+            glm::vec3 v;
+            in >> v.x >> v.y >> v.z;
+            vertices.push_back(v * scale + offset);
+
+        } else if(type == "f") {
+            corners.clear();
+            std::string corner;
+
+            while(in >> corner) {
+                int v = atoi(corner.c_str());
+                v = (v < 0) ? (int) vertices.size() + v : v - 1;
+
+                if(v < 0 || v >= vertices.size()) {
+                    std::cerr << "Bad face in mesh file: " << file << std::endl;
+                    return false;
+                }
+                corners.push_back(v);
+            }
+
+            for(int c = 1; c + 1 < corners.size(); c++) {
+                indices.push_back(corners[0]);
+                indices.push_back(corners[c]);
+                indices.push_back(corners[c + 1]);
+            }
+        }
+    }
+
+    if(indices.empty()) {
+        std::cerr << "No triangles in mesh file: " << file << std::endl;
+        return false;
+    }
+
+    measureBounds();
+
+    return true;
+}
+
+void TriangleMesh::setTriangles(const std::vector<glm::vec3>& v, const std::vector<int>& i) {
+    vertices = v;
+    indices = i;
+
+    measureBounds();
+}
+
+void TriangleMesh::measureBounds() {
+    lo = glm::vec3(0.0f);
+    hi = glm::vec3(0.0f);
+
+    if(vertices.empty()) {
+        return;
+    }
+
+    lo = vertices[0];
+    hi = vertices[0];
+    for(int v = 1; v < vertices.size(); v++) {
+        lo = glm::min(lo, vertices[v]);
+        hi = glm::max(hi, vertices[v]);
+    }
+}
+
+void TriangleMesh::getTriangle(int t, glm::vec3& a, glm::vec3& b, glm::vec3& c) const {
+    a = vertices[indices[3 * t]];
+    b = vertices[indices[3 * t + 1]];
+    c = vertices[indices[3 * t + 2]];
+}
+
+unsigned long long TriangleMesh::getHash() const {
+    unsigned long long hash = 14695981039346656037ULL;
+
+    if(vertices.empty() || indices.empty()) {
+        return hash;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) &vertices[0];
+    for(int b = 0; b < vertices.size() * sizeof(glm::vec3); b++) {
+        hash ^= bytes[b];
+        hash *= 1099511628211ULL;
+    }
+
+    bytes = (const unsigned char*) &indices[0];
+    for(int b = 0; b < indices.size() * sizeof(int); b++) {
+        hash ^= bytes[b];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+//****************************************************
+// Closest Point On Triangle:
+//      - Finds which vertex, edge or the face's
+//        Voronoi region p falls in, from the
+//        barycentric signs (Ericson, Real-Time
+//        Collision Detection 5.1.5)
+//****************************************************
+glm::vec3 closestPointOnTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 ap = p - a;
+
+    float d1 = glm::dot(ab, ap);
+    float d2 = glm::dot(ac, ap);
+    if(d1 <= 0.0f && d2 <= 0.0f) {
+        return a;
+    }
+
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp);
+    float d4 = glm::dot(ac, bp);
+    if(d3 >= 0.0f && d4 <= d3) {
+        return b;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp);
+    float d6 = glm::dot(ac, cp);
+    if(d6 >= 0.0f && d5 <= d6) {
+        return c;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denominator = va + vb + vc;
+    if(!(denominator != 0.0f)) {
+        return a;
+    }
+
+    float v = vb / denominator;
+    float w = vc / denominator;
+    return a + ab * v + ac * w;
+}
@@ -0,0 +1,56 @@
+#ifndef TRIANGLEMESH_H
+#define TRIANGLEMESH_H
+
+#include <vector>
+#include "glm/glm.hpp"
+
+//****************************************************
+// Triangle Mesh Header Definition
+//      - Vertices & triangles read from a Wavefront
+//        OBJ file: 'v x y z' and 'f a b c ...' lines.
+//        Polygons are split into fans, 'a/t/n' and
+//        negative (relative) indices are allowed, every
+//        other line is skipped
+//      - Placed in the scene as it is read: scaled,
+//        then moved by an offset
+//      - The hash covers the placed vertices and the
+//        triangles, so anything baked from a mesh can
+//        be cached under it
+//****************************************************
+
+class TriangleMesh {
+  private:
+    std::vector<glm::vec3> vertices;
+    std::vector<int> indices;           // 3 per triangle
+
+    glm::vec3 lo;
+    glm::vec3 hi;
+
+    void measureBounds();
+
+  public:
+    TriangleMesh();
+
+    // False if the file can't be read or holds no triangles
+    bool loadOBJ(const char* file, glm::vec3 offset, float scale);
+
+    // Takes the vertices & 3 indices per triangle as they are, for meshes made in code
+    void setTriangles(const std::vector<glm::vec3>& v, const std::vector<int>& i);
+
+    int getNumTriangles() const { return (int) indices.size() / 3; };
+    int getNumVertices() const { return (int) vertices.size(); };
+    void getTriangle(int t, glm::vec3& a, glm::vec3& b, glm::vec3& c) const;
+    const int* getIndices(int t) const { return &indices[3 * t]; };
+    glm::vec3 getVertex(int v) const { return vertices[v]; };
+
+    // Box around every vertex
+    void getBounds(glm::vec3& l, glm::vec3& h) const { l = lo; h = hi; };
+
+    // FNV-1a over the vertices' & indices' bytes
+    unsigned long long getHash() const;
+};
+
+// Closest point to p on triangle abc
+glm::vec3 closestPointOnTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c);
+
+#endif
@@ -0,0 +1,435 @@
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+#include "glm/glm.hpp"
+
+#include "TriangleMeshShape.h"
+
+
+//****************************************************
+// Triangle Mesh Shape Class - Constants
+//****************************************************
+
+// A node is skipped when its box is further than the best distance so far times this, so
+// rounding in the box test can never skip a triangle the search would have taken
+const float MESH_PRUNE_SLACK = 1.0001f;
+
+// A hinted triangle is kept while its distance is under this much of the room left to the
+// others, so rounding can never keep it where a search would find another
+const float MESH_HINT_SLACK = 0.9999f;
+
+static float getArea(glm::vec3 lo, glm::vec3 hi) {
+    glm::vec3 d = hi - lo;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static float getBoxDistance2(glm::vec3 p, const MeshNode& n) {
+    glm::vec3 d = glm::max(glm::max(n.lo - p, p - n.hi), glm::vec3(0.0f));
+    return glm::dot(d, d);
+}
+
+//****************************************************
+// Triangle Mesh Shape - Constructors
+//****************************************************
+TriangleMeshShape::TriangleMeshShape() {
+}
+
+bool TriangleMeshShape::load(const char* objFile, glm::vec3 offset, float scale) {
+    if(!mesh.loadOBJ(objFile, offset, scale)) {
+        return false;
+    }
+
+    build();
+    return true;
+}
+
+void TriangleMeshShape::setMesh(const TriangleMesh& m) {
+    mesh = m;
+    build();
+}
+
+void TriangleMeshShape::setNumParticles(int n) {
+    if(hints.size() != n) {
+        MeshHint none;
+        none.anchor = glm::vec3(0.0f);
+        none.clearance = -1.0f;
+        none.count = 0;
+
+        hints.assign(n, none);
+    }
+}
+
+//****************************************************
+// Build:
+//      - Splits top down, then copies the triangles
+//        out in the order the leaves hold them
+//****************************************************
+void TriangleMeshShape::build() {
+    int numTriangles = mesh.getNumTriangles();
+
+    std::vector<int> order(numTriangles);
+    std::vector<glm::vec3> centres(numTriangles);
+    std::vector<glm::vec3> boxLo(numTriangles);
+    std::vector<glm::vec3> boxHi(numTriangles);
+
+    for(int t = 0; t < numTriangles; t++) {
+        glm::vec3 a, b, c;
+        mesh.getTriangle(t, a, b, c);
+
+        order[t] = t;
+        boxLo[t] = glm::min(a, glm::min(b, c));
+        boxHi[t] = glm::max(a, glm::max(b, c));
+        centres[t] = (boxLo[t] + boxHi[t]) * 0.5f;
+    }
+
+    nodes.clear();
+    triangles.clear();
+    hints.clear();
+
+    if(numTriangles == 0) {
+        return;
+    }
+
+    nodes.push_back(MeshNode());
+    buildNode(0, 0, numTriangles, 0, order, centres, boxLo, boxHi);
+
+    triangles.resize(numTriangles);
+    for(int k = 0; k < numTriangles; k++) {
+        MeshTriangle& tri = triangles[k];
+        mesh.getTriangle(order[k], tri.a, tri.b, tri.c);
+
+        glm::vec3 n = glm::cross(tri.b - tri.a, tri.c - tri.a);
+        float length = glm::length(n);
+        tri.normal = (length > 0.0f) ? n / length : glm::vec3(0.0f);
+    }
+}
+
+//****************************************************
+// Build Node:
+//      - Bins the triangles' centres along each axis
+//        and splits where the children's areas times
+//        their triangle counts sum least. If every
+//        centre lands on one side the run is halved
+//****************************************************
+void TriangleMeshShape::buildNode(int at, int begin, int end, int depth, std::vector<int>& order,
+                                  const std::vector<glm::vec3>& centres, const std::vector<glm::vec3>& boxLo,
+                                  const std::vector<glm::vec3>& boxHi) {
+    glm::vec3 lo = boxLo[order[begin]];
+    glm::vec3 hi = boxHi[order[begin]];
+    glm::vec3 centreLo = centres[order[begin]];
+    glm::vec3 centreHi = centreLo;
+
+    for(int k = begin + 1; k < end; k++) {
+        int t = order[k];
+        lo = glm::min(lo, boxLo[t]);
+        hi = glm::max(hi, boxHi[t]);
+        centreLo = glm::min(centreLo, centres[t]);
+        centreHi = glm::max(centreHi, centres[t]);
+    }
+
+    nodes[at].lo = lo;
+    nodes[at].hi = hi;
+
+    int count = end - begin;
+    if(count <= MESH_LEAF_TRIANGLES || depth >= MESH_MAX_DEPTH) {
+        nodes[at].first = begin;
+        nodes[at].count = count;
+        return;
+    }
+
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = HUGE_VALF;
+
+    for(int axis = 0; axis < 3; axis++) {
+        float extent = centreHi[axis] - centreLo[axis];
+        if(!(extent > 0.0f)) {
+            continue;
+        }
+
+        int binCount[MESH_SAH_BINS] = { 0 };
+        glm::vec3 binLo[MESH_SAH_BINS];
+        glm::vec3 binHi[MESH_SAH_BINS];
+
+        for(int k = begin; k < end; k++) {
+            int t = order[k];
+            int b = glm::min((int) ((centres[t][axis] - centreLo[axis]) / extent * MESH_SAH_BINS), MESH_SAH_BINS - 1);
+
+            if(binCount[b] == 0) {
+                binLo[b] = boxLo[t];
+                binHi[b] = boxHi[t];
+            } else {
+                binLo[b] = glm::min(binLo[b], boxLo[t]);
+                binHi[b] = glm::max(binHi[b], boxHi[t]);
+            }
+            binCount[b]++;
+        }
+
+        // rightCost[b]: bins b + 1 onwards
+        float rightCost[MESH_SAH_BINS];
+        int rightCount = 0;
+        glm::vec3 rightLo, rightHi;
+
+        for(int b = MESH_SAH_BINS - 1; b > 0; b--) {
+            if(binCount[b] > 0) {
+                rightLo = (rightCount == 0) ? binLo[b] : glm::min(rightLo, binLo[b]);
+                rightHi = (rightCount == 0) ? binHi[b] : glm::max(rightHi, binHi[b]);
+                rightCount += binCount[b];
+            }
+            rightCost[b - 1] = (rightCount == 0) ? 0.0f : getArea(rightLo, rightHi) * rightCount;
+        }
+
+        int leftCount = 0;
+        glm::vec3 leftLo, leftHi;
+
+        for(int b = 0; b < MESH_SAH_BINS - 1; b++) {
+            if(binCount[b] > 0) {
+                leftLo = (leftCount == 0) ? binLo[b] : glm::min(leftLo, binLo[b]);
+                leftHi = (leftCount == 0) ? binHi[b] : glm::max(leftHi, binHi[b]);
+                leftCount += binCount[b];
+            }
+
+            if(leftCount == 0 || leftCount == count) {
+                continue;
+            }
+
+            float cost = getArea(leftLo, leftHi) * leftCount + rightCost[b];
+            if(cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    int mid = (begin + end) / 2;
+
+    if(bestAxis >= 0) {
+        float from = centreLo[bestAxis];
+        float extent = centreHi[bestAxis] - from;
+
+        mid = (int) (std::partition(order.begin() + begin, order.begin() + end, [&](int t) {
+            return glm::min((int) ((centres[t][bestAxis] - from) / extent * MESH_SAH_BINS), MESH_SAH_BINS - 1) <= bestSplit;
+        }) - order.begin());
+    }
+
+    int first = (int) nodes.size();
+    nodes.push_back(MeshNode());
+    nodes.push_back(MeshNode());
+    nodes[at].first = first;
+    nodes[at].count = 0;
+
+    buildNode(first, begin, mid, depth + 1, order, centres, boxLo, boxHi);
+    buildNode(first + 1, mid, end, depth + 1, order, centres, boxLo, boxHi);
+}
+
+//****************************************************
+// Find Nearest:
+//      - The k triangles nearer than sqrt(bound2) with
+//        the least (distance, triangle) pairs, in that
+//        order, with their squared distances. Returns
+//        how many there are
+//      - Walks the tree nearer child first, keeping
+//        the further one on a stack with its distance,
+//        so it is dropped if k nearer triangles turn
+//        up meanwhile
+//****************************************************
+int TriangleMeshShape::findNearest(glm::vec3 p, float bound2, int k, int* found, float* found2) const {
+    int count = 0;
+    float limit = bound2;
+
+    if(nodes.empty() || getBoxDistance2(p, nodes[0]) > limit * MESH_PRUNE_SLACK) {
+        return 0;
+    }
+
+    int stackNode[MESH_MAX_DEPTH + 1];
+    float stackDist[MESH_MAX_DEPTH + 1];
+    int top = 0;
+    int at = 0;
+
+    while(true) {
+        const MeshNode& node = nodes[at];
+
+        if(node.count > 0) {
+            for(int t = node.first; t < node.first + node.count; t++) {
+                const MeshTriangle& tri = triangles[t];
+                glm::vec3 q = closestPointOnTriangle(p, tri.a, tri.b, tri.c);
+                float d2 = glm::dot(p - q, p - q);
+
+                if(!(d2 < limit || (count == k && d2 == limit && t < found[k - 1]))) {
+                    continue;
+                }
+
+                int j = (count < k) ? count++ : k - 1;
+                while(j > 0 && (found2[j - 1] > d2 || (found2[j - 1] == d2 && found[j - 1] > t))) {
+                    found[j] = found[j - 1];
+                    found2[j] = found2[j - 1];
+                    j--;
+                }
+
+                found[j] = t;
+                found2[j] = d2;
+
+                if(count == k) {
+                    limit = found2[k - 1];
+                }
+            }
+        } else {
+            int near = node.first;
+            int far = node.first + 1;
+            float nearDist = getBoxDistance2(p, nodes[near]);
+            float farDist = getBoxDistance2(p, nodes[far]);
+
+            if(farDist < nearDist) {
+                std::swap(near, far);
+                std::swap(nearDist, farDist);
+            }
+
+            if(nearDist <= limit * MESH_PRUNE_SLACK) {
+                if(farDist <= limit * MESH_PRUNE_SLACK) {
+                    stackNode[top] = far;
+                    stackDist[top] = farDist;
+                    top++;
+                }
+
+                at = near;
+                continue;
+            }
+        }
+
+        while(top > 0 && stackDist[top - 1] > limit * MESH_PRUNE_SLACK) {
+            top--;
+        }
+
+        if(top == 0) {
+            break;
+        }
+
+        top--;
+        at = stackNode[top];
+    }
+
+    return count;
+}
+
+int TriangleMeshShape::findClosest(glm::vec3 p, float& dist2, glm::vec3& closest) const {
+    int t;
+    float d2;
+
+    if(findNearest(p, dist2, 1, &t, &d2) == 0) {
+        return -1;
+    }
+
+    const MeshTriangle& tri = triangles[t];
+    closest = closestPointOnTriangle(p, tri.a, tri.b, tri.c);
+    dist2 = d2;
+
+    return t;
+}
+
+//****************************************************
+// Collide Range:
+//      - A particle that has moved d since its hint
+//        is at least clearance - d from any unlisted
+//        triangle, and at least sqrt(distance) - d
+//        from a listed one, so the listed are tried
+//        nearest first until none left can be closer.
+//        If the closest is nearer than clearance - d
+//        it is the closest of all; if not, the
+//        particle searches out to MESH_HINT_DISTANCE
+//        and leaves a new hint
+//      - A particle behind the face of its closest
+//        triangle, within the contact distance, has
+//        gone through the surface (or is just under
+//        it): it moves to the closest point
+//****************************************************
+bool TriangleMeshShape::collideRange(ParticleStore* p, int begin, int end) {
+    bool hit = false;
+    float reach2 = MESH_CONTACT_DISTANCE * MESH_CONTACT_DISTANCE;
+
+    for(int i = begin; i < end; i++) {
+        glm::vec3 pos = p->getPos(i);
+
+        int t = -1;
+        float dist2 = reach2;
+        glm::vec3 closest;
+
+        if(i < hints.size()) {
+            MeshHint& hint = hints[i];
+            bool held = false;
+
+            if(hint.clearance >= 0.0f) {
+                float moved = glm::length(pos - hint.anchor);
+                float dist = 0.0f;
+
+                for(int h = 0; h < hint.count; h++) {
+                    if(t >= 0 && (hint.distances[h] - moved) * MESH_HINT_SLACK > dist) {
+                        break;
+                    }
+
+                    const MeshTriangle& tri = triangles[hint.triangles[h]];
+                    glm::vec3 q = closestPointOnTriangle(pos, tri.a, tri.b, tri.c);
+                    float d2 = glm::dot(pos - q, pos - q);
+
+                    if(t < 0 || d2 < dist2 || (d2 == dist2 && hint.triangles[h] < t)) {
+                        t = hint.triangles[h];
+                        dist2 = d2;
+                        dist = sqrtf(d2);
+                        closest = q;
+                    }
+                }
+
+                float room = (hint.clearance - moved) * MESH_HINT_SLACK;
+                held = (t < 0) ? room >= MESH_CONTACT_DISTANCE : dist < room;
+            }
+
+            if(!held) {
+                int found[MESH_HINT_TRIANGLES + 1];
+                float found2[MESH_HINT_TRIANGLES + 1];
+                int count = findNearest(pos, MESH_HINT_DISTANCE * MESH_HINT_DISTANCE, MESH_HINT_TRIANGLES + 1, found, found2);
+
+                hint.anchor = pos;
+                hint.count = glm::min(count, MESH_HINT_TRIANGLES);
+                hint.clearance = (count > MESH_HINT_TRIANGLES) ? sqrtf(found2[MESH_HINT_TRIANGLES]) : MESH_HINT_DISTANCE;
+
+                for(int h = 0; h < hint.count; h++) {
+                    hint.triangles[h] = found[h];
+                    hint.distances[h] = sqrtf(found2[h]);
+                }
+
+                t = -1;
+                dist2 = reach2;
+
+                if(count > 0) {
+                    const MeshTriangle& tri = triangles[found[0]];
+                    t = found[0];
+                    dist2 = found2[0];
+                    closest = closestPointOnTriangle(pos, tri.a, tri.b, tri.c);
+                }
+            }
+
+            if(!(dist2 < reach2)) {
+                t = -1;
+            }
+        } else {
+            t = findClosest(pos, dist2, closest);
+        }
+
+        if(t < 0 || !(glm::dot(pos - closest, triangles[t].normal) < 0.0f)) {
+            continue;
+        }
+
+        p->setPos(i, closest);
+        p->setVelocity(i, p->getVelocity(i) * 0.4f);
+        hit = true;
+    }
+
+    return hit;
+}
+
+void TriangleMeshShape::getBounds(glm::vec3& lo, glm::vec3& hi) {
+    mesh.getBounds(lo, hi);
+    lo -= glm::vec3(MESH_CONTACT_DISTANCE);
+    hi += glm::vec3(MESH_CONTACT_DISTANCE);
+}
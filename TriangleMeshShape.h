@@ -0,0 +1,122 @@
+#ifndef TRIANGLEMESHSHAPE_H
+#define TRIANGLEMESHSHAPE_H
+
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Shape.h"
+#include "ParticleStore.h"
+#include "TriangleMesh.h"
+
+//****************************************************
+// Triangle Mesh Shape Header Definition
+//      - A collider that is the exact surface of a
+//        triangle mesh, open or closed, its outside
+//        the side its triangles wind counter clockwise
+//        to
+//      - Finds each particle's closest point on the
+//        mesh within MESH_CONTACT_DISTANCE through a
+//        bounding volume hierarchy over the triangles,
+//        built once by the surface area heuristic
+//        (binned, leaves of up to MESH_LEAF_TRIANGLES).
+//        A particle behind its closest triangle is
+//        moved to the closest point and its velocity
+//        scaled by 0.4, as for a Sphere
+//      - Each particle keeps a hint from its last
+//        search: where it was, its nearest few
+//        triangles and how far all the others were.
+//        Until it has moved so far that an unlisted
+//        triangle could be as close as a listed one,
+//        the closest is among the listed and the search
+//        is skipped; a particle resting on a face costs
+//        one closest point. Ties go to the lowest
+//        triangle, so hints only change the speed,
+//        never the result
+//****************************************************
+
+// Particles further than this from every triangle don't collide
+const float MESH_CONTACT_DISTANCE = 0.1f;
+
+// Searches that refresh a hint look this far, so a particle that found nothing can move the
+// difference before it has to search again
+const float MESH_HINT_DISTANCE = 2.0f * MESH_CONTACT_DISTANCE;
+
+// Triangles a hint lists; a particle near a vertex of more than this many searches every step
+const int MESH_HINT_TRIANGLES = 6;
+
+// SAH leaves hold at most this many triangles, and the tree is at most this deep
+const int MESH_LEAF_TRIANGLES = 4;
+const int MESH_MAX_DEPTH = 60;
+
+// Split positions tried per axis
+const int MESH_SAH_BINS = 16;
+
+struct MeshNode {
+    glm::vec3 lo;
+    int first;                  // Leaf: first of its triangles. Inner: left child, right is first + 1
+    glm::vec3 hi;
+    int count;                  // Triangles of a leaf, 0 for an inner node
+};
+
+// A triangle in leaf order, with its unit normal
+struct MeshTriangle {
+    glm::vec3 a, b, c;
+    glm::vec3 normal;
+};
+
+// A particle's last search, from anchor: its nearest triangles (in leaf order) and their
+// distances, nearest first; every unlisted triangle was at least clearance away
+struct MeshHint {
+    glm::vec3 anchor;
+    float clearance;            // < 0 before the first search
+    int count;
+    int triangles[MESH_HINT_TRIANGLES];
+    float distances[MESH_HINT_TRIANGLES];
+};
+
+class TriangleMeshShape : public Shape {
+  private:
+    TriangleMesh mesh;
+
+    std::vector<MeshNode> nodes;
+    std::vector<MeshTriangle> triangles;
+
+    std::vector<MeshHint> hints;
+
+    void build();
+    int findNearest(glm::vec3 p, float bound2, int k, int* found, float* found2) const;
+    void buildNode(int at, int begin, int end, int depth, std::vector<int>& order,
+                   const std::vector<glm::vec3>& centres, const std::vector<glm::vec3>& boxLo,
+                   const std::vector<glm::vec3>& boxHi);
+
+  public:
+    TriangleMeshShape();
+
+    // Reads the OBJ, scaled then moved by offset, and builds its tree. False if it can't be read
+    bool load(const char* objFile, glm::vec3 offset, float scale);
+
+    // Builds the tree over a mesh made in code
+    void setMesh(const TriangleMesh& m);
+
+    // Sizes the hints for a cloth of n particles; without them every search starts from scratch.
+    // Not thread safe, call before collisions
+    void setNumParticles(int n);
+
+    // Closest point to p on the mesh, if any is nearer than sqrt(dist2); then dist2 becomes its
+    // squared distance. Returns the triangle (in leaf order) or -1
+    int findClosest(glm::vec3 p, float& dist2, glm::vec3& closest) const;
+
+    // Collides particles [begin, end), true if any collided. Threads must use disjoint ranges
+    bool collideRange(ParticleStore* p, int begin, int end);
+
+    int getNumNodes() const { return (int) nodes.size(); };
+
+    // Shape - Abstract Functions
+    bool collide(ParticleStore* p, int i) { return collideRange(p, i, i + 1); };
+    std::string getType() { return "MESH"; };
+    void getBounds(glm::vec3& lo, glm::vec3& hi);
+    int getNumTriangles() { return mesh.getNumTriangles(); };
+    void getTriangle(int t, glm::vec3& a, glm::vec3& b, glm::vec3& c) { mesh.getTriangle(t, a, b, c); };
+};
+
+#endif
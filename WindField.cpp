@@ -0,0 +1,345 @@
+#include <math.h>
+#include <functional>
+#include "glm/glm.hpp"
+
+#include "WindField.h"
+
+//****************************************************
+// Wind Field Class - Constants
+//****************************************************
+
+const float DEFAULT_TURBULENCE = 0.6f;
+const float DEFAULT_GUST_STRENGTH = 0.5f;
+const float DEFAULT_EDDY_SIZE = 1.5f;
+const int DEFAULT_OCTAVES = 3;
+const float DEFAULT_GUST_PERIOD = 2.0f;
+const float DEFAULT_FLOW_SPEED = 3.0f;
+
+// A 3 m flag and its padding fit in 16 cells
+const float DEFAULT_CELL_SIZE = 0.25f;
+const float DEFAULT_REFRESH_PERIOD = 1.0f / 60.0f;
+
+// Seeds of the three potentials & the gusts
+const unsigned int POTENTIAL_SEEDS[3] = { 0x9e3779b9u, 0x7f4a7c15u, 0x2545f491u };
+const unsigned int GUST_SEED = 0x68e31da4u;
+
+// Gradients of the lattice points, the cube's 12 edge directions
+const float NOISE_GRADIENTS[12][3] = {
+    { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+    { 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+    { 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 }
+};
+
+//****************************************************
+// Wind Field Class - Constructors
+//****************************************************
+WindField::WindField() {
+    meanForce = glm::vec3(0.0f, 0.0f, -1.0f);
+    turbulence = DEFAULT_TURBULENCE;
+    gustStrength = DEFAULT_GUST_STRENGTH;
+    eddySize = DEFAULT_EDDY_SIZE;
+    octaves = DEFAULT_OCTAVES;
+    gustPeriod = DEFAULT_GUST_PERIOD;
+    flowSpeed = DEFAULT_FLOW_SPEED;
+    cellSize = DEFAULT_CELL_SIZE;
+    refreshPeriod = DEFAULT_REFRESH_PERIOD;
+
+    origin = glm::vec3(0.0f);
+    cell = cellSize;
+    invCell = 1.0f / cell;
+    nx = ny = nz = 0;
+    gridTime = 0.0;
+    refreshes = 0;
+}
+
+//****************************************************
+// Noise:
+//      - Gradient (Perlin) noise on the integer
+//        lattice, each point's gradient picked by a
+//        hash of its coordinates, so no table is kept
+//      - Quintic fade, so the gradient is continuous
+//        and the curl is too
+//****************************************************
+static inline unsigned int hashLattice(int x, int y, int z, unsigned int seed) {
+    unsigned int h = seed + (unsigned int) x * 0x8da6b343u + (unsigned int) y * 0xd8163841u + (unsigned int) z * 0xcb1ab31fu;
+
+    h ^= h >> 16;  h *= 0x85ebca6bu;
+    h ^= h >> 13;  h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+// Gradient of the noise at (x, y, z)
+static glm::vec3 noiseGradient(float x, float y, float z, unsigned int seed) {
+    float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+    int ix = (int) fx, iy = (int) fy, iz = (int) fz;
+
+    glm::vec3 f(x - fx, y - fy, z - fz);
+    glm::vec3 u = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+    glm::vec3 du = 30.0f * f * f * (f * (f - 2.0f) + 1.0f);
+
+    // Corner c = (c & 1, c >> 1 & 1, c >> 2 & 1): its gradient g & its value g . (f - c)
+    glm::vec3 g[8];
+    float v[8];
+
+    for(int c = 0; c < 8; c++) {
+        int cx = c & 1, cy = (c >> 1) & 1, cz = (c >> 2) & 1;
+        const float* n = NOISE_GRADIENTS[hashLattice(ix + cx, iy + cy, iz + cz, seed) % 12];
+
+        g[c] = glm::vec3(n[0], n[1], n[2]);
+        v[c] = glm::dot(g[c], f - glm::vec3((float) cx, (float) cy, (float) cz));
+    }
+
+    // Trilinear blend of the values by u, as k0 + k1 ux + ... + k7 ux uy uz; likewise the gradients
+    float k1 = v[1] - v[0];
+    float k2 = v[2] - v[0];
+    float k3 = v[4] - v[0];
+    float k4 = v[0] - v[1] - v[2] + v[3];
+    float k5 = v[0] - v[2] - v[4] + v[6];
+    float k6 = v[0] - v[1] - v[4] + v[5];
+    float k7 = -v[0] + v[1] + v[2] - v[3] + v[4] - v[5] - v[6] + v[7];
+
+    glm::vec3 g1 = g[1] - g[0];
+    glm::vec3 g2 = g[2] - g[0];
+    glm::vec3 g3 = g[4] - g[0];
+    glm::vec3 g4 = g[0] - g[1] - g[2] + g[3];
+    glm::vec3 g5 = g[0] - g[2] - g[4] + g[6];
+    glm::vec3 g6 = g[0] - g[1] - g[4] + g[5];
+    glm::vec3 g7 = -g[0] + g[1] + g[2] - g[3] + g[4] - g[5] - g[6] + g[7];
+
+    glm::vec3 gradient = g[0] + g1 * u.x + g2 * u.y + g3 * u.z + g4 * (u.x * u.y) + g5 * (u.y * u.z)
+                       + g6 * (u.z * u.x) + g7 * (u.x * u.y * u.z);
+
+    gradient.x += du.x * (k1 + k4 * u.y + k6 * u.z + k7 * u.y * u.z);
+    gradient.y += du.y * (k2 + k5 * u.z + k4 * u.x + k7 * u.z * u.x);
+    gradient.z += du.z * (k3 + k6 * u.x + k5 * u.y + k7 * u.x * u.y);
+
+    return gradient;
+}
+
+// 1D gradient noise at t, roughly in [-1, 1]
+static float noise1(double t, unsigned int seed) {
+    double ft = floor(t);
+    int i = (int) ft;
+    float f = (float) (t - ft);
+
+    float g0 = (hashLattice(i, 0, 0, seed) & 0xffff) / 32767.5f - 1.0f;
+    float g1 = (hashLattice(i + 1, 0, 0, seed) & 0xffff) / 32767.5f - 1.0f;
+
+    float u = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+
+    return 2.0f * (g0 * f + u * (g1 * (f - 1.0f) - g0 * f));
+}
+
+//****************************************************
+// Evaluate:
+//      - Octave o has eddies 2^o times smaller &
+//        potentials 2^o times weaker, so each adds
+//        half the curl of the last. The sum is divided
+//        by the weights, so the turbulence's strength
+//        does not depend on the number of octaves
+//****************************************************
+glm::vec3 WindField::evaluate(glm::vec3 p, double time) const {
+    float strength = glm::length(meanForce);
+
+    if(strength == 0.0f) {
+        return meanForce;
+    }
+
+    glm::vec3 dir = meanForce / strength;
+
+    // Gusts arrive at p once they have been carried there
+    double gustTime = (time - glm::dot(p, dir) / flowSpeed) / gustPeriod;
+    float gust = 1.0f + gustStrength * noise1(gustTime, GUST_SEED);
+
+    glm::vec3 q = p - dir * (float) (flowSpeed * time);
+
+    glm::vec3 curl(0.0f);
+    float frequency = 1.0f / eddySize;
+    float weight = 1.0f;
+    float weights = 0.0f;
+
+    for(int o = 0; o < octaves; o++) {
+        glm::vec3 s = q * frequency;
+
+        glm::vec3 d1 = noiseGradient(s.x, s.y, s.z, POTENTIAL_SEEDS[0]);
+        glm::vec3 d2 = noiseGradient(s.x, s.y, s.z, POTENTIAL_SEEDS[1]);
+        glm::vec3 d3 = noiseGradient(s.x, s.y, s.z, POTENTIAL_SEEDS[2]);
+
+        curl += weight * glm::vec3(d3.y - d2.z, d1.z - d3.x, d2.x - d1.y);
+
+        weights += weight;
+        frequency *= 2.0f;
+        weight *= 0.5f;
+    }
+
+    if(weights > 0.0f) {
+        curl /= weights;
+    }
+
+    return meanForce * gust + curl * (strength * turbulence);
+}
+
+//****************************************************
+// Update:
+//      - Nodes are at whole multiples of the cell, one
+//        cell beyond [lo, hi] on every side, so the
+//        cloth can move a cell before the grid must
+//        move with it. Cells double until the grid
+//        fits WIND_GRID_MAX_NODES
+//      - Each z slab of nodes is independent, so they
+//        split across the pool
+//****************************************************
+bool WindField::update(double time, glm::vec3 lo, glm::vec3 hi, ThreadPool* pool) {
+    if(nx > 0) {
+        glm::vec3 top = origin + cell * glm::vec3((float) (nx - 1), (float) (ny - 1), (float) (nz - 1));
+
+        bool covered = glm::all(glm::greaterThanEqual(lo, origin)) && glm::all(glm::lessThanEqual(hi, top));
+
+        if(covered && time >= gridTime && time - gridTime < refreshPeriod) {
+            return false;
+        }
+    }
+
+    cell = cellSize;
+
+    glm::vec3 first, last;
+    while(true) {
+        first = glm::floor(lo / cell) - 1.0f;
+        last = glm::ceil(hi / cell) + 1.0f;
+
+        glm::vec3 n = last - first + 1.0f;
+        if(n.x <= WIND_GRID_MAX_NODES && n.y <= WIND_GRID_MAX_NODES && n.z <= WIND_GRID_MAX_NODES) {
+            break;
+        }
+
+        cell *= 2.0f;
+    }
+
+    origin = first * cell;
+    invCell = 1.0f / cell;
+    nx = (int) (last.x - first.x) + 1;
+    ny = (int) (last.y - first.y) + 1;
+    nz = (int) (last.z - first.z) + 1;
+
+    nodes.resize(nx * ny * nz);
+
+    std::function<void(int, int)> body = [this, time](int begin, int end) {
+        for(int k = begin; k < end; k++) {
+            evaluateSlab(k, time);
+        }
+    };
+
+    if(pool == NULL) {
+        body(0, nz);
+    } else {
+        pool->parallelFor(0, nz, body);
+    }
+
+    gridTime = time;
+    refreshes++;
+
+    return true;
+}
+
+void WindField::evaluateSlab(int k, double time) {
+    for(int j = 0; j < ny; j++) {
+        for(int i = 0; i < nx; i++) {
+            nodes[(k * ny + j) * nx + i] = evaluate(origin + cell * glm::vec3((float) i, (float) j, (float) k), time);
+        }
+    }
+}
+
+//****************************************************
+// Sample:
+//      - Trilinear between the 8 nodes of p's cell
+//****************************************************
+glm::vec3 WindField::sample(glm::vec3 p) const {
+    if(nx == 0) {
+        return meanForce;
+    }
+
+    glm::vec3 t = (p - origin) * invCell;
+    t = glm::clamp(t, glm::vec3(0.0f), glm::vec3((float) (nx - 1), (float) (ny - 1), (float) (nz - 1)));
+
+    int i = glm::min((int) t.x, nx - 2);
+    int j = glm::min((int) t.y, ny - 2);
+    int k = glm::min((int) t.z, nz - 2);
+
+    float fx = t.x - i, fy = t.y - j, fz = t.z - k;
+
+    const glm::vec3* v00 = &nodes[(k * ny + j) * nx + i];
+    const glm::vec3* v10 = v00 + nx;
+    const glm::vec3* v01 = v00 + nx * ny;
+    const glm::vec3* v11 = v01 + nx;
+
+    glm::vec3 y0 = glm::mix(glm::mix(v00[0], v00[1], fx), glm::mix(v10[0], v10[1], fx), fy);
+    glm::vec3 y1 = glm::mix(glm::mix(v01[0], v01[1], fx), glm::mix(v11[0], v11[1], fx), fy);
+
+    return glm::mix(y0, y1, fz);
+}
+
+//****************************************************
+// Apply Row:
+//      - Quad w has triangles A = (w, h), (w, h+1),
+//        (w+1, h) & B = (w+1, h+1), (w+1, h), (w, h+1)
+//        as Cloth::updateNormals
+//****************************************************
+void WindField::applyRow(ParticleStore* p, int width, int h) const {
+    for(int w = 0; w < width - 1; w++) {
+        int a0 = h * width + w, a1 = a0 + 1;
+        int b0 = a0 + width, b1 = b0 + 1;
+
+        int tri[2][3] = { { a0, b0, a1 }, { b1, a1, b0 } };
+
+        for(int t = 0; t < 2; t++) {
+            glm::vec3 p1 = p->getPos(tri[t][0]);
+            glm::vec3 p2 = p->getPos(tri[t][1]);
+            glm::vec3 p3 = p->getPos(tri[t][2]);
+
+            // n (n . F) = c (c . F) / |c|^2, with no square root
+            glm::vec3 c = glm::cross(p2 - p1, p3 - p1);
+            float c2 = glm::dot(c, c);
+
+            if(c2 == 0.0f) {
+                continue;
+            }
+
+            glm::vec3 force = c * (glm::dot(c, sample((p1 + p2 + p3) * (1.0f / 3.0f))) / c2);
+
+            p->addForce(tri[t][0], force);
+            p->addForce(tri[t][1], force);
+            p->addForce(tri[t][2], force);
+        }
+    }
+}
+
+//****************************************************
+// Apply:
+//      - Even quad rows, then odd ones, as
+//        Aerodynamics::apply
+//****************************************************
+void WindField::apply(ParticleStore* p, int width, int height, ThreadPool* pool) const {
+    int numRows = height - 1;
+
+    if(numRows <= 0 || width < 2) {
+        return;
+    }
+
+    for(int c = 0; c < 2; c++) {
+        std::function<void(int, int)> body = [this, p, width, c](int begin, int end) {
+            for(int j = begin; j < end; j++) {
+                applyRow(p, width, 2 * j + c);
+            }
+        };
+
+        int count = (numRows - c + 1) / 2;
+
+        if(pool == NULL) {
+            body(0, count);
+        } else {
+            pool->parallelFor(0, count, body);
+        }
+    }
+}
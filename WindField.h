@@ -0,0 +1,98 @@
+#ifndef WINDFIELD_H
+#define WINDFIELD_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// Wind Field Header Definition
+//      - A wind force that varies over space & time:
+//          mean force * (1 + gusts)
+//          + |mean force| * turbulence * curl(noise)
+//      - The turbulence is the curl of three octaved
+//        gradient noise potentials (curl noise), so it
+//        swirls without sources or sinks. It is frozen
+//        & carried downwind at flowSpeed
+//      - Gusts are 1D noise in time, travelling
+//        downwind at flowSpeed too, so a gust sweeps
+//        across the cloth instead of hitting it all at
+//        once
+//      - Evaluating that per triangle costs every
+//        octave per triangle per step. Instead update
+//        evaluates it on the nodes of a coarse grid
+//        around the cloth, at most once per
+//        refreshPeriod of simulated time (a frame at
+//        60 fps) however many steps that is, and
+//        triangles sample the grid trilinearly. Grid
+//        nodes lie on a fixed lattice, so moving the
+//        grid with the cloth does not move the field
+//      - Each triangle gets n (n . F), F sampled at its
+//        centroid, on each of its particles, as the
+//        constant force of Cloth::addTriangleForce
+//****************************************************
+
+// Most grid nodes along an axis; larger cloths get coarser cells
+const int WIND_GRID_MAX_NODES = 32;
+
+class WindField {
+  private:
+    // Settings
+    glm::vec3 meanForce;
+    float turbulence;           // Curl noise, relative to the mean
+    float gustStrength;         // Gusts, relative to the mean
+    float eddySize;             // Size in m of the largest eddies
+    int octaves;
+    float gustPeriod;           // Seconds between gusts, roughly
+    float flowSpeed;            // m/s the eddies & gusts are carried downwind
+    float cellSize;             // Grid spacing in m
+    float refreshPeriod;        // Seconds of simulated time between grid updates
+
+    // Grid, valid when nx > 0: node (i, j, k) is at origin + cell * (i, j, k), x fastest
+    glm::vec3 origin;
+    float cell;
+    float invCell;
+    int nx, ny, nz;
+    std::vector<glm::vec3> nodes;
+    double gridTime;
+    int refreshes;
+
+    void evaluateSlab(int k, double time);
+
+    // Quad row h: both triangles of quads [0, width - 1) of rows h & h + 1
+    void applyRow(ParticleStore* p, int width, int h) const;
+
+  public:
+    WindField();
+
+    void setMeanForce(glm::vec3 force) { meanForce = force; invalidate(); };
+    void setTurbulence(float t) { turbulence = t; invalidate(); };
+    void setGustStrength(float g) { gustStrength = g; invalidate(); };
+    void setEddySize(float s) { eddySize = s; invalidate(); };
+    void setOctaves(int n) { octaves = n; invalidate(); };
+    void setRefreshPeriod(float s) { refreshPeriod = s; };
+
+    glm::vec3 getMeanForce() const { return meanForce; };
+    float getTurbulence() const { return turbulence; };
+    float getGustStrength() const { return gustStrength; };
+    int getOctaves() const { return octaves; };
+    int getRefreshes() const { return refreshes; };
+    int getNumNodes() const { return nx * ny * nz; };
+
+    // The exact field at p & time, every octave
+    glm::vec3 evaluate(glm::vec3 p, double time) const;
+
+    // Re-evaluates the grid over [lo, hi] if it is older than refreshPeriod, from a later
+    // time (a step was undone), or no longer covers [lo, hi]. True if it did
+    bool update(double time, glm::vec3 lo, glm::vec3 hi, ThreadPool* pool);
+    void invalidate() { nx = ny = nz = 0; };
+
+    // The grid's field at p, clamped to the grid
+    glm::vec3 sample(glm::vec3 p) const;
+
+    // Adds every triangle's force. A NULL pool runs serially, with the same result
+    void apply(ParticleStore* p, int width, int height, ThreadPool* pool) const;
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include <math.h>
+#include <vector>
+#include <functional>
+
+#include "XPBDSolver.h"
+#include "ParticleStore.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+
+//****************************************************
+// XPBD Solver Class - Constants
+//****************************************************
+
+const int DEFAULT_XPBD_ITERATIONS = 10;
+
+// Springs per partial sum of a residual
+const int RESIDUAL_BLOCK = 256;
+
+//****************************************************
+// XPBD Solver - Constructors
+//      - Stretch springs are inextensible; shear &
+//        bend keep the compliance of the explicit
+//        springs, 1 / UNIT_SPRING per unit length
+//****************************************************
+XPBDSolver::XPBDSolver() {
+    numVertices = 0;
+    numSprings = 0;
+
+    compliance[STRETCH] = 0.0f;
+    compliance[SHEAR] = 1.0f / UNIT_SPRING;
+    compliance[BEND] = 1.0f / UNIT_SPRING;
+
+    iterations = DEFAULT_XPBD_ITERATIONS;
+    residualTolerance = 0.0f;
+}
+
+//****************************************************
+// Prepare:
+//      - Only allocates when the cloth changes size,
+//        so a step allocates nothing
+//****************************************************
+void XPBDSolver::prepare(int nv, int ns) {
+    residuals.reserve(iterations);
+
+    if(nv == numVertices && ns == numSprings) {
+        return;
+    }
+
+    numVertices = nv;
+    numSprings = ns;
+
+    lambda.assign(ns, 0.0f);
+    constraintError.assign(ns, 0.0f);
+    partials.assign((ns + RESIDUAL_BLOCK - 1) / RESIDUAL_BLOCK, 0.0);
+}
+
+//****************************************************
+// Parallel Helpers:
+//      - Particles split on PARTICLE_PAD boundaries
+//      - Springs split on RESIDUAL_BLOCK boundaries,
+//        for passes where springs are independent
+//****************************************************
+void XPBDSolver::forEachVertexChunk(ThreadPool* pool, const std::function<void(int, int)>& body) {
+    if(pool == NULL) {
+        body(0, numVertices);
+        return;
+    }
+
+    int numBlocks = (numVertices + PARTICLE_PAD - 1) / PARTICLE_PAD;
+    int count = numVertices;
+
+    pool->parallelFor(0, numBlocks, [&body, count](int blockBegin, int blockEnd) {
+        int end = blockEnd * PARTICLE_PAD;
+        body(blockBegin * PARTICLE_PAD, end < count ? end : count);
+    });
+}
+
+void XPBDSolver::forEachSpringBlock(ThreadPool* pool, const std::function<void(int, int)>& body) {
+    if(pool == NULL) {
+        body(0, numSprings);
+        return;
+    }
+
+    int numBlocks = (numSprings + RESIDUAL_BLOCK - 1) / RESIDUAL_BLOCK;
+    int count = numSprings;
+
+    pool->parallelFor(0, numBlocks, [&body, count](int blockBegin, int blockEnd) {
+        int end = blockEnd * RESIDUAL_BLOCK;
+        body(blockBegin * RESIDUAL_BLOCK, end < count ? end : count);
+    });
+}
+
+//****************************************************
+// Predict:
+//      - Unconstrained step: v += h w f, x += h v.
+//        The start of the step is kept in the previous
+//        positions for the velocity update.
+//****************************************************
+void XPBDSolver::predict(ParticleStore* p, float h, ThreadPool* pool) {
+    forEachVertexChunk(pool, [p, h](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            p->ox[i] = p->px[i];
+            p->oy[i] = p->py[i];
+            p->oz[i] = p->pz[i];
+
+            if(p->invMass[i] != 0.0f) {
+                p->vx[i] += p->fx[i] * p->invMass[i] * h;
+                p->vy[i] += p->fy[i] * p->invMass[i] * h;
+                p->vz[i] += p->fz[i] * p->invMass[i] * h;
+
+                p->px[i] += p->vx[i] * h;
+                p->py[i] += p->vy[i] * h;
+                p->pz[i] += p->vz[i] * h;
+            }
+
+            p->fx[i] = 0.0f;
+            p->fy[i] = 0.0f;
+            p->fz[i] = 0.0f;
+        }
+    });
+
+    forEachSpringBlock(pool, [this](int begin, int end) {
+        for(int s = begin; s < end; s++) {
+            lambda[s] = 0.0f;
+        }
+    });
+}
+
+//****************************************************
+// Project:
+//      - One Gauss-Seidel sweep over every spring, a
+//        color group at a time
+//      - Records each spring's residual before it is
+//        projected
+//****************************************************
+void XPBDSolver::project(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool) {
+    SpringSpan all = springs.getAll();
+    float invH2 = 1.0f / (h * h);
+
+    for(int g = 0; g < springs.getNumGroups(); g++) {
+        int groupBegin = springs.getGroupStart(g);
+
+        // A group never spans two families
+        int type = STRETCH;
+        while(type + 1 < NUM_SPRING_TYPES && groupBegin >= springs.getFamilyStart((SpringType) (type + 1))) {
+            type++;
+        }
+
+        float alphaScale = compliance[type] * invH2;
+
+        std::function<void(int, int)> body = [this, p, &all, alphaScale](int begin, int end) {
+            for(int s = begin; s < end; s++) {
+                int a = all.i0[s];
+                int b = all.i1[s];
+
+                float dx = p->px[a] - p->px[b];
+                float dy = p->py[a] - p->py[b];
+                float dz = p->pz[a] - p->pz[b];
+
+                float length = sqrtf(dx*dx + dy*dy + dz*dz);
+
+                float wa = p->invMass[a];
+                float wb = p->invMass[b];
+                float alpha = alphaScale * all.restLength[s];
+
+                float error = length - all.restLength[s] + alpha * lambda[s];
+                constraintError[s] = fabsf(error);
+
+                float denominator = wa + wb + alpha;
+                if(length <= 0.0f || denominator <= 0.0f) {
+                    continue;
+                }
+
+                float deltaLambda = -error / denominator;
+                lambda[s] += deltaLambda;
+
+                float scale = deltaLambda / length;
+                float cx = dx * scale;
+                float cy = dy * scale;
+                float cz = dz * scale;
+
+                p->px[a] += wa * cx;  p->py[a] += wa * cy;  p->pz[a] += wa * cz;
+                p->px[b] -= wb * cx;  p->py[b] -= wb * cy;  p->pz[b] -= wb * cz;
+            }
+        };
+
+        if(pool == NULL) {
+            body(groupBegin, springs.getGroupEnd(g));
+        } else {
+            pool->parallelFor(groupBegin, springs.getGroupEnd(g), body);
+        }
+    }
+}
+
+//****************************************************
+// Residual:
+//      - RMS of the residuals recorded by the last
+//        sweep, summed in fixed blocks so the value
+//        is the same for any thread count
+//****************************************************
+float XPBDSolver::residual(ThreadPool* pool) {
+    if(numSprings == 0) {
+        return 0.0f;
+    }
+
+    forEachSpringBlock(pool, [this](int begin, int end) {
+        for(int block = begin; block < end; block += RESIDUAL_BLOCK) {
+            int blockEnd = (block + RESIDUAL_BLOCK < end) ? block + RESIDUAL_BLOCK : end;
+
+            double sum = 0.0;
+            for(int s = block; s < blockEnd; s++) {
+                sum += (double) constraintError[s] * constraintError[s];
+            }
+
+            partials[block / RESIDUAL_BLOCK] = sum;
+        }
+    });
+
+    double total = 0.0;
+    for(int i = 0; i < partials.size(); i++) {
+        total += partials[i];
+    }
+
+    return (float) sqrt(total / numSprings);
+}
+
+//****************************************************
+// Update Velocities:
+//      - v = (x - x_start) / h, so constraint
+//        corrections carry into the velocity
+//****************************************************
+void XPBDSolver::updateVelocities(ParticleStore* p, float h, ThreadPool* pool) {
+    float invH = 1.0f / h;
+
+    forEachVertexChunk(pool, [p, invH](int begin, int end) {
+        for(int i = begin; i < end; i++) {
+            if(p->invMass[i] != 0.0f) {
+                p->vx[i] = (p->px[i] - p->ox[i]) * invH;
+                p->vy[i] = (p->py[i] - p->oy[i]) * invH;
+                p->vz[i] = (p->pz[i] - p->oz[i]) * invH;
+            }
+        }
+    });
+}
+
+//****************************************************
+// Step:
+//      - Predicts, runs up to iterations sweeps (fewer
+//        once the residual is within tolerance), then
+//        derives velocities from the motion
+//****************************************************
+void XPBDSolver::step(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool) {
+    prepare(p->size(), springs.size());
+    residuals.clear();
+
+    predict(p, h, pool);
+
+    for(int it = 0; it < iterations; it++) {
+        project(p, springs, h, pool);
+        residuals.push_back(residual(pool));
+
+        if(residualTolerance > 0.0f && residuals.back() <= residualTolerance) {
+            break;
+        }
+    }
+
+    updateVelocities(p, h, pool);
+}
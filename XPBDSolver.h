@@ -0,0 +1,85 @@
+#ifndef XPBDSOLVER_H
+#define XPBDSOLVER_H
+
+#include <vector>
+#include <functional>
+#include "ParticleStore.h"
+#include "Spring.h"
+#include "ThreadPool.h"
+
+//****************************************************
+// XPBD Solver Header Definition
+//      - Extended Position Based Dynamics after
+//        Macklin, Mueller & Chentanez, "XPBD:
+//        Position-Based Simulation of Compliant
+//        Constrained Dynamics"
+//      - Every spring is a distance constraint
+//        C = |x_a - x_b| - L with compliance alpha:
+//          dlambda = (-C - alpha~ lambda) / (w_a + w_b + alpha~)
+//          alpha~ = alpha / h^2
+//        so stiffness no longer depends on the
+//        timestep or the iteration count
+//      - Compliance is set per family, per unit of
+//        rest length: alpha = compliance * L, the
+//        inverse of the table's UNIT_SPRING / L
+//      - Gauss-Seidel over the color groups: springs of
+//        a group share no particle, so each group is
+//        split across threads, always in table order
+//****************************************************
+
+class XPBDSolver {
+  private:
+    int numVertices;
+    int numSprings;
+
+    // Compliance per unit rest length of each family, 0 = inextensible
+    float compliance[NUM_SPRING_TYPES];
+
+    int iterations;
+    float residualTolerance;
+
+    // Accumulated multiplier of each spring for the current step
+    std::vector<float> lambda;
+
+    // |C + alpha~ lambda| of each spring before its last projection
+    std::vector<float> constraintError;
+
+    // Fixed size partial sums, so residuals do not depend on the thread count
+    std::vector<double> partials;
+
+    // RMS residual after each iteration of the last step
+    std::vector<float> residuals;
+
+    void prepare(int nv, int ns);
+
+    void predict(ParticleStore* p, float h, ThreadPool* pool);
+    void project(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool);
+    void updateVelocities(ParticleStore* p, float h, ThreadPool* pool);
+    float residual(ThreadPool* pool);
+
+    // Parallel Helpers, pool may be NULL
+    void forEachVertexChunk(ThreadPool* pool, const std::function<void(int, int)>& body);
+    void forEachSpringBlock(ThreadPool* pool, const std::function<void(int, int)>& body);
+
+  public:
+    XPBDSolver();
+
+    // Advances p by h; forces must already hold every external force, springs are solved here
+    void step(ParticleStore* p, const SpringTable& springs, float h, ThreadPool* pool);
+
+    // Solve Settings
+    void setCompliance(SpringType type, float c) { compliance[type] = c; };
+    float getCompliance(SpringType type) { return compliance[type]; };
+
+    // Iterations per step; a residual tolerance > 0 may stop earlier
+    void setIterations(int n) { iterations = n; };
+    int getIterations() { return iterations; };
+    void setResidualTolerance(float tol) { residualTolerance = tol; };
+    float getResidualTolerance() { return residualTolerance; };
+
+    // Stats of the last step
+    const std::vector<float>& getResiduals() { return residuals; };
+    int getLastIterations() { return (int) residuals.size(); };
+};
+
+#endif